@@ -12,6 +12,32 @@
 #include <gio/gunixinputstream.h>
 #endif
 
+/* the synchronous getters cannot rely on the signals being processed */
+#define FWUPD_CLIENT_CACHE_SYNC_MAX_AGE		G_USEC_PER_SEC
+
+gboolean	 fwupd_client_is_connected		(FwupdClient	*self);
+GVariant	*fwupd_client_call_sync			(FwupdClient	*self,
+							 const gchar	*method,
+							 GVariant	*parameters,
+							 GCancellable	*cancellable,
+							 GError		**error);
+FwupdDevice	*fwupd_client_device_array_get_by_id	(GPtrArray	*devices,
+							 const gchar	*device_id,
+							 GError		**error);
+GPtrArray	*fwupd_client_device_array_get_by_guid	(GPtrArray	*devices,
+							 const gchar	*guid,
+							 GError		**error);
+guint		 fwupd_client_cache_get_generation	(FwupdClient	*self);
+GPtrArray	*fwupd_client_cache_get_devices		(FwupdClient	*self,
+							 gint64		 max_age);
+GPtrArray	*fwupd_client_cache_get_remotes		(FwupdClient	*self,
+							 gint64		 max_age);
+void		 fwupd_client_cache_set_devices		(FwupdClient	*self,
+							 guint		 generation,
+							 GPtrArray	*devices);
+void		 fwupd_client_cache_set_remotes		(FwupdClient	*self,
+							 guint		 generation,
+							 GPtrArray	*remotes);
 void		 fwupd_client_download_bytes2_async	(FwupdClient	*self,
 							 GPtrArray	*urls,
 							 FwupdClientDownloadFlags flags,
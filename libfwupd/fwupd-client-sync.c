@@ -14,7 +14,11 @@
 #include "fwupd-client-private.h"
 #include "fwupd-client-sync.h"
 #include "fwupd-common-private.h"
+#include "fwupd-device.h"
 #include "fwupd-error.h"
+#include "fwupd-plugin.h"
+#include "fwupd-remote.h"
+#include "fwupd-security-attr.h"
 
 typedef struct {
 	gboolean	 ret;
@@ -98,6 +102,10 @@ fwupd_client_connect (FwupdClient *self, GCancellable *cancellable, GError **err
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
+	/* already connected, so avoid the main loop */
+	if (fwupd_client_is_connected (self))
+		return TRUE;
+
 	/* call async version and run loop until complete */
 	helper = fwupd_client_helper_new (self);
 	fwupd_client_connect_async (self, cancellable, fwupd_client_connect_cb, helper);
@@ -109,14 +117,6 @@ fwupd_client_connect (FwupdClient *self, GCancellable *cancellable, GError **err
 	return TRUE;
 }
 
-static void
-fwupd_client_get_devices_cb (GObject *source, GAsyncResult *res, gpointer user_data)
-{
-	FwupdClientHelper *helper = (FwupdClientHelper *) user_data;
-	helper->array = fwupd_client_get_devices_finish (FWUPD_CLIENT (source), res, &helper->error);
-	g_main_loop_quit (helper->loop);
-}
-
 /**
  * fwupd_client_get_devices:
  * @self: a #FwupdClient
@@ -132,7 +132,9 @@ fwupd_client_get_devices_cb (GObject *source, GAsyncResult *res, gpointer user_d
 GPtrArray *
 fwupd_client_get_devices (FwupdClient *self, GCancellable *cancellable, GError **error)
 {
-	g_autoptr(FwupdClientHelper) helper = NULL;
+	GPtrArray *devices;
+	guint generation;
+	g_autoptr(GVariant) val = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (self), NULL);
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
@@ -142,24 +144,20 @@ fwupd_client_get_devices (FwupdClient *self, GCancellable *cancellable, GError *
 	if (!fwupd_client_connect (self, cancellable, error))
 		return NULL;
 
-	/* call async version and run loop until complete */
-	helper = fwupd_client_helper_new (self);
-	fwupd_client_get_devices_async (self, cancellable,
-					fwupd_client_get_devices_cb, helper);
-	g_main_loop_run (helper->loop);
-	if (helper->array == NULL) {
-		g_propagate_error (error, g_steal_pointer (&helper->error));
-		return NULL;
-	}
-	return g_steal_pointer (&helper->array);
-}
+	/* use the cache if enabled, but only if recent as the signals that
+	 * invalidate it may be waiting in a main context nobody is running */
+	generation = fwupd_client_cache_get_generation (self);
+	devices = fwupd_client_cache_get_devices (self, FWUPD_CLIENT_CACHE_SYNC_MAX_AGE);
+	if (devices != NULL)
+		return devices;
 
-static void
-fwupd_client_get_plugins_cb (GObject *source, GAsyncResult *res, gpointer user_data)
-{
-	FwupdClientHelper *helper = (FwupdClientHelper *) user_data;
-	helper->array = fwupd_client_get_plugins_finish (FWUPD_CLIENT (source), res, &helper->error);
-	g_main_loop_quit (helper->loop);
+	/* call into daemon directly, without a main loop */
+	val = fwupd_client_call_sync (self, "GetDevices", NULL, cancellable, error);
+	if (val == NULL)
+		return NULL;
+	devices = fwupd_device_array_from_variant (val);
+	fwupd_client_cache_set_devices (self, generation, devices);
+	return devices;
 }
 
 /**
@@ -177,7 +175,7 @@ fwupd_client_get_plugins_cb (GObject *source, GAsyncResult *res, gpointer user_d
 GPtrArray *
 fwupd_client_get_plugins (FwupdClient *self, GCancellable *cancellable, GError **error)
 {
-	g_autoptr(FwupdClientHelper) helper = NULL;
+	g_autoptr(GVariant) val = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (self), NULL);
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
@@ -187,24 +185,11 @@ fwupd_client_get_plugins (FwupdClient *self, GCancellable *cancellable, GError *
 	if (!fwupd_client_connect (self, cancellable, error))
 		return NULL;
 
-	/* call async version and run loop until complete */
-	helper = fwupd_client_helper_new (self);
-	fwupd_client_get_plugins_async (self, cancellable,
-					fwupd_client_get_plugins_cb, helper);
-	g_main_loop_run (helper->loop);
-	if (helper->array == NULL) {
-		g_propagate_error (error, g_steal_pointer (&helper->error));
+	/* call into daemon directly, without a main loop */
+	val = fwupd_client_call_sync (self, "GetPlugins", NULL, cancellable, error);
+	if (val == NULL)
 		return NULL;
-	}
-	return g_steal_pointer (&helper->array);
-}
-
-static void
-fwupd_client_get_history_cb (GObject *source, GAsyncResult *res, gpointer user_data)
-{
-	FwupdClientHelper *helper = (FwupdClientHelper *) user_data;
-	helper->array = fwupd_client_get_history_finish (FWUPD_CLIENT (source), res, &helper->error);
-	g_main_loop_quit (helper->loop);
+	return fwupd_plugin_array_from_variant (val);
 }
 
 /**
@@ -222,7 +207,7 @@ fwupd_client_get_history_cb (GObject *source, GAsyncResult *res, gpointer user_d
 GPtrArray *
 fwupd_client_get_history (FwupdClient *self, GCancellable *cancellable, GError **error)
 {
-	g_autoptr(FwupdClientHelper) helper = NULL;
+	g_autoptr(GVariant) val = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (self), NULL);
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
@@ -232,16 +217,11 @@ fwupd_client_get_history (FwupdClient *self, GCancellable *cancellable, GError *
 	if (!fwupd_client_connect (self, cancellable, error))
 		return NULL;
 
-	/* call async version and run loop until complete */
-	helper = fwupd_client_helper_new (self);
-	fwupd_client_get_history_async (self, cancellable,
-					fwupd_client_get_history_cb, helper);
-	g_main_loop_run (helper->loop);
-	if (helper->array == NULL) {
-		g_propagate_error (error, g_steal_pointer (&helper->error));
+	/* call into daemon directly, without a main loop */
+	val = fwupd_client_call_sync (self, "GetHistory", NULL, cancellable, error);
+	if (val == NULL)
 		return NULL;
-	}
-	return g_steal_pointer (&helper->array);
+	return fwupd_device_array_from_variant (val);
 }
 
 static void
@@ -866,14 +846,6 @@ fwupd_client_get_results (FwupdClient *self, const gchar *device_id,
 	return g_steal_pointer (&helper->device);
 }
 
-static void
-fwupd_client_get_host_security_attrs_cb (GObject *source, GAsyncResult *res, gpointer user_data)
-{
-	FwupdClientHelper *helper = (FwupdClientHelper *) user_data;
-	helper->array = fwupd_client_get_host_security_attrs_finish (FWUPD_CLIENT (source), res, &helper->error);
-	g_main_loop_quit (helper->loop);
-}
-
 /**
  * fwupd_client_get_host_security_attrs:
  * @self: a #FwupdClient
@@ -891,7 +863,7 @@ fwupd_client_get_host_security_attrs (FwupdClient *self,
 				      GCancellable *cancellable,
 				      GError **error)
 {
-	g_autoptr(FwupdClientHelper) helper = NULL;
+	g_autoptr(GVariant) val = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (self), NULL);
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
@@ -901,25 +873,11 @@ fwupd_client_get_host_security_attrs (FwupdClient *self,
 	if (!fwupd_client_connect (self, cancellable, error))
 		return NULL;
 
-	/* call async version and run loop until complete */
-	helper = fwupd_client_helper_new (self);
-	fwupd_client_get_host_security_attrs_async (self, cancellable,
-						    fwupd_client_get_host_security_attrs_cb,
-						    helper);
-	g_main_loop_run (helper->loop);
-	if (helper->array == NULL) {
-		g_propagate_error (error, g_steal_pointer (&helper->error));
+	/* call into daemon directly, without a main loop */
+	val = fwupd_client_call_sync (self, "GetHostSecurityAttrs", NULL, cancellable, error);
+	if (val == NULL)
 		return NULL;
-	}
-	return g_steal_pointer (&helper->array);
-}
-
-static void
-fwupd_client_get_device_by_id_cb (GObject *source, GAsyncResult *res, gpointer user_data)
-{
-	FwupdClientHelper *helper = (FwupdClientHelper *) user_data;
-	helper->device = fwupd_client_get_device_by_id_finish (FWUPD_CLIENT (source), res, &helper->error);
-	g_main_loop_quit (helper->loop);
+	return fwupd_security_attr_array_from_variant (val);
 }
 
 /**
@@ -941,36 +899,18 @@ fwupd_client_get_device_by_id (FwupdClient *self,
 			       GCancellable *cancellable,
 			       GError **error)
 {
-	g_autoptr(FwupdClientHelper) helper = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (self), NULL);
 	g_return_val_if_fail (device_id != NULL, NULL);
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	/* connect */
-	if (!fwupd_client_connect (self, cancellable, error))
-		return NULL;
-
-	/* call async version and run loop until complete */
-	helper = fwupd_client_helper_new (self);
-	fwupd_client_get_device_by_id_async (self, device_id, cancellable,
-					     fwupd_client_get_device_by_id_cb,
-					     helper);
-	g_main_loop_run (helper->loop);
-	if (helper->device == NULL) {
-		g_propagate_error (error, g_steal_pointer (&helper->error));
+	/* filter all the devices */
+	devices = fwupd_client_get_devices (self, cancellable, error);
+	if (devices == NULL)
 		return NULL;
-	}
-	return g_steal_pointer (&helper->device);
-}
-
-static void
-fwupd_client_get_devices_by_guid_cb (GObject *source, GAsyncResult *res, gpointer user_data)
-{
-	FwupdClientHelper *helper = (FwupdClientHelper *) user_data;
-	helper->array = fwupd_client_get_devices_by_guid_finish (FWUPD_CLIENT (source), res, &helper->error);
-	g_main_loop_quit (helper->loop);
+	return fwupd_client_device_array_get_by_id (devices, device_id, error);
 }
 
 /**
@@ -991,28 +931,18 @@ GPtrArray *
 fwupd_client_get_devices_by_guid (FwupdClient *self, const gchar *guid,
 				  GCancellable *cancellable, GError **error)
 {
-	g_autoptr(FwupdClientHelper) helper = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (self), NULL);
 	g_return_val_if_fail (guid != NULL, NULL);
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	/* connect */
-	if (!fwupd_client_connect (self, cancellable, error))
+	/* filter all the devices */
+	devices = fwupd_client_get_devices (self, cancellable, error);
+	if (devices == NULL)
 		return NULL;
-
-	/* call async version and run loop until complete */
-	helper = fwupd_client_helper_new (self);
-	fwupd_client_get_devices_by_guid_async (self, guid, cancellable,
-						fwupd_client_get_devices_by_guid_cb,
-						helper);
-	g_main_loop_run (helper->loop);
-	if (helper->array == NULL) {
-		g_propagate_error (error, g_steal_pointer (&helper->error));
-		return NULL;
-	}
-	return g_steal_pointer (&helper->array);
+	return fwupd_client_device_array_get_by_guid (devices, guid, error);
 }
 
 #ifdef HAVE_GIO_UNIX
@@ -1427,6 +1357,56 @@ fwupd_client_refresh_remote (FwupdClient *self,
 	return TRUE;
 }
 
+static void
+fwupd_client_refresh_remotes_cb (GObject *source,
+				 GAsyncResult *res,
+				 gpointer user_data)
+{
+	FwupdClientHelper *helper = (FwupdClientHelper *) user_data;
+	helper->ret = fwupd_client_refresh_remotes_finish (FWUPD_CLIENT (source),
+							   res, &helper->error);
+	g_main_loop_quit (helper->loop);
+}
+
+/**
+ * fwupd_client_refresh_remotes:
+ * @self: a #FwupdClient
+ * @remotes: (element-type FwupdRemote): remotes
+ * @cancellable: (nullable): optional #GCancellable
+ * @error: (nullable): optional return location for an error
+ *
+ * Refreshes all the enabled download remotes in @remotes at the same time.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fwupd_client_refresh_remotes (FwupdClient *self,
+			      GPtrArray *remotes,
+			      GCancellable *cancellable,
+			      GError **error)
+{
+	g_autoptr(FwupdClientHelper) helper = NULL;
+
+	g_return_val_if_fail (FWUPD_IS_CLIENT (self), FALSE);
+	g_return_val_if_fail (remotes != NULL, FALSE);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* call async version and run loop until complete */
+	helper = fwupd_client_helper_new (self);
+	fwupd_client_refresh_remotes_async (self, remotes, cancellable,
+					    fwupd_client_refresh_remotes_cb,
+					    helper);
+	g_main_loop_run (helper->loop);
+	if (!helper->ret) {
+		g_propagate_error (error, g_steal_pointer (&helper->error));
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static void
 fwupd_client_modify_remote_cb (GObject *source, GAsyncResult *res, gpointer user_data)
 {
@@ -1596,14 +1576,6 @@ fwupd_client_modify_device (FwupdClient *self,
 	return TRUE;
 }
 
-static void
-fwupd_client_get_remotes_cb (GObject *source, GAsyncResult *res, gpointer user_data)
-{
-	FwupdClientHelper *helper = (FwupdClientHelper *) user_data;
-	helper->array = fwupd_client_get_remotes_finish (FWUPD_CLIENT (source), res, &helper->error);
-	g_main_loop_quit (helper->loop);
-}
-
 /**
  * fwupd_client_get_remotes:
  * @self: a #FwupdClient
@@ -1619,7 +1591,9 @@ fwupd_client_get_remotes_cb (GObject *source, GAsyncResult *res, gpointer user_d
 GPtrArray *
 fwupd_client_get_remotes (FwupdClient *self, GCancellable *cancellable, GError **error)
 {
-	g_autoptr(FwupdClientHelper) helper = NULL;
+	GPtrArray *remotes;
+	guint generation;
+	g_autoptr(GVariant) val = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_CLIENT (self), NULL);
 	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), NULL);
@@ -1629,16 +1603,20 @@ fwupd_client_get_remotes (FwupdClient *self, GCancellable *cancellable, GError *
 	if (!fwupd_client_connect (self, cancellable, error))
 		return NULL;
 
-	/* call async version and run loop until complete */
-	helper = fwupd_client_helper_new (self);
-	fwupd_client_get_remotes_async (self, cancellable,
-					fwupd_client_get_remotes_cb, helper);
-	g_main_loop_run (helper->loop);
-	if (helper->array == NULL) {
-		g_propagate_error (error, g_steal_pointer (&helper->error));
+	/* use the cache if enabled, but only if recent as the signals that
+	 * invalidate it may be waiting in a main context nobody is running */
+	generation = fwupd_client_cache_get_generation (self);
+	remotes = fwupd_client_cache_get_remotes (self, FWUPD_CLIENT_CACHE_SYNC_MAX_AGE);
+	if (remotes != NULL)
+		return remotes;
+
+	/* call into daemon directly, without a main loop */
+	val = fwupd_client_call_sync (self, "GetRemotes", NULL, cancellable, error);
+	if (val == NULL)
 		return NULL;
-	}
-	return g_steal_pointer (&helper->array);
+	remotes = fwupd_remote_array_from_variant (val);
+	fwupd_client_cache_set_remotes (self, generation, remotes);
+	return remotes;
 }
 
 static FwupdRemote *
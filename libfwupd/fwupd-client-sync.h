@@ -149,6 +149,11 @@ gboolean	 fwupd_client_refresh_remote		(FwupdClient	*self,
 							 GCancellable	*cancellable,
 							 GError		**error)
 							 G_GNUC_WARN_UNUSED_RESULT;
+gboolean	 fwupd_client_refresh_remotes		(FwupdClient	*self,
+							 GPtrArray	*remotes,
+							 GCancellable	*cancellable,
+							 GError		**error)
+							 G_GNUC_WARN_UNUSED_RESULT;
 gboolean	 fwupd_client_modify_remote		(FwupdClient	*self,
 							 const gchar	*remote_id,
 							 const gchar	*key,
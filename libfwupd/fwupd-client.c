@@ -8,6 +8,7 @@
 
 #include <glib-object.h>
 #include <gio/gio.h>
+#include <glib/gstdio.h>
 #include <gmodule.h>
 #ifdef HAVE_LIBCURL
 #include <curl/curl.h>
@@ -16,10 +17,13 @@
 #include <gio/gunixfdlist.h>
 #endif
 
+#include <errno.h>
 #include <fcntl.h>
+#include <stdio.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
 
 #include "fwupd-client-private.h"
 #include "fwupd-client-sync.h"
@@ -35,6 +39,12 @@
 
 typedef GObject		*(*FwupdClientObjectNewFunc)	(void);
 
+#define FWUPD_CLIENT_DOWNLOAD_CACHE_MAX_SIZE	(512 * 1024 * 1024) /* bytes */
+#define FWUPD_CLIENT_DOWNLOAD_RANGED_MIN_SIZE	(4 * 1024 * 1024) /* bytes */
+#define FWUPD_CLIENT_DOWNLOAD_RANGED_MAX	4 /* parallel transfers */
+#define FWUPD_CLIENT_DOWNLOAD_RANGED_MAX_SIZE	(512 * 1024 * 1024) /* bytes */
+#define FWUPD_CLIENT_VALIDATORS_GROUP		"fwupd Validators"
+
 /**
  * FwupdClient:
  *
@@ -62,6 +72,14 @@ typedef struct {
 	GDBusProxy			*proxy;
 	GProxyResolver			*proxy_resolver;
 	gchar				*user_agent;
+	guint64				 download_speed;	/* bytes/s */
+	GMutex				 cache_mutex;	/* for @cache_generation and the @cache_* arrays */
+	gboolean			 cache_enabled;
+	guint				 cache_generation;
+	GPtrArray			*cache_devices;	/* (nullable) (element-type FwupdDevice) */
+	GPtrArray			*cache_remotes;	/* (nullable) (element-type FwupdRemote) */
+	gint64				 cache_devices_time;	/* monotonic */
+	gint64				 cache_remotes_time;	/* monotonic */
 #ifdef SOUP_SESSION_COMPAT
 	GObject				*soup_session;
 	GModule				*soup_module;	/* we leak this */
@@ -97,6 +115,7 @@ enum {
 	PROP_HOST_MACHINE_ID,
 	PROP_HOST_SECURITY_ID,
 	PROP_INTERACTIVE,
+	PROP_DOWNLOAD_SPEED,
 	PROP_LAST
 };
 
@@ -390,6 +409,119 @@ fwupd_client_properties_changed_cb (GDBusProxy *proxy,
 	}
 }
 
+static GPtrArray *
+fwupd_client_cache_array_copy (GPtrArray *array)
+{
+	GPtrArray *array_new = g_ptr_array_new_full (array->len, (GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < array->len; i++)
+		g_ptr_array_add (array_new, g_object_ref (g_ptr_array_index (array, i)));
+	return array_new;
+}
+
+/* called before asking the daemon, so that results can be dropped if a
+ * signal arrives while the method call is in flight */
+guint
+fwupd_client_cache_get_generation (FwupdClient *self)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->cache_mutex);
+	g_assert (locker != NULL);
+	return priv->cache_generation;
+}
+
+/* the signals that invalidate the cache are only processed when the main
+ * context is running, so callers that cannot rely on that use a @max_age in
+ * microseconds, or 0 for no limit */
+static gboolean
+fwupd_client_cache_is_fresh (gint64 created, gint64 max_age)
+{
+	if (max_age == 0)
+		return TRUE;
+	return g_get_monotonic_time () - created < max_age;
+}
+
+GPtrArray *
+fwupd_client_cache_get_devices (FwupdClient *self, gint64 max_age)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->cache_mutex);
+	g_assert (locker != NULL);
+	if (priv->cache_devices == NULL)
+		return NULL;
+	if (!fwupd_client_cache_is_fresh (priv->cache_devices_time, max_age))
+		return NULL;
+	return fwupd_client_cache_array_copy (priv->cache_devices);
+}
+
+GPtrArray *
+fwupd_client_cache_get_remotes (FwupdClient *self, gint64 max_age)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->cache_mutex);
+	g_assert (locker != NULL);
+	if (priv->cache_remotes == NULL)
+		return NULL;
+	if (!fwupd_client_cache_is_fresh (priv->cache_remotes_time, max_age))
+		return NULL;
+	return fwupd_client_cache_array_copy (priv->cache_remotes);
+}
+
+void
+fwupd_client_cache_set_devices (FwupdClient *self, guint generation, GPtrArray *devices)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->cache_mutex);
+	g_assert (locker != NULL);
+	if (!priv->cache_enabled || priv->cache_generation != generation)
+		return;
+	g_clear_pointer (&priv->cache_devices, g_ptr_array_unref);
+	priv->cache_devices = fwupd_client_cache_array_copy (devices);
+	priv->cache_devices_time = g_get_monotonic_time ();
+}
+
+void
+fwupd_client_cache_set_remotes (FwupdClient *self, guint generation, GPtrArray *remotes)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->cache_mutex);
+	g_assert (locker != NULL);
+	if (!priv->cache_enabled || priv->cache_generation != generation)
+		return;
+	g_clear_pointer (&priv->cache_remotes, g_ptr_array_unref);
+	priv->cache_remotes = fwupd_client_cache_array_copy (remotes);
+	priv->cache_remotes_time = g_get_monotonic_time ();
+}
+
+static void
+fwupd_client_cache_invalidate (FwupdClient *self)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->cache_mutex);
+	g_assert (locker != NULL);
+	priv->cache_generation++;
+	g_clear_pointer (&priv->cache_devices, g_ptr_array_unref);
+	g_clear_pointer (&priv->cache_remotes, g_ptr_array_unref);
+}
+
+/* the signals use a different serialization to GetDevices, e.g. without the
+ * serial number and instance IDs, and do not include the device parents */
+static void
+fwupd_client_cache_invalidate_devices (FwupdClient *self)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->cache_mutex);
+	g_assert (locker != NULL);
+	priv->cache_generation++;
+	g_clear_pointer (&priv->cache_devices, g_ptr_array_unref);
+}
+
+static void
+fwupd_client_name_owner_changed_cb (GDBusProxy *proxy, GParamSpec *pspec, FwupdClient *self)
+{
+	/* the daemon restarted or went away */
+	fwupd_client_cache_invalidate (self);
+}
+
 static void
 fwupd_client_signal_cb (GDBusProxy *proxy,
 			const gchar *sender_name,
@@ -399,12 +531,22 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 {
 	g_autoptr(FwupdDevice) dev = NULL;
 	if (g_strcmp0 (signal_name, "Changed") == 0) {
+		FwupdClientPrivate *priv = GET_PRIVATE (self);
+		g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->cache_mutex);
+
+		/* remotes have no finer-grained signal, devices are handled below */
+		g_assert (locker != NULL);
+		priv->cache_generation++;
+		g_clear_pointer (&priv->cache_remotes, g_ptr_array_unref);
+		g_clear_pointer (&locker, g_mutex_locker_free);
+
 		g_debug ("Emitting ::changed()");
 		g_signal_emit (self, signals[SIGNAL_CHANGED], 0);
 		return;
 	}
 	if (g_strcmp0 (signal_name, "DeviceAdded") == 0) {
 		dev = fwupd_device_from_variant (parameters);
+		fwupd_client_cache_invalidate_devices (self);
 		g_debug ("Emitting ::device-added(%s)",
 			 fwupd_device_get_id (dev));
 		fwupd_client_signal_emit_device (self, SIGNAL_DEVICE_ADDED, dev);
@@ -412,6 +554,7 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 	}
 	if (g_strcmp0 (signal_name, "DeviceRemoved") == 0) {
 		dev = fwupd_device_from_variant (parameters);
+		fwupd_client_cache_invalidate_devices (self);
 		g_debug ("Emitting ::device-removed(%s)",
 			 fwupd_device_get_id (dev));
 		fwupd_client_signal_emit_device (self, SIGNAL_DEVICE_REMOVED, dev);
@@ -419,6 +562,7 @@ fwupd_client_signal_cb (GDBusProxy *proxy,
 	}
 	if (g_strcmp0 (signal_name, "DeviceChanged") == 0) {
 		dev = fwupd_device_from_variant (parameters);
+		fwupd_client_cache_invalidate_devices (self);
 		g_debug ("Emitting ::device-changed(%s)",
 			 fwupd_device_get_id (dev));
 		fwupd_client_signal_emit_device (self, SIGNAL_DEVICE_CHANGED, dev);
@@ -467,6 +611,66 @@ fwupd_client_set_main_context (FwupdClient *self, GMainContext *main_ctx)
 		priv->main_ctx = g_main_context_ref (main_ctx);
 }
 
+/**
+ * fwupd_client_get_cache_enabled:
+ * @self: a #FwupdClient
+ *
+ * Gets if the client-side device and remote cache is enabled.
+ *
+ * Returns: %TRUE if enabled
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fwupd_client_get_cache_enabled (FwupdClient *self)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GMutexLocker) locker = NULL;
+	g_return_val_if_fail (FWUPD_IS_CLIENT (self), FALSE);
+	locker = g_mutex_locker_new (&priv->cache_mutex);
+	g_assert (locker != NULL);
+	return priv->cache_enabled;
+}
+
+/**
+ * fwupd_client_set_cache_enabled:
+ * @self: a #FwupdClient
+ * @cache_enabled: %TRUE to enable the cache
+ *
+ * Enables a client-side cache of the devices and remotes. The cache is
+ * populated by the first call to [method@Client.get_devices_async] or
+ * [method@Client.get_remotes_async] and is then dropped when the daemon
+ * signals that a device or remote has changed, so repeated calls do not need
+ * to ask the daemon.
+ *
+ * The signals are dispatched in the #GMainContext that was the thread-default
+ * when [method@Client.connect_async] was called, and so that context must be
+ * running for the cache to stay coherent. The synchronous getters do not
+ * iterate that context, and so they only use results that were cached in the
+ * last second.
+ *
+ * The objects returned from the cache are shared and must not be modified.
+ *
+ * Since: 1.6.2
+ **/
+void
+fwupd_client_set_cache_enabled (FwupdClient *self, gboolean cache_enabled)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GMutexLocker) locker = NULL;
+
+	g_return_if_fail (FWUPD_IS_CLIENT (self));
+
+	locker = g_mutex_locker_new (&priv->cache_mutex);
+	g_assert (locker != NULL);
+	if (priv->cache_enabled == cache_enabled)
+		return;
+	priv->cache_enabled = cache_enabled;
+	priv->cache_generation++;
+	g_clear_pointer (&priv->cache_devices, g_ptr_array_unref);
+	g_clear_pointer (&priv->cache_remotes, g_ptr_array_unref);
+}
+
 /**
  * fwupd_client_ensure_networking:
  * @self: a #FwupdClient
@@ -634,6 +838,8 @@ fwupd_client_connect_get_proxy_cb (GObject *source,
 			  G_CALLBACK (fwupd_client_properties_changed_cb), self);
 	g_signal_connect (priv->proxy, "g-signal",
 			  G_CALLBACK (fwupd_client_signal_cb), self);
+	g_signal_connect (priv->proxy, "notify::g-name-owner",
+			  G_CALLBACK (fwupd_client_name_owner_changed_cb), self);
 	val = g_dbus_proxy_get_cached_property (priv->proxy, "DaemonVersion");
 	if (val != NULL)
 		fwupd_client_set_daemon_version (self, g_variant_get_string (val, NULL));
@@ -759,6 +965,93 @@ fwupd_client_fixup_dbus_error (GError *error)
 	g_dbus_error_strip_remote_error (error);
 }
 
+/* used by the synchronous methods to avoid spinning a nested loop */
+gboolean
+fwupd_client_is_connected (FwupdClient *self)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->proxy_mutex);
+	g_assert (locker != NULL);
+	return priv->proxy != NULL;
+}
+
+/* this is safe to call from any thread, as #GDBusProxy is threadsafe */
+GVariant *
+fwupd_client_call_sync (FwupdClient *self,
+			const gchar *method,
+			GVariant *parameters,
+			GCancellable *cancellable,
+			GError **error)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	GVariant *val;
+	g_autoptr(GDBusProxy) proxy = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&priv->proxy_mutex);
+
+	g_assert (locker != NULL);
+	if (priv->proxy == NULL) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "not connected to daemon");
+		return NULL;
+	}
+	proxy = g_object_ref (priv->proxy);
+	g_clear_pointer (&locker, g_mutex_locker_free);
+
+	val = g_dbus_proxy_call_sync (proxy, method, parameters,
+				      G_DBUS_CALL_FLAGS_NONE,
+				      -1, cancellable, &error_local);
+	if (val == NULL) {
+		fwupd_client_fixup_dbus_error (error_local);
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return NULL;
+	}
+	return val;
+}
+
+/* find the device by ID (client side) */
+FwupdDevice *
+fwupd_client_device_array_get_by_id (GPtrArray *devices,
+				     const gchar *device_id,
+				     GError **error)
+{
+	for (guint i = 0; i < devices->len; i++) {
+		FwupdDevice *dev = g_ptr_array_index (devices, i);
+		if (g_strcmp0 (fwupd_device_get_id (dev), device_id) == 0)
+			return g_object_ref (dev);
+	}
+	g_set_error (error,
+		     FWUPD_ERROR,
+		     FWUPD_ERROR_NOT_FOUND,
+		     "failed to find %s", device_id);
+	return NULL;
+}
+
+/* find the devices by GUID (client side) */
+GPtrArray *
+fwupd_client_device_array_get_by_guid (GPtrArray *devices,
+				       const gchar *guid,
+				       GError **error)
+{
+	g_autoptr(GPtrArray) devices_tmp = NULL;
+	devices_tmp = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	for (guint i = 0; i < devices->len; i++) {
+		FwupdDevice *dev_tmp = g_ptr_array_index (devices, i);
+		if (fwupd_device_has_guid (dev_tmp, guid))
+			g_ptr_array_add (devices_tmp, g_object_ref (dev_tmp));
+	}
+	if (devices_tmp->len == 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "failed to find any device providing %s", guid);
+		return NULL;
+	}
+	return g_steal_pointer (&devices_tmp);
+}
+
 static void
 fwupd_client_get_host_security_attrs_cb (GObject *source,
 					 GAsyncResult *res,
@@ -946,8 +1239,11 @@ fwupd_client_get_devices_cb (GObject *source,
 			     gpointer user_data)
 {
 	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClient *self = g_task_get_source_object (task);
+	guint generation = GPOINTER_TO_UINT (g_task_get_task_data (task));
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GVariant) val = NULL;
+	GPtrArray *devices;
 
 	val = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
 	if (val == NULL) {
@@ -957,9 +1253,9 @@ fwupd_client_get_devices_cb (GObject *source,
 	}
 
 	/* success */
-	g_task_return_pointer (task,
-			       fwupd_device_array_from_variant (val),
-			       (GDestroyNotify) g_ptr_array_unref);
+	devices = fwupd_device_array_from_variant (val);
+	fwupd_client_cache_set_devices (self, generation, devices);
+	g_task_return_pointer (task, devices, (GDestroyNotify) g_ptr_array_unref);
 }
 
 /**
@@ -981,14 +1277,27 @@ fwupd_client_get_devices_async (FwupdClient *self, GCancellable *cancellable,
 				GAsyncReadyCallback callback, gpointer callback_data)
 {
 	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GPtrArray) devices = NULL;
 	g_autoptr(GTask) task = NULL;
 
 	g_return_if_fail (FWUPD_IS_CLIENT (self));
 	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
 	g_return_if_fail (priv->proxy != NULL);
 
-	/* call into daemon */
+	/* use the cache if enabled */
 	task = g_task_new (self, cancellable, callback, callback_data);
+	g_task_set_task_data (task,
+			      GUINT_TO_POINTER (fwupd_client_cache_get_generation (self)),
+			      NULL);
+	devices = fwupd_client_cache_get_devices (self, 0);
+	if (devices != NULL) {
+		g_task_return_pointer (task,
+				       g_steal_pointer (&devices),
+				       (GDestroyNotify) g_ptr_array_unref);
+		return;
+	}
+
+	/* call into daemon */
 	g_dbus_proxy_call (priv->proxy, "GetDevices",
 			   NULL, G_DBUS_CALL_FLAGS_NONE,
 			   -1, cancellable,
@@ -1179,6 +1488,7 @@ fwupd_client_get_device_by_id_cb (GObject *source,
 	g_autoptr(GTask) task = G_TASK (user_data);
 	g_autoptr(GError) error = NULL;
 	g_autoptr(GPtrArray) devices = NULL;
+	FwupdDevice *dev;
 	const gchar *device_id = g_task_get_task_data (task);
 
 	devices = fwupd_client_get_devices_finish (FWUPD_CLIENT (source), res, &error);
@@ -1186,23 +1496,14 @@ fwupd_client_get_device_by_id_cb (GObject *source,
 		g_task_return_error (task, g_steal_pointer (&error));
 		return;
 	}
-
-	/* find the device by ID (client side) */
-	for (guint i = 0; i < devices->len; i++) {
-		FwupdDevice *dev = g_ptr_array_index (devices, i);
-		if (g_strcmp0 (fwupd_device_get_id (dev), device_id) == 0) {
-			g_task_return_pointer (task,
-					       g_object_ref (dev),
-					       (GDestroyNotify) g_object_unref);
-			return;
-		}
+	dev = fwupd_client_device_array_get_by_id (devices, device_id, &error);
+	if (dev == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
 	}
 
-	/* failed */
-	g_task_return_new_error (task,
-				 FWUPD_ERROR,
-				 FWUPD_ERROR_NOT_FOUND,
-				 "failed to find %s", device_id);
+	/* success */
+	g_task_return_pointer (task, dev, (GDestroyNotify) g_object_unref);
 }
 
 /**
@@ -1281,20 +1582,9 @@ fwupd_client_get_devices_by_guid_cb (GObject *source,
 		return;
 	}
 
-	/* find the devices by GUID (client side) */
-	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
-	for (guint i = 0; i < devices_tmp->len; i++) {
-		FwupdDevice *dev_tmp = g_ptr_array_index (devices_tmp, i);
-		if (fwupd_device_has_guid (dev_tmp, guid))
-			g_ptr_array_add (devices, g_object_ref (dev_tmp));
-	}
-
-	/* nothing */
-	if (devices->len == 0) {
-		g_task_return_new_error (task,
-					 FWUPD_ERROR,
-					 FWUPD_ERROR_NOT_FOUND,
-					 "failed to find any device providing %s", guid);
+	devices = fwupd_client_device_array_get_by_guid (devices_tmp, guid, &error);
+	if (devices == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
 		return;
 	}
 
@@ -2426,6 +2716,196 @@ fwupd_client_install_finish (FwupdClient *self, GAsyncResult *res, GError **erro
 	return g_task_propagate_boolean (G_TASK(res), error);
 }
 
+/* files downloaded by the client are kept per-user */
+static gchar *
+fwupd_client_build_cachedir (const gchar *kind, const gchar *basename)
+{
+	return g_build_filename (g_get_user_cache_dir (), "fwupd", kind, basename, NULL);
+}
+
+/* the cache is content-addressed, so the checksum is also the filename */
+static gboolean
+fwupd_client_download_cache_key_valid (const gchar *checksum)
+{
+	if (checksum == NULL || checksum[0] == '\0')
+		return FALSE;
+	for (guint i = 0; checksum[i] != '\0'; i++) {
+		if (!g_ascii_isxdigit (checksum[i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* gets a firmware archive from the per-user download cache, verifying the
+ * checksum as the file may have been corrupted on disk -- this reads the whole
+ * file and so should not be called from the main thread */
+static GBytes *
+fwupd_client_download_cache_lookup (const gchar *checksum)
+{
+	gsize bufsz = 0;
+	g_autofree gchar *buf = NULL;
+	g_autofree gchar *checksum_actual = NULL;
+	g_autofree gchar *fn = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GFile) file = NULL;
+
+	if (!fwupd_client_download_cache_key_valid (checksum))
+		return NULL;
+	fn = fwupd_client_build_cachedir ("downloads", checksum);
+	if (!g_file_get_contents (fn, &buf, &bufsz, NULL))
+		return NULL;
+
+	/* verify on read, as the file may have been corrupted on disk */
+	checksum_actual = g_compute_checksum_for_data (fwupd_checksum_guess_kind (checksum),
+						       (const guchar *) buf, bufsz);
+	if (g_strcmp0 (checksum, checksum_actual) != 0) {
+		g_debug ("cached %s was invalid, removing", fn);
+		g_unlink (fn);
+		return NULL;
+	}
+
+	/* mark as recently used */
+	file = g_file_new_for_path (fn);
+	if (!g_file_set_attribute_uint64 (file,
+					  G_FILE_ATTRIBUTE_TIME_MODIFIED,
+					  (guint64) (g_get_real_time () / G_USEC_PER_SEC),
+					  G_FILE_QUERY_INFO_NONE,
+					  NULL, &error_local))
+		g_debug ("failed to touch %s: %s", fn, error_local->message);
+	g_debug ("using cached %s", fn);
+	return g_bytes_new_take (g_steal_pointer (&buf), bufsz);
+}
+
+typedef struct {
+	gchar		*fn;
+	guint64		 size;
+	gint64		 mtime;
+} FwupdClientDownloadCacheEntry;
+
+static void
+fwupd_client_download_cache_entry_free (FwupdClientDownloadCacheEntry *entry)
+{
+	g_free (entry->fn);
+	g_free (entry);
+}
+
+static gint
+fwupd_client_download_cache_entry_sort_cb (gconstpointer a, gconstpointer b)
+{
+	FwupdClientDownloadCacheEntry *entry1 = *((FwupdClientDownloadCacheEntry **) a);
+	FwupdClientDownloadCacheEntry *entry2 = *((FwupdClientDownloadCacheEntry **) b);
+	if (entry1->mtime < entry2->mtime)
+		return -1;
+	if (entry1->mtime > entry2->mtime)
+		return 1;
+	return 0;
+}
+
+/**
+ * fwupd_client_download_cache_prune:
+ * @max_size: the maximum size of the cache in bytes, or 0 to remove everything
+ * @error: (nullable): optional return location for an error
+ *
+ * Removes the least recently used firmware archives from the download cache
+ * until it is no larger than @max_size. Partial downloads that can still be
+ * resumed are not removed.
+ *
+ * The download cache is also pruned automatically when new firmware is added.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fwupd_client_download_cache_prune (guint64 max_size, GError **error)
+{
+	const gchar *fn;
+	guint64 total = 0;
+	g_autofree gchar *cachedir = NULL;
+	g_autoptr(GDir) dir = NULL;
+	g_autoptr(GPtrArray) entries = NULL;
+
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* nothing to do */
+	cachedir = fwupd_client_build_cachedir ("downloads", NULL);
+	if (!g_file_test (cachedir, G_FILE_TEST_IS_DIR))
+		return TRUE;
+	dir = g_dir_open (cachedir, 0, error);
+	if (dir == NULL)
+		return FALSE;
+	entries = g_ptr_array_new_with_free_func ((GDestroyNotify) fwupd_client_download_cache_entry_free);
+	while ((fn = g_dir_read_name (dir)) != NULL) {
+		GStatBuf st = { 0x0 };
+		FwupdClientDownloadCacheEntry *entry;
+		g_autofree gchar *path = NULL;
+
+		/* only the archives, not the partial downloads */
+		if (!fwupd_client_download_cache_key_valid (fn))
+			continue;
+		path = g_build_filename (cachedir, fn, NULL);
+		if (g_stat (path, &st) != 0 || !S_ISREG (st.st_mode))
+			continue;
+		entry = g_new0 (FwupdClientDownloadCacheEntry, 1);
+		entry->fn = g_steal_pointer (&path);
+		entry->size = st.st_size;
+		entry->mtime = st.st_mtime;
+		total += entry->size;
+		g_ptr_array_add (entries, entry);
+	}
+
+	/* remove the oldest first */
+	g_ptr_array_sort (entries, fwupd_client_download_cache_entry_sort_cb);
+	for (guint i = 0; i < entries->len && total > max_size; i++) {
+		FwupdClientDownloadCacheEntry *entry = g_ptr_array_index (entries, i);
+		g_debug ("pruning %s", entry->fn);
+		if (g_unlink (entry->fn) != 0) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     g_io_error_from_errno (errno),
+				     "failed to remove %s: %s",
+				     entry->fn, g_strerror (errno));
+			return FALSE;
+		}
+		total -= entry->size;
+	}
+
+	/* success */
+	return TRUE;
+}
+
+/* adds a firmware archive to the per-user download cache and then removes the
+ * least recently used archives if the cache is too large -- this writes the
+ * whole file and so should not be called from the main thread */
+static void
+fwupd_client_download_cache_save (const gchar *checksum, GBytes *blob)
+{
+	g_autofree gchar *cachedir = fwupd_client_build_cachedir ("downloads", NULL);
+	g_autofree gchar *fn = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	/* the cache is only an optimization, so failures are not fatal */
+	if (!fwupd_client_download_cache_key_valid (checksum))
+		return;
+	if (g_mkdir_with_parents (cachedir, 0700) != 0) {
+		g_debug ("failed to create %s: %s", cachedir, g_strerror (errno));
+		return;
+	}
+	fn = fwupd_client_build_cachedir ("downloads", checksum);
+	if (!g_file_set_contents (fn,
+				  g_bytes_get_data (blob, NULL),
+				  (gssize) g_bytes_get_size (blob),
+				  &error_local)) {
+		g_debug ("failed to save %s: %s", fn, error_local->message);
+		return;
+	}
+	if (!fwupd_client_download_cache_prune (FWUPD_CLIENT_DOWNLOAD_CACHE_MAX_SIZE,
+						&error_local)) {
+		g_debug ("failed to prune download cache: %s", error_local->message);
+		return;
+	}
+}
+
 typedef struct {
 	FwupdDevice		*device;
 	FwupdRelease		*release;
@@ -2471,45 +2951,46 @@ fwupd_client_install_release_bytes_cb (GObject *source, GAsyncResult *res, gpoin
 	g_task_return_boolean (task, TRUE);
 }
 
+/* takes ownership of @task */
 static void
-fwupd_client_install_release_download_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+fwupd_client_install_release_blob (GTask *task, GBytes *blob)
 {
-	g_autoptr(GBytes) blob = NULL;
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClient *self = g_task_get_source_object (task);
 	FwupdClientInstallReleaseData *data = g_task_get_task_data (task);
-	GChecksumType checksum_type;
 	GCancellable *cancellable = g_task_get_cancellable (task);
-	const gchar *checksum_expected;
-	g_autofree gchar *checksum_actual = NULL;
-
-	blob = fwupd_client_download_bytes_finish (FWUPD_CLIENT (source), res, &error);
-	if (blob == NULL) {
-		g_task_return_error (task, g_steal_pointer (&error));
-		return;
-	}
-
-	/* verify checksum */
-	checksum_expected = fwupd_checksum_get_best (fwupd_release_get_checksums (data->release));
-	checksum_type = fwupd_checksum_guess_kind (checksum_expected);
-	checksum_actual = g_compute_checksum_for_bytes (checksum_type, blob);
-	if (g_strcmp0 (checksum_expected, checksum_actual) != 0) {
-		g_task_return_new_error (task,
-					 FWUPD_ERROR,
-					 FWUPD_ERROR_INVALID_FILE,
-					 "checksum invalid, expected %s got %s",
-					 checksum_expected, checksum_actual);
-		return;
-	}
 
 	/* if the device specifies ONLY_OFFLINE automatically set this flag */
 	if (fwupd_device_has_flag (data->device, FWUPD_DEVICE_FLAG_ONLY_OFFLINE))
 		data->install_flags |= FWUPD_INSTALL_FLAG_OFFLINE;
-	fwupd_client_install_bytes_async (FWUPD_CLIENT (source),
+	fwupd_client_install_bytes_async (self,
 					  fwupd_device_get_id (data->device), blob,
 					  data->install_flags, cancellable,
 					  fwupd_client_install_release_bytes_cb,
-					  g_steal_pointer (&task));
+					  task);
+}
+
+static void	fwupd_client_download_release_async	(FwupdClient	*self,
+							 GPtrArray	*urls,
+							 FwupdClientDownloadFlags flags,
+							 const gchar	*checksum,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+
+static void
+fwupd_client_install_release_download_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GTask) task = G_TASK (user_data);
+
+	/* already verified and cached in the worker thread */
+	blob = g_task_propagate_pointer (G_TASK (res), &error);
+	if (blob == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	fwupd_client_install_release_blob (g_steal_pointer (&task), blob);
 }
 
 static gboolean
@@ -2602,12 +3083,13 @@ fwupd_client_install_release_remote_cb (GObject *source, GAsyncResult *res, gpoi
 	}
 
 	/* download file */
-	fwupd_client_download_bytes2_async (FWUPD_CLIENT (source),
-					    uris_built,
-					    data->download_flags,
-					    cancellable,
-					    fwupd_client_install_release_download_cb,
-					    g_steal_pointer (&task));
+	fwupd_client_download_release_async (FWUPD_CLIENT (source),
+					     uris_built,
+					     data->download_flags,
+					     fwupd_checksum_get_best (fwupd_release_get_checksums (data->release)),
+					     cancellable,
+					     fwupd_client_install_release_download_cb,
+					     g_steal_pointer (&task));
 }
 
 #ifdef HAVE_LIBCURL
@@ -2691,12 +3173,13 @@ fwupd_client_install_release2_async (FwupdClient *self,
 	/* work out what remote-specific URI fields this should use */
 	remote_id = fwupd_release_get_remote_id (release);
 	if (remote_id == NULL) {
-		fwupd_client_download_bytes2_async (self,
-						    fwupd_release_get_locations (release),
-						    download_flags,
-						    cancellable,
-						    fwupd_client_install_release_download_cb,
-						    g_steal_pointer (&task));
+		fwupd_client_download_release_async (self,
+						     fwupd_release_get_locations (release),
+						     download_flags,
+						     fwupd_checksum_get_best (fwupd_release_get_checksums (release)),
+						     cancellable,
+						     fwupd_client_install_release_download_cb,
+						     g_steal_pointer (&task));
 		return;
 	}
 
@@ -2910,6 +3393,25 @@ fwupd_client_get_percentage (FwupdClient *self)
 	return priv->percentage;
 }
 
+/**
+ * fwupd_client_get_download_speed:
+ * @self: a #FwupdClient
+ *
+ * Gets the transfer rate of the current or last download, which is updated
+ * at the same time as the percentage.
+ *
+ * Returns: bytes per second, or 0 for unknown.
+ *
+ * Since: 1.6.2
+ **/
+guint64
+fwupd_client_get_download_speed (FwupdClient *self)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FWUPD_IS_CLIENT (self), 0);
+	return priv->download_speed;
+}
+
 /**
  * fwupd_client_get_daemon_version:
  * @self: a #FwupdClient
@@ -3378,188 +3880,789 @@ fwupd_client_refresh_remote_finish (FwupdClient *self, GAsyncResult *res, GError
 	return g_task_propagate_boolean (G_TASK(res), error);
 }
 
+typedef struct {
+	FwupdRemote	*remote;
+	gchar		*cachedir;
+	gboolean	 is_metadata;
+	gboolean	 is_fallback;	/* not supported by the parallel download */
+	gchar		*fn;		/* destination of the transfer in progress */
+	gchar		*fn_tmp;
+	FILE		*fp;
+	gchar		*etag;
+#ifdef HAVE_LIBCURL
+	gchar		 errbuf[CURL_ERROR_SIZE];
+	FwupdCurlHelper	*helper;
+#endif
+	GBytes		*signature;
+	gchar		*metadata_fn;	/* set when the daemon needs to be updated */
+	GError		*error;
+} FwupdClientRefreshRemotesItem;
+
+typedef struct {
+	GPtrArray	*items;		/* element-type FwupdClientRefreshRemotesItem */
+	guint		 idx;		/* next item to send to the daemon */
+} FwupdClientRefreshRemotesData;
+
 static void
-fwupd_client_get_remotes_cb (GObject *source,
-			     GAsyncResult *res,
-			     gpointer user_data)
+fwupd_client_refresh_remotes_item_free (FwupdClientRefreshRemotesItem *item)
 {
-	g_autoptr(GTask) task = G_TASK (user_data);
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GVariant) val = NULL;
-
-	val = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
-	if (val == NULL) {
-		fwupd_client_fixup_dbus_error (error);
-		g_task_return_error (task, g_steal_pointer (&error));
-		return;
+	if (item->fp != NULL) {
+		fclose (item->fp);
+		g_unlink (item->fn_tmp);
 	}
-
-	/* success */
-	g_task_return_pointer (task,
-			       fwupd_remote_array_from_variant (val),
-			       (GDestroyNotify) g_ptr_array_unref);
+#ifdef HAVE_LIBCURL
+	if (item->helper != NULL)
+		fwupd_client_curl_helper_free (item->helper);
+#endif
+	if (item->signature != NULL)
+		g_bytes_unref (item->signature);
+	if (item->error != NULL)
+		g_error_free (item->error);
+	g_object_unref (item->remote);
+	g_free (item->cachedir);
+	g_free (item->fn);
+	g_free (item->fn_tmp);
+	g_free (item->etag);
+	g_free (item->metadata_fn);
+	g_free (item);
 }
 
-/**
- * fwupd_client_get_remotes_async:
- * @self: a #FwupdClient
- * @cancellable: (nullable): optional #GCancellable
- * @callback: the function to run on completion
- * @callback_data: the data to pass to @callback
- *
- * Gets the list of remotes that have been configured for the system.
- *
- * You must have called [method@Client.connect_async] on @self before using
- * this method.
- *
- * Since: 1.5.0
- **/
-void
-fwupd_client_get_remotes_async (FwupdClient *self, GCancellable *cancellable,
-				GAsyncReadyCallback callback, gpointer callback_data)
+static void
+fwupd_client_refresh_remotes_data_free (FwupdClientRefreshRemotesData *data)
 {
-	FwupdClientPrivate *priv = GET_PRIVATE (self);
-	g_autoptr(GTask) task = NULL;
-
-	g_return_if_fail (FWUPD_IS_CLIENT (self));
-	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
-	g_return_if_fail (priv->proxy != NULL);
-
-	/* call into daemon */
-	task = g_task_new (self, cancellable, callback, callback_data);
-	g_dbus_proxy_call (priv->proxy, "GetRemotes",
-			   NULL, G_DBUS_CALL_FLAGS_NONE,
-			   -1, cancellable,
-			   fwupd_client_get_remotes_cb,
-			   g_steal_pointer (&task));
+	g_ptr_array_unref (data->items);
+	g_free (data);
 }
 
-/**
- * fwupd_client_get_remotes_finish:
- * @self: a #FwupdClient
- * @res: the asynchronous result
- * @error: (nullable): optional return location for an error
- *
- * Gets the result of fwupd_client_get_remotes_async().
- *
- * Returns: (element-type FwupdRemote) (transfer container): results
- *
- * Since: 1.5.0
- **/
-GPtrArray *
-fwupd_client_get_remotes_finish (FwupdClient *self, GAsyncResult *res, GError **error)
+#ifdef HAVE_LIBCURL
+static size_t
+fwupd_client_refresh_remotes_header_cb (char *ptr, size_t size, size_t nmemb, void *userdata)
 {
-	g_return_val_if_fail (FWUPD_IS_CLIENT (self), NULL);
-	g_return_val_if_fail (g_task_is_valid (res, self), NULL);
-	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
-	return g_task_propagate_pointer (G_TASK(res), error);
+	FwupdClientRefreshRemotesItem *item = (FwupdClientRefreshRemotesItem *) userdata;
+	gsize realsize = size * nmemb;
+	const gchar *key = "ETag:";
+	gsize keysz = strlen (key);
+
+	/* the validator to send back next time */
+	if (realsize > keysz && g_ascii_strncasecmp (ptr, key, keysz) == 0) {
+		g_free (item->etag);
+		item->etag = g_strstrip (g_strndup (ptr + keysz, realsize - keysz));
+	}
+	return realsize;
 }
 
-static void
-fwupd_client_get_approved_firmware_cb (GObject *source,
-				       GAsyncResult *res,
-				       gpointer user_data)
+static gboolean
+fwupd_client_refresh_remotes_item_start (FwupdClient *self,
+					 FwupdClientRefreshRemotesItem *item,
+					 const gchar *url,
+					 GError **error)
 {
-	g_auto(GStrv) strv = NULL;
-	g_autoptr(GTask) task = G_TASK (user_data);
-	g_autoptr(GError) error = NULL;
-	g_autoptr(GPtrArray) array = g_ptr_array_new_with_free_func (g_free);
-	g_autoptr(GVariant) val = NULL;
+	g_autofree gchar *basename = g_path_get_basename (url);
+	g_autofree gchar *fn_validators = NULL;
+	g_autoptr(FwupdCurlHelper) helper = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
 
-	val = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
-	if (val == NULL) {
-		fwupd_client_fixup_dbus_error (error);
-		g_task_return_error (task, g_steal_pointer (&error));
-		return;
+	helper = fwupd_client_curl_new (self, error);
+	if (helper == NULL)
+		return FALSE;
+	g_free (item->fn);
+	g_free (item->fn_tmp);
+	g_clear_pointer (&item->etag, g_free);
+	item->fn = g_build_filename (item->cachedir, basename, NULL);
+	item->fn_tmp = g_strdup_printf ("%s.tmp", item->fn);
+	item->errbuf[0] = '\0';
+
+	/* progress from many parallel transfers is meaningless */
+	fwupd_client_curl_helper_set_proxy (self, helper, url);
+	curl_easy_setopt (helper->curl, CURLOPT_NOPROGRESS, 1L);
+	curl_easy_setopt (helper->curl, CURLOPT_URL, url);
+	curl_easy_setopt (helper->curl, CURLOPT_PRIVATE, item);
+	curl_easy_setopt (helper->curl, CURLOPT_ERRORBUFFER, item->errbuf);
+	curl_easy_setopt (helper->curl, CURLOPT_FILETIME, 1L);
+	curl_easy_setopt (helper->curl, CURLOPT_HEADERFUNCTION, fwupd_client_refresh_remotes_header_cb);
+	curl_easy_setopt (helper->curl, CURLOPT_HEADERDATA, item);
+
+	/* conditional GET using the validators the server sent last time, as
+	 * the local clock and file times cannot be compared with the server */
+	fn_validators = g_strdup_printf ("%s.validators", item->fn);
+	if (g_file_test (item->fn, G_FILE_TEST_EXISTS) &&
+	    g_key_file_load_from_file (kf, fn_validators, G_KEY_FILE_NONE, NULL)) {
+		g_autofree gchar *etag = NULL;
+		gint64 last_modified;
+		etag = g_key_file_get_string (kf, FWUPD_CLIENT_VALIDATORS_GROUP, "ETag", NULL);
+		if (etag != NULL) {
+			g_autofree gchar *hdr = g_strdup_printf ("If-None-Match: %s", etag);
+			helper->headers = curl_slist_append (helper->headers, hdr);
+			curl_easy_setopt (helper->curl, CURLOPT_HTTPHEADER, helper->headers);
+		}
+		last_modified = g_key_file_get_int64 (kf, FWUPD_CLIENT_VALIDATORS_GROUP,
+						      "LastModified", NULL);
+		if (last_modified > 0) {
+			curl_easy_setopt (helper->curl, CURLOPT_TIMECONDITION, (long) CURL_TIMECOND_IFMODSINCE);
+			curl_easy_setopt (helper->curl, CURLOPT_TIMEVALUE, (long) last_modified);
+		}
 	}
 
-	g_variant_get (val, "(^as)", &strv);
-	for (guint i = 0; strv[i] != NULL; i++)
-		g_ptr_array_add (array, g_strdup (strv[i]));
+	/* stream the body to disk rather than into memory */
+	item->fp = fopen (item->fn_tmp, "wb");
+	if (item->fp == NULL) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     g_io_error_from_errno (errno),
+			     "failed to open %s: %s",
+			     item->fn_tmp, g_strerror (errno));
+		return FALSE;
+	}
+	curl_easy_setopt (helper->curl, CURLOPT_WRITEDATA, item->fp);
 
 	/* success */
-	g_task_return_pointer (task,
-			       g_steal_pointer (&array),
-			       (GDestroyNotify) g_ptr_array_unref);
+	if (item->helper != NULL)
+		fwupd_client_curl_helper_free (item->helper);
+	item->helper = g_steal_pointer (&helper);
+	return TRUE;
 }
 
-/**
- * fwupd_client_get_approved_firmware_async:
- * @self: a #FwupdClient
- * @cancellable: (nullable): optional #GCancellable
- * @callback: the function to run on completion
- * @callback_data: the data to pass to @callback
- *
- * Gets the list of approved firmware.
- *
- * You must have called [method@Client.connect_async] on @self before using
- * this method.
- *
- * Since: 1.5.0
- **/
-void
-fwupd_client_get_approved_firmware_async (FwupdClient *self,
-					  GCancellable *cancellable,
-					  GAsyncReadyCallback callback,
-					  gpointer callback_data)
-{
-	FwupdClientPrivate *priv = GET_PRIVATE (self);
-	g_autoptr(GTask) task = NULL;
+static gboolean
+fwupd_client_refresh_remotes_item_save (FwupdClientRefreshRemotesItem *item,
+					CURLcode res,
+					GError **error)
+{
+	glong status_code = 0;
+	glong filetime = -1;
+	g_autofree gchar *fn_validators = g_strdup_printf ("%s.validators", item->fn);
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	fclose (g_steal_pointer (&item->fp));
+	curl_easy_getinfo (item->helper->curl, CURLINFO_RESPONSE_CODE, &status_code);
+	if (res != CURLE_OK || (status_code != 200 && status_code != 304)) {
+		g_unlink (item->fn_tmp);
+		g_debug ("status-code was %ld", status_code);
+		if (status_code == 429) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INVALID_FILE,
+					     "Failed to download due to server limit");
+			return FALSE;
+		}
+		if (res == CURLE_OK) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "failed to download file: HTTP status %ld",
+				     status_code);
+			return FALSE;
+		}
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "failed to download file: %s",
+			     item->errbuf[0] != '\0' ? item->errbuf : curl_easy_strerror (res));
+		return FALSE;
+	}
 
-	g_return_if_fail (FWUPD_IS_CLIENT (self));
-	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
-	g_return_if_fail (priv->proxy != NULL);
+	/* use the file from last time */
+	if (status_code == 304) {
+		g_debug ("%s is unchanged on the server", item->fn);
+		g_unlink (item->fn_tmp);
+		return TRUE;
+	}
 
-	/* call into daemon */
-	task = g_task_new (self, cancellable, callback, callback_data);
-	g_dbus_proxy_call (priv->proxy, "GetApprovedFirmware",
-			   NULL,
-			   G_DBUS_CALL_FLAGS_NONE,
-			   -1, cancellable,
-			   fwupd_client_get_approved_firmware_cb,
-			   g_steal_pointer (&task));
+	/* save the body and validators for next time */
+	if (g_rename (item->fn_tmp, item->fn) != 0) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     g_io_error_from_errno (errno),
+			     "failed to rename %s: %s",
+			     item->fn_tmp, g_strerror (errno));
+		return FALSE;
+	}
+	curl_easy_getinfo (item->helper->curl, CURLINFO_FILETIME, &filetime);
+	if (item->etag == NULL && filetime <= 0) {
+		g_unlink (fn_validators);
+		return TRUE;
+	}
+	if (item->etag != NULL)
+		g_key_file_set_string (kf, FWUPD_CLIENT_VALIDATORS_GROUP, "ETag", item->etag);
+	if (filetime > 0)
+		g_key_file_set_int64 (kf, FWUPD_CLIENT_VALIDATORS_GROUP, "LastModified", filetime);
+	return g_key_file_save_to_file (kf, fn_validators, error);
 }
 
-/**
- * fwupd_client_get_approved_firmware_finish:
- * @self: a #FwupdClient
- * @res: the asynchronous result
- * @error: (nullable): optional return location for an error
- *
- * Gets the result of fwupd_client_get_approved_firmware_async().
- *
- * Returns: (element-type utf8) (transfer container): checksums, or %NULL for error
- *
- * Since: 1.5.0
- **/
-GPtrArray *
-fwupd_client_get_approved_firmware_finish (FwupdClient *self, GAsyncResult *res, GError **error)
+/* returns TRUE if another transfer was started for @item */
+static gboolean
+fwupd_client_refresh_remotes_item_done (FwupdClient *self,
+					FwupdClientRefreshRemotesItem *item,
+					CURLcode res)
 {
-	g_return_val_if_fail (FWUPD_IS_CLIENT (self), NULL);
-	g_return_val_if_fail (g_task_is_valid (res, self), NULL);
-	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
-	return g_task_propagate_pointer (G_TASK(res), error);
+	GChecksumType checksum_kind;
+	gsize bufsz = 0;
+	g_autofree gchar *buf = NULL;
+	g_autofree gchar *checksum = NULL;
+
+	if (!fwupd_client_refresh_remotes_item_save (item, res, &item->error))
+		return FALSE;
+
+	/* metadata is ready to be sent to the daemon */
+	if (item->is_metadata) {
+		item->metadata_fn = g_strdup (item->fn);
+		return FALSE;
+	}
+
+	/* load signature */
+	if (!g_file_get_contents (item->fn, &buf, &bufsz, &item->error))
+		return FALSE;
+	item->signature = g_bytes_new_take (g_steal_pointer (&buf), bufsz);
+	if (fwupd_remote_get_keyring_kind (item->remote) == FWUPD_KEYRING_KIND_JCAT) {
+		if (!fwupd_remote_load_signature_bytes (item->remote, item->signature, &item->error)) {
+			g_prefix_error (&item->error, "Failed to load signature: ");
+			return FALSE;
+		}
+	}
+
+	/* is the signature checksum the same? */
+	checksum_kind = fwupd_checksum_guess_kind (fwupd_remote_get_checksum (item->remote));
+	checksum = g_compute_checksum_for_bytes (checksum_kind, item->signature);
+	if (g_strcmp0 (checksum, fwupd_remote_get_checksum (item->remote)) == 0) {
+		g_debug ("metadata signature of %s is unchanged, skipping",
+			 fwupd_remote_get_id (item->remote));
+		return FALSE;
+	}
+
+	/* download metadata */
+	item->is_metadata = TRUE;
+	return fwupd_client_refresh_remotes_item_start (self,
+							item,
+							fwupd_remote_get_metadata_uri (item->remote),
+							&item->error);
 }
 
 static void
-fwupd_client_set_approved_firmware_cb (GObject *source,
-				       GAsyncResult *res,
-				       gpointer user_data)
+fwupd_client_refresh_remotes_thread_cb (GTask *task,
+					gpointer source_object,
+					gpointer task_data,
+					GCancellable *cancellable)
 {
-	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClient *self = FWUPD_CLIENT (source_object);
+	FwupdClientRefreshRemotesData *data = task_data;
+	CURLM *multi = curl_multi_init ();
+	gint running = 0;
 	g_autoptr(GError) error = NULL;
-	g_autoptr(GVariant) val = NULL;
 
-	val = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
-	if (val == NULL) {
-		fwupd_client_fixup_dbus_error (error);
-		g_task_return_error (task, g_steal_pointer (&error));
-		return;
+	/* start all the signature downloads at once */
+	fwupd_client_set_status (self, FWUPD_STATUS_DOWNLOADING);
+	for (guint i = 0; i < data->items->len; i++) {
+		FwupdClientRefreshRemotesItem *item = g_ptr_array_index (data->items, i);
+		if (item->is_fallback)
+			continue;
+		if (!fwupd_client_refresh_remotes_item_start (self,
+							      item,
+							      fwupd_remote_get_metadata_uri_sig (item->remote),
+							      &item->error))
+			continue;
+		curl_multi_add_handle (multi, item->helper->curl);
 	}
 
-	/* success */
-	g_task_return_boolean (task, TRUE);
-}
+	/* run until every transfer is complete */
+	while (!g_cancellable_is_cancelled (cancellable)) {
+		CURLMsg *msg;
+		CURLMcode mc;
+		gint msgs_left = 0;
+
+		mc = curl_multi_perform (multi, &running);
+		if (mc != CURLM_OK) {
+			g_set_error (&error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INTERNAL,
+				     "failed to download: %s",
+				     curl_multi_strerror (mc));
+			break;
+		}
+		while ((msg = curl_multi_info_read (multi, &msgs_left)) != NULL) {
+			FwupdClientRefreshRemotesItem *item = NULL;
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+			curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, (char **) &item);
+			curl_multi_remove_handle (multi, msg->easy_handle);
+			if (fwupd_client_refresh_remotes_item_done (self, item, msg->data.result)) {
+				curl_multi_add_handle (multi, item->helper->curl);
+				running++;
+			}
+		}
+		if (running == 0)
+			break;
+		curl_multi_wait (multi, NULL, 0, 1000, NULL);
+	}
+
+	/* remove any transfers still in progress */
+	for (guint i = 0; i < data->items->len; i++) {
+		FwupdClientRefreshRemotesItem *item = g_ptr_array_index (data->items, i);
+		if (item->fp != NULL)
+			curl_multi_remove_handle (multi, item->helper->curl);
+	}
+	curl_multi_cleanup (multi);
+	fwupd_client_set_status (self, FWUPD_STATUS_IDLE);
+	if (error != NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	if (g_task_return_error_if_cancelled (task))
+		return;
+	g_task_return_boolean (task, TRUE);
+}
+#endif
+
+static void fwupd_client_refresh_remotes_update_next (GTask *task);
+
+static void
+fwupd_client_refresh_remotes_update_cb (GObject *source,
+					GAsyncResult *res,
+					gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClientRefreshRemotesData *data = g_task_get_task_data (task);
+	FwupdClientRefreshRemotesItem *item = g_ptr_array_index (data->items, data->idx - 1);
+
+	if (!fwupd_client_update_metadata_bytes_finish (FWUPD_CLIENT (source), res, &item->error))
+		g_debug ("failed to update %s", fwupd_remote_get_id (item->remote));
+	fwupd_client_refresh_remotes_update_next (g_steal_pointer (&task));
+}
+
+static void
+fwupd_client_refresh_remotes_fallback_cb (GObject *source,
+					  GAsyncResult *res,
+					  gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClientRefreshRemotesData *data = g_task_get_task_data (task);
+	FwupdClientRefreshRemotesItem *item = g_ptr_array_index (data->items, data->idx - 1);
+
+	if (!fwupd_client_refresh_remote_finish (FWUPD_CLIENT (source), res, &item->error))
+		g_debug ("failed to refresh %s", fwupd_remote_get_id (item->remote));
+	fwupd_client_refresh_remotes_update_next (g_steal_pointer (&task));
+}
+
+/* send the changed metadata to the daemon one remote at a time */
+static void
+fwupd_client_refresh_remotes_update_next (GTask *task)
+{
+	FwupdClient *self = g_task_get_source_object (task);
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	FwupdClientRefreshRemotesData *data = g_task_get_task_data (task);
+	GCancellable *cancellable = g_task_get_cancellable (task);
+
+	while (data->idx < data->items->len) {
+		FwupdClientRefreshRemotesItem *item = g_ptr_array_index (data->items, data->idx++);
+#ifdef HAVE_GIO_UNIX
+		g_autoptr(GUnixInputStream) istr = NULL;
+		g_autoptr(GUnixInputStream) istr_sig = NULL;
+#else
+		gsize bufsz = 0;
+		gchar *buf = NULL;
+		g_autoptr(GBytes) metadata = NULL;
+#endif
+
+		if (item->error != NULL)
+			continue;
+		if (!item->is_fallback && item->metadata_fn == NULL)
+			continue;
+		if (priv->proxy == NULL) {
+			g_set_error_literal (&item->error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INTERNAL,
+					     "not connected to the daemon");
+			continue;
+		}
+
+		/* one at a time using the old method, e.g. for IPFS */
+		if (item->is_fallback) {
+			fwupd_client_refresh_remote_async (self,
+							   item->remote,
+							   cancellable,
+							   fwupd_client_refresh_remotes_fallback_cb,
+							   task);
+			return;
+		}
+#ifdef HAVE_GIO_UNIX
+		istr = fwupd_unix_input_stream_from_fn (item->metadata_fn, &item->error);
+		if (istr == NULL)
+			continue;
+		istr_sig = fwupd_unix_input_stream_from_bytes (item->signature, &item->error);
+		if (istr_sig == NULL)
+			continue;
+		fwupd_client_update_metadata_stream_async (self,
+							   fwupd_remote_get_id (item->remote),
+							   istr, istr_sig,
+							   cancellable,
+							   fwupd_client_refresh_remotes_update_cb,
+							   task);
+#else
+		if (!g_file_get_contents (item->metadata_fn, &buf, &bufsz, &item->error))
+			continue;
+		metadata = g_bytes_new_take (buf, bufsz);
+		fwupd_client_update_metadata_bytes_async (self,
+							  fwupd_remote_get_id (item->remote),
+							  metadata,
+							  item->signature,
+							  cancellable,
+							  fwupd_client_refresh_remotes_update_cb,
+							  task);
+#endif
+		return;
+	}
+
+	/* report the first failure, but only after refreshing the others */
+	for (guint i = 0; i < data->items->len; i++) {
+		FwupdClientRefreshRemotesItem *item = g_ptr_array_index (data->items, i);
+		if (item->error != NULL) {
+			GError *error = g_error_copy (item->error);
+			g_prefix_error (&error, "failed to refresh %s: ",
+					fwupd_remote_get_id (item->remote));
+			g_task_return_error (task, error);
+			g_object_unref (task);
+			return;
+		}
+	}
+
+	/* success */
+	g_task_return_boolean (task, TRUE);
+	g_object_unref (task);
+}
+
+static void
+fwupd_client_refresh_remotes_download_cb (GObject *source,
+					  GAsyncResult *res,
+					  gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	g_autoptr(GError) error = NULL;
+
+	if (!g_task_propagate_boolean (G_TASK (res), &error)) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	fwupd_client_refresh_remotes_update_next (g_steal_pointer (&task));
+}
+
+/**
+ * fwupd_client_refresh_remotes_async:
+ * @self: a #FwupdClient
+ * @remotes: (element-type FwupdRemote): remotes
+ * @cancellable: (nullable): optional #GCancellable
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Refreshes all the enabled download remotes in @remotes at the same time.
+ *
+ * The downloaded files are kept in the user cache directory, and the server is
+ * asked to only send them again if they have changed. The metadata is not
+ * downloaded at all if the signature matches the one the daemon already has.
+ *
+ * Remotes that do not use HTTP, e.g. IPFS, and all remotes when libfwupd was
+ * built without libcurl, are refreshed one at a time using
+ * [method@Client.refresh_remote_async].
+ *
+ * If any of the remotes fail to refresh, the others are still refreshed and
+ * the first failure is returned.
+ *
+ * NOTE: This method is thread-safe, but progress signals will be
+ * emitted in the global default main context, if not explicitly set with
+ * [method@Client.set_main_context].
+ *
+ * Since: 1.6.2
+ **/
+void
+fwupd_client_refresh_remotes_async (FwupdClient *self,
+				    GPtrArray *remotes,
+				    GCancellable *cancellable,
+				    GAsyncReadyCallback callback,
+				    gpointer callback_data)
+{
+	FwupdClientRefreshRemotesData *data;
+	g_autoptr(GTask) task = NULL;
+#ifdef HAVE_LIBCURL
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GTask) task_download = NULL;
+#endif
+
+	g_return_if_fail (FWUPD_IS_CLIENT (self));
+	g_return_if_fail (remotes != NULL);
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+	task = g_task_new (self, cancellable, callback, callback_data);
+	data = g_new0 (FwupdClientRefreshRemotesData, 1);
+	data->items = g_ptr_array_new_with_free_func ((GDestroyNotify) fwupd_client_refresh_remotes_item_free);
+	for (guint i = 0; i < remotes->len; i++) {
+		FwupdRemote *remote = g_ptr_array_index (remotes, i);
+		FwupdClientRefreshRemotesItem *item;
+		if (!fwupd_remote_get_enabled (remote))
+			continue;
+		if (fwupd_remote_get_kind (remote) != FWUPD_REMOTE_KIND_DOWNLOAD)
+			continue;
+		item = g_new0 (FwupdClientRefreshRemotesItem, 1);
+		item->remote = g_object_ref (remote);
+		item->cachedir = fwupd_client_build_cachedir ("remotes.d",
+							      fwupd_remote_get_id (remote));
+#ifdef HAVE_LIBCURL
+		item->is_fallback = fwupd_remote_get_metadata_uri_sig (remote) == NULL ||
+				    !fwupd_client_is_url_http (fwupd_remote_get_metadata_uri (remote)) ||
+				    !fwupd_client_is_url_http (fwupd_remote_get_metadata_uri_sig (remote));
+#else
+		item->is_fallback = TRUE;
+#endif
+		g_ptr_array_add (data->items, item);
+	}
+	g_task_set_task_data (task, data, (GDestroyNotify) fwupd_client_refresh_remotes_data_free);
+
+#ifdef HAVE_LIBCURL
+	/* check the user agent is sane */
+	if (!fwupd_client_ensure_networking (self, &error)) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	for (guint i = 0; i < data->items->len; i++) {
+		FwupdClientRefreshRemotesItem *item = g_ptr_array_index (data->items, i);
+		if (item->is_fallback)
+			continue;
+		if (g_mkdir_with_parents (item->cachedir, 0700) != 0) {
+			g_task_return_new_error (task,
+						 G_IO_ERROR,
+						 g_io_error_from_errno (errno),
+						 "failed to create %s: %s",
+						 item->cachedir, g_strerror (errno));
+			return;
+		}
+	}
+
+	/* download everything in a thread, then update the daemon from here */
+	task_download = g_task_new (self, cancellable,
+				    fwupd_client_refresh_remotes_download_cb,
+				    g_steal_pointer (&task));
+	g_task_set_task_data (task_download, data, NULL);
+	g_task_run_in_thread (task_download, fwupd_client_refresh_remotes_thread_cb);
+#else
+	fwupd_client_refresh_remotes_update_next (g_steal_pointer (&task));
+#endif
+}
+
+/**
+ * fwupd_client_refresh_remotes_finish:
+ * @self: a #FwupdClient
+ * @res: the asynchronous result
+ * @error: (nullable): optional return location for an error
+ *
+ * Gets the result of fwupd_client_refresh_remotes_async().
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fwupd_client_refresh_remotes_finish (FwupdClient *self, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (self), FALSE);
+	g_return_val_if_fail (g_task_is_valid (res, self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+	return g_task_propagate_boolean (G_TASK(res), error);
+}
+
+static void
+fwupd_client_get_remotes_cb (GObject *source,
+			     GAsyncResult *res,
+			     gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	FwupdClient *self = g_task_get_source_object (task);
+	guint generation = GPOINTER_TO_UINT (g_task_get_task_data (task));
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) val = NULL;
+	GPtrArray *remotes;
+
+	val = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+	if (val == NULL) {
+		fwupd_client_fixup_dbus_error (error);
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+
+	/* success */
+	remotes = fwupd_remote_array_from_variant (val);
+	fwupd_client_cache_set_remotes (self, generation, remotes);
+	g_task_return_pointer (task, remotes, (GDestroyNotify) g_ptr_array_unref);
+}
+
+/**
+ * fwupd_client_get_remotes_async:
+ * @self: a #FwupdClient
+ * @cancellable: (nullable): optional #GCancellable
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets the list of remotes that have been configured for the system.
+ *
+ * You must have called [method@Client.connect_async] on @self before using
+ * this method.
+ *
+ * Since: 1.5.0
+ **/
+void
+fwupd_client_get_remotes_async (FwupdClient *self, GCancellable *cancellable,
+				GAsyncReadyCallback callback, gpointer callback_data)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GPtrArray) remotes = NULL;
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (FWUPD_IS_CLIENT (self));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	g_return_if_fail (priv->proxy != NULL);
+
+	/* use the cache if enabled */
+	task = g_task_new (self, cancellable, callback, callback_data);
+	g_task_set_task_data (task,
+			      GUINT_TO_POINTER (fwupd_client_cache_get_generation (self)),
+			      NULL);
+	remotes = fwupd_client_cache_get_remotes (self, 0);
+	if (remotes != NULL) {
+		g_task_return_pointer (task,
+				       g_steal_pointer (&remotes),
+				       (GDestroyNotify) g_ptr_array_unref);
+		return;
+	}
+
+	/* call into daemon */
+	g_dbus_proxy_call (priv->proxy, "GetRemotes",
+			   NULL, G_DBUS_CALL_FLAGS_NONE,
+			   -1, cancellable,
+			   fwupd_client_get_remotes_cb,
+			   g_steal_pointer (&task));
+}
+
+/**
+ * fwupd_client_get_remotes_finish:
+ * @self: a #FwupdClient
+ * @res: the asynchronous result
+ * @error: (nullable): optional return location for an error
+ *
+ * Gets the result of fwupd_client_get_remotes_async().
+ *
+ * Returns: (element-type FwupdRemote) (transfer container): results
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fwupd_client_get_remotes_finish (FwupdClient *self, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (self), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	return g_task_propagate_pointer (G_TASK(res), error);
+}
+
+static void
+fwupd_client_get_approved_firmware_cb (GObject *source,
+				       GAsyncResult *res,
+				       gpointer user_data)
+{
+	g_auto(GStrv) strv = NULL;
+	g_autoptr(GTask) task = G_TASK (user_data);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) array = g_ptr_array_new_with_free_func (g_free);
+	g_autoptr(GVariant) val = NULL;
+
+	val = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+	if (val == NULL) {
+		fwupd_client_fixup_dbus_error (error);
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+
+	g_variant_get (val, "(^as)", &strv);
+	for (guint i = 0; strv[i] != NULL; i++)
+		g_ptr_array_add (array, g_strdup (strv[i]));
+
+	/* success */
+	g_task_return_pointer (task,
+			       g_steal_pointer (&array),
+			       (GDestroyNotify) g_ptr_array_unref);
+}
+
+/**
+ * fwupd_client_get_approved_firmware_async:
+ * @self: a #FwupdClient
+ * @cancellable: (nullable): optional #GCancellable
+ * @callback: the function to run on completion
+ * @callback_data: the data to pass to @callback
+ *
+ * Gets the list of approved firmware.
+ *
+ * You must have called [method@Client.connect_async] on @self before using
+ * this method.
+ *
+ * Since: 1.5.0
+ **/
+void
+fwupd_client_get_approved_firmware_async (FwupdClient *self,
+					  GCancellable *cancellable,
+					  GAsyncReadyCallback callback,
+					  gpointer callback_data)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GTask) task = NULL;
+
+	g_return_if_fail (FWUPD_IS_CLIENT (self));
+	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+	g_return_if_fail (priv->proxy != NULL);
+
+	/* call into daemon */
+	task = g_task_new (self, cancellable, callback, callback_data);
+	g_dbus_proxy_call (priv->proxy, "GetApprovedFirmware",
+			   NULL,
+			   G_DBUS_CALL_FLAGS_NONE,
+			   -1, cancellable,
+			   fwupd_client_get_approved_firmware_cb,
+			   g_steal_pointer (&task));
+}
+
+/**
+ * fwupd_client_get_approved_firmware_finish:
+ * @self: a #FwupdClient
+ * @res: the asynchronous result
+ * @error: (nullable): optional return location for an error
+ *
+ * Gets the result of fwupd_client_get_approved_firmware_async().
+ *
+ * Returns: (element-type utf8) (transfer container): checksums, or %NULL for error
+ *
+ * Since: 1.5.0
+ **/
+GPtrArray *
+fwupd_client_get_approved_firmware_finish (FwupdClient *self, GAsyncResult *res, GError **error)
+{
+	g_return_val_if_fail (FWUPD_IS_CLIENT (self), NULL);
+	g_return_val_if_fail (g_task_is_valid (res, self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+	return g_task_propagate_pointer (G_TASK(res), error);
+}
+
+static void
+fwupd_client_set_approved_firmware_cb (GObject *source,
+				       GAsyncResult *res,
+				       gpointer user_data)
+{
+	g_autoptr(GTask) task = G_TASK (user_data);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	val = g_dbus_proxy_call_finish (G_DBUS_PROXY (source), res, &error);
+	if (val == NULL) {
+		fwupd_client_fixup_dbus_error (error);
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+
+	/* success */
+	g_task_return_boolean (task, TRUE);
+}
 
 /**
  * fwupd_client_set_approved_firmware_async:
@@ -4333,155 +5436,942 @@ fwupd_client_set_user_agent_for_package (FwupdClient *self,
 	priv->user_agent = g_string_free (str, FALSE);
 }
 
-#ifdef HAVE_LIBCURL
+#ifdef HAVE_LIBCURL
+static size_t
+fwupd_client_download_write_callback_cb (char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	GByteArray *buf = (GByteArray *) userdata;
+	gsize realsize = size * nmemb;
+	g_byte_array_append (buf, (const guint8 *) ptr, realsize);
+	return realsize;
+}
+
+static GBytes *
+fwupd_client_stream_read_bytes (GInputStream *stream, GError **error)
+{
+	guint8 tmp[0x8000] = { 0x0 };
+	g_autoptr(GByteArray) buf = g_byte_array_new ();
+
+	/* read from stream in 32kB chunks */
+	while (TRUE) {
+		gssize sz;
+		sz = g_input_stream_read (stream, tmp, sizeof(tmp), NULL, error);
+		if (sz == 0)
+			break;
+		if (sz < 0)
+			return NULL;
+		g_byte_array_append (buf, tmp, sz);
+	}
+	return g_byte_array_free_to_bytes (g_steal_pointer (&buf));
+}
+
+static GBytes *
+fwupd_client_download_ipfs (FwupdClient *self, const gchar *url, GError **error)
+{
+	GInputStream *stream = NULL;
+	g_autofree gchar *path = NULL;
+	g_autoptr(GSubprocess) subprocess = NULL;
+
+	/* we get no detailed progress details */
+	fwupd_client_set_status (self, FWUPD_STATUS_DOWNLOADING);
+	fwupd_client_set_percentage (self, 0);
+
+	/* convert from URI to path */
+	if (g_str_has_prefix (url, "ipfs://")) {
+		path = g_strdup_printf ("/ipfs/%s", url + 7);
+	} else if (g_str_has_prefix (url, "ipns://")) {
+		path = g_strdup_printf ("/ipns/%s", url + 7);
+	} else {
+		path = g_strdup (url);
+	}
+
+	/* run sync */
+	subprocess = g_subprocess_new (G_SUBPROCESS_FLAGS_STDOUT_PIPE,
+				       error, "ipfs", "cat", path, NULL);
+	if (subprocess == NULL)
+		return NULL;
+	if (!g_subprocess_wait_check (subprocess, NULL, error))
+		return NULL;
+
+	/* get raw stdout */
+	stream = g_subprocess_get_stdout_pipe (subprocess);
+	return fwupd_client_stream_read_bytes (stream, error);
+}
+
+/* run callback in the correct thread */
+static void
+fwupd_client_set_download_speed (FwupdClient *self, guint64 download_speed)
+{
+	FwupdClientPrivate *priv = GET_PRIVATE (self);
+	if (priv->download_speed == download_speed)
+		return;
+	priv->download_speed = download_speed;
+	fwupd_client_object_notify (self, "download-speed");
+}
+
+typedef struct {
+	FwupdClient	*self;
+	gint64		 started;	/* monotonic, in µs */
+	gint64		 updated;	/* monotonic, in µs */
+	guint64		 offset;	/* bytes already downloaded in a previous session */
+	guint64		 received;	/* bytes downloaded in this session */
+	guint64		 total;		/* bytes, or 0 for unknown */
+} FwupdClientDownloadProgress;
+
+static void
+fwupd_client_download_progress_init (FwupdClientDownloadProgress *progress, FwupdClient *self)
+{
+	progress->self = self;
+	progress->started = g_get_monotonic_time ();
+	progress->updated = progress->started;
+	progress->offset = 0;
+	progress->received = 0;
+	progress->total = 0;
+	fwupd_client_set_download_speed (self, 0);
+}
+
+static void
+fwupd_client_download_progress_update (FwupdClientDownloadProgress *progress)
+{
+	gint64 now = g_get_monotonic_time ();
+	guint64 done = progress->offset + progress->received;
+
+	if (progress->total > 0 && done <= progress->total) {
+		guint percentage = (guint) ((100 * done) / progress->total);
+		fwupd_client_set_percentage (progress->self, percentage);
+	}
+
+	/* the rate is noisy, so only recalculate it once per second */
+	if (now - progress->updated >= G_USEC_PER_SEC) {
+		guint64 speed = (progress->received * G_USEC_PER_SEC) / (now - progress->started);
+		g_debug ("download progress: %" G_GUINT64_FORMAT " of %" G_GUINT64_FORMAT
+			 " bytes at %" G_GUINT64_FORMAT " bytes/s",
+			 done, progress->total, speed);
+		progress->updated = now;
+		fwupd_client_set_download_speed (progress->self, speed);
+	}
+}
+
+static int
+fwupd_client_download_progress_cb (void *clientp,
+				   curl_off_t dltotal,
+				   curl_off_t dlnow,
+				   curl_off_t ultotal,
+				   curl_off_t ulnow)
+{
+	FwupdClientDownloadProgress *progress = (FwupdClientDownloadProgress *) clientp;
+	if (dltotal > 0)
+		progress->total = progress->offset + dltotal;
+	if (dlnow >= 0)
+		progress->received = dlnow;
+	fwupd_client_download_progress_update (progress);
+	return 0;
+}
+
+typedef struct {
+	CURL		*curl;
+	gchar		*fn;		/* (nullable) */
+	FILE		*fp;		/* (nullable) */
+	GByteArray	*buf;		/* used if @fp is %NULL */
+	gchar		*etag;		/* (nullable): of the current response */
+	struct curl_slist *headers;
+	glong		 status_code;
+	FwupdClientDownloadProgress progress;
+} FwupdClientDownloadPartial;
+
+static size_t
+fwupd_client_download_partial_header_cb (char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	FwupdClientDownloadPartial *partial = (FwupdClientDownloadPartial *) userdata;
+	gsize realsize = size * nmemb;
+
+	/* a new response, e.g. after a redirect */
+	if (realsize > 5 && strncmp (ptr, "HTTP/", 5) == 0)
+		g_clear_pointer (&partial->etag, g_free);
+	if (realsize > 5 && g_ascii_strncasecmp (ptr, "ETag:", 5) == 0) {
+		g_free (partial->etag);
+		partial->etag = g_strstrip (g_strndup (ptr + 5, realsize - 5));
+	}
+	return realsize;
+}
+
+static gchar *
+fwupd_client_download_partial_get_validators_fn (FwupdClientDownloadPartial *partial)
+{
+	return g_strdup_printf ("%s.validators", partial->fn);
+}
+
+/* only a strong ETag can be used with If-Range to check the partial file is
+ * for the same version of the file that the server has now */
+static void
+fwupd_client_download_partial_save_validators (FwupdClientDownloadPartial *partial)
+{
+	g_autofree gchar *fn = fwupd_client_download_partial_get_validators_fn (partial);
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	if (partial->etag == NULL || g_str_has_prefix (partial->etag, "W/")) {
+		g_unlink (fn);
+		return;
+	}
+	g_key_file_set_string (kf, FWUPD_CLIENT_VALIDATORS_GROUP, "ETag", partial->etag);
+	if (!g_key_file_save_to_file (kf, fn, &error_local))
+		g_debug ("failed to save %s: %s", fn, error_local->message);
+}
+
+static gchar *
+fwupd_client_download_partial_load_etag (FwupdClientDownloadPartial *partial)
+{
+	g_autofree gchar *fn = fwupd_client_download_partial_get_validators_fn (partial);
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	if (!g_key_file_load_from_file (kf, fn, G_KEY_FILE_NONE, NULL))
+		return NULL;
+	return g_key_file_get_string (kf, FWUPD_CLIENT_VALIDATORS_GROUP, "ETag", NULL);
+}
+
+static gboolean
+fwupd_client_download_partial_truncate (FwupdClientDownloadPartial *partial)
+{
+	partial->progress.offset = 0;
+	if (fflush (partial->fp) != 0)
+		return FALSE;
+	return ftruncate (fileno (partial->fp), 0) == 0;
+}
+
+static size_t
+fwupd_client_download_partial_write_cb (char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	FwupdClientDownloadPartial *partial = (FwupdClientDownloadPartial *) userdata;
+	gsize realsize = size * nmemb;
+
+	/* check the status before anything gets written to the partial file */
+	if (partial->status_code == 0) {
+		curl_easy_getinfo (partial->curl, CURLINFO_RESPONSE_CODE, &partial->status_code);
+		if (partial->status_code >= 400)
+			return 0;
+		if (partial->fp != NULL && partial->status_code != 206) {
+			if (partial->progress.offset > 0) {
+				g_debug ("server sent the whole file, restarting");
+				if (!fwupd_client_download_partial_truncate (partial))
+					return 0;
+			}
+			fwupd_client_download_partial_save_validators (partial);
+		}
+	}
+	if (partial->fp != NULL)
+		return fwrite (ptr, 1, realsize, partial->fp);
+	g_byte_array_append (partial->buf, (const guint8 *) ptr, realsize);
+	return realsize;
+}
+
+/* only one thread or process can append to the partial file at a time */
+static gboolean
+fwupd_client_download_partial_lock (gint fd)
+{
+#ifdef HAVE_WRLCK
+	struct flock lockp = {
+		.l_type = F_WRLCK,
+		.l_whence = SEEK_SET,
+	};
+#ifdef HAVE_OFD
+	return fcntl (fd, F_OFD_SETLK, &lockp) == 0;
+#else
+	return fcntl (fd, F_SETLK, &lockp) == 0;
+#endif
+#else
+	/* no way to stop another process appending too */
+	return FALSE;
+#endif
+}
+
+/* so that an interrupted transfer can be resumed, even by a later process */
+static void
+fwupd_client_download_partial_open (FwupdClientDownloadPartial *partial, const gchar *url)
+{
+	gint fd;
+	g_autofree gchar *cachedir = fwupd_client_build_cachedir ("downloads", NULL);
+	g_autofree gchar *basename = NULL;
+	g_autofree gchar *etag = NULL;
+	g_autofree gchar *hash = g_compute_checksum_for_string (G_CHECKSUM_SHA1, url, -1);
+	g_autofree gchar *hdr = NULL;
+
+	/* not fatal, just download into memory instead */
+	if (g_mkdir_with_parents (cachedir, 0700) != 0) {
+		g_debug ("failed to create %s: %s", cachedir, g_strerror (errno));
+		return;
+	}
+	basename = g_strdup_printf ("%s.part", hash);
+	partial->fn = fwupd_client_build_cachedir ("downloads", basename);
+	fd = g_open (partial->fn, O_WRONLY | O_CREAT | O_APPEND, 0600);
+	if (fd < 0) {
+		g_debug ("failed to open %s: %s", partial->fn, g_strerror (errno));
+		g_clear_pointer (&partial->fn, g_free);
+		return;
+	}
+	if (!fwupd_client_download_partial_lock (fd)) {
+		g_debug ("failed to lock %s, perhaps already being downloaded", partial->fn);
+		g_close (fd, NULL);
+		g_clear_pointer (&partial->fn, g_free);
+		return;
+	}
+	partial->fp = fdopen (fd, "ab");
+	if (partial->fp == NULL) {
+		g_debug ("failed to open %s: %s", partial->fn, g_strerror (errno));
+		g_close (fd, NULL);
+		g_clear_pointer (&partial->fn, g_free);
+		return;
+	}
+	fseek (partial->fp, 0, SEEK_END);
+	partial->progress.offset = (guint64) ftell (partial->fp);
+	if (partial->progress.offset == 0)
+		return;
+
+	/* the server has to confirm the file has not changed since */
+	etag = fwupd_client_download_partial_load_etag (partial);
+	if (etag == NULL) {
+		g_debug ("no validator for partial download of %s, restarting", url);
+		if (!fwupd_client_download_partial_truncate (partial)) {
+			g_debug ("failed to truncate %s: %s", partial->fn, g_strerror (errno));
+			fclose (g_steal_pointer (&partial->fp));
+			g_clear_pointer (&partial->fn, g_free);
+		}
+		return;
+	}
+	g_debug ("resuming %s from %" G_GUINT64_FORMAT " bytes",
+		 url, partial->progress.offset);
+	hdr = g_strdup_printf ("If-Range: %s", etag);
+	partial->headers = curl_slist_append (partial->headers, hdr);
+}
+
+static void
+fwupd_client_download_partial_remove (FwupdClientDownloadPartial *partial)
+{
+	g_autofree gchar *fn_validators = fwupd_client_download_partial_get_validators_fn (partial);
+	g_unlink (partial->fn);
+	g_unlink (fn_validators);
+}
+
+static GBytes *
+fwupd_client_download_partial_close (FwupdClientDownloadPartial *partial, GError **error)
+{
+	gsize bufsz = 0;
+	g_autofree gchar *buf = NULL;
+
+	/* downloaded into memory */
+	if (partial->fp == NULL)
+		return g_byte_array_free_to_bytes (g_steal_pointer (&partial->buf));
+
+	/* the file is complete, so read it back while still holding the lock */
+	if (fflush (partial->fp) != 0) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     g_io_error_from_errno (errno),
+			     "failed to write %s: %s",
+			     partial->fn, g_strerror (errno));
+		return NULL;
+	}
+	if (!g_file_get_contents (partial->fn, &buf, &bufsz, error))
+		return NULL;
+
+	/* the partial is not required anymore */
+	fwupd_client_download_partial_remove (partial);
+	return g_bytes_new_take (g_steal_pointer (&buf), bufsz);
+}
+
+static void
+fwupd_client_download_partial_clear (FwupdClientDownloadPartial *partial)
+{
+	if (partial->fp != NULL)
+		fclose (partial->fp);
+	if (partial->buf != NULL)
+		g_byte_array_unref (partial->buf);
+	if (partial->headers != NULL)
+		curl_slist_free_all (partial->headers);
+	g_free (partial->etag);
+	g_free (partial->fn);
+}
+
+static GBytes *
+fwupd_client_download_http (FwupdClient *self,
+			    CURL *curl,
+			    const gchar *url,
+			    GError **error)
+{
+	CURLcode res;
+	gchar errbuf[CURL_ERROR_SIZE] = { '\0' };
+	FwupdClientDownloadPartial partial = { 0x0 };
+	g_autofree gchar *range = NULL;
+	g_autoptr(GBytes) blob = NULL;
+
+	fwupd_client_download_progress_init (&partial.progress, self);
+	partial.curl = curl;
+	partial.buf = g_byte_array_new ();
+	fwupd_client_download_partial_open (&partial, url);
+	if (partial.progress.offset > 0)
+		range = g_strdup_printf ("%" G_GUINT64_FORMAT "-", partial.progress.offset);
+
+	fwupd_client_set_status (self, FWUPD_STATUS_DOWNLOADING);
+	curl_easy_setopt (curl, CURLOPT_URL, url);
+	curl_easy_setopt (curl, CURLOPT_ERRORBUFFER, errbuf);
+	curl_easy_setopt (curl, CURLOPT_WRITEFUNCTION, fwupd_client_download_partial_write_cb);
+	curl_easy_setopt (curl, CURLOPT_WRITEDATA, &partial);
+	curl_easy_setopt (curl, CURLOPT_XFERINFOFUNCTION, fwupd_client_download_progress_cb);
+	curl_easy_setopt (curl, CURLOPT_XFERINFODATA, &partial.progress);
+	curl_easy_setopt (curl, CURLOPT_HEADERFUNCTION, fwupd_client_download_partial_header_cb);
+	curl_easy_setopt (curl, CURLOPT_HEADERDATA, &partial);
+	curl_easy_setopt (curl, CURLOPT_HTTPHEADER, partial.headers);
+	curl_easy_setopt (curl, CURLOPT_RANGE, range);
+	res = curl_easy_perform (curl);
+	curl_easy_setopt (curl, CURLOPT_HEADERFUNCTION, NULL);
+	curl_easy_setopt (curl, CURLOPT_HEADERDATA, NULL);
+	curl_easy_setopt (curl, CURLOPT_HTTPHEADER, NULL);
+	fwupd_client_set_status (self, FWUPD_STATUS_IDLE);
+	if (partial.status_code == 0)
+		curl_easy_getinfo (curl, CURLINFO_RESPONSE_CODE, &partial.status_code);
+
+	/* the partial file is larger than the file on the server */
+	if (partial.status_code == 416 && partial.progress.offset > 0) {
+		g_debug ("partial download of %s is invalid, restarting", url);
+		fwupd_client_download_partial_remove (&partial);
+		fwupd_client_download_partial_clear (&partial);
+		return fwupd_client_download_http (self, curl, url, error);
+	}
+	if (res != CURLE_OK || partial.status_code >= 400) {
+		g_debug ("status-code was %ld", partial.status_code);
+		if (partial.status_code == 429) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "Failed to download due to server limit");
+			fwupd_client_download_partial_clear (&partial);
+			return NULL;
+		}
+		if (partial.status_code >= 400) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "failed to download file: HTTP status %ld",
+				     partial.status_code);
+			fwupd_client_download_partial_clear (&partial);
+			return NULL;
+		}
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "failed to download file: %s",
+			     errbuf[0] != '\0' ? errbuf : curl_easy_strerror (res));
+		fwupd_client_download_partial_clear (&partial);
+		return NULL;
+	}
+	blob = fwupd_client_download_partial_close (&partial, error);
+	fwupd_client_download_partial_clear (&partial);
+	return g_steal_pointer (&blob);
+}
+
+typedef struct {
+	GPtrArray	*urls;		/* element-type utf8 */
+	GPtrArray	*ranges;	/* element-type FwupdClientDownloadRange */
+	CURLM		*multi;
+	guint8		*buf;
+	guint64		 bufsz;
+	FwupdClientDownloadPartial partial;	/* of the first mirror */
+	FwupdClientDownloadProgress progress;
+} FwupdClientDownloadRanged;
+
+typedef struct {
+	FwupdClientDownloadRanged *ranged;
+	FwupdCurlHelper	*helper;
+	gboolean	 active;	/* added to @multi */
+	guint		 url_idx;	/* the mirror currently in use */
+	guint		 attempts;
+	guint64		 start;
+	guint64		 end;		/* inclusive */
+	guint64		 received;
+	glong		 status_code;
+	gchar		 errbuf[CURL_ERROR_SIZE];
+	GError		*error;
+} FwupdClientDownloadRange;
+
+static void
+fwupd_client_download_range_free (FwupdClientDownloadRange *range)
+{
+	if (range->helper != NULL)
+		fwupd_client_curl_helper_free (range->helper);
+	if (range->error != NULL)
+		g_error_free (range->error);
+	g_free (range);
+}
+
+static void
+fwupd_client_download_ranged_free (FwupdClientDownloadRanged *ranged)
+{
+	/* remove any transfers still in progress */
+	for (guint i = 0; i < ranged->ranges->len; i++) {
+		FwupdClientDownloadRange *range = g_ptr_array_index (ranged->ranges, i);
+		if (range->active)
+			curl_multi_remove_handle (ranged->multi, range->helper->curl);
+	}
+	curl_multi_cleanup (ranged->multi);
+	fwupd_client_download_partial_clear (&ranged->partial);
+	g_ptr_array_unref (ranged->ranges);
+	g_ptr_array_unref (ranged->urls);
+	g_free (ranged->buf);
+	g_free (ranged);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FwupdClientDownloadRanged, fwupd_client_download_ranged_free)
+
+typedef struct {
+	gboolean	 accept_ranges;
+	gchar		*etag;		/* (nullable) */
+} FwupdClientDownloadProbe;
+
+static size_t
+fwupd_client_download_probe_header_cb (char *ptr, size_t size, size_t nmemb, void *userdata)
+{
+	FwupdClientDownloadProbe *probe = (FwupdClientDownloadProbe *) userdata;
+	gsize realsize = size * nmemb;
+	g_autofree gchar *line = g_strndup (ptr, realsize);
+
+	/* each redirect has its own set of headers */
+	g_strstrip (line);
+	if (g_str_has_prefix (line, "HTTP/")) {
+		probe->accept_ranges = FALSE;
+		g_clear_pointer (&probe->etag, g_free);
+	} else if (g_ascii_strcasecmp (line, "Accept-Ranges: bytes") == 0) {
+		probe->accept_ranges = TRUE;
+	} else if (g_ascii_strncasecmp (line, "ETag:", 5) == 0) {
+		g_free (probe->etag);
+		probe->etag = g_strstrip (g_strdup (line + 5));
+	}
+	return realsize;
+}
+
+/* returns the size of the file, or 0 if it cannot be fetched in ranges */
+static guint64
+fwupd_client_download_http_probe (FwupdClient *self,
+				  const gchar *url,
+				  gchar **etag,
+				  GError **error)
+{
+	CURLcode res;
+	curl_off_t size = -1;
+	gchar errbuf[CURL_ERROR_SIZE] = { '\0' };
+	glong status_code = 0;
+	FwupdClientDownloadProbe probe = { 0x0 };
+	g_autofree gchar *probe_etag = NULL;
+	g_autoptr(FwupdCurlHelper) helper = NULL;
+
+	helper = fwupd_client_curl_new (self, error);
+	if (helper == NULL)
+		return 0;
+	fwupd_client_curl_helper_set_proxy (self, helper, url);
+	curl_easy_setopt (helper->curl, CURLOPT_NOPROGRESS, 1L);
+	curl_easy_setopt (helper->curl, CURLOPT_NOBODY, 1L);
+	curl_easy_setopt (helper->curl, CURLOPT_URL, url);
+	curl_easy_setopt (helper->curl, CURLOPT_ERRORBUFFER, errbuf);
+	curl_easy_setopt (helper->curl, CURLOPT_HEADERFUNCTION, fwupd_client_download_probe_header_cb);
+	curl_easy_setopt (helper->curl, CURLOPT_HEADERDATA, &probe);
+	res = curl_easy_perform (helper->curl);
+	probe_etag = g_steal_pointer (&probe.etag);
+	if (res != CURLE_OK) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "failed to query %s: %s",
+			     url, errbuf[0] != '\0' ? errbuf : curl_easy_strerror (res));
+		return 0;
+	}
+	curl_easy_getinfo (helper->curl, CURLINFO_RESPONSE_CODE, &status_code);
+	if (status_code != 200) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "failed to query %s: HTTP status %ld",
+			     url, status_code);
+		return 0;
+	}
+	if (!probe.accept_ranges) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "%s does not support ranges",
+			     url);
+		return 0;
+	}
+	curl_easy_getinfo (helper->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &size);
+	if (size <= 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "%s has no content length",
+			     url);
+		return 0;
+	}
+	if (etag != NULL)
+		*etag = g_steal_pointer (&probe_etag);
+	return (guint64) size;
+}
+
 static size_t
-fwupd_client_download_write_callback_cb (char *ptr, size_t size, size_t nmemb, void *userdata)
+fwupd_client_download_range_write_cb (char *ptr, size_t size, size_t nmemb, void *userdata)
 {
-	GByteArray *buf = (GByteArray *) userdata;
+	FwupdClientDownloadRange *range = (FwupdClientDownloadRange *) userdata;
+	FwupdClientDownloadRanged *ranged = range->ranged;
 	gsize realsize = size * nmemb;
-	g_byte_array_append (buf, (const guint8 *) ptr, realsize);
+	guint64 offset = range->start + range->received;
+
+	/* a mirror that ignored the range would overwrite the other ranges */
+	if (range->status_code == 0) {
+		curl_easy_getinfo (range->helper->curl, CURLINFO_RESPONSE_CODE, &range->status_code);
+		if (range->status_code != 206)
+			return 0;
+	}
+	if (offset + realsize > range->end + 1)
+		return 0;
+	memcpy (ranged->buf + offset, ptr, realsize);
+	range->received += realsize;
+	ranged->progress.received += realsize;
+	fwupd_client_download_progress_update (&ranged->progress);
 	return realsize;
 }
 
-static GBytes *
-fwupd_client_stream_read_bytes (GInputStream *stream, GError **error)
+static gboolean
+fwupd_client_download_range_start (FwupdClient *self,
+				   FwupdClientDownloadRange *range,
+				   GError **error)
 {
-	guint8 tmp[0x8000] = { 0x0 };
-	g_autoptr(GByteArray) buf = g_byte_array_new ();
+	FwupdClientDownloadRanged *ranged = range->ranged;
+	const gchar *url = g_ptr_array_index (ranged->urls, range->url_idx);
+	g_autofree gchar *str = NULL;
+	g_autoptr(FwupdCurlHelper) helper = NULL;
 
-	/* read from stream in 32kB chunks */
-	while (TRUE) {
-		gssize sz;
-		sz = g_input_stream_read (stream, tmp, sizeof(tmp), NULL, error);
-		if (sz == 0)
-			break;
-		if (sz < 0)
-			return NULL;
-		g_byte_array_append (buf, tmp, sz);
-	}
-	return g_byte_array_free_to_bytes (g_steal_pointer (&buf));
+	helper = fwupd_client_curl_new (self, error);
+	if (helper == NULL)
+		return FALSE;
+	range->status_code = 0;
+	range->errbuf[0] = '\0';
+
+	/* only fetch what is still missing */
+	str = g_strdup_printf ("%" G_GUINT64_FORMAT "-%" G_GUINT64_FORMAT,
+			       range->start + range->received, range->end);
+	g_debug ("downloading range %s from %s", str, url);
+	fwupd_client_curl_helper_set_proxy (self, helper, url);
+	curl_easy_setopt (helper->curl, CURLOPT_NOPROGRESS, 1L);
+	curl_easy_setopt (helper->curl, CURLOPT_URL, url);
+	curl_easy_setopt (helper->curl, CURLOPT_RANGE, str);
+	curl_easy_setopt (helper->curl, CURLOPT_PRIVATE, range);
+	curl_easy_setopt (helper->curl, CURLOPT_ERRORBUFFER, range->errbuf);
+	curl_easy_setopt (helper->curl, CURLOPT_WRITEFUNCTION, fwupd_client_download_range_write_cb);
+	curl_easy_setopt (helper->curl, CURLOPT_WRITEDATA, range);
+
+	/* success */
+	if (range->helper != NULL)
+		fwupd_client_curl_helper_free (range->helper);
+	range->helper = g_steal_pointer (&helper);
+	return TRUE;
 }
 
-static GBytes *
-fwupd_client_download_ipfs (FwupdClient *self, const gchar *url, GError **error)
+/* returns TRUE if the rest of @range is being fetched from another mirror */
+static gboolean
+fwupd_client_download_range_done (FwupdClient *self,
+				  FwupdClientDownloadRange *range,
+				  CURLcode res)
 {
-	GInputStream *stream = NULL;
-	g_autofree gchar *path = NULL;
-	g_autoptr(GSubprocess) subprocess = NULL;
+	FwupdClientDownloadRanged *ranged = range->ranged;
+	g_autofree gchar *reason = NULL;
 
-	/* we get no detailed progress details */
-	fwupd_client_set_status (self, FWUPD_STATUS_DOWNLOADING);
-	fwupd_client_set_percentage (self, 0);
+	/* complete */
+	if (res == CURLE_OK && range->start + range->received == range->end + 1)
+		return FALSE;
 
-	/* convert from URI to path */
-	if (g_str_has_prefix (url, "ipfs://")) {
-		path = g_strdup_printf ("/ipfs/%s", url + 7);
-	} else if (g_str_has_prefix (url, "ipns://")) {
-		path = g_strdup_printf ("/ipns/%s", url + 7);
+	/* try each mirror once */
+	if (range->status_code == 0)
+		curl_easy_getinfo (range->helper->curl, CURLINFO_RESPONSE_CODE, &range->status_code);
+	if (range->status_code != 206) {
+		reason = g_strdup_printf ("HTTP status %ld", range->status_code);
+	} else if (res != CURLE_OK) {
+		reason = g_strdup (range->errbuf[0] != '\0' ? range->errbuf : curl_easy_strerror (res));
 	} else {
-		path = g_strdup (url);
+		reason = g_strdup ("transfer was incomplete");
+	}
+	if (++range->attempts >= ranged->urls->len) {
+		g_set_error (&range->error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "failed to download file: %s",
+			     reason);
+		return FALSE;
 	}
+	g_debug ("failed to download range from %s: %s, trying next URI…",
+		 (const gchar *) g_ptr_array_index (ranged->urls, range->url_idx),
+		 reason);
+	range->url_idx = (range->url_idx + 1) % ranged->urls->len;
+	return fwupd_client_download_range_start (self, range, &range->error);
+}
+
+/* returns the number of bytes already in the partial file of the first mirror,
+ * which are copied to the start of the buffer; takes ownership of @etag */
+static guint64
+fwupd_client_download_ranged_resume (FwupdClientDownloadRanged *ranged, gchar *etag)
+{
+	FwupdClientDownloadPartial *partial = &ranged->partial;
+	gsize bufsz = 0;
+	g_autofree gchar *buf = NULL;
+	g_autofree gchar *etag_saved = NULL;
+	g_autoptr(GError) error_local = NULL;
 
-	/* run sync */
-	subprocess = g_subprocess_new (G_SUBPROCESS_FLAGS_STDOUT_PIPE,
-				       error, "ipfs", "cat", path, NULL);
-	if (subprocess == NULL)
-		return NULL;
-	if (!g_subprocess_wait_check (subprocess, NULL, error))
-		return NULL;
+	partial->etag = etag;
+	fwupd_client_download_partial_open (partial, g_ptr_array_index (ranged->urls, 0));
+	if (partial->fp == NULL)
+		return 0;
+	if (partial->progress.offset == 0) {
+		fwupd_client_download_partial_save_validators (partial);
+		return 0;
+	}
 
-	/* get raw stdout */
-	stream = g_subprocess_get_stdout_pipe (subprocess);
-	return fwupd_client_stream_read_bytes (stream, error);
+	/* the HEAD response has to match what the partial file was saved from */
+	etag_saved = fwupd_client_download_partial_load_etag (partial);
+	if (partial->progress.offset >= ranged->bufsz ||
+	    g_strcmp0 (etag_saved, partial->etag) != 0) {
+		g_debug ("partial download of %s is invalid, restarting", partial->fn);
+	} else if (!g_file_get_contents (partial->fn, &buf, &bufsz, &error_local)) {
+		g_debug ("failed to read %s: %s", partial->fn, error_local->message);
+	} else if (bufsz != partial->progress.offset) {
+		g_debug ("partial download of %s changed size, restarting", partial->fn);
+	} else {
+		g_debug ("resuming %s from %" G_GUINT64_FORMAT " bytes",
+			 partial->fn, partial->progress.offset);
+		memcpy (ranged->buf, buf, bufsz);
+		return partial->progress.offset;
+	}
+	if (!fwupd_client_download_partial_truncate (partial)) {
+		g_debug ("failed to truncate %s: %s", partial->fn, g_strerror (errno));
+		fclose (g_steal_pointer (&partial->fp));
+		return 0;
+	}
+	fwupd_client_download_partial_save_validators (partial);
+	return 0;
 }
 
-static GBytes *
-fwupd_client_download_http (FwupdClient *self,
-			    CURL *curl,
-			    const gchar *url,
-			    GError **error)
+/* append the contiguous data after the partial file so it can be resumed */
+static void
+fwupd_client_download_ranged_save (FwupdClientDownloadRanged *ranged)
 {
-	CURLcode res;
-	gchar errbuf[CURL_ERROR_SIZE] = { '\0' };
-	g_autoptr(GByteArray) buf = g_byte_array_new ();
+	FwupdClientDownloadPartial *partial = &ranged->partial;
+
+	if (partial->fp == NULL)
+		return;
+	for (guint i = 0; i < ranged->ranges->len; i++) {
+		FwupdClientDownloadRange *range = g_ptr_array_index (ranged->ranges, i);
+		if (range->received > 0 &&
+		    fwrite (ranged->buf + range->start, 1, range->received, partial->fp) != range->received) {
+			g_debug ("failed to write %s: %s", partial->fn, g_strerror (errno));
+			break;
+		}
+		if (range->start + range->received != range->end + 1)
+			break;
+	}
+	if (fflush (partial->fp) != 0)
+		g_debug ("failed to write %s: %s", partial->fn, g_strerror (errno));
+}
+
+/* fetch a different part of the file from each mirror at the same time */
+static GBytes *
+fwupd_client_download_http_ranged (FwupdClient *self, GPtrArray *urls, GError **error)
+{
+	gint running = 0;
+	guint64 offset;
+	guint64 size;
+	guint nr_ranges;
+	g_autofree gchar *etag = NULL;
+	g_autofree guint8 *buf = NULL;
+	g_autoptr(FwupdClientDownloadRanged) ranged = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	/* only worth it for large files, and every mirror is expected to be the same */
+	size = fwupd_client_download_http_probe (self, g_ptr_array_index (urls, 0), &etag, error);
+	if (size == 0)
+		return NULL;
+	if (size < FWUPD_CLIENT_DOWNLOAD_RANGED_MIN_SIZE) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "file of %" G_GUINT64_FORMAT " bytes is too small",
+			     size);
+		return NULL;
+	}
+
+	/* the size comes from the server, so do not trust it for the allocation */
+	if (size > FWUPD_CLIENT_DOWNLOAD_RANGED_MAX_SIZE) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "file of %" G_GUINT64_FORMAT " bytes is too large",
+			     size);
+		return NULL;
+	}
+	buf = g_try_malloc (size);
+	if (buf == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "failed to allocate %" G_GUINT64_FORMAT " bytes",
+			     size);
+		return NULL;
+	}
+	ranged = g_new0 (FwupdClientDownloadRanged, 1);
+	ranged->buf = g_steal_pointer (&buf);
+	ranged->bufsz = size;
+	ranged->urls = g_ptr_array_ref (urls);
+	ranged->ranges = g_ptr_array_new_with_free_func ((GDestroyNotify) fwupd_client_download_range_free);
+	ranged->multi = curl_multi_init ();
+	offset = fwupd_client_download_ranged_resume (ranged, g_steal_pointer (&etag));
+	fwupd_client_download_progress_init (&ranged->progress, self);
+	ranged->progress.offset = offset;
+	ranged->progress.total = size;
+
+	/* split what is left into contiguous ranges, each starting on a different mirror */
+	nr_ranges = MIN (urls->len, FWUPD_CLIENT_DOWNLOAD_RANGED_MAX);
+	nr_ranges = MIN (nr_ranges, size - offset);
+	for (guint i = 0; i < nr_ranges; i++) {
+		FwupdClientDownloadRange *range = g_new0 (FwupdClientDownloadRange, 1);
+		range->ranged = ranged;
+		range->url_idx = i;
+		range->start = offset + ((size - offset) * i) / nr_ranges;
+		range->end = offset + (((size - offset) * (i + 1)) / nr_ranges) - 1;
+		g_ptr_array_add (ranged->ranges, range);
+		if (!fwupd_client_download_range_start (self, range, error))
+			return NULL;
+		curl_multi_add_handle (ranged->multi, range->helper->curl);
+		range->active = TRUE;
+	}
 
+	/* run until every range is complete */
 	fwupd_client_set_status (self, FWUPD_STATUS_DOWNLOADING);
-	curl_easy_setopt (curl, CURLOPT_URL, url);
-	curl_easy_setopt (curl, CURLOPT_ERRORBUFFER, errbuf);
-	curl_easy_setopt (curl, CURLOPT_WRITEFUNCTION, fwupd_client_download_write_callback_cb);
-	curl_easy_setopt (curl, CURLOPT_WRITEDATA, buf);
-	res = curl_easy_perform (curl);
-	fwupd_client_set_status (self, FWUPD_STATUS_IDLE);
-	if (res != CURLE_OK) {
-		glong status_code = 0;
-		curl_easy_getinfo (curl, CURLINFO_RESPONSE_CODE, &status_code);
-		g_debug ("status-code was %ld", status_code);
-		if (status_code == 429) {
-			g_set_error (error,
+	while (TRUE) {
+		CURLMsg *msg;
+		CURLMcode mc;
+		gint msgs_left = 0;
+
+		mc = curl_multi_perform (ranged->multi, &running);
+		if (mc != CURLM_OK) {
+			g_set_error (&error_local,
 				     FWUPD_ERROR,
-				     FWUPD_ERROR_INVALID_FILE,
-				     "Failed to download due to server limit");
-			return NULL;
+				     FWUPD_ERROR_INTERNAL,
+				     "failed to download: %s",
+				     curl_multi_strerror (mc));
+			break;
 		}
-		if (errbuf[0] != '\0') {
-			g_set_error (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_INVALID_FILE,
-				     "failed to download file: %s",
-				     errbuf);
-			return NULL;
+		while ((msg = curl_multi_info_read (ranged->multi, &msgs_left)) != NULL) {
+			FwupdClientDownloadRange *range = NULL;
+			if (msg->msg != CURLMSG_DONE)
+				continue;
+			curl_easy_getinfo (msg->easy_handle, CURLINFO_PRIVATE, (char **) &range);
+			curl_multi_remove_handle (ranged->multi, msg->easy_handle);
+			range->active = FALSE;
+			if (fwupd_client_download_range_done (self, range, msg->data.result)) {
+				curl_multi_add_handle (ranged->multi, range->helper->curl);
+				range->active = TRUE;
+				running++;
+			}
 		}
-		g_set_error (error,
-			     FWUPD_ERROR,
-			     FWUPD_ERROR_INVALID_FILE,
-			     "failed to download file: %s",
-			     curl_easy_strerror (res));
+		if (running == 0)
+			break;
+		curl_multi_wait (ranged->multi, NULL, 0, 1000, NULL);
+	}
+	fwupd_client_set_status (self, FWUPD_STATUS_IDLE);
+	for (guint i = 0; error_local == NULL && i < ranged->ranges->len; i++) {
+		FwupdClientDownloadRange *range = g_ptr_array_index (ranged->ranges, i);
+		if (range->error != NULL)
+			error_local = g_steal_pointer (&range->error);
+	}
+	if (error_local != NULL) {
+		fwupd_client_download_ranged_save (ranged);
+		g_propagate_error (error, g_steal_pointer (&error_local));
 		return NULL;
 	}
-	return g_byte_array_free_to_bytes (g_steal_pointer (&buf));
+
+	/* the partial is not required anymore */
+	if (ranged->partial.fp != NULL)
+		fwupd_client_download_partial_remove (&ranged->partial);
+
+	/* success */
+	return g_bytes_new_take (g_steal_pointer (&ranged->buf), ranged->bufsz);
 }
 
-static void
-fwupd_client_download_bytes_thread_cb (GTask *task,
-				       gpointer source_object,
-				       gpointer task_data,
-				       GCancellable *cancellable)
+/* tries each URL in turn, blocking until complete */
+static GBytes *
+fwupd_client_download_bytes_helper (FwupdClient *self, FwupdCurlHelper *helper, GError **error)
 {
-	FwupdClient *self = FWUPD_CLIENT (source_object);
-	FwupdCurlHelper *helper = g_task_get_task_data (task);
 	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GPtrArray) urls_http = g_ptr_array_new ();
 
+	/* large files can be fetched from several mirrors at once */
 	for (guint i = 0; i < helper->urls->len; i++) {
 		const gchar *url = g_ptr_array_index (helper->urls, i);
-		g_autoptr(GError) error = NULL;
+		if (fwupd_client_is_url_http (url))
+			g_ptr_array_add (urls_http, (gpointer) url);
+	}
+	if (urls_http->len > 1) {
+		g_autoptr(GError) error_local = NULL;
+		blob = fwupd_client_download_http_ranged (self, urls_http, &error_local);
+		if (blob != NULL)
+			return g_steal_pointer (&blob);
+		g_debug ("failed to download ranges: %s, trying each URI in turn",
+			 error_local->message);
+		fwupd_client_set_percentage (self, 0);
+	}
+
+	for (guint i = 0; i < helper->urls->len; i++) {
+		const gchar *url = g_ptr_array_index (helper->urls, i);
+		g_autoptr(GError) error_local = NULL;
 		g_debug ("downloading %s", url);
 		fwupd_client_curl_helper_set_proxy (self, helper, url);
 		if (fwupd_client_is_url_http (url)) {
-			blob = fwupd_client_download_http (self, helper->curl, url, &error);
+			blob = fwupd_client_download_http (self, helper->curl, url, &error_local);
 			if (blob != NULL)
 				break;
 		} else if (fwupd_client_is_url_ipfs (url)) {
-			blob = fwupd_client_download_ipfs (self, url, &error);
+			blob = fwupd_client_download_ipfs (self, url, &error_local);
 			if (blob != NULL)
 				break;
 		} else {
-			g_set_error (&error,
+			g_set_error (&error_local,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "not sure how to handle: %s", url);
 		}
 		if (i == helper->urls->len - 1) {
-			g_task_return_error (task, g_steal_pointer (&error));
-			return;
+			g_propagate_error (error, g_steal_pointer (&error_local));
+			return NULL;
 		}
 		fwupd_client_set_percentage (self, 0);
 		fwupd_client_set_status (self, FWUPD_STATUS_IDLE);
 		g_debug ("failed to download %s: %s, trying next URI…",
-			 url, error->message);
+			 url, error_local->message);
 	}
-	g_task_return_pointer (task,
-			       g_steal_pointer (&blob),
-			       (GDestroyNotify) g_bytes_unref);
+	return g_steal_pointer (&blob);
+}
+
+static void
+fwupd_client_download_bytes_thread_cb (GTask *task,
+				       gpointer source_object,
+				       gpointer task_data,
+				       GCancellable *cancellable)
+{
+	FwupdClient *self = FWUPD_CLIENT (source_object);
+	FwupdCurlHelper *helper = g_task_get_task_data (task);
+	GBytes *blob;
+	GError *error = NULL;
+
+	blob = fwupd_client_download_bytes_helper (self, helper, &error);
+	if (blob == NULL) {
+		g_task_return_error (task, error);
+		return;
+	}
+	g_task_return_pointer (task, blob, (GDestroyNotify) g_bytes_unref);
 }
 #endif
 
@@ -4494,7 +6384,6 @@ fwupd_client_download_bytes2_async (FwupdClient *self,
 				    GAsyncReadyCallback callback,
 				    gpointer callback_data)
 {
-	FwupdClientPrivate *priv = GET_PRIVATE (self);
 	g_autoptr(GTask) task = NULL;
 #ifdef HAVE_LIBCURL
 	g_autoptr(GError) error = NULL;
@@ -4504,7 +6393,6 @@ fwupd_client_download_bytes2_async (FwupdClient *self,
 	g_return_if_fail (FWUPD_IS_CLIENT (self));
 	g_return_if_fail (urls != NULL);
 	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
-	g_return_if_fail (priv->proxy != NULL);
 
 	/* ensure networking set up */
 	task = g_task_new (self, cancellable, callback, callback_data);
@@ -4531,6 +6419,106 @@ fwupd_client_download_bytes2_async (FwupdClient *self,
 #endif
 }
 
+typedef struct {
+	GPtrArray			*urls;
+	FwupdClientDownloadFlags	 flags;
+	gchar				*checksum;
+} FwupdClientDownloadReleaseData;
+
+static void
+fwupd_client_download_release_data_free (FwupdClientDownloadReleaseData *data)
+{
+	g_ptr_array_unref (data->urls);
+	g_free (data->checksum);
+	g_free (data);
+}
+
+static void
+fwupd_client_download_release_thread_cb (GTask *task,
+					 gpointer source_object,
+					 gpointer task_data,
+					 GCancellable *cancellable)
+{
+	FwupdClientDownloadReleaseData *data = task_data;
+	g_autoptr(GBytes) blob = NULL;
+#ifdef HAVE_LIBCURL
+	FwupdClient *self = FWUPD_CLIENT (source_object);
+	g_autofree gchar *checksum_actual = NULL;
+	g_autoptr(FwupdCurlHelper) helper = NULL;
+	g_autoptr(GError) error = NULL;
+#endif
+
+	/* already downloaded, perhaps for an identical device */
+	blob = fwupd_client_download_cache_lookup (data->checksum);
+	if (blob != NULL) {
+		g_task_return_pointer (task,
+				       g_steal_pointer (&blob),
+				       (GDestroyNotify) g_bytes_unref);
+		return;
+	}
+
+#ifdef HAVE_LIBCURL
+	helper = fwupd_client_curl_new (self, &error);
+	if (helper == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	helper->urls = fwupd_client_filter_locations (data->urls, data->flags, &error);
+	if (helper->urls == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+	blob = fwupd_client_download_bytes_helper (self, helper, &error);
+	if (blob == NULL) {
+		g_task_return_error (task, g_steal_pointer (&error));
+		return;
+	}
+
+	/* verify checksum */
+	checksum_actual = g_compute_checksum_for_bytes (fwupd_checksum_guess_kind (data->checksum), blob);
+	if (g_strcmp0 (data->checksum, checksum_actual) != 0) {
+		g_task_return_new_error (task,
+					 FWUPD_ERROR,
+					 FWUPD_ERROR_INVALID_FILE,
+					 "checksum invalid, expected %s got %s",
+					 data->checksum, checksum_actual);
+		return;
+	}
+
+	/* save for the next device that uses the same release */
+	fwupd_client_download_cache_save (data->checksum, blob);
+	g_task_return_pointer (task,
+			       g_steal_pointer (&blob),
+			       (GDestroyNotify) g_bytes_unref);
+#else
+	g_task_return_new_error (task,
+				 FWUPD_ERROR,
+				 FWUPD_ERROR_NOT_SUPPORTED,
+				 "no libcurl support");
+#endif
+}
+
+/* like fwupd_client_download_bytes2_async(), but also uses the download cache
+ * and verifies @checksum, with all the file access done in the worker thread */
+static void
+fwupd_client_download_release_async (FwupdClient *self,
+				     GPtrArray *urls,
+				     FwupdClientDownloadFlags flags,
+				     const gchar *checksum,
+				     GCancellable *cancellable,
+				     GAsyncReadyCallback callback,
+				     gpointer callback_data)
+{
+	FwupdClientDownloadReleaseData *data = g_new0 (FwupdClientDownloadReleaseData, 1);
+	g_autoptr(GTask) task = g_task_new (self, cancellable, callback, callback_data);
+
+	data->urls = g_ptr_array_ref (urls);
+	data->flags = flags;
+	data->checksum = g_strdup (checksum);
+	g_task_set_task_data (task, data, (GDestroyNotify) fwupd_client_download_release_data_free);
+	g_task_run_in_thread (task, fwupd_client_download_release_thread_cb);
+}
+
 /**
  * fwupd_client_download_bytes_async:
  * @self: a #FwupdClient
@@ -4543,8 +6531,9 @@ fwupd_client_download_bytes2_async (FwupdClient *self,
  * Downloads data from a remote server. The [method@Client.set_user_agent] function
  * should be called before this method is used.
  *
- * You must have called [method@Client.connect_async] on @self before using
- * this method.
+ * Interrupted downloads are resumed from where they stopped the next time the
+ * same URL is requested, if the server sent a strong ETag that can be used
+ * to check the file has not changed since.
  *
  * NOTE: This method is thread-safe, but progress signals will be
  * emitted in the global default main context, if not explicitly set with
@@ -4560,13 +6549,11 @@ fwupd_client_download_bytes_async (FwupdClient *self,
 				   GAsyncReadyCallback callback,
 				   gpointer callback_data)
 {
-	FwupdClientPrivate *priv = GET_PRIVATE (self);
 	g_autoptr(GPtrArray) urls = g_ptr_array_new_with_free_func (g_free);
 
 	g_return_if_fail (FWUPD_IS_CLIENT (self));
 	g_return_if_fail (url != NULL);
 	g_return_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
-	g_return_if_fail (priv->proxy != NULL);
 
 	/* just proxy */
 	g_ptr_array_add (urls, g_strdup (url));
@@ -4833,6 +6820,9 @@ fwupd_client_get_property (GObject *object, guint prop_id,
 	case PROP_INTERACTIVE:
 		g_value_set_boolean (value, priv->interactive);
 		break;
+	case PROP_DOWNLOAD_SPEED:
+		g_value_set_uint64 (value, priv->download_speed);
+		break;
 	default:
 		G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
 		break;
@@ -4998,6 +6988,18 @@ fwupd_client_class_init (FwupdClientClass *klass)
 				   G_PARAM_READWRITE | G_PARAM_STATIC_NAME);
 	g_object_class_install_property (object_class, PROP_PERCENTAGE, pspec);
 
+	/**
+	 * FwupdClient:download-speed:
+	 *
+	 * The transfer rate of the current download in bytes per second.
+	 *
+	 * Since: 1.6.2
+	 */
+	pspec = g_param_spec_uint64 ("download-speed", NULL, NULL,
+				     0, G_MAXUINT64, 0,
+				     G_PARAM_READABLE | G_PARAM_STATIC_NAME);
+	g_object_class_install_property (object_class, PROP_DOWNLOAD_SPEED, pspec);
+
 	/**
 	 * FwupdClient:daemon-version:
 	 *
@@ -5060,6 +7062,7 @@ fwupd_client_init (FwupdClient *self)
 	FwupdClientPrivate *priv = GET_PRIVATE (self);
 	g_mutex_init (&priv->proxy_mutex);
 	g_mutex_init (&priv->idle_mutex);
+	g_mutex_init (&priv->cache_mutex);
 	priv->idle_sources = g_ptr_array_new_with_free_func ((GDestroyNotify) fwupd_client_context_helper_free);
 	priv->proxy_resolver = g_proxy_resolver_get_default ();
 }
@@ -5083,6 +7086,11 @@ fwupd_client_finalize (GObject *object)
 	g_mutex_clear (&priv->proxy_mutex);
 	if (priv->proxy != NULL)
 		g_object_unref (priv->proxy);
+	g_mutex_clear (&priv->cache_mutex);
+	if (priv->cache_devices != NULL)
+		g_ptr_array_unref (priv->cache_devices);
+	if (priv->cache_remotes != NULL)
+		g_ptr_array_unref (priv->cache_remotes);
 #ifdef SOUP_SESSION_COMPAT
 	if (priv->soup_session != NULL)
 		g_object_unref (priv->soup_session);
@@ -73,6 +73,9 @@ FwupdClient	*fwupd_client_new			(void);
 GMainContext	*fwupd_client_get_main_context		(FwupdClient	*self);
 void		 fwupd_client_set_main_context		(FwupdClient	*self,
 							 GMainContext	*main_ctx);
+gboolean	 fwupd_client_get_cache_enabled		(FwupdClient	*self);
+void		 fwupd_client_set_cache_enabled		(FwupdClient	*self,
+							 gboolean	 cache_enabled);
 void		 fwupd_client_connect_async		(FwupdClient	*self,
 							 GCancellable	*cancellable,
 							 GAsyncReadyCallback callback,
@@ -293,6 +296,15 @@ gboolean	 fwupd_client_refresh_remote_finish	(FwupdClient	*self,
 							 GAsyncResult	*res,
 							 GError		**error)
 							 G_GNUC_WARN_UNUSED_RESULT;
+void		 fwupd_client_refresh_remotes_async	(FwupdClient	*self,
+							 GPtrArray	*remotes,
+							 GCancellable	*cancellable,
+							 GAsyncReadyCallback callback,
+							 gpointer	 callback_data);
+gboolean	 fwupd_client_refresh_remotes_finish	(FwupdClient	*self,
+							 GAsyncResult	*res,
+							 GError		**error)
+							 G_GNUC_WARN_UNUSED_RESULT;
 void		 fwupd_client_modify_remote_async	(FwupdClient	*self,
 							 const gchar	*remote_id,
 							 const gchar	*key,
@@ -328,6 +340,7 @@ FwupdStatus	 fwupd_client_get_status		(FwupdClient	*self);
 gboolean	 fwupd_client_get_tainted		(FwupdClient	*self);
 gboolean	 fwupd_client_get_daemon_interactive	(FwupdClient	*self);
 guint		 fwupd_client_get_percentage		(FwupdClient	*self);
+guint64		 fwupd_client_get_download_speed	(FwupdClient	*self);
 const gchar	*fwupd_client_get_daemon_version	(FwupdClient	*self);
 const gchar	*fwupd_client_get_host_product		(FwupdClient	*self);
 const gchar	*fwupd_client_get_host_machine_id	(FwupdClient	*self);
@@ -434,5 +447,8 @@ GBytes		*fwupd_client_upload_bytes_finish	(FwupdClient	*self,
 gboolean	 fwupd_client_ensure_networking		(FwupdClient	*self,
 							 GError		**error)
 							 G_GNUC_WARN_UNUSED_RESULT;
+gboolean	 fwupd_client_download_cache_prune	(guint64	 max_size,
+							 GError		**error)
+							 G_GNUC_WARN_UNUSED_RESULT;
 
 G_END_DECLS
@@ -66,6 +66,8 @@ typedef struct {
 	FwupdStatus			 status;
 	GPtrArray			*releases;
 	FwupdDevice			*parent;	/* noref */
+	GVariant			*variant_untrusted;	/* cached */
+	GVariant			*variant_trusted;	/* cached */
 } FwupdDevicePrivate;
 
 enum {
@@ -82,6 +84,15 @@ enum {
 G_DEFINE_TYPE_WITH_PRIVATE (FwupdDevice, fwupd_device, G_TYPE_OBJECT)
 #define GET_PRIVATE(o) (fwupd_device_get_instance_private (o))
 
+/* called before any of the serialized properties are changed */
+static void
+fwupd_device_invalidate_variant (FwupdDevice *self)
+{
+	FwupdDevicePrivate *priv = GET_PRIVATE (self);
+	g_clear_pointer (&priv->variant_untrusted, g_variant_unref);
+	g_clear_pointer (&priv->variant_trusted, g_variant_unref);
+}
+
 /**
  * fwupd_device_get_checksums:
  * @self: a #FwupdDevice
@@ -120,6 +131,7 @@ fwupd_device_add_checksum (FwupdDevice *self, const gchar *checksum)
 		if (g_strcmp0 (checksum_tmp, checksum) == 0)
 			return;
 	}
+	fwupd_device_invalidate_variant (self);
 	g_ptr_array_add (priv->checksums, g_strdup (checksum));
 }
 
@@ -178,6 +190,7 @@ fwupd_device_set_summary (FwupdDevice *self, const gchar *summary)
 	if (g_strcmp0 (priv->summary, summary) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->summary);
 	priv->summary = g_strdup (summary);
 }
@@ -219,6 +232,7 @@ fwupd_device_set_branch (FwupdDevice *self, const gchar *branch)
 	if (g_strcmp0 (priv->branch, branch) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->branch);
 	priv->branch = g_strdup (branch);
 }
@@ -260,6 +274,7 @@ fwupd_device_set_serial (FwupdDevice *self, const gchar *serial)
 	if (g_strcmp0 (priv->serial, serial) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->serial);
 	priv->serial = g_strdup (serial);
 }
@@ -301,6 +316,7 @@ fwupd_device_set_id (FwupdDevice *self, const gchar *id)
 	if (g_strcmp0 (priv->id, id) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->id);
 	priv->id = g_strdup (id);
 }
@@ -342,6 +358,7 @@ fwupd_device_set_parent_id (FwupdDevice *self, const gchar *parent_id)
 	if (g_strcmp0 (priv->parent_id, parent_id) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->parent_id);
 	priv->parent_id = g_strdup (parent_id);
 }
@@ -389,6 +406,7 @@ fwupd_device_set_composite_id (FwupdDevice *self, const gchar *composite_id)
 	if (g_strcmp0 (priv->composite_id, composite_id) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->composite_id);
 	priv->composite_id = g_strdup (composite_id);
 }
@@ -568,6 +586,7 @@ fwupd_device_add_guid (FwupdDevice *self, const gchar *guid)
 	g_return_if_fail (guid != NULL);
 	if (fwupd_device_has_guid (self, guid))
 		return;
+	fwupd_device_invalidate_variant (self);
 	g_ptr_array_add (priv->guids, g_strdup (guid));
 }
 
@@ -653,6 +672,7 @@ fwupd_device_add_instance_id (FwupdDevice *self, const gchar *instance_id)
 	g_return_if_fail (instance_id != NULL);
 	if (fwupd_device_has_instance_id (self, instance_id))
 		return;
+	fwupd_device_invalidate_variant (self);
 	g_ptr_array_add (priv->instance_ids, g_strdup (instance_id));
 }
 
@@ -706,6 +726,7 @@ fwupd_device_add_icon (FwupdDevice *self, const gchar *icon)
 	g_return_if_fail (icon != NULL);
 	if (fwupd_device_has_icon (self, icon))
 		return;
+	fwupd_device_invalidate_variant (self);
 	g_ptr_array_add (priv->icons, g_strdup (icon));
 }
 
@@ -746,6 +767,7 @@ fwupd_device_set_name (FwupdDevice *self, const gchar *name)
 	if (g_strcmp0 (priv->name, name) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->name);
 	priv->name = g_strdup (name);
 }
@@ -787,6 +809,7 @@ fwupd_device_set_vendor (FwupdDevice *self, const gchar *vendor)
 	if (g_strcmp0 (priv->vendor, vendor) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->vendor);
 	priv->vendor = g_strdup (vendor);
 }
@@ -901,6 +924,7 @@ fwupd_device_add_vendor_id (FwupdDevice *self, const gchar *vendor_id)
 
 	if (fwupd_device_has_vendor_id (self, vendor_id))
 		return;
+	fwupd_device_invalidate_variant (self);
 	g_ptr_array_add (priv->vendor_ids, g_strdup (vendor_id));
 
 	/* build for compatibility */
@@ -950,6 +974,7 @@ fwupd_device_set_description (FwupdDevice *self, const gchar *description)
 	if (g_strcmp0 (priv->description, description) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->description);
 	priv->description = g_strdup (description);
 }
@@ -991,6 +1016,7 @@ fwupd_device_set_version (FwupdDevice *self, const gchar *version)
 	if (g_strcmp0 (priv->version, version) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->version);
 	priv->version = g_strdup (version);
 }
@@ -1032,6 +1058,7 @@ fwupd_device_set_version_lowest (FwupdDevice *self, const gchar *version_lowest)
 	if (g_strcmp0 (priv->version_lowest, version_lowest) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->version_lowest);
 	priv->version_lowest = g_strdup (version_lowest);
 }
@@ -1068,6 +1095,7 @@ fwupd_device_set_version_lowest_raw (FwupdDevice *self, guint64 version_lowest_r
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FWUPD_IS_DEVICE (self));
+	fwupd_device_invalidate_variant (self);
 	priv->version_lowest_raw = version_lowest_raw;
 }
 
@@ -1108,6 +1136,7 @@ fwupd_device_set_version_bootloader (FwupdDevice *self, const gchar *version_boo
 	if (g_strcmp0 (priv->version_bootloader, version_bootloader) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->version_bootloader);
 	priv->version_bootloader = g_strdup (version_bootloader);
 }
@@ -1144,6 +1173,7 @@ fwupd_device_set_version_bootloader_raw (FwupdDevice *self, guint64 version_boot
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FWUPD_IS_DEVICE (self));
+	fwupd_device_invalidate_variant (self);
 	priv->version_bootloader_raw = version_bootloader_raw;
 }
 
@@ -1179,6 +1209,7 @@ fwupd_device_set_flashes_left (FwupdDevice *self, guint32 flashes_left)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FWUPD_IS_DEVICE (self));
+	fwupd_device_invalidate_variant (self);
 	priv->flashes_left = flashes_left;
 }
 
@@ -1214,6 +1245,7 @@ fwupd_device_set_install_duration (FwupdDevice *self, guint32 duration)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FWUPD_IS_DEVICE (self));
+	fwupd_device_invalidate_variant (self);
 	priv->install_duration = duration;
 }
 
@@ -1254,6 +1286,7 @@ fwupd_device_set_plugin (FwupdDevice *self, const gchar *plugin)
 	if (g_strcmp0 (priv->plugin, plugin) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->plugin);
 	priv->plugin = g_strdup (plugin);
 }
@@ -1368,6 +1401,7 @@ fwupd_device_add_protocol (FwupdDevice *self, const gchar *protocol)
 
 	if (fwupd_device_has_protocol (self, protocol))
 		return;
+	fwupd_device_invalidate_variant (self);
 	g_ptr_array_add (priv->protocols, g_strdup (protocol));
 
 	/* build for compatibility */
@@ -1414,6 +1448,7 @@ fwupd_device_set_flags (FwupdDevice *self, guint64 flags)
 	g_return_if_fail (FWUPD_IS_DEVICE (self));
 	if (priv->flags == flags)
 		return;
+	fwupd_device_invalidate_variant (self);
 	priv->flags = flags;
 	g_object_notify (G_OBJECT (self), "flags");
 }
@@ -1436,6 +1471,7 @@ fwupd_device_add_flag (FwupdDevice *self, FwupdDeviceFlags flag)
 		return;
 	if ((priv->flags | flag) == priv->flags)
 		return;
+	fwupd_device_invalidate_variant (self);
 	priv->flags |= flag;
 	g_object_notify (G_OBJECT (self), "flags");
 }
@@ -1458,6 +1494,7 @@ fwupd_device_remove_flag (FwupdDevice *self, FwupdDeviceFlags flag)
 		return;
 	if ((priv->flags & flag) == 0)
 		return;
+	fwupd_device_invalidate_variant (self);
 	priv->flags &= ~flag;
 	g_object_notify (G_OBJECT (self), "flags");
 }
@@ -1513,6 +1550,7 @@ fwupd_device_set_created (FwupdDevice *self, guint64 created)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FWUPD_IS_DEVICE (self));
+	fwupd_device_invalidate_variant (self);
 	priv->created = created;
 }
 
@@ -1548,6 +1586,7 @@ fwupd_device_set_modified (FwupdDevice *self, guint64 modified)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FWUPD_IS_DEVICE (self));
+	fwupd_device_invalidate_variant (self);
 	priv->modified = modified;
 }
 
@@ -1655,6 +1694,9 @@ fwupd_device_incorporate (FwupdDevice *self, FwupdDevice *donor)
  * Serialize the device data.
  * Optionally provides additional data based upon flags
  *
+ * The serialized data is cached until the device is next modified, so
+ * repeated calls for an unchanged device do not rebuild the dictionary.
+ *
  * Returns: the serialized data, or %NULL for error
  *
  * Since: 1.1.2
@@ -1664,9 +1706,22 @@ fwupd_device_to_variant_full (FwupdDevice *self, FwupdDeviceFlags flags)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (self);
 	GVariantBuilder builder;
+	GVariant **variant_cached;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GVariant) val = NULL;
 
 	g_return_val_if_fail (FWUPD_IS_DEVICE (self), NULL);
 
+	/* only the trusted flag changes what is serialized */
+	if (flags & FWUPD_DEVICE_FLAG_TRUSTED)
+		variant_cached = &priv->variant_trusted;
+	else
+		variant_cached = &priv->variant_untrusted;
+	if (*variant_cached != NULL) {
+		blob = g_variant_get_data_as_bytes (*variant_cached);
+		return g_variant_new_from_bytes (G_VARIANT_TYPE_VARDICT, blob, TRUE);
+	}
+
 	/* create an array with all the metadata in */
 	g_variant_builder_init (&builder, G_VARIANT_TYPE_VARDICT);
 	if (priv->id != NULL) {
@@ -1876,7 +1931,15 @@ fwupd_device_to_variant_full (FwupdDevice *self, FwupdDeviceFlags flags)
 							    children,
 							    priv->releases->len));
 	}
-	return g_variant_new ("a{sv}", &builder);
+	val = g_variant_ref_sink (g_variant_new ("a{sv}", &builder));
+
+	/* releases can be modified without the device knowing */
+	if (priv->releases->len == 0)
+		*variant_cached = g_variant_ref (val);
+
+	/* always return a new floating reference */
+	blob = g_variant_get_data_as_bytes (val);
+	return g_variant_new_from_bytes (G_VARIANT_TYPE_VARDICT, blob, TRUE);
 }
 
 /**
@@ -2152,6 +2215,7 @@ fwupd_device_set_update_state (FwupdDevice *self, FwupdUpdateState update_state)
 	g_return_if_fail (FWUPD_IS_DEVICE (self));
 	if (priv->update_state == update_state)
 		return;
+	fwupd_device_invalidate_variant (self);
 	priv->update_state = update_state;
 	g_object_notify (G_OBJECT (self), "update-state");
 }
@@ -2188,6 +2252,7 @@ fwupd_device_set_version_format (FwupdDevice *self, FwupdVersionFormat version_f
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FWUPD_IS_DEVICE (self));
+	fwupd_device_invalidate_variant (self);
 	priv->version_format = version_format;
 }
 
@@ -2223,6 +2288,7 @@ fwupd_device_set_version_raw (FwupdDevice *self, guint64 version_raw)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FWUPD_IS_DEVICE (self));
+	fwupd_device_invalidate_variant (self);
 	priv->version_raw = version_raw;
 }
 
@@ -2263,6 +2329,7 @@ fwupd_device_set_update_message (FwupdDevice *self, const gchar *update_message)
 	if (g_strcmp0 (priv->update_message, update_message) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->update_message);
 	priv->update_message = g_strdup (update_message);
 }
@@ -2304,6 +2371,7 @@ fwupd_device_set_update_image (FwupdDevice *self, const gchar *update_image)
 	if (g_strcmp0 (priv->update_image, update_image) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->update_image);
 	priv->update_image = g_strdup (update_image);
 }
@@ -2345,6 +2413,7 @@ fwupd_device_set_update_error (FwupdDevice *self, const gchar *update_error)
 	if (g_strcmp0 (priv->update_error, update_error) == 0)
 		return;
 
+	fwupd_device_invalidate_variant (self);
 	g_free (priv->update_error);
 	priv->update_error = g_strdup (update_error);
 }
@@ -2401,6 +2470,7 @@ fwupd_device_add_release (FwupdDevice *self, FwupdRelease *release)
 {
 	FwupdDevicePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FWUPD_IS_DEVICE (self));
+	fwupd_device_invalidate_variant (self);
 	g_ptr_array_add (priv->releases, g_object_ref (release));
 }
 /**
@@ -2437,6 +2507,7 @@ fwupd_device_set_status (FwupdDevice *self, FwupdStatus status)
 	g_return_if_fail (FWUPD_IS_DEVICE (self));
 	if (priv->status == status)
 		return;
+	fwupd_device_invalidate_variant (self);
 	priv->status = status;
 	g_object_notify (G_OBJECT (self), "status");
 }
@@ -2863,6 +2934,7 @@ fwupd_device_finalize (GObject *object)
 	FwupdDevice *self = FWUPD_DEVICE (object);
 	FwupdDevicePrivate *priv = GET_PRIVATE (self);
 
+	fwupd_device_invalidate_variant (self);
 	if (priv->parent != NULL)
 		g_object_remove_weak_pointer (G_OBJECT (priv->parent), (gpointer *) &priv->parent);
 	for (guint i = 0; i < priv->children->len; i++) {
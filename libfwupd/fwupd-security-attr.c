@@ -915,6 +915,47 @@ fwupd_security_attr_array_from_variant (GVariant *value)
 	return array;
 }
 
+/**
+ * fwupd_security_attr_copy:
+ * @self: a #FwupdSecurityAttr
+ *
+ * Creates a new security attribute with all the same properties as @self.
+ *
+ * Returns: (transfer full): a new #FwupdSecurityAttr
+ *
+ * Since: 1.6.2
+ **/
+FwupdSecurityAttr *
+fwupd_security_attr_copy (FwupdSecurityAttr *self)
+{
+	FwupdSecurityAttrPrivate *priv = GET_PRIVATE (self);
+	FwupdSecurityAttrPrivate *priv_new;
+	FwupdSecurityAttr *new;
+
+	g_return_val_if_fail (FWUPD_IS_SECURITY_ATTR (self), NULL);
+
+	new = fwupd_security_attr_new (priv->appstream_id);
+	priv_new = GET_PRIVATE (new);
+	priv_new->name = g_strdup (priv->name);
+	priv_new->plugin = g_strdup (priv->plugin);
+	priv_new->url = g_strdup (priv->url);
+	priv_new->level = priv->level;
+	priv_new->result = priv->result;
+	priv_new->flags = priv->flags;
+	for (guint i = 0; i < priv->obsoletes->len; i++) {
+		const gchar *obsolete = g_ptr_array_index (priv->obsoletes, i);
+		fwupd_security_attr_add_obsolete (new, obsolete);
+	}
+	if (priv->metadata != NULL) {
+		GHashTableIter iter;
+		gpointer key, value;
+		g_hash_table_iter_init (&iter, priv->metadata);
+		while (g_hash_table_iter_next (&iter, &key, &value))
+			fwupd_security_attr_add_metadata (new, key, value);
+	}
+	return new;
+}
+
 /**
  * fwupd_security_attr_new:
  * @appstream_id: (nullable): the AppStream component ID, e.g. `com.intel.BiosGuard`
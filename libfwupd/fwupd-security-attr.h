@@ -112,6 +112,7 @@ typedef enum {
 } FwupdSecurityAttrResult;
 
 FwupdSecurityAttr *fwupd_security_attr_new		(const gchar		*appstream_id);
+FwupdSecurityAttr *fwupd_security_attr_copy		(FwupdSecurityAttr	*self);
 gchar		*fwupd_security_attr_to_string		(FwupdSecurityAttr	*self);
 
 const gchar	*fwupd_security_attr_get_appstream_id	(FwupdSecurityAttr	*self);
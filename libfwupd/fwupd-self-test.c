@@ -7,17 +7,20 @@
 #include "config.h"
 
 #include <glib-object.h>
+#include <glib/gstdio.h>
 #include <string.h>
 #ifdef HAVE_FNMATCH_H
 #include <fnmatch.h>
 #endif
 
 #include "fwupd-client.h"
+#include "fwupd-client-private.h"
 #include "fwupd-client-sync.h"
 #include "fwupd-common.h"
 #include "fwupd-enums.h"
 #include "fwupd-error.h"
 #include "fwupd-device-private.h"
+#include "fwupd-enums-private.h"
 #include "fwupd-release-private.h"
 #include "fwupd-remote-private.h"
 
@@ -480,6 +483,38 @@ fwupd_device_func (void)
 	g_assert (ret);
 }
 
+static void
+fwupd_device_variant_cache_func (void)
+{
+	const gchar *tmp = NULL;
+	g_autoptr(FwupdDevice) dev = fwupd_device_new ();
+	g_autoptr(GVariant) val1 = NULL;
+	g_autoptr(GVariant) val2 = NULL;
+	g_autoptr(GVariant) val3 = NULL;
+	g_autoptr(GVariant) val4 = NULL;
+
+	fwupd_device_set_id (dev, "USB:foo");
+	fwupd_device_set_name (dev, "ColorHug2");
+	fwupd_device_set_serial (dev, "12345");
+
+	/* unchanged */
+	val1 = g_variant_ref_sink (fwupd_device_to_variant (dev));
+	val2 = g_variant_ref_sink (fwupd_device_to_variant (dev));
+	g_assert_true (g_variant_equal (val1, val2));
+	g_assert_false (g_variant_lookup (val2, FWUPD_RESULT_KEY_SERIAL, "&s", &tmp));
+
+	/* the trusted data is cached separately */
+	val3 = g_variant_ref_sink (fwupd_device_to_variant_full (dev, FWUPD_DEVICE_FLAG_TRUSTED));
+	g_assert_true (g_variant_lookup (val3, FWUPD_RESULT_KEY_SERIAL, "&s", &tmp));
+	g_assert_cmpstr (tmp, ==, "12345");
+
+	/* modified */
+	fwupd_device_set_name (dev, "ColorHug3");
+	val4 = g_variant_ref_sink (fwupd_device_to_variant (dev));
+	g_assert_true (g_variant_lookup (val4, FWUPD_RESULT_KEY_NAME, "&s", &tmp));
+	g_assert_cmpstr (tmp, ==, "ColorHug3");
+}
+
 static void
 fwupd_client_devices_func (void)
 {
@@ -487,6 +522,9 @@ fwupd_client_devices_func (void)
 	gboolean ret;
 	g_autoptr(FwupdClient) client = NULL;
 	g_autoptr(GPtrArray) array = NULL;
+	g_autoptr(GPtrArray) array_cached1 = NULL;
+	g_autoptr(GPtrArray) array_cached2 = NULL;
+	g_autoptr(GPtrArray) array_uncached = NULL;
 	g_autoptr(GError) error = NULL;
 
 	client = fwupd_client_new ();
@@ -529,6 +567,28 @@ fwupd_client_devices_func (void)
 	g_assert (FWUPD_IS_DEVICE (dev));
 	g_assert_cmpstr (fwupd_device_get_guid_default (dev), !=, NULL);
 	g_assert_cmpstr (fwupd_device_get_id (dev), !=, NULL);
+
+	/* second call is served from the client-side cache */
+	fwupd_client_set_cache_enabled (client, TRUE);
+	array_cached1 = fwupd_client_get_devices (client, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (array_cached1 != NULL);
+	array_cached2 = fwupd_client_get_devices (client, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (array_cached2 != NULL);
+	g_assert_cmpint (array_cached1->len, ==, array_cached2->len);
+	for (guint i = 0; i < array_cached1->len; i++) {
+		FwupdDevice *dev1 = g_ptr_array_index (array_cached1, i);
+		FwupdDevice *dev2 = g_ptr_array_index (array_cached2, i);
+		g_assert_cmpstr (fwupd_device_get_id (dev1), ==, fwupd_device_get_id (dev2));
+	}
+
+	/* disabling drops the cached objects */
+	fwupd_client_set_cache_enabled (client, FALSE);
+	array_uncached = fwupd_client_get_devices (client, NULL, &error);
+	g_assert_no_error (error);
+	g_assert (array_uncached != NULL);
+	g_assert (g_ptr_array_index (array_cached1, 0) != g_ptr_array_index (array_uncached, 0));
 }
 
 static void
@@ -591,6 +651,524 @@ fwupd_client_remotes_func (void)
 	g_assert (remote3 == NULL);
 }
 
+static gchar *
+fwupd_test_download_cache_add (const gchar *basename, const gchar *data, guint64 mtime)
+{
+	gboolean ret;
+	g_autofree gchar *cachedir = g_build_filename (g_get_user_cache_dir (), "fwupd", "downloads", NULL);
+	g_autofree gchar *fn = g_build_filename (cachedir, basename, NULL);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GFile) file = g_file_new_for_path (fn);
+
+	g_assert_cmpint (g_mkdir_with_parents (cachedir, 0700), ==, 0);
+	ret = g_file_set_contents (fn, data, -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = g_file_set_attribute_uint64 (file,
+					   G_FILE_ATTRIBUTE_TIME_MODIFIED,
+					   mtime,
+					   G_FILE_QUERY_INFO_NONE,
+					   NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	return g_steal_pointer (&fn);
+}
+
+static void
+fwupd_client_download_cache_func (void)
+{
+	gboolean ret;
+	g_autofree gchar *checksum1 = g_compute_checksum_for_string (G_CHECKSUM_SHA256, "hello", -1);
+	g_autofree gchar *checksum2 = g_compute_checksum_for_string (G_CHECKSUM_SHA256, "world", -1);
+	g_autofree gchar *fn1 = NULL;
+	g_autofree gchar *fn2 = NULL;
+	g_autofree gchar *fn_part = NULL;
+	g_autofree gchar *fn_validators = NULL;
+	g_autoptr(GError) error = NULL;
+
+	/* start empty */
+	ret = fwupd_client_download_cache_prune (0, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* the least recently used is pruned first */
+	fn1 = fwupd_test_download_cache_add (checksum1, "hello", 1000);
+	fn2 = fwupd_test_download_cache_add (checksum2, "world", 2000);
+	fn_part = fwupd_test_download_cache_add ("0123abcd.part", "wor", 0);
+	fn_validators = fwupd_test_download_cache_add ("0123abcd.part.validators",
+						       "[download]\n", 0);
+	ret = fwupd_client_download_cache_prune (5, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_false (g_file_test (fn1, G_FILE_TEST_EXISTS));
+	g_assert_true (g_file_test (fn2, G_FILE_TEST_EXISTS));
+
+	/* remove everything, apart from the partial downloads */
+	ret = fwupd_client_download_cache_prune (0, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_false (g_file_test (fn2, G_FILE_TEST_EXISTS));
+	g_assert_true (g_file_test (fn_part, G_FILE_TEST_EXISTS));
+	g_assert_true (g_file_test (fn_validators, G_FILE_TEST_EXISTS));
+	g_unlink (fn_part);
+	g_unlink (fn_validators);
+}
+
+#ifdef HAVE_LIBCURL
+/* a minimal HTTP server that understands Range and can drop the connection */
+typedef struct {
+	GBytes		*payload;
+	gsize		 truncate;	/* close after this many bytes, once */
+	gboolean	 ignore_ranges;
+	gchar		*range;		/* last Range requested */
+	const gchar	*etag;
+	const gchar	*last_modified;
+	gchar		*if_none_match;	/* from the last request */
+	gchar		*if_modified_since;
+	gchar		*if_range;
+	guint		 not_modified_cnt;
+	guint		 request_cnt;
+	GMutex		 mutex;
+} FwupdTestHttpServer;
+
+static gboolean
+fwupd_test_http_server_run_cb (GThreadedSocketService *service,
+			       GSocketConnection *connection,
+			       GObject *source_object,
+			       gpointer user_data)
+{
+	FwupdTestHttpServer *server = (FwupdTestHttpServer *) user_data;
+	GOutputStream *ostream = g_io_stream_get_output_stream (G_IO_STREAM (connection));
+	const guint8 *buf = g_bytes_get_data (server->payload, NULL);
+	gsize bufsz = g_bytes_get_size (server->payload);
+	gsize start = 0;
+	gsize end = bufsz - 1;
+	gsize length;
+	gboolean is_head = FALSE;
+	gboolean is_partial = FALSE;
+	g_autoptr(GDataInputStream) istream = NULL;
+	g_autoptr(GString) hdr = g_string_new (NULL);
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&server->mutex);
+
+	g_assert (locker != NULL);
+	server->request_cnt++;
+	g_clear_pointer (&server->if_none_match, g_free);
+	g_clear_pointer (&server->if_modified_since, g_free);
+	g_clear_pointer (&server->if_range, g_free);
+
+	/* parse request */
+	istream = g_data_input_stream_new (g_io_stream_get_input_stream (G_IO_STREAM (connection)));
+	g_data_input_stream_set_newline_type (istream, G_DATA_STREAM_NEWLINE_TYPE_CR_LF);
+	while (TRUE) {
+		g_autofree gchar *line = g_data_input_stream_read_line (istream, NULL, NULL, NULL);
+		if (line == NULL || line[0] == '\0')
+			break;
+		if (g_str_has_prefix (line, "HEAD "))
+			is_head = TRUE;
+		if (g_ascii_strncasecmp (line, "Range: bytes=", 13) == 0) {
+			gchar *endptr = NULL;
+			g_free (server->range);
+			server->range = g_strdup (line + 13);
+			if (server->ignore_ranges)
+				continue;
+			start = g_ascii_strtoull (line + 13, &endptr, 10);
+			if (endptr[0] == '-' && endptr[1] != '\0')
+				end = g_ascii_strtoull (endptr + 1, NULL, 10);
+			is_partial = TRUE;
+		}
+		if (g_ascii_strncasecmp (line, "If-None-Match: ", 15) == 0)
+			server->if_none_match = g_strdup (line + 15);
+		if (g_ascii_strncasecmp (line, "If-Modified-Since: ", 19) == 0)
+			server->if_modified_since = g_strdup (line + 19);
+		if (g_ascii_strncasecmp (line, "If-Range: ", 10) == 0)
+			server->if_range = g_strdup (line + 10);
+	}
+
+	/* the file has changed since the client got the first part */
+	if (is_partial && server->if_range != NULL &&
+	    g_strcmp0 (server->if_range, server->etag) != 0) {
+		start = 0;
+		end = bufsz - 1;
+		is_partial = FALSE;
+	}
+
+	/* the client already has this version */
+	if (server->etag != NULL && g_strcmp0 (server->if_none_match, server->etag) == 0) {
+		const gchar *reply = "HTTP/1.1 304 Not Modified\r\nConnection: close\r\n\r\n";
+		server->not_modified_cnt++;
+		g_output_stream_write_all (ostream, reply, strlen (reply), NULL, NULL, NULL);
+		g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+		return TRUE;
+	}
+
+	/* send reply */
+	length = end - start + 1;
+	if (is_partial) {
+		g_string_append (hdr, "HTTP/1.1 206 Partial Content\r\n");
+		g_string_append_printf (hdr, "Content-Range: bytes %" G_GSIZE_FORMAT "-%"
+					G_GSIZE_FORMAT "/%" G_GSIZE_FORMAT "\r\n",
+					start, end, bufsz);
+	} else {
+		g_string_append (hdr, "HTTP/1.1 200 OK\r\n");
+	}
+	if (!server->ignore_ranges)
+		g_string_append (hdr, "Accept-Ranges: bytes\r\n");
+	if (server->etag != NULL)
+		g_string_append_printf (hdr, "ETag: %s\r\n", server->etag);
+	if (server->last_modified != NULL)
+		g_string_append_printf (hdr, "Last-Modified: %s\r\n", server->last_modified);
+	g_string_append_printf (hdr, "Content-Length: %" G_GSIZE_FORMAT "\r\n", length);
+	g_string_append (hdr, "Connection: close\r\n\r\n");
+	g_output_stream_write_all (ostream, hdr->str, hdr->len, NULL, NULL, NULL);
+	if (!is_head) {
+		if (server->truncate > 0) {
+			length = MIN (length, server->truncate);
+			server->truncate = 0;
+		}
+		g_output_stream_write_all (ostream, buf + start, length, NULL, NULL, NULL);
+	}
+	g_io_stream_close (G_IO_STREAM (connection), NULL, NULL);
+	return TRUE;
+}
+
+typedef struct {
+	GMainLoop	*loop;
+	GBytes		*blob;
+	GError		*error;
+} FwupdTestDownloadHelper;
+
+static void
+fwupd_test_download_bytes_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	FwupdTestDownloadHelper *helper = (FwupdTestDownloadHelper *) user_data;
+	helper->blob = fwupd_client_download_bytes_finish (FWUPD_CLIENT (source), res, &helper->error);
+	g_main_loop_quit (helper->loop);
+}
+
+static GBytes *
+fwupd_test_download_bytes (FwupdClient *client, const gchar *url, GError **error)
+{
+	FwupdTestDownloadHelper helper = { 0x0 };
+	g_autoptr(GMainLoop) loop = g_main_loop_new (NULL, FALSE);
+
+	helper.loop = loop;
+	fwupd_client_download_bytes_async (client, url, FWUPD_CLIENT_DOWNLOAD_FLAG_NONE, NULL,
+					   fwupd_test_download_bytes_cb, &helper);
+	g_main_loop_run (loop);
+	if (helper.error != NULL) {
+		g_propagate_error (error, helper.error);
+		return NULL;
+	}
+	return helper.blob;
+}
+
+static void
+fwupd_client_download_resume_func (void)
+{
+	guint16 port;
+	FwupdTestHttpServer server = { 0x0 };
+	g_autofree gchar *fn_basename = NULL;
+	g_autofree gchar *fn_hash = NULL;
+	g_autofree gchar *fn_part = NULL;
+	g_autofree gchar *fn_validators = NULL;
+	g_autofree gchar *url = NULL;
+	g_autofree guint8 *buf = g_malloc (0x10000);
+	g_autofree guint8 *buf2 = g_malloc (0x10000);
+	g_autoptr(FwupdClient) client = fwupd_client_new ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GBytes) blob2 = NULL;
+	g_autoptr(GBytes) blob3 = NULL;
+	g_autoptr(GBytes) blob4 = NULL;
+	g_autoptr(GBytes) blob5 = NULL;
+	g_autoptr(GBytes) payload2 = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GSocketService) service = g_threaded_socket_service_new (1);
+
+	/* serve a payload that is not the same at every offset */
+	for (guint i = 0; i < 0x10000; i++) {
+		buf[i] = (guint8) (i * 7);
+		buf2[i] = (guint8) (i * 13);
+	}
+	server.payload = g_bytes_new_static (buf, 0x10000);
+	server.etag = "\"v1\"";
+	payload2 = g_bytes_new_static (buf2, 0x10000);
+	g_mutex_init (&server.mutex);
+	port = g_socket_listener_add_any_inet_port (G_SOCKET_LISTENER (service), NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (port, !=, 0);
+	g_signal_connect (service, "run",
+			  G_CALLBACK (fwupd_test_http_server_run_cb), &server);
+	g_socket_service_start (service);
+	url = g_strdup_printf ("http://127.0.0.1:%u/firmware.bin", port);
+
+	/* no partial file from a previous run */
+	fn_hash = g_compute_checksum_for_string (G_CHECKSUM_SHA1, url, -1);
+	fn_basename = g_strdup_printf ("%s.part", fn_hash);
+	fn_part = g_build_filename (g_get_user_cache_dir (), "fwupd", "downloads", fn_basename, NULL);
+	fn_validators = g_strdup_printf ("%s.validators", fn_part);
+	g_unlink (fn_part);
+	g_unlink (fn_validators);
+	fwupd_client_set_user_agent (client, "fwupd/" PACKAGE_VERSION);
+
+	/* connection dropped part way through */
+	server.truncate = 0x5000;
+	blob = fwupd_test_download_bytes (client, url, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_FILE);
+	g_assert_null (blob);
+	g_clear_error (&error);
+
+	/* resumed from the partial file */
+	blob = fwupd_test_download_bytes (client, url, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob);
+	g_assert_true (g_bytes_equal (blob, server.payload));
+	g_assert_cmpstr (server.range, ==, "20480-");
+	g_assert_cmpstr (server.if_range, ==, "\"v1\"");
+	g_assert_cmpint (fwupd_client_get_percentage (client), ==, 100);
+
+	/* the partial file was removed, so this is a full download */
+	g_clear_pointer (&server.range, g_free);
+	blob2 = fwupd_test_download_bytes (client, url, &error);
+	g_assert_no_error (error);
+	g_assert_true (g_bytes_equal (blob2, server.payload));
+	g_assert_null (server.range);
+
+	/* the server does not support resume, so start again */
+	server.truncate = 0x5000;
+	server.ignore_ranges = TRUE;
+	blob3 = fwupd_test_download_bytes (client, url, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_FILE);
+	g_assert_null (blob3);
+	g_clear_error (&error);
+	blob3 = fwupd_test_download_bytes (client, url, &error);
+	g_assert_no_error (error);
+	g_assert_true (g_bytes_equal (blob3, server.payload));
+	g_assert_cmpstr (server.range, ==, "20480-");
+
+	/* the file changed on the server, so the old head is not used */
+	server.truncate = 0x5000;
+	server.ignore_ranges = FALSE;
+	blob4 = fwupd_test_download_bytes (client, url, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_FILE);
+	g_assert_null (blob4);
+	g_clear_error (&error);
+	g_mutex_lock (&server.mutex);
+	g_bytes_unref (server.payload);
+	server.payload = g_bytes_ref (payload2);
+	server.etag = "\"v2\"";
+	g_mutex_unlock (&server.mutex);
+	blob4 = fwupd_test_download_bytes (client, url, &error);
+	g_assert_no_error (error);
+	g_assert_true (g_bytes_equal (blob4, payload2));
+	g_assert_cmpstr (server.if_range, ==, "\"v1\"");
+
+	/* without a validator the partial file cannot be trusted */
+	server.truncate = 0x5000;
+	server.etag = NULL;
+	blob5 = fwupd_test_download_bytes (client, url, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_FILE);
+	g_assert_null (blob5);
+	g_clear_error (&error);
+	g_clear_pointer (&server.range, g_free);
+	blob5 = fwupd_test_download_bytes (client, url, &error);
+	g_assert_no_error (error);
+	g_assert_true (g_bytes_equal (blob5, payload2));
+	g_assert_null (server.range);
+
+	g_socket_service_stop (service);
+	g_socket_listener_close (G_SOCKET_LISTENER (service));
+	g_bytes_unref (server.payload);
+	g_free (server.range);
+	g_free (server.if_range);
+	g_mutex_clear (&server.mutex);
+}
+
+static void
+fwupd_client_download_cache_install_func (void)
+{
+	gboolean ret;
+	guint16 port;
+	guint request_cnt;
+	FwupdTestHttpServer server = { 0x0 };
+	g_autofree gchar *checksum = NULL;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *url = NULL;
+	g_autoptr(FwupdClient) client = fwupd_client_new ();
+	g_autoptr(FwupdDevice) device = fwupd_device_new ();
+	g_autoptr(FwupdRelease) release = fwupd_release_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GSocketService) service = NULL;
+
+	/* the release is installed using the daemon */
+	if (!fwupd_client_connect (client, NULL, &error)) {
+		g_debug ("%s", error->message);
+		g_test_skip ("failed to connect to daemon");
+		return;
+	}
+
+	/* serve the firmware */
+	server.payload = g_bytes_new_static ("hello", 5);
+	g_mutex_init (&server.mutex);
+	service = g_threaded_socket_service_new (1);
+	port = g_socket_listener_add_any_inet_port (G_SOCKET_LISTENER (service), NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (port, !=, 0);
+	g_signal_connect (service, "run",
+			  G_CALLBACK (fwupd_test_http_server_run_cb), &server);
+	g_socket_service_start (service);
+	url = g_strdup_printf ("http://127.0.0.1:%u/cached.bin", port);
+	checksum = g_compute_checksum_for_bytes (G_CHECKSUM_SHA256, server.payload);
+	fn = g_build_filename (g_get_user_cache_dir (), "fwupd", "downloads", checksum, NULL);
+	g_unlink (fn);
+
+	/* a device the daemon does not know about, so nothing is installed */
+	fwupd_device_set_id (device, "0000000000000000000000000000000000000000");
+	fwupd_release_add_location (release, url);
+	fwupd_release_add_checksum (release, checksum);
+	fwupd_client_set_user_agent (client, "fwupd/" PACKAGE_VERSION);
+
+	/* downloaded and added to the cache */
+	ret = fwupd_client_install_release2 (client, device, release,
+					     FWUPD_INSTALL_FLAG_NONE,
+					     FWUPD_CLIENT_DOWNLOAD_FLAG_NONE,
+					     NULL, &error);
+	g_assert_nonnull (error);
+	g_assert_false (ret);
+	g_clear_error (&error);
+	g_assert_cmpint (server.request_cnt, >, 0);
+	g_assert_true (g_file_test (fn, G_FILE_TEST_EXISTS));
+
+	/* the server is not asked again */
+	request_cnt = server.request_cnt;
+	ret = fwupd_client_install_release2 (client, device, release,
+					     FWUPD_INSTALL_FLAG_NONE,
+					     FWUPD_CLIENT_DOWNLOAD_FLAG_NONE,
+					     NULL, &error);
+	g_assert_nonnull (error);
+	g_assert_false (ret);
+	g_clear_error (&error);
+	g_assert_cmpint (server.request_cnt, ==, request_cnt);
+
+	/* a corrupt file is not used */
+	ret = g_file_set_contents (fn, "jello", -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fwupd_client_install_release2 (client, device, release,
+					     FWUPD_INSTALL_FLAG_NONE,
+					     FWUPD_CLIENT_DOWNLOAD_FLAG_NONE,
+					     NULL, &error);
+	g_assert_nonnull (error);
+	g_assert_false (ret);
+	g_clear_error (&error);
+	g_assert_cmpint (server.request_cnt, >, request_cnt);
+
+	g_unlink (fn);
+	g_socket_service_stop (service);
+	g_socket_listener_close (G_SOCKET_LISTENER (service));
+	g_bytes_unref (server.payload);
+	g_free (server.range);
+	g_free (server.if_range);
+	g_free (server.if_none_match);
+	g_free (server.if_modified_since);
+	g_mutex_clear (&server.mutex);
+}
+
+static void
+fwupd_client_refresh_remotes_func (void)
+{
+	gboolean ret;
+	guint16 port;
+	FwupdTestHttpServer server = { 0x0 };
+	const gchar *sig = "-----BEGIN PGP SIGNATURE-----";
+	g_autofree gchar *conf = NULL;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *fn_sig = NULL;
+	g_autofree gchar *fn_validators = NULL;
+	g_autofree gchar *remotedir = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autoptr(FwupdClient) client = fwupd_client_new ();
+	g_autoptr(FwupdRemote) remote = fwupd_remote_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) remotes = g_ptr_array_new ();
+	g_autoptr(GSocketService) service = g_threaded_socket_service_new (1);
+
+	/* serve a signature with both kinds of validator */
+	server.payload = g_bytes_new_static (sig, strlen (sig));
+	server.etag = "\"abc\"";
+	server.last_modified = "Wed, 21 Oct 2015 07:28:00 GMT";
+	g_mutex_init (&server.mutex);
+	port = g_socket_listener_add_any_inet_port (G_SOCKET_LISTENER (service), NULL, &error);
+	g_assert_no_error (error);
+	g_assert_cmpint (port, !=, 0);
+	g_signal_connect (service, "run",
+			  G_CALLBACK (fwupd_test_http_server_run_cb), &server);
+	g_socket_service_start (service);
+
+	/* the daemon already has this signature, so the metadata is not needed */
+	tmpdir = g_dir_make_tmp ("fwupd-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	fn = g_build_filename (tmpdir, "http-test.conf", NULL);
+	conf = g_strdup_printf ("[fwupd Remote]\n"
+				"Enabled=true\n"
+				"Keyring=gpg\n"
+				"MetadataURI=http://127.0.0.1:%u/firmware.xml.gz\n",
+				port);
+	ret = g_file_set_contents (fn, conf, -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	remotedir = g_build_filename (tmpdir, "http-test", NULL);
+	g_assert_cmpint (g_mkdir_with_parents (remotedir, 0700), ==, 0);
+	fn_sig = g_build_filename (remotedir, "metadata.xml.gz.asc", NULL);
+	ret = g_file_set_contents (fn_sig, sig, -1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	fwupd_remote_set_remotes_dir (remote, tmpdir);
+	ret = fwupd_remote_load_from_filename (remote, fn, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fwupd_remote_setup (remote, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_nonnull (fwupd_remote_get_checksum (remote));
+	g_ptr_array_add (remotes, remote);
+
+	/* no validators from a previous run */
+	fn_validators = g_build_filename (g_get_user_cache_dir (), "fwupd", "remotes.d",
+					  "http-test", "firmware.xml.gz.asc.validators", NULL);
+	g_unlink (fn_validators);
+	fwupd_client_set_user_agent (client, "fwupd/" PACKAGE_VERSION);
+
+	/* first refresh is unconditional */
+	ret = fwupd_client_refresh_remotes (client, remotes, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_null (server.if_none_match);
+	g_assert_null (server.if_modified_since);
+	g_assert_cmpint (server.not_modified_cnt, ==, 0);
+
+	/* second refresh sends back what the server sent */
+	ret = fwupd_client_refresh_remotes (client, remotes, NULL, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpstr (server.if_none_match, ==, server.etag);
+	g_assert_cmpstr (server.if_modified_since, ==, server.last_modified);
+	g_assert_cmpint (server.not_modified_cnt, ==, 1);
+
+	g_socket_service_stop (service);
+	g_socket_listener_close (G_SOCKET_LISTENER (service));
+	g_unlink (fn_sig);
+	g_unlink (fn);
+	g_rmdir (remotedir);
+	g_rmdir (tmpdir);
+	g_bytes_unref (server.payload);
+	g_free (server.range);
+	g_free (server.if_none_match);
+	g_free (server.if_modified_since);
+	g_free (server.if_range);
+	g_mutex_clear (&server.mutex);
+}
+#endif
+
 static gboolean
 fwupd_has_system_bus (void)
 {
@@ -707,6 +1285,7 @@ main (int argc, char **argv)
 	/* only critical and error are fatal */
 	g_log_set_fatal_mask (NULL, G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL);
 	g_setenv ("G_MESSAGES_DEBUG", "all", TRUE);
+	g_setenv ("XDG_CACHE_HOME", "/tmp/fwupd-self-test/cache", TRUE);
 
 	/* tests go here */
 	g_test_add_func ("/fwupd/enums", fwupd_enums_func);
@@ -715,14 +1294,24 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/common{guid}", fwupd_common_guid_func);
 	g_test_add_func ("/fwupd/release", fwupd_release_func);
 	g_test_add_func ("/fwupd/device", fwupd_device_func);
+	g_test_add_func ("/fwupd/device{variant-cache}", fwupd_device_variant_cache_func);
 	g_test_add_func ("/fwupd/remote{download}", fwupd_remote_download_func);
 	g_test_add_func ("/fwupd/remote{base-uri}", fwupd_remote_baseuri_func);
 	g_test_add_func ("/fwupd/remote{no-path}", fwupd_remote_nopath_func);
 	g_test_add_func ("/fwupd/remote{local}", fwupd_remote_local_func);
 	g_test_add_func ("/fwupd/remote{duplicate}", fwupd_remote_duplicate_func);
+	g_test_add_func ("/fwupd/client{download-cache}", fwupd_client_download_cache_func);
+#ifdef HAVE_LIBCURL
+	g_test_add_func ("/fwupd/client{download-resume}", fwupd_client_download_resume_func);
+	g_test_add_func ("/fwupd/client{refresh-remotes}", fwupd_client_refresh_remotes_func);
+#endif
 	if (fwupd_has_system_bus ()) {
 		g_test_add_func ("/fwupd/client{remotes}", fwupd_client_remotes_func);
 		g_test_add_func ("/fwupd/client{devices}", fwupd_client_devices_func);
+#ifdef HAVE_LIBCURL
+		g_test_add_func ("/fwupd/client{download-cache-install}",
+				 fwupd_client_download_cache_install_func);
+#endif
 	}
 	return g_test_run ();
 }
@@ -71,6 +71,66 @@ fwupd_thread_test_activate_cb (GApplication *app, gpointer user_data)
 	g_idle_add (fwupd_thread_test_idle_cb, self);
 }
 
+static void
+fwupd_thread_test_get_devices_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	GMainLoop *loop = user_data;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+	devices = fwupd_client_get_devices_finish (FWUPD_CLIENT (source), res, &error_local);
+	if (devices == NULL)
+		g_warning ("%s", error_local->message);
+	g_main_loop_quit (loop);
+}
+
+static void
+fwupd_thread_test_benchmark (FwupdClient *client)
+{
+	const guint iterations = 100;
+	gdouble elapsed_direct;
+	gdouble elapsed_loop;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	if (!fwupd_client_connect (client, NULL, &error)) {
+		g_message ("failed to connect, skipping benchmark: %s", error->message);
+		return;
+	}
+
+	/* synchronous call directly into the daemon */
+	g_timer_reset (timer);
+	for (guint i = 0; i < iterations; i++) {
+		g_autoptr(GError) error_local = NULL;
+		g_autoptr(GPtrArray) devices = NULL;
+		devices = fwupd_client_get_devices (client, NULL, &error_local);
+		if (devices == NULL) {
+			g_message ("failed to get devices, skipping benchmark: %s",
+				   error_local->message);
+			return;
+		}
+	}
+	elapsed_direct = g_timer_elapsed (timer, NULL);
+
+	/* async call with a thread-default context and main loop per call */
+	g_timer_reset (timer);
+	for (guint i = 0; i < iterations; i++) {
+		g_autoptr(GMainContext) context = g_main_context_new ();
+		g_autoptr(GMainLoop) loop = g_main_loop_new (context, FALSE);
+		g_main_context_push_thread_default (context);
+		fwupd_client_get_devices_async (client, NULL,
+						fwupd_thread_test_get_devices_cb,
+						loop);
+		g_main_loop_run (loop);
+		g_main_context_pop_thread_default (context);
+	}
+	elapsed_loop = g_timer_elapsed (timer, NULL);
+
+	g_message ("GetDevices x%u: direct=%.3fms, main-loop=%.3fms",
+		   iterations,
+		   elapsed_direct * 1000.f / iterations,
+		   elapsed_loop * 1000.f / iterations);
+}
+
 static gboolean
 fwupd_thread_test_has_system_bus (void)
 {
@@ -94,6 +154,9 @@ main (void)
 		return 0;
 	}
 
+	/* compare the direct and main-loop sync paths */
+	fwupd_thread_test_benchmark (client);
+
 	g_message ("Created FwupdClient in thread %p with main context %p",
 		   g_thread_self (), g_main_context_get_thread_default ());
 	g_signal_connect (app, "activate",
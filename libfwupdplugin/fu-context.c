@@ -8,8 +8,10 @@
 
 #include "config.h"
 
+#include "fu-common.h"
 #include "fu-context-private.h"
-#include "fu-hwids.h"
+#include "fu-hwids-private.h"
+#include "fu-mutex.h"
 #include "fu-smbios-private.h"
 
 /**
@@ -22,6 +24,10 @@
 typedef struct {
 	FuHwids			*hwids;
 	FuSmbios		*smbios;
+	GRWLock			 hwinfo_mutex;
+	gboolean		 hwinfo_enabled;
+	gint			 smbios_loaded;		/* atomic */
+	gint			 hwids_loaded;		/* atomic */
 	FuQuirks		*quirks;
 	GHashTable		*runtime_versions;
 	GHashTable		*compile_versions;
@@ -34,6 +40,7 @@ typedef struct {
 
 enum {
 	SIGNAL_SECURITY_CHANGED,
+	SIGNAL_RUNTIME_VERSIONS_CHANGED,
 	SIGNAL_LAST
 };
 
@@ -51,6 +58,95 @@ G_DEFINE_TYPE_WITH_PRIVATE (FuContext, fu_context, G_TYPE_OBJECT)
 
 #define GET_PRIVATE(o) (fu_context_get_instance_private (o))
 
+/* must be called with hwinfo_mutex held for writing */
+static void
+fu_context_ensure_smbios_unlocked (FuContext *self)
+{
+	FuContextPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GError) error_local = NULL;
+
+	if (!priv->hwinfo_enabled || g_atomic_int_get (&priv->smbios_loaded))
+		return;
+	if (!fu_smbios_setup (priv->smbios, &error_local))
+		g_warning ("Failed to load SMBIOS: %s", error_local->message);
+	g_atomic_int_set (&priv->smbios_loaded, TRUE);
+}
+
+static void
+fu_context_ensure_smbios (FuContext *self)
+{
+	FuContextPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	/* fast path, which can be called from the udev probe threads */
+	if (g_atomic_int_get (&priv->smbios_loaded))
+		return;
+	locker = g_rw_lock_writer_locker_new (&priv->hwinfo_mutex);
+	g_return_if_fail (locker != NULL);
+	fu_context_ensure_smbios_unlocked (self);
+}
+
+/* the HWIDs are only valid for this exact SMBIOS table and fwupd version */
+static gchar *
+fu_context_get_hwids_checksum (void)
+{
+	gsize bufsz = 0;
+	g_autofree gchar *buf = NULL;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *sysfsfwdir = fu_common_get_path (FU_PATH_KIND_SYSFSDIR_FW);
+	g_autoptr(GChecksum) csum = g_checksum_new (G_CHECKSUM_SHA256);
+
+	fn = g_build_filename (sysfsfwdir, "dmi", "tables", "DMI", NULL);
+	if (!g_file_get_contents (fn, &buf, &bufsz, NULL))
+		return NULL;
+	g_checksum_update (csum, (const guchar *) PACKAGE_VERSION, -1);
+	g_checksum_update (csum, (const guchar *) buf, bufsz);
+	return g_strdup (g_checksum_get_string (csum));
+}
+
+static void
+fu_context_ensure_hwids (FuContext *self)
+{
+	FuContextPrivate *priv = GET_PRIVATE (self);
+	g_autofree gchar *cachedir = NULL;
+	g_autofree gchar *checksum = NULL;
+	g_autofree gchar *filename = NULL;
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	/* fast path, which can be called from the udev probe threads */
+	if (g_atomic_int_get (&priv->hwids_loaded))
+		return;
+	locker = g_rw_lock_writer_locker_new (&priv->hwinfo_mutex);
+	g_return_if_fail (locker != NULL);
+	if (!priv->hwinfo_enabled || g_atomic_int_get (&priv->hwids_loaded))
+		return;
+
+	/* use the cache if the SMBIOS tables have not changed */
+	cachedir = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	filename = g_build_filename (cachedir, "hwids.ini", NULL);
+	checksum = fu_context_get_hwids_checksum ();
+	if (checksum != NULL) {
+		if (fu_hwids_load_cache (priv->hwids, filename, checksum, &error_local)) {
+			g_debug ("loaded HWIDs from %s", filename);
+			g_atomic_int_set (&priv->hwids_loaded, TRUE);
+			return;
+		}
+		g_debug ("ignoring HWID cache: %s", error_local->message);
+		g_clear_error (&error_local);
+	}
+
+	/* parse the SMBIOS tables */
+	fu_context_ensure_smbios_unlocked (self);
+	if (!fu_hwids_setup (priv->hwids, priv->smbios, &error_local)) {
+		g_warning ("Failed to load HWIDs: %s", error_local->message);
+	} else if (checksum != NULL) {
+		if (!fu_hwids_save_cache (priv->hwids, filename, checksum, &error_local))
+			g_debug ("failed to save HWID cache: %s", error_local->message);
+	}
+	g_atomic_int_set (&priv->hwids_loaded, TRUE);
+}
+
 /**
  * fu_context_get_smbios_string:
  * @self: a #FuContext
@@ -71,6 +167,7 @@ fu_context_get_smbios_string (FuContext *self, guint8 structure_type, guint8 off
 {
 	FuContextPrivate *priv = GET_PRIVATE (self);
 	g_return_val_if_fail (FU_IS_CONTEXT (self), NULL);
+	fu_context_ensure_smbios (self);
 	return fu_smbios_get_string (priv->smbios, structure_type, offset, NULL);
 }
 
@@ -90,6 +187,7 @@ fu_context_get_smbios_data (FuContext *self, guint8 structure_type)
 {
 	FuContextPrivate *priv = GET_PRIVATE (self);
 	g_return_val_if_fail (FU_IS_CONTEXT (self), NULL);
+	fu_context_ensure_smbios (self);
 	return fu_smbios_get_data (priv->smbios, structure_type, NULL);
 }
 
@@ -113,6 +211,7 @@ fu_context_get_smbios_integer (FuContext *self, guint8 type, guint8 offset)
 {
 	FuContextPrivate *priv = GET_PRIVATE (self);
 	g_return_val_if_fail (FU_IS_CONTEXT (self), G_MAXUINT);
+	fu_context_ensure_smbios (self);
 	return fu_smbios_get_integer (priv->smbios, type, offset, NULL);
 }
 
@@ -132,6 +231,7 @@ fu_context_has_hwid_guid (FuContext *self, const gchar *guid)
 {
 	FuContextPrivate *priv = GET_PRIVATE (self);
 	g_return_val_if_fail (FU_IS_CONTEXT (self), FALSE);
+	fu_context_ensure_hwids (self);
 	return fu_hwids_has_guid (priv->hwids, guid);
 }
 
@@ -151,6 +251,7 @@ fu_context_get_hwid_guids (FuContext *self)
 {
 	FuContextPrivate *priv = GET_PRIVATE (self);
 	g_return_val_if_fail (FU_IS_CONTEXT (self), NULL);
+	fu_context_ensure_hwids (self);
 	return fu_hwids_get_guids (priv->hwids);
 }
 
@@ -172,6 +273,7 @@ fu_context_get_hwid_value (FuContext *self, const gchar *key)
 	FuContextPrivate *priv = GET_PRIVATE (self);
 	g_return_val_if_fail (FU_IS_CONTEXT (self), NULL);
 	g_return_val_if_fail (key != NULL, NULL);
+	fu_context_ensure_hwids (self);
 	return fu_hwids_get_value (priv->hwids, key);
 }
 
@@ -194,6 +296,7 @@ fu_context_get_hwid_replace_value (FuContext *self, const gchar *keys, GError **
 	FuContextPrivate *priv = GET_PRIVATE (self);
 	g_return_val_if_fail (FU_IS_CONTEXT (self), NULL);
 	g_return_val_if_fail (keys != NULL, NULL);
+	fu_context_ensure_hwids (self);
 	return fu_hwids_get_replace_values (priv->hwids, keys, error);
 }
 
@@ -205,6 +308,8 @@ fu_context_get_hwid_replace_value (FuContext *self, const gchar *keys, GError **
  *
  * Sets a runtime version of a specific dependency.
  *
+ * The `runtime-versions-changed` signal is emitted if the version is different.
+ *
  * Since: 1.6.0
  **/
 void
@@ -220,9 +325,12 @@ fu_context_add_runtime_version (FuContext *self,
 
 	if (priv->runtime_versions == NULL)
 		return;
+	if (g_strcmp0 (g_hash_table_lookup (priv->runtime_versions, component_id), version) == 0)
+		return;
 	g_hash_table_insert (priv->runtime_versions,
 			     g_strdup (component_id),
 			     g_strdup (version));
+	g_signal_emit (self, signals[SIGNAL_RUNTIME_VERSIONS_CHANGED], 0);
 }
 
 /**
@@ -506,7 +614,11 @@ fu_context_security_changed (FuContext *self)
  * @self: a #FuContext
  * @error: (nullable): optional return location for an error
  *
- * Loads all hardware information parts of the context.
+ * Enables loading all hardware information parts of the context.
+ *
+ * The SMBIOS tables and hardware IDs are not parsed until they are first
+ * used, and the hardware IDs are cached for the next startup for as long as
+ * the SMBIOS tables do not change.
  *
  * Returns: %TRUE for success
  *
@@ -516,16 +628,15 @@ gboolean
 fu_context_load_hwinfo (FuContext *self, GError **error)
 {
 	FuContextPrivate *priv = GET_PRIVATE (self);
-	g_autoptr(GError) error_smbios = NULL;
-	g_autoptr(GError) error_hwids = NULL;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
 
 	g_return_val_if_fail (FU_IS_CONTEXT (self), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
-	if (!fu_smbios_setup (priv->smbios, &error_smbios))
-		g_warning ("Failed to load SMBIOS: %s", error_smbios->message);
-	if (!fu_hwids_setup (priv->hwids, priv->smbios, &error_hwids))
-		g_warning ("Failed to load HWIDs: %s", error_hwids->message);
+	/* loaded on demand */
+	locker = g_rw_lock_writer_locker_new (&priv->hwinfo_mutex);
+	g_return_val_if_fail (locker != NULL, FALSE);
+	priv->hwinfo_enabled = TRUE;
 
 	/* always */
 	return TRUE;
@@ -736,6 +847,7 @@ fu_context_finalize (GObject *object)
 	g_object_unref (priv->hwids);
 	g_object_unref (priv->quirks);
 	g_object_unref (priv->smbios);
+	g_rw_lock_clear (&priv->hwinfo_mutex);
 	g_hash_table_unref (priv->firmware_gtypes);
 	g_ptr_array_unref (priv->udev_subsystems);
 
@@ -781,6 +893,12 @@ fu_context_class_init (FuContextClass *klass)
 			      G_STRUCT_OFFSET (FuContextClass, security_changed),
 			      NULL, NULL, g_cclosure_marshal_VOID__VOID,
 			      G_TYPE_NONE, 0);
+	signals[SIGNAL_RUNTIME_VERSIONS_CHANGED] =
+		g_signal_new ("runtime-versions-changed",
+			      G_TYPE_FROM_CLASS (object_class), G_SIGNAL_RUN_LAST,
+			      G_STRUCT_OFFSET (FuContextClass, runtime_versions_changed),
+			      NULL, NULL, g_cclosure_marshal_VOID__VOID,
+			      G_TYPE_NONE, 0);
 
 	object_class->finalize = fu_context_finalize;
 }
@@ -793,6 +911,7 @@ fu_context_init (FuContext *self)
 	priv->battery_threshold = FU_BATTERY_VALUE_INVALID;
 	priv->smbios = fu_smbios_new ();
 	priv->hwids = fu_hwids_new ();
+	g_rw_lock_init (&priv->hwinfo_mutex);
 	priv->udev_subsystems = g_ptr_array_new_with_free_func (g_free);
 	priv->firmware_gtypes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
 	priv->quirks = fu_quirks_new ();
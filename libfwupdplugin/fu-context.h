@@ -17,8 +17,9 @@ struct _FuContextClass {
 	GObjectClass	 parent_class;
 	/* signals */
 	void		 (* security_changed)		(FuContext	*self);
+	void		 (* runtime_versions_changed)	(FuContext	*self);
 	/*< private >*/
-	gpointer	 padding[30];
+	gpointer	 padding[29];
 };
 
 /**
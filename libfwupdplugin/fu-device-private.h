@@ -34,9 +34,13 @@ void		 fu_device_incorporate_from_component	(FuDevice	*device,
 							 XbNode		*component);
 void		 fu_device_convert_instance_ids		(FuDevice	*self);
 gchar		*fu_device_get_guids_as_str		(FuDevice	*self);
+GPtrArray	*fu_device_get_metadata_keys		(FuDevice	*self);
 GPtrArray	*fu_device_get_possible_plugins		(FuDevice	*self);
 void		 fu_device_add_possible_plugin		(FuDevice	*self,
 							 const gchar	*plugin);
+FuDeviceInternalFlags fu_device_get_internal_flags	(FuDevice	*self);
+void		 fu_device_set_internal_flags		(FuDevice	*self,
+							 FuDeviceInternalFlags flags);
 guint64		 fu_device_get_private_flags		(FuDevice	*self);
 void		 fu_device_set_private_flags		(FuDevice	*self,
 							 guint64	 flag);
@@ -12,6 +12,7 @@
 #include <glib-object.h>
 #include <gio/gio.h>
 
+#include "fu-chunk.h"
 #include "fu-common.h"
 #include "fu-common-version.h"
 #include "fu-device-private.h"
@@ -64,6 +65,8 @@ typedef struct {
 	gboolean			 device_id_valid;
 	guint64				 size_min;
 	guint64				 size_max;
+	guint32				 erase_block_size;
+	GPtrArray			*erase_block_checksums;	/* (nullable) (element-type utf8) */
 	gint				 open_refcount;	/* atomic */
 	GType				 specialized_gtype;
 	GPtrArray			*possible_plugins;
@@ -72,6 +75,7 @@ typedef struct {
 	FuDeviceInternalFlags		 internal_flags;
 	guint64				 private_flags;
 	GPtrArray			*private_flag_items;	/* (nullable) */
+	FuSecurityAttrsInput		 security_inputs;
 } FuDevicePrivate;
 
 typedef struct {
@@ -225,6 +229,8 @@ fu_device_internal_flag_to_string (FuDeviceInternalFlags flag)
 		return "auto-parent-children";
 	if (flag == FU_DEVICE_INTERNAL_FLAG_ATTACH_EXTRA_RESET)
 		return "attach-extra-reset";
+	if (flag == FU_DEVICE_INTERNAL_FLAG_PROBE_CACHE)
+		return "probe-cache";
 	return NULL;
 }
 
@@ -269,6 +275,8 @@ fu_device_internal_flag_from_string (const gchar *flag)
 		return FU_DEVICE_INTERNAL_FLAG_AUTO_PARENT_CHILDREN;
 	if (g_strcmp0 (flag, "attach-extra-reset") == 0)
 		return FU_DEVICE_INTERNAL_FLAG_ATTACH_EXTRA_RESET;
+	if (g_strcmp0 (flag, "probe-cache") == 0)
+		return FU_DEVICE_INTERNAL_FLAG_PROBE_CACHE;
 	return FU_DEVICE_INTERNAL_FLAG_UNKNOWN;
 }
 
@@ -409,6 +417,41 @@ fu_device_set_private_flags (FuDevice *self, guint64 flag)
 	priv->private_flags = flag;
 }
 
+/**
+ * fu_device_get_internal_flags:
+ * @self: a #FuDevice
+ *
+ * Returns all the internal flags set on the device.
+ *
+ * Returns: flags
+ *
+ * Since: 1.6.2
+ **/
+FuDeviceInternalFlags
+fu_device_get_internal_flags (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), FU_DEVICE_INTERNAL_FLAG_UNKNOWN);
+	return priv->internal_flags;
+}
+
+/**
+ * fu_device_set_internal_flags:
+ * @self: a #FuDevice
+ * @flags: internal flags
+ *
+ * Sets all the internal flags on the device, replacing any existing values.
+ *
+ * Since: 1.6.2
+ **/
+void
+fu_device_set_internal_flags (FuDevice *self, FuDeviceInternalFlags flags)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	priv->internal_flags = flags;
+}
+
 /**
  * fu_device_get_possible_plugins:
  * @self: a #FuDevice
@@ -1669,6 +1712,114 @@ fu_device_get_firmware_size_max (FuDevice *self)
 	return priv->size_max;
 }
 
+/**
+ * fu_device_set_erase_block_size:
+ * @self: a #FuDevice
+ * @erase_block_size: Size in bytes, or 0 to disable differential writes
+ *
+ * Sets the size of the smallest region of flash that can be erased and written
+ * independently.
+ *
+ * If the device also implements the `->write_firmware_partial()` vfunc then
+ * only the erase blocks that differ from the current contents will be written.
+ *
+ * Since: 1.6.2
+ **/
+void
+fu_device_set_erase_block_size (FuDevice *self, guint32 erase_block_size)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	if (priv->erase_block_size == erase_block_size)
+		return;
+	priv->erase_block_size = erase_block_size;
+	g_clear_pointer (&priv->erase_block_checksums, g_ptr_array_unref);
+}
+
+static GPtrArray *
+fu_device_build_erase_block_checksums (FuDevice *self, GBytes *blob)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	gsize bufsz = 0;
+	const guint8 *buf = g_bytes_get_data (blob, &bufsz);
+	GPtrArray *checksums = g_ptr_array_new_with_free_func (g_free);
+	for (gsize off = 0; off < bufsz; off += priv->erase_block_size) {
+		gsize sz = MIN(priv->erase_block_size, bufsz - off);
+		g_ptr_array_add (checksums,
+				 g_compute_checksum_for_data (G_CHECKSUM_SHA256,
+							      buf + off, sz));
+	}
+	return checksums;
+}
+
+/**
+ * fu_device_set_erase_block_contents:
+ * @self: a #FuDevice
+ * @blob: the current contents of the flash
+ *
+ * Sets the current contents of the flash, typically because it has already
+ * been read in the `->prepare_firmware()` vfunc. This avoids having to call
+ * fu_device_dump_firmware() again to find the erase blocks that have changed.
+ *
+ * Since: 1.6.2
+ **/
+void
+fu_device_set_erase_block_contents (FuDevice *self, GBytes *blob)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	g_return_if_fail (blob != NULL);
+	g_clear_pointer (&priv->erase_block_checksums, g_ptr_array_unref);
+	if (priv->erase_block_size == 0)
+		return;
+	priv->erase_block_checksums = fu_device_build_erase_block_checksums (self, blob);
+}
+
+/**
+ * fu_device_invalidate_erase_blocks:
+ * @self: a #FuDevice
+ * @address: the start address of the region that was written
+ * @size: the size of the region in bytes
+ *
+ * Forgets the known contents of the erase blocks covering a region of flash.
+ * This has to be called by plugins every time the flash is written outside of
+ * the `->write_firmware_partial()` vfunc so those blocks are written again.
+ *
+ * Since: 1.6.2
+ **/
+void
+fu_device_invalidate_erase_blocks (FuDevice *self, gsize address, gsize size)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	if (priv->erase_block_checksums == NULL || priv->erase_block_size == 0 || size == 0)
+		return;
+	for (gsize idx = address / priv->erase_block_size;
+	     idx <= (address + size - 1) / priv->erase_block_size &&
+	     idx < priv->erase_block_checksums->len; idx++) {
+		g_free (g_ptr_array_index (priv->erase_block_checksums, idx));
+		priv->erase_block_checksums->pdata[idx] = NULL;
+	}
+}
+
+/**
+ * fu_device_get_erase_block_size:
+ * @self: a #FuDevice
+ *
+ * Gets the size of the smallest region of flash that can be erased.
+ *
+ * Returns: Size in bytes, or 0 if unset
+ *
+ * Since: 1.6.2
+ **/
+guint32
+fu_device_get_erase_block_size (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), 0);
+	return priv->erase_block_size;
+}
+
 static void
 fu_device_add_guid_safe (FuDevice *self, const gchar *guid)
 {
@@ -1868,6 +2019,34 @@ fu_device_get_metadata (FuDevice *self, const gchar *key)
 	return g_hash_table_lookup (priv->metadata, key);
 }
 
+/**
+ * fu_device_get_metadata_keys:
+ * @self: a #FuDevice
+ *
+ * Gets all the metadata keys set on the device.
+ *
+ * Returns: (transfer container) (element-type utf8): keys
+ *
+ * Since: 1.6.2
+ **/
+GPtrArray *
+fu_device_get_metadata_keys (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	GPtrArray *keys = g_ptr_array_new_with_free_func (g_free);
+	g_autoptr(GRWLockReaderLocker) locker = g_rw_lock_reader_locker_new (&priv->metadata_mutex);
+	g_return_val_if_fail (FU_IS_DEVICE (self), keys);
+	g_return_val_if_fail (locker != NULL, keys);
+	if (priv->metadata != NULL) {
+		GHashTableIter iter;
+		gpointer key;
+		g_hash_table_iter_init (&iter, priv->metadata);
+		while (g_hash_table_iter_next (&iter, &key, NULL))
+			g_ptr_array_add (keys, g_strdup (key));
+	}
+	return keys;
+}
+
 /**
  * fu_device_get_metadata_boolean:
  * @self: a #FuDevice
@@ -3227,6 +3406,8 @@ fu_device_add_string (FuDevice *self, guint idt, GString *str)
 		g_autofree gchar *sz = g_strdup_printf ("%" G_GUINT64_FORMAT, priv->size_max);
 		fu_common_string_append_kv (str, idt + 1, "FirmwareSizeMax", sz);
 	}
+	if (priv->erase_block_size > 0)
+		fu_common_string_append_kx (str, idt + 1, "EraseBlockSize", priv->erase_block_size);
 	if (priv->order != G_MAXINT)
 		fu_common_string_append_ku (str, idt + 1, "Order", priv->order);
 	if (priv->priority > 0)
@@ -3367,6 +3548,74 @@ fu_device_get_release_default (FuDevice *self)
 	return rel;
 }
 
+/* the checksums of the new image are returned in @checksums */
+static GPtrArray *
+fu_device_get_dirty_chunks (FuDevice *self,
+			    FuFirmware *firmware,
+			    GPtrArray *checksums,
+			    GError **error)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	gsize bufsz = 0;
+	const guint8 *buf;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GPtrArray) checksums_old = NULL;
+	g_autoptr(GPtrArray) chunks = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+	/* the raw image as it will be written to the flash */
+	blob = fu_firmware_write (firmware, error);
+	if (blob == NULL)
+		return NULL;
+	buf = g_bytes_get_data (blob, &bufsz);
+
+	/* use the checksums from the last write or prepare if possible */
+	if (priv->erase_block_checksums != NULL) {
+		checksums_old = g_ptr_array_ref (priv->erase_block_checksums);
+	} else {
+		g_autoptr(GBytes) blob_old = fu_device_dump_firmware (self, error);
+		if (blob_old == NULL)
+			return NULL;
+		if (g_bytes_get_size (blob_old) != bufsz) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_SUPPORTED,
+				     "image size 0x%x does not match device 0x%x",
+				     (guint) bufsz, (guint) g_bytes_get_size (blob_old));
+			return NULL;
+		}
+		checksums_old = fu_device_build_erase_block_checksums (self, blob_old);
+	}
+
+	/* compare each block; the chunks keep a reference to the data as @blob
+	 * is freed when this function returns */
+	for (gsize off = 0; off < bufsz; off += priv->erase_block_size) {
+		gsize sz = MIN(priv->erase_block_size, bufsz - off);
+		guint idx = checksums->len;
+		gchar *checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA256, buf + off, sz);
+		g_autoptr(FuChunk) chk = NULL;
+		g_autoptr(GBytes) blob_chk = NULL;
+		g_ptr_array_add (checksums, checksum);
+		if (idx < checksums_old->len &&
+		    g_strcmp0 (checksum, g_ptr_array_index (checksums_old, idx)) == 0)
+			continue;
+		blob_chk = g_bytes_new_from_bytes (blob, off, sz);
+		chk = fu_chunk_bytes_new (blob_chk);
+		fu_chunk_set_idx (chk, idx);
+		fu_chunk_set_address (chk, off);
+		g_ptr_array_add (chunks, g_steal_pointer (&chk));
+	}
+	if (checksums->len != checksums_old->len) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "image has %u erase blocks but device has %u",
+			     checksums->len, checksums_old->len);
+		return NULL;
+	}
+	g_debug ("%u of %u erase blocks have changed", chunks->len, checksums->len);
+	return g_steal_pointer (&chunks);
+}
+
 /**
  * fu_device_write_firmware:
  * @self: a #FuDevice
@@ -3376,6 +3625,10 @@ fu_device_get_release_default (FuDevice *self)
  *
  * Writes firmware to the device by calling a plugin-specific vfunc.
  *
+ * If the device has an erase block size and implements `->write_firmware_partial()`
+ * then only the erase blocks that differ from the existing flash contents are
+ * written, unless %FWUPD_INSTALL_FLAG_FORCE is used.
+ *
  * Returns: %TRUE on success
  *
  * Since: 1.0.8
@@ -3387,6 +3640,7 @@ fu_device_write_firmware (FuDevice *self,
 			  GError **error)
 {
 	FuDeviceClass *klass = FU_DEVICE_GET_CLASS (self);
+	FuDevicePrivate *priv = GET_PRIVATE (self);
 	g_autoptr(FuFirmware) firmware = NULL;
 	g_autofree gchar *str = NULL;
 
@@ -3409,7 +3663,27 @@ fu_device_write_firmware (FuDevice *self,
 	str = fu_firmware_to_string (firmware);
 	g_debug ("installing onto %s:\n%s", fu_device_get_id (self), str);
 
+	/* only write the erase blocks that have changed */
+	if (klass->write_firmware_partial != NULL &&
+	    priv->erase_block_size > 0 &&
+	    (flags & FWUPD_INSTALL_FLAG_FORCE) == 0) {
+		g_autoptr(GError) error_local = NULL;
+		g_autoptr(GPtrArray) checksums = g_ptr_array_new_with_free_func (g_free);
+		g_autoptr(GPtrArray) chunks = NULL;
+
+		chunks = fu_device_get_dirty_chunks (self, firmware, checksums, &error_local);
+		if (chunks != NULL) {
+			g_clear_pointer (&priv->erase_block_checksums, g_ptr_array_unref);
+			if (!klass->write_firmware_partial (self, chunks, flags, error))
+				return FALSE;
+			priv->erase_block_checksums = g_steal_pointer (&checksums);
+			return TRUE;
+		}
+		g_debug ("writing all erase blocks: %s", error_local->message);
+	}
+
 	/* call vfunc */
+	g_clear_pointer (&priv->erase_block_checksums, g_ptr_array_unref);
 	return klass->write_firmware (self, firmware, flags, error);
 }
 
@@ -3457,6 +3731,10 @@ fu_device_prepare_firmware (FuDevice *self,
 		firmware = fu_firmware_new_from_bytes (fw);
 	}
 
+	/* load any deferred images as the payload is about to be written */
+	if (!fu_firmware_check (firmware, error))
+		return NULL;
+
 	/* check size */
 	fw_def = fu_firmware_get_bytes (firmware, NULL);
 	if (fw_def != NULL) {
@@ -4126,6 +4404,43 @@ fu_device_add_security_attrs (FuDevice *self, FuSecurityAttrs *attrs)
 		return klass->add_security_attrs (self, attrs);
 }
 
+/**
+ * fu_device_set_security_inputs:
+ * @self: a #FuDevice
+ * @inputs: a #FuSecurityAttrsInput, e.g. %FU_SECURITY_ATTRS_INPUT_NONE
+ *
+ * Sets what the attributes added in fu_device_add_security_attrs() depend on,
+ * in addition to the device itself changing.
+ * The default is %FU_SECURITY_ATTRS_INPUT_ALL.
+ *
+ * Since: 1.6.2
+ **/
+void
+fu_device_set_security_inputs (FuDevice *self, FuSecurityAttrsInput inputs)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_DEVICE (self));
+	priv->security_inputs = inputs;
+}
+
+/**
+ * fu_device_get_security_inputs:
+ * @self: a #FuDevice
+ *
+ * Gets what the device security attributes depend on.
+ *
+ * Returns: a #FuSecurityAttrsInput, e.g. %FU_SECURITY_ATTRS_INPUT_NONE
+ *
+ * Since: 1.6.2
+ **/
+FuSecurityAttrsInput
+fu_device_get_security_inputs (FuDevice *self)
+{
+	FuDevicePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_DEVICE (self), FU_SECURITY_ATTRS_INPUT_ALL);
+	return priv->security_inputs;
+}
+
 /**
  * fu_device_bind_driver:
  * @self: a #FuDevice
@@ -4415,6 +4730,7 @@ fu_device_init (FuDevice *self)
 	priv->order = G_MAXINT;
 	priv->battery_level = FU_BATTERY_VALUE_INVALID;
 	priv->battery_threshold = FU_BATTERY_VALUE_INVALID;
+	priv->security_inputs = FU_SECURITY_ATTRS_INPUT_ALL;
 	priv->parent_guids = g_ptr_array_new_with_free_func (g_free);
 	priv->possible_plugins = g_ptr_array_new_with_free_func (g_free);
 	priv->retry_recs = g_ptr_array_new_with_free_func (g_free);
@@ -4447,6 +4763,8 @@ fu_device_finalize (GObject *object)
 		g_ptr_array_unref (priv->parent_physical_ids);
 	if (priv->private_flag_items != NULL)
 		g_ptr_array_unref (priv->private_flag_items);
+	if (priv->erase_block_checksums != NULL)
+		g_ptr_array_unref (priv->erase_block_checksums);
 	g_ptr_array_unref (priv->parent_guids);
 	g_ptr_array_unref (priv->possible_plugins);
 	g_ptr_array_unref (priv->retry_recs);
@@ -106,8 +106,13 @@ struct _FuDeviceClass
 							 FuDevice	*child);
 	void			 (*child_removed)	(FuDevice	*self,	/* signal */
 							 FuDevice	*child);
+	gboolean		 (*write_firmware_partial)(FuDevice	*self,
+							 GPtrArray	*chunks,
+							 FwupdInstallFlags flags,
+							 GError		**error)
+							 G_GNUC_WARN_UNUSED_RESULT;
 	/*< private >*/
-	gpointer	padding[7];
+	gpointer	padding[6];
 #endif
 };
 
@@ -234,6 +239,7 @@ FuDevice	*fu_device_new				(void);
  * @FU_DEVICE_INTERNAL_FLAG_NO_SERIAL_NUMBER:		Do not attempt to read the device serial number
  * @FU_DEVICE_INTERNAL_FLAG_AUTO_PARENT_CHILDREN:	Automatically assign the parent for children of this device
  * @FU_DEVICE_INTERNAL_FLAG_ATTACH_EXTRA_RESET:		Device needs resetting twice for attach after the firmware update
+ * @FU_DEVICE_INTERNAL_FLAG_PROBE_CACHE:		Restore the probed and setup device from a cache when the hardware is unchanged, which has to be set in the device init or from a quirk matching the backend device
  *
  * The device internal flags.
  **/
@@ -253,6 +259,7 @@ typedef enum {
 	FU_DEVICE_INTERNAL_FLAG_NO_SERIAL_NUMBER	= (1llu << 11),	/* Since: 1.6.2 */
 	FU_DEVICE_INTERNAL_FLAG_AUTO_PARENT_CHILDREN	= (1llu << 12),	/* Since: 1.6.2 */
 	FU_DEVICE_INTERNAL_FLAG_ATTACH_EXTRA_RESET	= (1llu << 13),	/* Since: 1.6.2 */
+	FU_DEVICE_INTERNAL_FLAG_PROBE_CACHE		= (1llu << 14),	/* Since: 1.6.2 */
 	/*< private >*/
 	FU_DEVICE_INTERNAL_FLAG_UNKNOWN			= G_MAXUINT64,
 } FuDeviceInternalFlags;
@@ -366,6 +373,14 @@ void		 fu_device_set_firmware_size_max	(FuDevice	*self,
 							 guint64	 size_max);
 guint64		 fu_device_get_firmware_size_min	(FuDevice	*self);
 guint64		 fu_device_get_firmware_size_max	(FuDevice	*self);
+void		 fu_device_set_erase_block_size		(FuDevice	*self,
+							 guint32	 erase_block_size);
+guint32		 fu_device_get_erase_block_size		(FuDevice	*self);
+void		 fu_device_set_erase_block_contents	(FuDevice	*self,
+							 GBytes		*blob);
+void		 fu_device_invalidate_erase_blocks	(FuDevice	*self,
+							 gsize		 address,
+							 gsize		 size);
 guint		 fu_device_get_progress			(FuDevice	*self);
 void		 fu_device_set_progress			(FuDevice	*self,
 							 guint		 progress);
@@ -484,6 +499,9 @@ GHashTable	*fu_device_report_metadata_pre		(FuDevice	*self);
 GHashTable	*fu_device_report_metadata_post		(FuDevice	*self);
 void		 fu_device_add_security_attrs		(FuDevice	*self,
 							 FuSecurityAttrs *attrs);
+void		 fu_device_set_security_inputs		(FuDevice	*self,
+							 FuSecurityAttrsInput inputs);
+FuSecurityAttrsInput fu_device_get_security_inputs	(FuDevice	*self);
 void		 fu_device_register_private_flag	(FuDevice	*self,
 							 guint64	 value,
 							 const gchar	*value_str);
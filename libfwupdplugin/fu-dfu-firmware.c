@@ -384,12 +384,38 @@ fu_dfu_firmware_init (FuDfuFirmware *self)
 	fu_firmware_add_flag (FU_FIRMWARE (self), FU_FIRMWARE_FLAG_HAS_VID_PID);
 }
 
+static gboolean
+fu_dfu_firmware_check_magic (FuFirmware *firmware, GBytes *fw, gsize offset, GError **error)
+{
+	gsize bufsz = 0;
+	const guint8 *buf = g_bytes_get_data (fw, &bufsz);
+
+	/* the footer is at the end of the image */
+	if (bufsz < offset + sizeof(FuDfuFirmwareFooter)) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "size check failed, too small");
+		return FALSE;
+	}
+	if (memcmp (&buf[bufsz - G_STRUCT_OFFSET (FuDfuFirmwareFooter, sig)],
+		    "UFD", 3) != 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "no DFU signature");
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static void
 fu_dfu_firmware_class_init (FuDfuFirmwareClass *klass)
 {
 	FuFirmwareClass *klass_firmware = FU_FIRMWARE_CLASS (klass);
 	klass_firmware->export = fu_dfu_firmware_export;
 	klass_firmware->parse = fu_dfu_firmware_parse;
+	klass_firmware->check_magic = fu_dfu_firmware_check_magic;
 	klass_firmware->write = fu_dfu_firmware_write;
 	klass_firmware->build = fu_dfu_firmware_build;
 }
@@ -333,11 +333,33 @@ fu_dfuse_firmware_init (FuDfuseFirmware *self)
 	fu_dfu_firmware_set_version (FU_DFU_FIRMWARE (self), FU_DFU_FIRMARE_VERSION_DFUSE);
 }
 
+static gboolean
+fu_dfuse_firmware_check_magic (FuFirmware *firmware, GBytes *fw, gsize offset, GError **error)
+{
+	gsize bufsz = 0;
+	const guint8 *buf = g_bytes_get_data (fw, &bufsz);
+
+	/* DFU footer */
+	if (!FU_FIRMWARE_CLASS (fu_dfuse_firmware_parent_class)->check_magic (firmware, fw, offset, error))
+		return FALSE;
+
+	/* DfuSe prefix */
+	if (bufsz < offset + 5 || memcmp (buf + offset, "DfuSe", 5) != 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "invalid DfuSe prefix");
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static void
 fu_dfuse_firmware_class_init (FuDfuseFirmwareClass *klass)
 {
 	FuFirmwareClass *klass_firmware = FU_FIRMWARE_CLASS (klass);
 	klass_firmware->parse = fu_dfuse_firmware_parse;
+	klass_firmware->check_magic = fu_dfuse_firmware_check_magic;
 	klass_firmware->write = fu_dfuse_firmware_write;
 }
 
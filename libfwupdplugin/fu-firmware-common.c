@@ -10,6 +10,8 @@
 
 #include <string.h>
 
+#include "fwupd-error.h"
+
 #include "fu-common.h"
 #include "fu-firmware-common.h"
 
@@ -172,3 +174,84 @@ fu_firmware_strparse_uint32_safe (const gchar *data,
 		*value = (guint32) g_ascii_strtoull (buffer, NULL, 16);
 	return TRUE;
 }
+
+/* ASCII to nibble, where invalid chars map to 0xff */
+static const guint8 fu_firmware_hex_table[256] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+/**
+ * fu_firmware_strparse_hex_safe:
+ * @data: source buffer
+ * @datasz: size of @data, typcally the same as `strlen(data)`
+ * @offset: offset in chars into @data to read
+ * @buf: (out): destination buffer
+ * @bufsz: number of bytes to write into @buf
+ * @error: (nullable): optional return location for an error
+ *
+ * Parses @bufsz bytes of base 16 data, i.e. `bufsz * 2` chars from @data.
+ * Unlike fu_firmware_strparse_uint8_safe() every char must be a valid
+ * hexadecimal digit.
+ *
+ * Returns: %TRUE if parsed, %FALSE otherwise
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fu_firmware_strparse_hex_safe (const gchar *data,
+			       gsize datasz,
+			       gsize offset,
+			       guint8 *buf,
+			       gsize bufsz,
+			       GError **error)
+{
+	const guint8 *src = (const guint8 *) data + offset;
+	guint8 invalid = 0x0;
+
+	/* check bounds */
+	if (offset > datasz || bufsz > (datasz - offset) / 2) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "0x%x bytes of hex from offset 0x%x is beyond "
+			     "buffer size 0x%x",
+			     (guint) bufsz, (guint) offset, (guint) datasz);
+		return FALSE;
+	}
+
+	/* no branches in the loop, and only check once at the end */
+	for (gsize i = 0; i < bufsz; i++) {
+		guint8 hi = fu_firmware_hex_table[src[i * 2]];
+		guint8 lo = fu_firmware_hex_table[src[(i * 2) + 1]];
+		invalid |= hi | lo;
+		buf[i] = (guint8) (hi << 4) | (lo & 0x0f);
+	}
+	if (invalid & 0xf0) {
+		for (gsize i = 0; i < bufsz * 2; i++) {
+			if (fu_firmware_hex_table[src[i]] == 0xff) {
+				g_set_error (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INVALID_FILE,
+					     "invalid hex char 0x%02x at offset 0x%x",
+					     src[i], (guint) (offset + i));
+				return FALSE;
+			}
+		}
+	}
+	return TRUE;
+}
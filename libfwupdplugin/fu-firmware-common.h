@@ -33,3 +33,9 @@ gboolean	 fu_firmware_strparse_uint32_safe	(const gchar	*data,
 							 gsize		 offset,
 							 guint32	*value,
 							 GError		**error);
+gboolean	 fu_firmware_strparse_hex_safe		(const gchar	*data,
+							 gsize		 datasz,
+							 gsize		 offset,
+							 guint8		*buf,
+							 gsize		 bufsz,
+							 GError		**error);
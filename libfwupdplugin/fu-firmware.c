@@ -8,6 +8,8 @@
 
 #include "config.h"
 
+#include <string.h>
+
 #include "fu-chunk-private.h"
 #include "fu-common.h"
 #include "fu-firmware.h"
@@ -34,8 +36,17 @@ typedef struct {
 	guint64				 offset;
 	gsize				 size;
 	GPtrArray			*chunks;	/* nullable, element-type FuChunk */
+	gboolean			 images_loaded;
+	GHashTable			*images_by_id;	/* nullable, str:FuFirmware */
+	GHashTable			*images_by_idx;	/* nullable, guint64:FuFirmware */
+	GPtrArray			*parents;	/* noref, element-type FuFirmware */
 } FuFirmwarePrivate;
 
+typedef struct {
+	FuFirmware			*parent;	/* noref */
+	guint				 pos;
+} FuFirmwareIterLevel;
+
 G_DEFINE_TYPE_WITH_PRIVATE (FuFirmware, fu_firmware, G_TYPE_OBJECT)
 #define GET_PRIVATE(o) (fu_firmware_get_instance_private (o))
 
@@ -247,6 +258,59 @@ fu_firmware_set_filename (FuFirmware *self, const gchar *filename)
 	priv->filename = g_strdup (filename);
 }
 
+/* the lookup tables are rebuilt on demand when next required */
+static void
+fu_firmware_invalidate_index (FuFirmware *self)
+{
+	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+	g_clear_pointer (&priv->images_by_id, g_hash_table_unref);
+	g_clear_pointer (&priv->images_by_idx, g_hash_table_unref);
+}
+
+/* images can be added to more than one firmware */
+static void
+fu_firmware_invalidate_parent_indexes (FuFirmware *self)
+{
+	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+	for (guint i = 0; i < priv->parents->len; i++)
+		fu_firmware_invalidate_index (g_ptr_array_index (priv->parents, i));
+}
+
+static void
+fu_firmware_index_add_image (FuFirmware *self, FuFirmware *img)
+{
+	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+	FuFirmwarePrivate *priv_img = GET_PRIVATE (img);
+
+	/* the first image added wins, to match a linear search */
+	if (priv_img->id != NULL &&
+	    g_hash_table_lookup (priv->images_by_id, priv_img->id) == NULL) {
+		g_hash_table_insert (priv->images_by_id,
+				     g_strdup (priv_img->id), img);
+	}
+	if (g_hash_table_lookup (priv->images_by_idx, &priv_img->idx) == NULL) {
+		guint64 *idx = g_new (guint64, 1);
+		*idx = priv_img->idx;
+		g_hash_table_insert (priv->images_by_idx, idx, img);
+	}
+}
+
+static void
+fu_firmware_ensure_index (FuFirmware *self)
+{
+	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+	if (priv->images_by_id != NULL)
+		return;
+	priv->images_by_id = g_hash_table_new_full (g_str_hash, g_str_equal,
+						    g_free, NULL);
+	priv->images_by_idx = g_hash_table_new_full (g_int64_hash, g_int64_equal,
+						     g_free, NULL);
+	for (guint i = 0; i < priv->images->len; i++) {
+		FuFirmware *img = g_ptr_array_index (priv->images, i);
+		fu_firmware_index_add_image (self, img);
+	}
+}
+
 /**
  * fu_firmware_set_id:
  * @self: a #FuPlugin
@@ -264,6 +328,7 @@ fu_firmware_set_id (FuFirmware *self, const gchar *id)
 	if (g_strcmp0 (priv->id, id) == 0)
 		return;
 
+	fu_firmware_invalidate_parent_indexes (self);
 	g_free (priv->id);
 	priv->id = g_strdup (id);
 }
@@ -414,6 +479,12 @@ fu_firmware_set_idx (FuFirmware *self, guint64 idx)
 {
 	FuFirmwarePrivate *priv = GET_PRIVATE (self);
 	g_return_if_fail (FU_IS_FIRMWARE (self));
+
+	/* not changed */
+	if (priv->idx == idx)
+		return;
+
+	fu_firmware_invalidate_parent_indexes (self);
 	priv->idx = idx;
 }
 
@@ -660,6 +731,37 @@ fu_firmware_tokenize (FuFirmware *self, GBytes *fw,
 	return TRUE;
 }
 
+/**
+ * fu_firmware_check_magic:
+ * @self: a #FuFirmware
+ * @fw: firmware blob
+ * @offset: start offset, typically 0x0
+ * @error: (nullable): optional return location for an error
+ *
+ * Checks the firmware has the expected magic bytes at @offset, which is
+ * much quicker than parsing the entire image. This is typically used to find
+ * the correct firmware type when the type is not known.
+ *
+ * If the firmware type does not define any magic then this always succeeds.
+ *
+ * Returns: %TRUE if the magic matches
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fu_firmware_check_magic (FuFirmware *self, GBytes *fw, gsize offset, GError **error)
+{
+	FuFirmwareClass *klass = FU_FIRMWARE_GET_CLASS (self);
+
+	g_return_val_if_fail (FU_IS_FIRMWARE (self), FALSE);
+	g_return_val_if_fail (fw != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (klass->check_magic == NULL)
+		return TRUE;
+	return klass->check_magic (self, fw, offset, error);
+}
+
 /**
  * fu_firmware_parse_full:
  * @self: a #FuFirmware
@@ -684,6 +786,7 @@ fu_firmware_parse_full (FuFirmware *self,
 			GError **error)
 {
 	FuFirmwareClass *klass = FU_FIRMWARE_GET_CLASS (self);
+	FuFirmwarePrivate *priv = GET_PRIVATE (self);
 
 	g_return_val_if_fail (FU_IS_FIRMWARE (self), FALSE);
 	g_return_val_if_fail (fw != NULL, FALSE);
@@ -698,6 +801,9 @@ fu_firmware_parse_full (FuFirmware *self,
 		return FALSE;
 	}
 
+	/* any deferred images are loaded from the new payload */
+	priv->images_loaded = FALSE;
+
 	/* subclassed */
 	if (klass->tokenize != NULL) {
 		if (!klass->tokenize (self, fw, flags, error))
@@ -712,6 +818,38 @@ fu_firmware_parse_full (FuFirmware *self,
 	return TRUE;
 }
 
+/**
+ * fu_firmware_check:
+ * @self: a #FuFirmware
+ * @error: (nullable): optional return location for an error
+ *
+ * Loads any images that the subclass deferred when parsing, for the entire
+ * image tree. This detects any corrupt payloads that fu_firmware_parse() would
+ * otherwise not have checked, and is typically used when validating untrusted
+ * firmware.
+ *
+ * Returns: %TRUE if all the images could be loaded
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fu_firmware_check (FuFirmware *self, GError **error)
+{
+	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+
+	g_return_val_if_fail (FU_IS_FIRMWARE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (!fu_firmware_ensure_images (self, error))
+		return FALSE;
+	for (guint i = 0; i < priv->images->len; i++) {
+		FuFirmware *img = g_ptr_array_index (priv->images, i);
+		if (!fu_firmware_check (img, error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
 /**
  * fu_firmware_parse:
  * @self: a #FuFirmware
@@ -1144,6 +1282,31 @@ fu_firmware_write_file (FuFirmware *self, GFile *file, GError **error)
 					NULL, NULL, error);
 }
 
+static void
+fu_firmware_remove_image_index (FuFirmware *self, guint idx)
+{
+	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+	FuFirmware *img = g_ptr_array_index (priv->images, idx);
+	FuFirmwarePrivate *priv_img = GET_PRIVATE (img);
+
+	g_ptr_array_remove (priv_img->parents, self);
+	g_ptr_array_remove_index (priv->images, idx);
+	fu_firmware_invalidate_index (self);
+}
+
+static gboolean
+fu_firmware_remove_image_internal (FuFirmware *self, FuFirmware *img)
+{
+	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+	for (guint i = 0; i < priv->images->len; i++) {
+		if (g_ptr_array_index (priv->images, i) == img) {
+			fu_firmware_remove_image_index (self, i);
+			return TRUE;
+		}
+	}
+	return FALSE;
+}
+
 /**
  * fu_firmware_add_image:
  * @self: a #FuPlugin
@@ -1160,6 +1323,7 @@ void
 fu_firmware_add_image (FuFirmware *self, FuFirmware *img)
 {
 	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+	FuFirmwarePrivate *priv_img = GET_PRIVATE (img);
 	g_return_if_fail (FU_IS_FIRMWARE (self));
 	g_return_if_fail (FU_IS_FIRMWARE (img));
 
@@ -1169,20 +1333,24 @@ fu_firmware_add_image (FuFirmware *self, FuFirmware *img)
 		if (priv->flags & FU_FIRMWARE_FLAG_DEDUPE_ID) {
 			if (g_strcmp0 (fu_firmware_get_id (img_tmp),
 				       fu_firmware_get_id (img)) == 0) {
-				g_ptr_array_remove_index (priv->images, i);
+				fu_firmware_remove_image_index (self, i);
 				break;
 			}
 		}
 		if (priv->flags & FU_FIRMWARE_FLAG_DEDUPE_IDX) {
 			if (fu_firmware_get_idx (img_tmp) ==
 			    fu_firmware_get_idx (img)) {
-				g_ptr_array_remove_index (priv->images, i);
+				fu_firmware_remove_image_index (self, i);
 				break;
 			}
 		}
 	}
 
+	/* the image may also be a child of other firmware */
+	g_ptr_array_add (priv_img->parents, self);
 	g_ptr_array_add (priv->images, g_object_ref (img));
+	if (priv->images_by_id != NULL)
+		fu_firmware_index_add_image (self, img);
 }
 
 /**
@@ -1200,13 +1368,11 @@ fu_firmware_add_image (FuFirmware *self, FuFirmware *img)
 gboolean
 fu_firmware_remove_image (FuFirmware *self, FuFirmware *img, GError **error)
 {
-	FuFirmwarePrivate *priv = GET_PRIVATE (self);
-
 	g_return_val_if_fail (FU_IS_FIRMWARE (self), FALSE);
 	g_return_val_if_fail (FU_IS_FIRMWARE (img), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
-	if (g_ptr_array_remove (priv->images, img))
+	if (fu_firmware_remove_image_internal (self, img))
 		return TRUE;
 
 	/* did not exist */
@@ -1233,7 +1399,6 @@ fu_firmware_remove_image (FuFirmware *self, FuFirmware *img, GError **error)
 gboolean
 fu_firmware_remove_image_by_idx (FuFirmware *self, guint64 idx, GError **error)
 {
-	FuFirmwarePrivate *priv = GET_PRIVATE (self);
 	g_autoptr(FuFirmware) img = NULL;
 
 	g_return_val_if_fail (FU_IS_FIRMWARE (self), FALSE);
@@ -1242,8 +1407,7 @@ fu_firmware_remove_image_by_idx (FuFirmware *self, guint64 idx, GError **error)
 	img = fu_firmware_get_image_by_idx (self, idx, error);
 	if (img == NULL)
 		return FALSE;
-	g_ptr_array_remove (priv->images, img);
-	return TRUE;
+	return fu_firmware_remove_image_internal (self, img);
 }
 
 /**
@@ -1261,7 +1425,6 @@ fu_firmware_remove_image_by_idx (FuFirmware *self, guint64 idx, GError **error)
 gboolean
 fu_firmware_remove_image_by_id (FuFirmware *self, const gchar *id, GError **error)
 {
-	FuFirmwarePrivate *priv = GET_PRIVATE (self);
 	g_autoptr(FuFirmware) img = NULL;
 
 	g_return_val_if_fail (FU_IS_FIRMWARE (self), FALSE);
@@ -1270,10 +1433,52 @@ fu_firmware_remove_image_by_id (FuFirmware *self, const gchar *id, GError **erro
 	img = fu_firmware_get_image_by_id (self, id, error);
 	if (img == NULL)
 		return FALSE;
-	g_ptr_array_remove (priv->images, img);
+	return fu_firmware_remove_image_internal (self, img);
+}
+
+/**
+ * fu_firmware_ensure_images:
+ * @self: a #FuFirmware
+ * @error: (nullable): optional return location for an error
+ *
+ * Creates any images the subclass deferred until they were first required,
+ * for instance by decompressing a section. Getters that cannot return an
+ * error, e.g. fu_firmware_get_images(), return no images if this fails.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fu_firmware_ensure_images (FuFirmware *self, GError **error)
+{
+	FuFirmwareClass *klass = FU_FIRMWARE_GET_CLASS (self);
+	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+
+	g_return_val_if_fail (FU_IS_FIRMWARE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (klass->ensure_images == NULL || priv->images_loaded)
+		return TRUE;
+	if (!klass->ensure_images (self, error))
+		return FALSE;
+	priv->images_loaded = TRUE;
 	return TRUE;
 }
 
+/* for the functions that cannot return an error; the failure is caused by
+ * the untrusted firmware and so is not a warning */
+static void
+fu_firmware_ensure_images_or_debug (FuFirmware *self)
+{
+	g_autoptr(GError) error_local = NULL;
+	if (!fu_firmware_ensure_images (self, &error_local)) {
+		g_debug ("failed to load %s images: %s",
+			 G_OBJECT_TYPE_NAME (self),
+			 error_local->message);
+	}
+}
+
 /**
  * fu_firmware_get_images:
  * @self: a #FuFirmware
@@ -1292,6 +1497,7 @@ fu_firmware_get_images (FuFirmware *self)
 
 	g_return_val_if_fail (FU_IS_FIRMWARE (self), NULL);
 
+	fu_firmware_ensure_images_or_debug (self);
 	imgs = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	for (guint i = 0; i < priv->images->len; i++) {
 		FuFirmware *img = g_ptr_array_index (priv->images, i);
@@ -1300,6 +1506,34 @@ fu_firmware_get_images (FuFirmware *self)
 	return g_steal_pointer (&imgs);
 }
 
+/* returns (transfer none) */
+static FuFirmware *
+fu_firmware_lookup_image_by_id (FuFirmware *self, const gchar *id)
+{
+	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+
+	/* not indexed */
+	if (id == NULL) {
+		for (guint i = 0; i < priv->images->len; i++) {
+			FuFirmware *img = g_ptr_array_index (priv->images, i);
+			if (fu_firmware_get_id (img) == NULL)
+				return img;
+		}
+		return NULL;
+	}
+	fu_firmware_ensure_index (self);
+	return g_hash_table_lookup (priv->images_by_id, id);
+}
+
+/* returns (transfer none) */
+static FuFirmware *
+fu_firmware_lookup_image_by_idx (FuFirmware *self, guint64 idx)
+{
+	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+	fu_firmware_ensure_index (self);
+	return g_hash_table_lookup (priv->images_by_idx, &idx);
+}
+
 /**
  * fu_firmware_get_image_by_id:
  * @self: a #FuPlugin
@@ -1315,16 +1549,17 @@ fu_firmware_get_images (FuFirmware *self)
 FuFirmware *
 fu_firmware_get_image_by_id (FuFirmware *self, const gchar *id, GError **error)
 {
-	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+	FuFirmware *img;
 
 	g_return_val_if_fail (FU_IS_FIRMWARE (self), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	for (guint i = 0; i < priv->images->len; i++) {
-		FuFirmware *img = g_ptr_array_index (priv->images, i);
-		if (g_strcmp0 (fu_firmware_get_id (img), id) == 0)
-			return g_object_ref (img);
-	}
+	if (!fu_firmware_ensure_images (self, error))
+		return NULL;
+
+	img = fu_firmware_lookup_image_by_id (self, id);
+	if (img != NULL)
+		return g_object_ref (img);
 	g_set_error (error,
 		     FWUPD_ERROR,
 		     FWUPD_ERROR_NOT_FOUND,
@@ -1368,16 +1603,17 @@ fu_firmware_get_image_by_id_bytes (FuFirmware *self, const gchar *id, GError **e
 FuFirmware *
 fu_firmware_get_image_by_idx (FuFirmware *self, guint64 idx, GError **error)
 {
-	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+	FuFirmware *img;
 
 	g_return_val_if_fail (FU_IS_FIRMWARE (self), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	for (guint i = 0; i < priv->images->len; i++) {
-		FuFirmware *img = g_ptr_array_index (priv->images, i);
-		if (fu_firmware_get_idx (img) == idx)
-			return g_object_ref (img);
-	}
+	if (!fu_firmware_ensure_images (self, error))
+		return NULL;
+
+	img = fu_firmware_lookup_image_by_idx (self, idx);
+	if (img != NULL)
+		return g_object_ref (img);
 	g_set_error (error,
 		     FWUPD_ERROR,
 		     FWUPD_ERROR_NOT_FOUND,
@@ -1385,6 +1621,289 @@ fu_firmware_get_image_by_idx (FuFirmware *self, guint64 idx, GError **error)
 	return NULL;
 }
 
+/* matches `FuEfiFirmwareVolume` with `volume`, ignoring case */
+static gboolean
+fu_firmware_gtype_has_suffix (FuFirmware *self, const gchar *suffix)
+{
+	const gchar *gtypestr = G_OBJECT_TYPE_NAME (self);
+	gsize gtypestrsz = strlen (gtypestr);
+	gsize suffixsz = strlen (suffix);
+	if (suffixsz > gtypestrsz)
+		return FALSE;
+	return g_ascii_strcasecmp (gtypestr + gtypestrsz - suffixsz, suffix) == 0;
+}
+
+/* a decimal or hexadecimal index rather than an ID like a GUID */
+static gboolean
+fu_firmware_path_key_is_idx (const gchar *key)
+{
+	gboolean hex = g_str_has_prefix (key, "0x");
+	if (hex)
+		key += 2;
+	if (key[0] == '\0')
+		return FALSE;
+	for (guint i = 0; key[i] != '\0'; i++) {
+		if (hex ? !g_ascii_isxdigit (key[i]) : !g_ascii_isdigit (key[i]))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/* returns (transfer none) */
+static FuFirmware *
+fu_firmware_lookup_image_by_segment (FuFirmware *self,
+				     const gchar *segment,
+				     GError **error)
+{
+	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+	const gchar *bracket = strchr (segment, '[');
+	gsize segmentsz = strlen (segment);
+	g_autofree gchar *kind = NULL;
+	g_autofree gchar *key = NULL;
+
+	if (!fu_firmware_ensure_images (self, error))
+		return NULL;
+
+	/* ID, falling back to the type */
+	if (bracket == NULL) {
+		FuFirmware *img = fu_firmware_lookup_image_by_id (self, segment);
+		if (img != NULL)
+			return img;
+		kind = g_strdup (segment);
+
+	/* TYPE[IDX] or TYPE[ID] where TYPE is optional */
+	} else {
+		if (segmentsz < 3 || segment[segmentsz - 1] != ']') {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "invalid path segment %s", segment);
+			return NULL;
+		}
+		kind = g_strndup (segment, bracket - segment);
+		key = g_strndup (bracket + 1, segmentsz - (bracket - segment) - 2);
+		if (kind[0] == '\0') {
+			FuFirmware *img;
+			if (fu_firmware_path_key_is_idx (key))
+				img = fu_firmware_lookup_image_by_idx (self, fu_common_strtoull (key));
+			else
+				img = fu_firmware_lookup_image_by_id (self, key);
+			if (img != NULL)
+				return img;
+		}
+	}
+
+	/* filter by type, which is not indexed */
+	if (kind[0] != '\0') {
+		gboolean key_is_idx = key != NULL && fu_firmware_path_key_is_idx (key);
+		guint64 idx = key_is_idx ? fu_common_strtoull (key) : 0;
+		for (guint i = 0; i < priv->images->len; i++) {
+			FuFirmware *img = g_ptr_array_index (priv->images, i);
+			if (!fu_firmware_gtype_has_suffix (img, kind))
+				continue;
+			if (key == NULL)
+				return img;
+			if (key_is_idx && fu_firmware_get_idx (img) == idx)
+				return img;
+			if (!key_is_idx && g_strcmp0 (fu_firmware_get_id (img), key) == 0)
+				return img;
+		}
+	}
+	g_set_error (error,
+		     FWUPD_ERROR,
+		     FWUPD_ERROR_NOT_FOUND,
+		     "no image %s found in firmware", segment);
+	return NULL;
+}
+
+/**
+ * fu_firmware_get_image_by_path:
+ * @self: a #FuFirmware
+ * @path: image path, e.g. `bios/volume[2]/file[GUID]`
+ * @error: (nullable): optional return location for an error
+ *
+ * Gets a nested firmware image using a path of `/`-separated segments.
+ *
+ * Each segment is either an image ID, or `TYPE[KEY]` where `KEY` is either an
+ * image index or ID, and the optional `TYPE` is matched case-insensitively
+ * against the end of the image type name, e.g. `volume` for
+ * `FuEfiFirmwareVolume`. A bare segment that does not match an image ID is
+ * also tried as a `TYPE`.
+ *
+ * Returns: (transfer full): a #FuFirmware, or %NULL if the image is not found
+ *
+ * Since: 1.6.2
+ **/
+FuFirmware *
+fu_firmware_get_image_by_path (FuFirmware *self, const gchar *path, GError **error)
+{
+	FuFirmware *img = self;
+	g_auto(GStrv) split = NULL;
+
+	g_return_val_if_fail (FU_IS_FIRMWARE (self), NULL);
+	g_return_val_if_fail (path != NULL, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	split = g_strsplit (path, "/", -1);
+	for (guint i = 0; split[i] != NULL; i++) {
+		if (split[i][0] == '\0')
+			continue;
+		img = fu_firmware_lookup_image_by_segment (img, split[i], error);
+		if (img == NULL) {
+			g_prefix_error (error, "failed to find %s: ", path);
+			return NULL;
+		}
+	}
+	return g_object_ref (img);
+}
+
+/**
+ * fu_firmware_get_parent:
+ * @self: a #FuFirmware
+ *
+ * Gets the firmware that this image was most recently added to.
+ *
+ * Returns: (transfer none): a #FuFirmware, or %NULL if unset
+ *
+ * Since: 1.6.2
+ **/
+FuFirmware *
+fu_firmware_get_parent (FuFirmware *self)
+{
+	FuFirmwarePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_FIRMWARE (self), NULL);
+	if (priv->parents->len == 0)
+		return NULL;
+	return g_ptr_array_index (priv->parents, priv->parents->len - 1);
+}
+
+/**
+ * fu_firmware_iter_init:
+ * @iter: an uninitialized #FuFirmwareIter
+ * @self: a #FuFirmware
+ *
+ * Initializes a depth-first iterator over all the nested images of @self,
+ * not including @self itself.
+ *
+ * The tree must not be modified while iterating. If the iteration is stopped
+ * before fu_firmware_iter_next() returns %FALSE then fu_firmware_iter_clear()
+ * must be called, or the iterator declared using
+ * `g_auto(FuFirmwareIter) iter = { NULL };`.
+ *
+ * Since: 1.6.2
+ **/
+void
+fu_firmware_iter_init (FuFirmwareIter *iter, FuFirmware *self)
+{
+	g_return_if_fail (iter != NULL);
+	g_return_if_fail (FU_IS_FIRMWARE (self));
+	iter->root = self;
+	iter->img = NULL;
+	iter->stack = g_array_new (FALSE, FALSE, sizeof(FuFirmwareIterLevel));
+}
+
+/**
+ * fu_firmware_iter_clear:
+ * @iter: a #FuFirmwareIter
+ *
+ * Frees any resources used by the iterator.
+ *
+ * Since: 1.6.2
+ **/
+void
+fu_firmware_iter_clear (FuFirmwareIter *iter)
+{
+	g_return_if_fail (iter != NULL);
+	iter->root = NULL;
+	iter->img = NULL;
+	g_clear_pointer (&iter->stack, g_array_unref);
+}
+
+/**
+ * fu_firmware_iter_next:
+ * @iter: an initialized #FuFirmwareIter
+ * @img: (out) (optional) (transfer none): the next image
+ * @error: (nullable): optional return location for an error
+ *
+ * Advances @iter to the next image in the tree, where children are returned
+ * before siblings.
+ *
+ * Returns: %FALSE if there are no more images, or if the deferred images of
+ * the current image could not be loaded, in which case @error is set
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fu_firmware_iter_next (FuFirmwareIter *iter, FuFirmware **img, GError **error)
+{
+	FuFirmware *cur;
+	FuFirmware *next = NULL;
+	FuFirmwarePrivate *priv;
+
+	g_return_val_if_fail (iter != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* already finished */
+	if (iter->root == NULL)
+		return FALSE;
+
+	/* descend */
+	cur = iter->img != NULL ? iter->img : iter->root;
+	if (!fu_firmware_ensure_images (cur, error)) {
+		fu_firmware_iter_clear (iter);
+		return FALSE;
+	}
+	priv = GET_PRIVATE (cur);
+	if (priv->images->len > 0) {
+		FuFirmwareIterLevel level = { .parent = cur, .pos = 0 };
+		g_array_append_val (iter->stack, level);
+		next = g_ptr_array_index (priv->images, 0);
+	} else {
+		/* next sibling, or the next sibling of an ancestor; the parents
+		 * are tracked here as an image may have more than one */
+		while (iter->stack->len > 0) {
+			FuFirmwareIterLevel *level = &g_array_index (iter->stack,
+								     FuFirmwareIterLevel,
+								     iter->stack->len - 1);
+			FuFirmwarePrivate *priv_parent = GET_PRIVATE (level->parent);
+			if (level->pos + 1 < priv_parent->images->len) {
+				level->pos++;
+				next = g_ptr_array_index (priv_parent->images, level->pos);
+				break;
+			}
+			g_array_set_size (iter->stack, iter->stack->len - 1);
+		}
+	}
+	if (next == NULL) {
+		fu_firmware_iter_clear (iter);
+		return FALSE;
+	}
+	iter->img = next;
+	if (img != NULL)
+		*img = next;
+	return TRUE;
+}
+
+/**
+ * fu_firmware_iter_get_depth:
+ * @iter: an initialized #FuFirmwareIter
+ *
+ * Gets the depth of the current image, where direct children of the
+ * iterator root are depth 1.
+ *
+ * Returns: integer
+ *
+ * Since: 1.6.2
+ **/
+guint
+fu_firmware_iter_get_depth (FuFirmwareIter *iter)
+{
+	g_return_val_if_fail (iter != NULL, 0);
+	if (iter->stack == NULL)
+		return 0;
+	return iter->stack->len;
+}
+
 /**
  * fu_firmware_get_image_by_checksum:
  * @self: a #FuPlugin
@@ -1410,6 +1929,8 @@ fu_firmware_get_image_by_checksum (FuFirmware *self,
 	g_return_val_if_fail (checksum != NULL, NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
+	if (!fu_firmware_ensure_images (self, error))
+		return NULL;
 	csum_kind = fwupd_checksum_guess_kind (checksum);
 	for (guint i = 0; i < priv->images->len; i++) {
 		FuFirmware *img = g_ptr_array_index (priv->images, i);
@@ -1526,6 +2047,7 @@ fu_firmware_export (FuFirmware *self,
 		klass->export (self, flags, bn);
 
 	/* children */
+	fu_firmware_ensure_images_or_debug (self);
 	if (priv->images->len > 0) {
 		for (guint i = 0; i < priv->images->len; i++) {
 			FuFirmware *img = g_ptr_array_index (priv->images, i);
@@ -1595,6 +2117,7 @@ fu_firmware_init (FuFirmware *self)
 {
 	FuFirmwarePrivate *priv = GET_PRIVATE (self);
 	priv->images = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	priv->parents = g_ptr_array_new ();
 }
 
 static void
@@ -1609,7 +2132,13 @@ fu_firmware_finalize (GObject *object)
 		g_bytes_unref (priv->bytes);
 	if (priv->chunks != NULL)
 		g_ptr_array_unref (priv->chunks);
+	for (guint i = 0; i < priv->images->len; i++) {
+		FuFirmware *img = g_ptr_array_index (priv->images, i);
+		g_ptr_array_remove (GET_PRIVATE (img)->parents, self);
+	}
 	g_ptr_array_unref (priv->images);
+	g_ptr_array_unref (priv->parents);
+	fu_firmware_invalidate_index (self);
 	G_OBJECT_CLASS (fu_firmware_parent_class)->finalize (object);
 }
 
@@ -1655,38 +2184,32 @@ fu_firmware_new_from_bytes (GBytes *fw)
 }
 
 /**
- * fu_firmware_new_from_gtypes:
+ * fu_firmware_new_from_gtype_array:
  * @fw: firmware blob
+ * @gtypes: (element-type GType): an array of #GTypes
  * @flags: install flags, e.g. %FWUPD_INSTALL_FLAG_IGNORE_CHECKSUM
  * @error: (nullable): optional return location for an error
- * @...: an array of #GTypes, ending with %G_TYPE_INVALID
  *
- * Tries to parse the firmware with each #GType in order.
+ * Tries to parse the firmware with each #GType in order, skipping any where
+ * the magic bytes do not match.
  *
  * Returns: (transfer full) (nullable): a #FuFirmware, or %NULL
  *
- * Since: 1.5.6
+ * Since: 1.6.2
  **/
 FuFirmware *
-fu_firmware_new_from_gtypes (GBytes *fw, FwupdInstallFlags flags, GError **error, ...)
+fu_firmware_new_from_gtype_array (GBytes *fw,
+				  GArray *gtypes,
+				  FwupdInstallFlags flags,
+				  GError **error)
 {
-	va_list args;
-	g_autoptr(GArray) gtypes = g_array_new (FALSE, FALSE, sizeof(GType));
 	g_autoptr(GError) error_all = NULL;
+	g_autoptr(GPtrArray) candidates = NULL;
 
 	g_return_val_if_fail (fw != NULL, NULL);
+	g_return_val_if_fail (gtypes != NULL, NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
-	/* create array of GTypes */
-	va_start (args, error);
-	for (guint i = 0; ; i++) {
-		GType gtype = va_arg (args, GType);
-		if (gtype == G_TYPE_INVALID)
-			break;
-		g_array_append_val (gtypes, gtype);
-	}
-	va_end (args);
-
 	/* invalid */
 	if (gtypes->len == 0) {
 		g_set_error_literal (error,
@@ -1696,11 +2219,31 @@ fu_firmware_new_from_gtypes (GBytes *fw, FwupdInstallFlags flags, GError **error
 		return NULL;
 	}
 
-	/* try each GType in turn */
+	/* the magic check is much cheaper than a full parse */
+	candidates = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	for (guint i = 0; i < gtypes->len; i++) {
 		GType gtype = g_array_index (gtypes, GType, i);
 		g_autoptr(FuFirmware) firmware = g_object_new (gtype, NULL);
 		g_autoptr(GError) error_local = NULL;
+		if (!fu_firmware_check_magic (firmware, fw, 0x0, &error_local)) {
+			g_debug ("ignoring %s: %s",
+				 g_type_name (gtype), error_local->message);
+			if (error_all == NULL) {
+				g_propagate_error (&error_all,
+						   g_steal_pointer (&error_local));
+			} else {
+				g_prefix_error (&error_all, "%s: ",
+						error_local->message);
+			}
+			continue;
+		}
+		g_ptr_array_add (candidates, g_steal_pointer (&firmware));
+	}
+
+	/* try each remaining GType in turn */
+	for (guint i = 0; i < candidates->len; i++) {
+		FuFirmware *firmware = g_ptr_array_index (candidates, i);
+		g_autoptr(GError) error_local = NULL;
 		if (!fu_firmware_parse (firmware, fw, flags, &error_local)) {
 			if (error_all == NULL) {
 				g_propagate_error (&error_all,
@@ -1711,10 +2254,44 @@ fu_firmware_new_from_gtypes (GBytes *fw, FwupdInstallFlags flags, GError **error
 			}
 			continue;
 		}
-		return g_steal_pointer (&firmware);
+		return g_object_ref (firmware);
 	}
 
 	/* failed */
 	g_propagate_error (error, g_steal_pointer (&error_all));
 	return NULL;
 }
+
+/**
+ * fu_firmware_new_from_gtypes:
+ * @fw: firmware blob
+ * @flags: install flags, e.g. %FWUPD_INSTALL_FLAG_IGNORE_CHECKSUM
+ * @error: (nullable): optional return location for an error
+ * @...: an array of #GTypes, ending with %G_TYPE_INVALID
+ *
+ * Tries to parse the firmware with each #GType in order.
+ *
+ * Returns: (transfer full) (nullable): a #FuFirmware, or %NULL
+ *
+ * Since: 1.5.6
+ **/
+FuFirmware *
+fu_firmware_new_from_gtypes (GBytes *fw, FwupdInstallFlags flags, GError **error, ...)
+{
+	va_list args;
+	g_autoptr(GArray) gtypes = g_array_new (FALSE, FALSE, sizeof(GType));
+
+	g_return_val_if_fail (fw != NULL, NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* create array of GTypes */
+	va_start (args, error);
+	for (guint i = 0; ; i++) {
+		GType gtype = va_arg (args, GType);
+		if (gtype == G_TYPE_INVALID)
+			break;
+		g_array_append_val (gtypes, gtype);
+	}
+	va_end (args);
+	return fu_firmware_new_from_gtype_array (fw, gtypes, flags, error);
+}
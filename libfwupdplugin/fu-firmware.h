@@ -77,8 +77,16 @@ struct _FuFirmwareClass
 							 GChecksumType	 csum_kind,
 							 GError		**error)
 							 G_GNUC_WARN_UNUSED_RESULT;
+	gboolean		 (*ensure_images)	(FuFirmware	*self,
+							 GError		**error)
+							 G_GNUC_WARN_UNUSED_RESULT;
+	gboolean		 (*check_magic)		(FuFirmware	*self,
+							 GBytes		*fw,
+							 gsize		 offset,
+							 GError		**error)
+							 G_GNUC_WARN_UNUSED_RESULT;
 	/*< private >*/
-	gpointer		 padding[26];
+	gpointer		 padding[24];
 };
 
 /**
@@ -129,6 +137,20 @@ struct _FuFirmwareClass
  **/
 typedef guint64 FuFirmwareFlags;
 
+/**
+ * FuFirmwareIter:
+ *
+ * A depth-first iterator over nested firmware images, which is typically
+ * allocated on the stack.
+ **/
+typedef struct {
+	/*< private >*/
+	FuFirmware	*root;
+	FuFirmware	*img;
+	GArray		*stack;
+	gpointer	 padding[5];
+} FuFirmwareIter;
+
 /**
  * FU_FIRMWARE_ID_PAYLOAD:
  *
@@ -145,6 +167,7 @@ typedef guint64 FuFirmwareFlags;
  * Since: 1.6.0
  **/
 #define FU_FIRMWARE_ID_SIGNATURE		"signature"
+
 /**
  * FU_FIRMWARE_ID_HEADER:
  *
@@ -197,6 +220,10 @@ FuFirmware	*fu_firmware_new_from_gtypes		(GBytes		*fw,
 							 FwupdInstallFlags flags,
 							 GError		**error,
 							 ...);
+FuFirmware	*fu_firmware_new_from_gtype_array	(GBytes		*fw,
+							 GArray		*gtypes,
+							 FwupdInstallFlags flags,
+							 GError		**error);
 gchar		*fu_firmware_to_string			(FuFirmware	*self);
 void		 fu_firmware_export			(FuFirmware	*self,
 							 FuFirmwareExportFlags flags,
@@ -257,6 +284,17 @@ gboolean	 fu_firmware_build_from_xml		(FuFirmware	*self,
 							 const gchar	*xml,
 							 GError		**error)
 							 G_GNUC_WARN_UNUSED_RESULT;
+gboolean	 fu_firmware_check			(FuFirmware	*self,
+							 GError		**error)
+							 G_GNUC_WARN_UNUSED_RESULT;
+gboolean	 fu_firmware_ensure_images		(FuFirmware	*self,
+							 GError		**error)
+							 G_GNUC_WARN_UNUSED_RESULT;
+gboolean	 fu_firmware_check_magic		(FuFirmware	*self,
+							 GBytes		*fw,
+							 gsize		 offset,
+							 GError		**error)
+							 G_GNUC_WARN_UNUSED_RESULT;
 gboolean	 fu_firmware_parse			(FuFirmware	*self,
 							 GBytes		*fw,
 							 FwupdInstallFlags flags,
@@ -317,3 +355,16 @@ GBytes		*fu_firmware_get_image_by_idx_bytes	(FuFirmware	*self,
 FuFirmware	*fu_firmware_get_image_by_checksum	(FuFirmware	*self,
 							 const gchar	*checksum,
 							 GError		**error);
+FuFirmware	*fu_firmware_get_image_by_path		(FuFirmware	*self,
+							 const gchar	*path,
+							 GError		**error);
+FuFirmware	*fu_firmware_get_parent			(FuFirmware	*self);
+void		 fu_firmware_iter_init			(FuFirmwareIter	*iter,
+							 FuFirmware	*self);
+void		 fu_firmware_iter_clear			(FuFirmwareIter	*iter);
+gboolean	 fu_firmware_iter_next			(FuFirmwareIter	*iter,
+							 FuFirmware	**img,
+							 GError		**error);
+guint		 fu_firmware_iter_get_depth		(FuFirmwareIter	*iter);
+
+G_DEFINE_AUTO_CLEANUP_CLEAR_FUNC (FuFirmwareIter, fu_firmware_iter_clear)
@@ -225,11 +225,28 @@ fu_fmap_firmware_init (FuFmapFirmware *self)
 {
 }
 
+static gboolean
+fu_fmap_firmware_check_magic (FuFirmware *firmware, GBytes *fw, gsize offset, GError **error)
+{
+	FuFmapFirmware *self = FU_FMAP_FIRMWARE (firmware);
+	gsize bufsz = 0;
+	const guint8 *buf = g_bytes_get_data (fw, &bufsz);
+	if (offset >= bufsz) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "firmware too small for fmap");
+		return FALSE;
+	}
+	return fu_fmap_firmware_find_offset (self, buf + offset, bufsz - offset, error);
+}
+
 static void
 fu_fmap_firmware_class_init (FuFmapFirmwareClass *klass)
 {
 	FuFirmwareClass *klass_firmware = FU_FIRMWARE_CLASS (klass);
 	klass_firmware->parse = fu_fmap_firmware_parse;
+	klass_firmware->check_magic = fu_fmap_firmware_check_magic;
 	klass_firmware->write = fu_fmap_firmware_write;
 }
 
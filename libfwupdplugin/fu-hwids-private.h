@@ -0,0 +1,22 @@
+/*
+ * Copyright (C) 2017 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <glib-object.h>
+
+#include "fu-hwids.h"
+
+gboolean	 fu_hwids_load_cache		(FuHwids	*self,
+						 const gchar	*filename,
+						 const gchar	*checksum,
+						 GError		**error)
+						 G_GNUC_WARN_UNUSED_RESULT;
+gboolean	 fu_hwids_save_cache		(FuHwids	*self,
+						 const gchar	*filename,
+						 const gchar	*checksum,
+						 GError		**error)
+						 G_GNUC_WARN_UNUSED_RESULT;
@@ -13,7 +13,7 @@
 #include <string.h>
 
 #include "fu-common.h"
-#include "fu-hwids.h"
+#include "fu-hwids-private.h"
 #include "fwupd-common.h"
 #include "fwupd-error.h"
 
@@ -496,6 +496,153 @@ fu_hwids_setup (FuHwids *self, FuSmbios *smbios, GError **error)
 	return TRUE;
 }
 
+/**
+ * fu_hwids_load_cache:
+ * @self: a #FuHwids
+ * @filename: a cache filename, e.g. `/var/cache/fwupd/hwids.ini`
+ * @checksum: the checksum of the SMBIOS tables the cache must match
+ * @error: (nullable): optional return location for an error
+ *
+ * Loads the SMBIOS values and hardware GUIDs from a cache file previously
+ * written by fu_hwids_save_cache(), which is much faster than parsing the
+ * SMBIOS tables and hashing all the GUIDs again.
+ *
+ * The cache is never used when values have been set with
+ * fu_hwids_add_smbios_override().
+ *
+ * Returns: %TRUE for success, or %FALSE if the cache was missing or stale
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fu_hwids_load_cache (FuHwids *self,
+		     const gchar *filename,
+		     const gchar *checksum,
+		     GError **error)
+{
+	g_autofree gchar *checksum_cache = NULL;
+	g_auto(GStrv) guids = NULL;
+	g_auto(GStrv) keys = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	g_return_val_if_fail (FU_IS_HWIDS (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (checksum != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* the cache only describes the real hardware */
+	if (g_hash_table_size (self->hash_smbios_override) > 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_SUPPORTED,
+				     "cannot use cached values with SMBIOS overrides");
+		return FALSE;
+	}
+	if (!g_key_file_load_from_file (kf, filename, G_KEY_FILE_NONE, error))
+		return FALSE;
+	checksum_cache = g_key_file_get_string (kf, "fwupd", "Checksum", NULL);
+	if (g_strcmp0 (checksum_cache, checksum) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "cache checksum %s did not match %s",
+			     checksum_cache, checksum);
+		return FALSE;
+	}
+
+	/* values are only replaced once the whole file is known to be valid */
+	guids = g_key_file_get_string_list (kf, "fwupd", "Guids", NULL, error);
+	if (guids == NULL)
+		return FALSE;
+	keys = g_key_file_get_keys (kf, "Hardware", NULL, error);
+	if (keys == NULL)
+		return FALSE;
+	g_hash_table_remove_all (self->hash_dmi_hw);
+	g_hash_table_remove_all (self->hash_dmi_display);
+	g_hash_table_remove_all (self->hash_guid);
+	g_ptr_array_set_size (self->array_guids, 0);
+	for (guint i = 0; keys[i] != NULL; i++) {
+		gchar *value_hw = g_key_file_get_string (kf, "Hardware", keys[i], NULL);
+		gchar *value_display = g_key_file_get_string (kf, "Display", keys[i], NULL);
+		if (value_hw != NULL) {
+			g_hash_table_insert (self->hash_dmi_hw,
+					     g_strdup (keys[i]), value_hw);
+		}
+		if (value_display != NULL) {
+			g_hash_table_insert (self->hash_dmi_display,
+					     g_strdup (keys[i]), value_display);
+		}
+	}
+	for (guint i = 0; guids[i] != NULL; i++) {
+		g_hash_table_insert (self->hash_guid,
+				     g_strdup (guids[i]),
+				     GUINT_TO_POINTER (1));
+		g_ptr_array_add (self->array_guids, g_strdup (guids[i]));
+	}
+	return TRUE;
+}
+
+/**
+ * fu_hwids_save_cache:
+ * @self: a #FuHwids
+ * @filename: a cache filename, e.g. `/var/cache/fwupd/hwids.ini`
+ * @checksum: the checksum of the SMBIOS tables used in fu_hwids_setup()
+ * @error: (nullable): optional return location for an error
+ *
+ * Saves the SMBIOS values and hardware GUIDs to a cache file so that they can
+ * be loaded using fu_hwids_load_cache() when the SMBIOS tables are unchanged.
+ *
+ * Values set with fu_hwids_add_smbios_override() do not describe the
+ * hardware and so cannot be saved.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fu_hwids_save_cache (FuHwids *self,
+		     const gchar *filename,
+		     const gchar *checksum,
+		     GError **error)
+{
+	GHashTableIter iter;
+	gchar *data;
+	gpointer key, value;
+	gsize datasz = 0;
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GKeyFile) kf = g_key_file_new ();
+
+	g_return_val_if_fail (FU_IS_HWIDS (self), FALSE);
+	g_return_val_if_fail (filename != NULL, FALSE);
+	g_return_val_if_fail (checksum != NULL, FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (g_hash_table_size (self->hash_smbios_override) > 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_SUPPORTED,
+				     "cannot cache overridden SMBIOS values");
+		return FALSE;
+	}
+
+	g_key_file_set_string (kf, "fwupd", "Checksum", checksum);
+	g_key_file_set_string_list (kf, "fwupd", "Guids",
+				    (const gchar * const *) self->array_guids->pdata,
+				    self->array_guids->len);
+	g_hash_table_iter_init (&iter, self->hash_dmi_hw);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_key_file_set_string (kf, "Hardware", key, value);
+	g_hash_table_iter_init (&iter, self->hash_dmi_display);
+	while (g_hash_table_iter_next (&iter, &key, &value))
+		g_key_file_set_string (kf, "Display", key, value);
+
+	data = g_key_file_to_data (kf, &datasz, error);
+	if (data == NULL)
+		return FALSE;
+	blob = g_bytes_new_take (data, datasz);
+	return fu_common_set_contents_bytes (filename, blob, error);
+}
+
 static void
 fu_hwids_finalize (GObject *object)
 {
@@ -25,53 +25,24 @@
 typedef struct {
 	FuFirmware		 parent_instance;
 	GPtrArray		*records;
+	gboolean		 records_loaded;
+	GByteArray		*tokens;	/* of FuIhexFirmwareToken+data */
+	GBytes			*fw;		/* for creating records on demand */
+	FwupdInstallFlags	 flags;
 	guint8			 padding_value;
 } FuIhexFirmwarePrivate;
 
+/* each decoded line is stored in ->tokens as this header followed by the data */
+typedef struct {
+	guint32			 ln;
+	guint16			 addr;
+	guint8			 record_type;
+	guint8			 datasz;
+} FuIhexFirmwareToken;
+
 G_DEFINE_TYPE_WITH_PRIVATE (FuIhexFirmware, fu_ihex_firmware, FU_TYPE_FIRMWARE)
 #define GET_PRIVATE(o) (fu_ihex_firmware_get_instance_private (o))
 
-/**
- * fu_ihex_firmware_get_records:
- * @self: A #FuIhexFirmware
- *
- * Returns the raw lines from tokenization.
- *
- * This might be useful if the plugin is expecting the hex file to be a list
- * of operations, rather than a simple linear image with filled holes.
- *
- * Returns: (transfer none) (element-type FuIhexFirmwareRecord): records
- *
- * Since: 1.3.4
- **/
-GPtrArray *
-fu_ihex_firmware_get_records (FuIhexFirmware *self)
-{
-	FuIhexFirmwarePrivate *priv = GET_PRIVATE (self);
-	g_return_val_if_fail (FU_IS_IHEX_FIRMWARE (self), NULL);
-	return priv->records;
-}
-
-/**
- * fu_ihex_firmware_set_padding_value:
- * @self: A #FuIhexFirmware
- * @padding_value: the byte used to pad the image
- *
- * Set the padding value to fill incomplete address ranges.
- *
- * The default value of zero can be changed to `0xff` if functions like
- * fu_common_bytes_is_empty() are going to be used on subsections of the data.
- *
- * Since: 1.6.0
- **/
-void
-fu_ihex_firmware_set_padding_value (FuIhexFirmware *self, guint8 padding_value)
-{
-	FuIhexFirmwarePrivate *priv = GET_PRIVATE (self);
-	g_return_if_fail (FU_IS_IHEX_FIRMWARE (self));
-	priv->padding_value = padding_value;
-}
-
 static void
 fu_ihex_firmware_record_free (FuIhexFirmwareRecord *rcd)
 {
@@ -80,86 +51,175 @@ fu_ihex_firmware_record_free (FuIhexFirmwareRecord *rcd)
 	g_free (rcd);
 }
 
-G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuIhexFirmwareRecord, fu_ihex_firmware_record_free)
-
-static FuIhexFirmwareRecord *
-fu_ihex_firmware_record_new (guint ln, const gchar *line,
-			     FwupdInstallFlags flags, GError **error)
+/* @buf must be at least 0x104 bytes, and has the data from offset 4 */
+static gboolean
+fu_ihex_firmware_decode_line (const gchar *line, gsize linesz,
+			      FwupdInstallFlags flags, guint8 *buf,
+			      GError **error)
 {
-	g_autoptr(FuIhexFirmwareRecord) rcd = NULL;
-	gsize linesz = strlen (line);
 	guint line_end;
-	guint16 addr16 = 0;
 
 	/* check starting token */
 	if (line[0] != ':') {
-		g_autofree gchar *strsafe = fu_common_strsafe (line, 5);
+		g_autofree gchar *strsafe = fu_common_strsafe (line, MIN (linesz, 5));
 		if (strsafe != NULL) {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "invalid starting token: %s",
 				     strsafe);
-			return NULL;
+			return FALSE;
 		}
 		g_set_error_literal (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "invalid starting token");
-		return NULL;
+		return FALSE;
 	}
 
 	/* length, 16-bit address, type */
-	rcd = g_new0 (FuIhexFirmwareRecord, 1);
-	rcd->ln = ln;
-	rcd->data = g_byte_array_new ();
-	rcd->buf = g_string_new (line);
-	if (!fu_firmware_strparse_uint8_safe (line, linesz, 1, &rcd->byte_cnt, error))
-		return NULL;
-	if (!fu_firmware_strparse_uint16_safe (line, linesz, 3, &addr16, error))
-		return NULL;
-	rcd->addr = addr16;
-	if (!fu_firmware_strparse_uint8_safe (line, linesz, 7, &rcd->record_type, error))
-		return NULL;
+	if (!fu_firmware_strparse_hex_safe (line, linesz, 1, buf, 4, error))
+		return FALSE;
 
 	/* position of checksum */
-	line_end = 9 + rcd->byte_cnt * 2;
-	if (line_end > (guint) rcd->buf->len) {
+	line_end = 9 + buf[0] * 2;
+	if (line_end > linesz) {
 		g_set_error (error,
 			     FWUPD_ERROR,
 			     FWUPD_ERROR_INVALID_FILE,
 			     "line malformed, length: %u",
 			     line_end);
-		return NULL;
+		return FALSE;
 	}
 
-	/* verify checksum */
+	/* data, and verify checksum */
 	if ((flags & FWUPD_INSTALL_FLAG_IGNORE_CHECKSUM) == 0) {
 		guint8 checksum = 0;
-		for (guint i = 1; i < line_end + 2; i += 2) {
-			guint8 data_tmp = 0;
-			if (!fu_firmware_strparse_uint8_safe (line, linesz, i, &data_tmp, error))
-				return NULL;
-			checksum += data_tmp;
-		}
+		if (!fu_firmware_strparse_hex_safe (line, linesz, 9, buf + 4, buf[0] + 1, error))
+			return FALSE;
+		for (guint i = 0; i < (guint) buf[0] + 5; i++)
+			checksum += buf[i];
 		if (checksum != 0)  {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "invalid checksum (0x%02x)",
 				     checksum);
-			return NULL;
+			return FALSE;
 		}
+	} else {
+		if (!fu_firmware_strparse_hex_safe (line, linesz, 9, buf + 4, buf[0], error))
+			return FALSE;
 	}
+	return TRUE;
+}
 
-	/* add data */
-	for (guint i = 9; i < line_end; i += 2) {
-		guint8 tmp_c = 0;
-		if (!fu_firmware_strparse_uint8_safe (line, linesz, i, &tmp_c, error))
-			return NULL;
-		fu_byte_array_append_uint8 (rcd->data, tmp_c);
+/* decodes each line exactly once, either into compact @tokens or into @records */
+static gboolean
+fu_ihex_firmware_tokenize_full (FuIhexFirmware *self, GBytes *fw,
+				FwupdInstallFlags flags,
+				GPtrArray *records,
+				GByteArray *tokens,
+				GError **error)
+{
+	gsize sz = 0;
+	const gchar *data = g_bytes_get_data (fw, &sz);
+	guint ln = 0;
+	guint8 buf[4 + 0xff + 1];
+
+	for (gsize offset = 0; offset < sz; ln++) {
+		const gchar *line = data + offset;
+		const gchar *tmp = memchr (line, '\n', sz - offset);
+		gsize linesz = tmp != NULL ? (gsize) (tmp - line) : sz - offset;
+
+		/* ignore anything after a CR, EOF or NUL */
+		offset += linesz + 1;
+		for (gsize i = 0; i < linesz; i++) {
+			if (line[i] == '\r' || line[i] == 0x1a || line[i] == '\0') {
+				linesz = i;
+				break;
+			}
+		}
+		if (linesz == 0 || line[0] == ';')
+			continue;
+		if (!fu_ihex_firmware_decode_line (line, linesz, flags, buf, error)) {
+			g_prefix_error (error, "invalid line %u: ", ln + 1);
+			return FALSE;
+		}
+		if (records != NULL) {
+			FuIhexFirmwareRecord *rcd = g_new0 (FuIhexFirmwareRecord, 1);
+			rcd->ln = ln + 1;
+			rcd->buf = g_string_new_len (line, linesz);
+			rcd->byte_cnt = buf[0];
+			rcd->addr = ((guint16) buf[1] << 8) | buf[2];
+			rcd->record_type = buf[3];
+			rcd->data = g_byte_array_sized_new (buf[0]);
+			g_byte_array_append (rcd->data, buf + 4, buf[0]);
+			g_ptr_array_add (records, rcd);
+		}
+		if (tokens != NULL) {
+			FuIhexFirmwareToken tok = {
+				.ln = ln + 1,
+				.addr = ((guint16) buf[1] << 8) | buf[2],
+				.record_type = buf[3],
+				.datasz = buf[0],
+			};
+			g_byte_array_append (tokens, (const guint8 *) &tok, sizeof(tok));
+			g_byte_array_append (tokens, buf + 4, buf[0]);
+		}
 	}
-	return g_steal_pointer (&rcd);
+	return TRUE;
+}
+
+/**
+ * fu_ihex_firmware_get_records:
+ * @self: A #FuIhexFirmware
+ *
+ * Returns the raw lines from tokenization.
+ *
+ * This might be useful if the plugin is expecting the hex file to be a list
+ * of operations, rather than a simple linear image with filled holes.
+ *
+ * The records are only created the first time this function is called.
+ *
+ * Returns: (transfer none) (element-type FuIhexFirmwareRecord): records
+ *
+ * Since: 1.3.4
+ **/
+GPtrArray *
+fu_ihex_firmware_get_records (FuIhexFirmware *self)
+{
+	FuIhexFirmwarePrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_IHEX_FIRMWARE (self), NULL);
+	if (!priv->records_loaded && priv->fw != NULL) {
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_ihex_firmware_tokenize_full (self, priv->fw, priv->flags,
+						     priv->records, NULL,
+						     &error_local))
+			g_warning ("failed to create records: %s", error_local->message);
+	}
+	priv->records_loaded = TRUE;
+	return priv->records;
+}
+
+/**
+ * fu_ihex_firmware_set_padding_value:
+ * @self: A #FuIhexFirmware
+ * @padding_value: the byte used to pad the image
+ *
+ * Set the padding value to fill incomplete address ranges.
+ *
+ * The default value of zero can be changed to `0xff` if functions like
+ * fu_common_bytes_is_empty() are going to be used on subsections of the data.
+ *
+ * Since: 1.6.0
+ **/
+void
+fu_ihex_firmware_set_padding_value (FuIhexFirmware *self, guint8 padding_value)
+{
+	FuIhexFirmwarePrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_IHEX_FIRMWARE (self));
+	priv->padding_value = padding_value;
 }
 
 static const gchar *
@@ -188,24 +248,16 @@ fu_ihex_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 {
 	FuIhexFirmware *self = FU_IHEX_FIRMWARE (firmware);
 	FuIhexFirmwarePrivate *priv = GET_PRIVATE (self);
-	gsize sz = 0;
-	const gchar *data = g_bytes_get_data (fw, &sz);
-	g_auto(GStrv) lines = fu_common_strnsplit (data, sz, "\n", -1);
 
-	for (guint ln = 0; lines[ln] != NULL; ln++) {
-		g_autoptr(FuIhexFirmwareRecord) rcd = NULL;
-		g_strdelimit (lines[ln], "\r\x1a", '\0');
-		if (g_str_has_prefix (lines[ln], ";"))
-			continue;
-		if (lines[ln][0] == '\0')
-			continue;
-		rcd = fu_ihex_firmware_record_new (ln + 1, lines[ln], flags, error);
-		if (rcd == NULL) {
-			g_prefix_error (error, "invalid line %u: ", ln + 1);
-			return FALSE;
-		}
-		g_ptr_array_add (priv->records, g_steal_pointer (&rcd));
-	}
+	/* records are only created if required */
+	g_ptr_array_set_size (priv->records, 0);
+	priv->records_loaded = FALSE;
+	g_byte_array_set_size (priv->tokens, 0);
+	g_clear_pointer (&priv->fw, g_bytes_unref);
+	if (!fu_ihex_firmware_tokenize_full (self, fw, flags, NULL, priv->tokens, error))
+		return FALSE;
+	priv->fw = g_bytes_ref (fw);
+	priv->flags = flags;
 	return TRUE;
 }
 
@@ -221,27 +273,36 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 	FuIhexFirmwarePrivate *priv = GET_PRIVATE (self);
 	gboolean got_eof = FALSE;
 	gboolean got_sig = FALSE;
+	gboolean verbose = g_getenv ("FU_IHEX_FIRMWARE_VERBOSE") != NULL;
 	guint32 abs_addr = 0x0;
 	guint32 addr_last = 0x0;
 	guint32 img_addr = G_MAXUINT32;
 	guint32 seg_addr = 0x0;
 	g_autoptr(GBytes) img_bytes = NULL;
-	g_autoptr(GByteArray) buf = g_byte_array_new ();
+	g_autoptr(GByteArray) buf = g_byte_array_sized_new (priv->tokens->len);
 
-	/* parse records */
-	for (guint k = 0; k < priv->records->len; k++) {
-		FuIhexFirmwareRecord *rcd = g_ptr_array_index (priv->records, k);
+	/* parse tokens */
+	for (guint k = 0, offset = 0; offset < priv->tokens->len; k++) {
+		FuIhexFirmwareToken rcd;
+		const guint8 *data;
 		guint16 addr16 = 0;
-		guint32 addr = rcd->addr + seg_addr + abs_addr;
+		guint32 addr;
 		guint32 len_hole;
 
-		g_debug ("%s:", fu_ihex_firmware_record_type_to_string (rcd->record_type));
-		g_debug ("  length:\t0x%02x", rcd->data->len);
-		g_debug ("  addr:\t0x%08x", addr);
+		/* the header is not aligned */
+		memcpy (&rcd, priv->tokens->data + offset, sizeof(rcd));
+		data = priv->tokens->data + offset + sizeof(rcd);
+		offset += sizeof(rcd) + rcd.datasz;
+		addr = rcd.addr + seg_addr + abs_addr;
+		if (verbose) {
+			g_debug ("%s:", fu_ihex_firmware_record_type_to_string (rcd.record_type));
+			g_debug ("  length:\t0x%02x", rcd.datasz);
+			g_debug ("  addr:\t0x%08x", addr);
+		}
 
 		/* sanity check */
-		if (rcd->record_type != FU_IHEX_FIRMWARE_RECORD_TYPE_EOF &&
-		    rcd->data->len == 0) {
+		if (rcd.record_type != FU_IHEX_FIRMWARE_RECORD_TYPE_EOF &&
+		    rcd.datasz == 0) {
 			g_set_error (error,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_NOT_SUPPORTED,
@@ -250,7 +311,7 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 		}
 
 		/* process different record types */
-		switch (rcd->record_type) {
+		switch (rcd.record_type) {
 		case FU_IHEX_FIRMWARE_RECORD_TYPE_DATA:
 
 			/* does not make sense */
@@ -261,7 +322,7 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 						     "cannot process data after EOF");
 				return FALSE;
 			}
-			if (rcd->data->len == 0) {
+			if (rcd.datasz == 0) {
 				g_set_error_literal (error,
 						     FWUPD_ERROR,
 						     FWUPD_ERROR_INVALID_FILE,
@@ -281,7 +342,7 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 					     "invalid address 0x%x, last was 0x%x on line %u",
 					     (guint) addr,
 					     (guint) addr_last,
-					     rcd->ln);
+					     rcd.ln);
 				return FALSE;
 			}
 
@@ -293,27 +354,27 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 					     FWUPD_ERROR_INVALID_FILE,
 					     "hole of 0x%x bytes too large to fill on line %u",
 					     (guint) len_hole,
-					     rcd->ln);
+					     rcd.ln);
 				return FALSE;
 			}
 			if (addr_last > 0x0 && len_hole > 1) {
 				g_debug ("filling address 0x%08x to 0x%08x on line %u",
-					 addr_last + 1, addr_last + len_hole - 1, rcd->ln);
-				for (guint j = 1; j < len_hole; j++)
-					fu_byte_array_append_uint8 (buf, priv->padding_value);
+					 addr_last + 1, addr_last + len_hole - 1, rcd.ln);
+				fu_byte_array_set_size_full (buf, buf->len + len_hole - 1,
+							     priv->padding_value);
 			}
-			addr_last = addr + rcd->data->len - 1;
+			addr_last = addr + rcd.datasz - 1;
 			if (addr_last < addr) {
 				g_set_error (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_INVALID_FILE,
 					     "overflow of address 0x%x on line %u",
-					     (guint) addr, rcd->ln);
+					     (guint) addr, rcd.ln);
 				return FALSE;
 			}
 
 			/* write into buf */
-			g_byte_array_append (buf, rcd->data->data, rcd->data->len);
+			g_byte_array_append (buf, data, rcd.datasz);
 			break;
 		case FU_IHEX_FIRMWARE_RECORD_TYPE_EOF:
 			if (got_eof) {
@@ -327,32 +388,32 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 			got_eof = TRUE;
 			break;
 		case FU_IHEX_FIRMWARE_RECORD_TYPE_EXTENDED_LINEAR:
-			if (!fu_common_read_uint16_safe (rcd->data->data, rcd->data->len,
+			if (!fu_common_read_uint16_safe (data, rcd.datasz,
 							 0x0, &addr16, G_BIG_ENDIAN, error))
 				return FALSE;
 			abs_addr = (guint32) addr16 << 16;
-			g_debug ("  abs_addr:\t0x%02x on line %u", abs_addr, rcd->ln);
+			g_debug ("  abs_addr:\t0x%02x on line %u", abs_addr, rcd.ln);
 			break;
 		case FU_IHEX_FIRMWARE_RECORD_TYPE_START_LINEAR:
-			if (!fu_common_read_uint32_safe (rcd->data->data, rcd->data->len,
+			if (!fu_common_read_uint32_safe (data, rcd.datasz,
 							 0x0, &abs_addr, G_BIG_ENDIAN, error))
 				return FALSE;
-			g_debug ("  abs_addr:\t0x%08x on line %u", abs_addr, rcd->ln);
+			g_debug ("  abs_addr:\t0x%08x on line %u", abs_addr, rcd.ln);
 			break;
 		case FU_IHEX_FIRMWARE_RECORD_TYPE_EXTENDED_SEGMENT:
-			if (!fu_common_read_uint16_safe (rcd->data->data, rcd->data->len,
+			if (!fu_common_read_uint16_safe (data, rcd.datasz,
 							 0x0, &addr16, G_BIG_ENDIAN, error))
 				return FALSE;
 			/* segment base address, so ~1Mb addressable */
 			seg_addr = (guint32) addr16 * 16;
-			g_debug ("  seg_addr:\t0x%08x on line %u", seg_addr, rcd->ln);
+			g_debug ("  seg_addr:\t0x%08x on line %u", seg_addr, rcd.ln);
 			break;
 		case FU_IHEX_FIRMWARE_RECORD_TYPE_START_SEGMENT:
 			/* initial content of the CS:IP registers */
-			if (!fu_common_read_uint32_safe (rcd->data->data, rcd->data->len,
+			if (!fu_common_read_uint32_safe (data, rcd.datasz,
 							 0x0, &seg_addr, G_BIG_ENDIAN, error))
 				return FALSE;
-			g_debug ("  seg_addr:\t0x%02x on line %u", seg_addr, rcd->ln);
+			g_debug ("  seg_addr:\t0x%02x on line %u", seg_addr, rcd.ln);
 			break;
 		case FU_IHEX_FIRMWARE_RECORD_TYPE_SIGNATURE:
 			if (got_sig) {
@@ -363,8 +424,8 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 						     "corrupt file");
 				return FALSE;
 			}
-			if (rcd->data->len > 0) {
-				g_autoptr(GBytes) data_sig = g_bytes_new (rcd->data->data, rcd->data->len);
+			if (rcd.datasz > 0) {
+				g_autoptr(GBytes) data_sig = g_bytes_new (data, rcd.datasz);
 				g_autoptr(FuFirmware) img_sig = fu_firmware_new_from_bytes (data_sig);
 				fu_firmware_set_id (img_sig, FU_FIRMWARE_ID_SIGNATURE);
 				fu_firmware_add_image (firmware, img_sig);
@@ -379,7 +440,7 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 				     FWUPD_ERROR,
 				     FWUPD_ERROR_INVALID_FILE,
 				     "invalid ihex record type %i on line %u",
-				     rcd->record_type, rcd->ln);
+				     rcd.record_type, rcd.ln);
 			return FALSE;
 		}
 	}
@@ -393,14 +454,25 @@ fu_ihex_firmware_parse (FuFirmware *firmware,
 		return FALSE;
 	}
 
+	/* the tokens are not required now */
+	g_byte_array_set_size (priv->tokens, 0);
+
 	/* add single image */
-	img_bytes = g_bytes_new (buf->data, buf->len);
+	img_bytes = g_byte_array_free_to_bytes (g_steal_pointer (&buf));
 	if (img_addr != G_MAXUINT32)
 		fu_firmware_set_addr (firmware, img_addr);
 	fu_firmware_set_bytes (firmware, img_bytes);
 	return TRUE;
 }
 
+static void
+fu_ihex_firmware_append_uint8 (GString *str, guint8 val)
+{
+	const gchar hex[] = "0123456789ABCDEF";
+	g_string_append_c (str, hex[val >> 4]);
+	g_string_append_c (str, hex[val & 0x0f]);
+}
+
 static void
 fu_ihex_firmware_emit_chunk (GString *str,
 			     guint16 address,
@@ -409,19 +481,21 @@ fu_ihex_firmware_emit_chunk (GString *str,
 			     gsize sz)
 {
 	guint8 checksum = 0x00;
-	g_string_append_printf (str, ":%02X%04X%02X",
-				(guint) sz,
-				(guint) address,
-				(guint) record_type);
+	g_string_append_c (str, ':');
+	fu_ihex_firmware_append_uint8 (str, (guint8) sz);
+	fu_ihex_firmware_append_uint8 (str, (guint8) (address >> 8));
+	fu_ihex_firmware_append_uint8 (str, (guint8) address);
+	fu_ihex_firmware_append_uint8 (str, record_type);
 	for (gsize j = 0; j < sz; j++)
-		g_string_append_printf (str, "%02X", data[j]);
+		fu_ihex_firmware_append_uint8 (str, data[j]);
 	checksum = (guint8) sz;
 	checksum += (guint8) ((address & 0xff00) >> 8);
 	checksum += (guint8) (address & 0xff);
 	checksum += record_type;
 	for (gsize j = 0; j < sz; j++)
 		checksum += data[j];
-	g_string_append_printf (str, "%02X\n", (guint) (((~checksum) + 0x01) & 0xff));
+	fu_ihex_firmware_append_uint8 (str, (guint8) ((~checksum) + 0x01));
+	g_string_append_c (str, '\n');
 }
 
 static gboolean
@@ -461,12 +535,13 @@ fu_ihex_firmware_write (FuFirmware *firmware, GError **error)
 {
 	g_autoptr(GBytes) fw = NULL;
 	g_autoptr(FuFirmware) img_sig = NULL;
-	g_autoptr(GString) str = g_string_new ("");
+	g_autoptr(GString) str = NULL;
 
-	/* payload */
+	/* payload, where each 16 byte chunk is 44 chars */
 	fw = fu_firmware_get_bytes (firmware, error);
 	if (fw == NULL)
 		return NULL;
+	str = g_string_sized_new (((g_bytes_get_size (fw) / 16) + 1) * 44);
 	if (!fu_ihex_firmware_image_to_string (fw,
 					       fu_firmware_get_addr (firmware),
 					       FU_IHEX_FIRMWARE_RECORD_TYPE_DATA,
@@ -487,7 +562,7 @@ fu_ihex_firmware_write (FuFirmware *firmware, GError **error)
 
 	/* add EOF */
 	fu_ihex_firmware_emit_chunk (str, 0x0, FU_IHEX_FIRMWARE_RECORD_TYPE_EOF, NULL, 0);
-	return g_bytes_new (str->str, str->len);
+	return g_string_free_to_bytes (g_steal_pointer (&str));
 }
 
 static void
@@ -496,6 +571,9 @@ fu_ihex_firmware_finalize (GObject *object)
 	FuIhexFirmware *self = FU_IHEX_FIRMWARE (object);
 	FuIhexFirmwarePrivate *priv = GET_PRIVATE (self);
 	g_ptr_array_unref (priv->records);
+	g_byte_array_unref (priv->tokens);
+	if (priv->fw != NULL)
+		g_bytes_unref (priv->fw);
 	G_OBJECT_CLASS (fu_ihex_firmware_parent_class)->finalize (object);
 }
 
@@ -505,9 +583,36 @@ fu_ihex_firmware_init (FuIhexFirmware *self)
 	FuIhexFirmwarePrivate *priv = GET_PRIVATE (self);
 	priv->padding_value = 0x00;	/* chosen as we can't write 0xffff to PIC14 */
 	priv->records = g_ptr_array_new_with_free_func ((GFreeFunc) fu_ihex_firmware_record_free);
+	priv->tokens = g_byte_array_new ();
 	fu_firmware_add_flag (FU_FIRMWARE (self), FU_FIRMWARE_FLAG_HAS_CHECKSUM);
 }
 
+static gboolean
+fu_ihex_firmware_check_magic (FuFirmware *firmware, GBytes *fw, gsize offset, GError **error)
+{
+	gsize bufsz = 0;
+	const guint8 *buf = g_bytes_get_data (fw, &bufsz);
+
+	/* skip any blank lines and comments */
+	for (gsize i = offset; i < bufsz; i++) {
+		if (buf[i] == '\r' || buf[i] == '\n' || buf[i] == 0x1a)
+			continue;
+		if (buf[i] == ';') {
+			while (i < bufsz && buf[i] != '\n')
+				i++;
+			continue;
+		}
+		if (buf[i] == ':')
+			return TRUE;
+		break;
+	}
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "invalid starting token, expected ':'");
+	return FALSE;
+}
+
 static void
 fu_ihex_firmware_class_init (FuIhexFirmwareClass *klass)
 {
@@ -515,6 +620,7 @@ fu_ihex_firmware_class_init (FuIhexFirmwareClass *klass)
 	FuFirmwareClass *klass_firmware = FU_FIRMWARE_CLASS (klass);
 	object_class->finalize = fu_ihex_firmware_finalize;
 	klass_firmware->parse = fu_ihex_firmware_parse;
+	klass_firmware->check_magic = fu_ihex_firmware_check_magic;
 	klass_firmware->tokenize = fu_ihex_firmware_tokenize;
 	klass_firmware->write = fu_ihex_firmware_write;
 }
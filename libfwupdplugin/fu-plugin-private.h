@@ -119,6 +119,10 @@ gboolean	 fu_plugin_runner_get_results		(FuPlugin	*self,
 							 G_GNUC_WARN_UNUSED_RESULT;
 void		 fu_plugin_runner_add_security_attrs	(FuPlugin	*self,
 							 FuSecurityAttrs*attrs);
+void		 fu_plugin_release_memory		(FuPlugin	*self);
+gboolean	 fu_plugin_save_probe_cache		(FuPlugin	*self,
+							 GError		**error)
+							 G_GNUC_WARN_UNUSED_RESULT;
 gint		 fu_plugin_name_compare			(FuPlugin	*plugin1,
 							 FuPlugin	*plugin2);
 gint		 fu_plugin_order_compare		(FuPlugin	*plugin1,
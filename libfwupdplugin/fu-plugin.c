@@ -17,6 +17,7 @@
 #include "fu-context-private.h"
 #include "fu-device-private.h"
 #include "fu-plugin-private.h"
+#include "fu-probe-cache.h"
 #include "fu-mutex.h"
 
 /**
@@ -43,6 +44,8 @@ typedef struct {
 	GHashTable		*cache;			/* (nullable): platform_id:GObject */
 	GRWLock			 cache_mutex;
 	GHashTable		*report_metadata;	/* (nullable): key:value */
+	FuSecurityAttrsInput	 security_inputs;
+	FuProbeCache		*probe_cache;		/* (nullable) */
 	FuPluginData		*data;
 } FuPluginPrivate;
 
@@ -1258,6 +1261,45 @@ fu_plugin_runner_add_security_attrs (FuPlugin *self, FuSecurityAttrs *attrs)
 	func (self, attrs);
 }
 
+/**
+ * fu_plugin_set_security_inputs:
+ * @self: a #FuPlugin
+ * @inputs: a #FuSecurityAttrsInput, e.g. %FU_SECURITY_ATTRS_INPUT_RUNTIME
+ *
+ * Sets what the attributes added in `fu_plugin_add_security_attrs()` depend on.
+ * The daemon caches the attributes and only runs the vfunc again when one of
+ * the inputs has changed. The default is %FU_SECURITY_ATTRS_INPUT_ALL.
+ *
+ * Plugins can use this method only in fu_plugin_init()
+ *
+ * Since: 1.6.2
+ **/
+void
+fu_plugin_set_security_inputs (FuPlugin *self, FuSecurityAttrsInput inputs)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_return_if_fail (FU_IS_PLUGIN (self));
+	priv->security_inputs = inputs;
+}
+
+/**
+ * fu_plugin_get_security_inputs:
+ * @self: a #FuPlugin
+ *
+ * Gets what the plugin security attributes depend on.
+ *
+ * Returns: a #FuSecurityAttrsInput, e.g. %FU_SECURITY_ATTRS_INPUT_RUNTIME
+ *
+ * Since: 1.6.2
+ **/
+FuSecurityAttrsInput
+fu_plugin_get_security_inputs (FuPlugin *self)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_PLUGIN (self), FU_SECURITY_ATTRS_INPUT_ALL);
+	return priv->security_inputs;
+}
+
 /**
  * fu_plugin_add_device_gtype:
  * @self: a #FuPlugin
@@ -1346,11 +1388,73 @@ fu_plugin_check_supported_device (FuPlugin *self, FuDevice *device)
 	return FALSE;
 }
 
+static FuProbeCache *
+fu_plugin_get_probe_cache (FuPlugin *self)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	if (priv->probe_cache == NULL) {
+		g_autofree gchar *cachedir = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+		g_autofree gchar *basename = g_strdup_printf ("%s.ini", fu_plugin_get_name (self));
+		g_autofree gchar *filename = g_build_filename (cachedir, "probe", basename, NULL);
+		priv->probe_cache = fu_probe_cache_new (filename);
+	}
+	return priv->probe_cache;
+}
+
+/**
+ * fu_plugin_release_memory:
+ * @self: a #FuPlugin
+ *
+ * Drops the probe cache, which is reloaded from disk when next required.
+ *
+ * Since: 1.6.2
+ **/
+void
+fu_plugin_release_memory (FuPlugin *self)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GError) error_local = NULL;
+
+	g_return_if_fail (FU_IS_PLUGIN (self));
+
+	/* do not lose any pending changes */
+	if (!fu_plugin_save_probe_cache (self, &error_local))
+		g_warning ("failed to save probe cache: %s", error_local->message);
+	g_clear_object (&priv->probe_cache);
+}
+
+/**
+ * fu_plugin_save_probe_cache:
+ * @self: a #FuPlugin
+ * @error: (nullable): optional return location for an error
+ *
+ * Writes any pending probe cache changes to disk. This is typically called
+ * once after all the backend devices have been coldplugged.
+ *
+ * Returns: #TRUE for success, #FALSE for failure
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fu_plugin_save_probe_cache (FuPlugin *self, GError **error)
+{
+	FuPluginPrivate *priv = GET_PRIVATE (self);
+
+	g_return_val_if_fail (FU_IS_PLUGIN (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* never loaded */
+	if (priv->probe_cache == NULL)
+		return TRUE;
+	return fu_probe_cache_save (priv->probe_cache, error);
+}
+
 static gboolean
 fu_plugin_backend_device_added (FuPlugin *self, FuDevice *device, GError **error)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
 	GType device_gtype = fu_device_get_specialized_gtype (FU_DEVICE (device));
+	g_autofree gchar *probe_cache_key = NULL;
 	g_autoptr(FuDevice) dev = NULL;
 	g_autoptr(FuDeviceLocker) locker = NULL;
 
@@ -1372,6 +1476,21 @@ fu_plugin_backend_device_added (FuPlugin *self, FuDevice *device, GError **error
 	if (!fu_plugin_runner_device_created (self, dev, error))
 		return FALSE;
 
+	/* restore without any hardware I/O if the device has not changed */
+	if (fu_device_has_internal_flag (dev, FU_DEVICE_INTERNAL_FLAG_PROBE_CACHE))
+		probe_cache_key = fu_probe_cache_build_key (device, device_gtype);
+	if (probe_cache_key != NULL) {
+		g_autoptr(GError) error_local = NULL;
+		if (fu_probe_cache_restore (fu_plugin_get_probe_cache (self),
+					    probe_cache_key, dev, &error_local)) {
+			g_debug ("restored %s from probe cache", fu_device_get_id (dev));
+			fu_plugin_device_add (self, dev);
+			fu_plugin_runner_device_added (self, dev);
+			return TRUE;
+		}
+		g_debug ("not using probe cache: %s", error_local->message);
+	}
+
 	/* there are a lot of different devices that match, but not all respond
 	 * well to opening -- so limit some ones with issued updates */
 	if (fu_device_has_internal_flag (dev, FU_DEVICE_INTERNAL_FLAG_ONLY_SUPPORTED)) {
@@ -1389,6 +1508,12 @@ fu_plugin_backend_device_added (FuPlugin *self, FuDevice *device, GError **error
 	locker = fu_device_locker_new (dev, error);
 	if (locker == NULL)
 		return FALSE;
+	if (probe_cache_key != NULL) {
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_probe_cache_add (fu_plugin_get_probe_cache (self),
+					 probe_cache_key, dev, &error_local))
+			g_debug ("not adding to probe cache: %s", error_local->message);
+	}
 	fu_plugin_device_add (self, dev);
 	fu_plugin_runner_device_added (self, dev);
 	return TRUE;
@@ -1853,6 +1978,16 @@ fu_plugin_runner_update (FuPlugin *self,
 		return TRUE;
 	}
 
+	/* the device is about to change */
+	if (fu_device_has_internal_flag (device, FU_DEVICE_INTERNAL_FLAG_PROBE_CACHE)) {
+		g_autoptr(GError) error_probe_cache = NULL;
+		fu_probe_cache_invalidate (fu_plugin_get_probe_cache (self), device);
+		if (!fu_plugin_save_probe_cache (self, &error_probe_cache)) {
+			g_warning ("failed to invalidate probe cache: %s",
+				   error_probe_cache->message);
+		}
+	}
+
 	/* optional */
 	g_module_symbol (priv->module, "fu_plugin_update", (gpointer *) &update_func);
 	if (update_func == NULL) {
@@ -2307,6 +2442,7 @@ static void
 fu_plugin_init (FuPlugin *self)
 {
 	FuPluginPrivate *priv = GET_PRIVATE (self);
+	priv->security_inputs = FU_SECURITY_ATTRS_INPUT_ALL;
 	g_rw_lock_init (&priv->cache_mutex);
 }
 
@@ -2346,6 +2482,8 @@ fu_plugin_finalize (GObject *object)
 		g_hash_table_unref (priv->cache);
 	if (priv->device_gtypes != NULL)
 		g_array_unref (priv->device_gtypes);
+	if (priv->probe_cache != NULL)
+		g_object_unref (priv->probe_cache);
 	g_free (priv->build_hash);
 	g_free (priv->data);
 
@@ -130,6 +130,9 @@ void		 fu_plugin_add_rule			(FuPlugin	*self,
 void		 fu_plugin_add_report_metadata		(FuPlugin	*self,
 							 const gchar	*key,
 							 const gchar	*value);
+void		 fu_plugin_set_security_inputs		(FuPlugin	*self,
+							 FuSecurityAttrsInput inputs);
+FuSecurityAttrsInput fu_plugin_get_security_inputs	(FuPlugin	*self);
 gchar		*fu_plugin_get_config_value		(FuPlugin	*self,
 							 const gchar	*key);
 gboolean	 fu_plugin_get_config_value_boolean	(FuPlugin	*self,
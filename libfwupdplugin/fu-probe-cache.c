@@ -0,0 +1,568 @@
+/*
+ * Copyright (C) 2021 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#define G_LOG_DOMAIN				"FuProbeCache"
+
+#include "config.h"
+
+#include <glib/gstdio.h>
+
+#include "fu-common.h"
+#include "fu-device-private.h"
+#include "fu-probe-cache.h"
+#include "fu-udev-device.h"
+#include "fu-usb-device.h"
+#include "fwupd-error.h"
+
+/**
+ * FuProbeCache:
+ *
+ * A persistent cache of the results of fu_device_probe() and fu_device_setup()
+ * for devices with the %FU_DEVICE_INTERNAL_FLAG_PROBE_CACHE flag set.
+ *
+ * Each entry is keyed by a fingerprint of the backend device, so when the
+ * daemon is restarted the device can be restored without any hardware I/O.
+ * The instance IDs are restored using fu_device_add_instance_id() so that any
+ * quirks are applied, and the public, internal and private flags are restored
+ * afterwards. Any other subclass state is not saved; the restored device is not
+ * marked as probed or set up, and so the real vfuncs are still run when the
+ * device is opened for an update.
+ *
+ * Devices with children are never cached.
+ *
+ * Changes are only written to disk when fu_probe_cache_save() is called, which
+ * is typically done once after all the devices have been coldplugged.
+ *
+ * See also: [class@FuDevice]
+ */
+
+struct _FuProbeCache {
+	GObject			 parent_instance;
+	gchar			*filename;
+	GKeyFile		*kf;		/* (nullable): loaded on demand */
+	gboolean		 dirty;
+};
+
+G_DEFINE_TYPE (FuProbeCache, fu_probe_cache, G_TYPE_OBJECT)
+
+/* only describe the current daemon instance, so are never saved */
+#define FU_PROBE_CACHE_FLAGS_RUNTIME		(FWUPD_DEVICE_FLAG_REGISTERED)
+#define FU_PROBE_CACHE_INTERNAL_FLAGS_RUNTIME	(FU_DEVICE_INTERNAL_FLAG_IS_OPEN)
+
+static GKeyFile *
+fu_probe_cache_ensure_keyfile (FuProbeCache *self)
+{
+	g_autoptr(GError) error_local = NULL;
+
+	if (self->kf != NULL)
+		return self->kf;
+	self->kf = g_key_file_new ();
+	if (!g_key_file_load_from_file (self->kf, self->filename,
+					G_KEY_FILE_NONE, &error_local)) {
+		if (!g_error_matches (error_local, G_FILE_ERROR, G_FILE_ERROR_NOENT))
+			g_debug ("ignoring %s: %s", self->filename, error_local->message);
+	}
+	return self->kf;
+}
+
+/**
+ * fu_probe_cache_save:
+ * @self: a #FuProbeCache
+ * @error: (nullable): optional return location for an error
+ *
+ * Writes the cache to disk if any entries have been added or invalidated.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fu_probe_cache_save (FuProbeCache *self, GError **error)
+{
+	gchar *data;
+	gsize datasz = 0;
+	g_autoptr(GBytes) blob = NULL;
+
+	g_return_val_if_fail (FU_IS_PROBE_CACHE (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* nothing to do */
+	if (!self->dirty)
+		return TRUE;
+
+	data = g_key_file_to_data (self->kf, &datasz, error);
+	if (data == NULL)
+		return FALSE;
+	blob = g_bytes_new_take (data, datasz);
+	if (!fu_common_set_contents_bytes (self->filename, blob, error))
+		return FALSE;
+	self->dirty = FALSE;
+	return TRUE;
+}
+
+static void
+fu_probe_cache_add_file_ctime (GChecksum *csum, const gchar *filename)
+{
+	GStatBuf st = { 0x0 };
+	if (filename == NULL || g_stat (filename, &st) != 0)
+		return;
+	g_checksum_update (csum, (const guchar *) &st.st_ctime, sizeof(st.st_ctime));
+}
+
+static void
+fu_probe_cache_add_string (GChecksum *csum, const gchar *str)
+{
+	if (str != NULL)
+		g_checksum_update (csum, (const guchar *) str, -1);
+	g_checksum_update (csum, (const guchar *) "\n", 1);
+}
+
+/**
+ * fu_probe_cache_build_key:
+ * @device: a #FuDevice from a backend, e.g. a #FuUdevDevice
+ * @gtype: the #GType of the device that will be created from @device
+ *
+ * Builds a fingerprint for the backend device that changes when the device is
+ * unplugged, the system is rebooted or fwupd is upgraded.
+ *
+ * Returns: (transfer full): a string, or %NULL if @device cannot be cached
+ *
+ * Since: 1.6.2
+ **/
+gchar *
+fu_probe_cache_build_key (FuDevice *device, GType gtype)
+{
+	g_autofree gchar *boot_id = NULL;
+	g_autofree gchar *boot_id_fn = NULL;
+	g_autofree gchar *procfs = fu_common_get_path (FU_PATH_KIND_PROCFS);
+	g_autoptr(GChecksum) csum = g_checksum_new (G_CHECKSUM_SHA1);
+
+	g_return_val_if_fail (FU_IS_DEVICE (device), NULL);
+
+	fu_probe_cache_add_string (csum, PACKAGE_VERSION);
+	fu_probe_cache_add_string (csum, g_type_name (gtype));
+	fu_probe_cache_add_string (csum, fu_device_get_backend_id (device));
+	fu_probe_cache_add_string (csum, fu_device_get_physical_id (device));
+	fu_probe_cache_add_string (csum, fu_device_get_logical_id (device));
+
+	/* the entry is only valid for this boot */
+	boot_id_fn = g_build_filename (procfs, "sys", "kernel", "random", "boot_id", NULL);
+	if (!g_file_get_contents (boot_id_fn, &boot_id, NULL, NULL))
+		return NULL;
+	fu_probe_cache_add_string (csum, boot_id);
+
+	/* sysfs directories are created when the device is added */
+	if (FU_IS_UDEV_DEVICE (device)) {
+		FuUdevDevice *udev_device = FU_UDEV_DEVICE (device);
+		const gchar *sysfs_path = fu_udev_device_get_sysfs_path (udev_device);
+		g_autofree gchar *revision = NULL;
+		if (sysfs_path == NULL)
+			return NULL;
+		revision = g_strdup_printf ("%04x:%04x:%02x",
+					    fu_udev_device_get_vendor (udev_device),
+					    fu_udev_device_get_model (udev_device),
+					    fu_udev_device_get_revision (udev_device));
+		fu_probe_cache_add_string (csum, revision);
+		fu_probe_cache_add_file_ctime (csum, sysfs_path);
+		return g_strdup (g_checksum_get_string (csum));
+	}
+
+#ifdef HAVE_GUSB
+	/* the device address changes every time the device is replugged */
+	if (FU_IS_USB_DEVICE (device)) {
+		GUsbDevice *usb_device = fu_usb_device_get_dev (FU_USB_DEVICE (device));
+		g_autofree gchar *address = NULL;
+		if (usb_device == NULL)
+			return NULL;
+		address = g_strdup_printf ("%02x:%02x:%04x:%04x:%04x",
+					   g_usb_device_get_bus (usb_device),
+					   g_usb_device_get_address (usb_device),
+					   g_usb_device_get_vid (usb_device),
+					   g_usb_device_get_pid (usb_device),
+					   g_usb_device_get_release (usb_device));
+		fu_probe_cache_add_string (csum, address);
+		return g_strdup (g_checksum_get_string (csum));
+	}
+#endif
+
+	/* not supported */
+	return NULL;
+}
+
+static void
+fu_probe_cache_set_ptr_array (GKeyFile *kf,
+			      const gchar *group,
+			      const gchar *key,
+			      GPtrArray *array)
+{
+	if (array == NULL || array->len == 0)
+		return;
+	g_key_file_set_string_list (kf, group, key,
+				    (const gchar * const *) array->pdata,
+				    array->len);
+}
+
+/**
+ * fu_probe_cache_add:
+ * @self: a #FuProbeCache
+ * @key: a key from fu_probe_cache_build_key()
+ * @device: a #FuDevice that has been probed and set up
+ * @error: (nullable): optional return location for an error
+ *
+ * Adds the probed properties of the device to the cache. The cache is not
+ * written to disk until fu_probe_cache_save() is called.
+ *
+ * Returns: %TRUE for success, or %FALSE if the device cannot be cached
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fu_probe_cache_add (FuProbeCache *self,
+		    const gchar *key,
+		    FuDevice *device,
+		    GError **error)
+{
+	GKeyFile *kf;
+	g_autoptr(GPtrArray) metadata_keys = NULL;
+
+	g_return_val_if_fail (FU_IS_PROBE_CACHE (self), FALSE);
+	g_return_val_if_fail (key != NULL, FALSE);
+	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* the children are not restored */
+	if (fu_device_get_children (device)->len > 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "%s has children and cannot be cached",
+			     fu_device_get_id (device));
+		return FALSE;
+	}
+
+	/* required to restore the device ID */
+	if (fu_device_get_id (device) == NULL ||
+	    fu_device_get_physical_id (device) == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "%s has no physical ID and cannot be cached",
+			     fu_device_get_name (device));
+		return FALSE;
+	}
+
+	kf = fu_probe_cache_ensure_keyfile (self);
+	g_key_file_remove_group (kf, key, NULL);
+	g_key_file_set_string (kf, key, "DeviceId", fu_device_get_id (device));
+	g_key_file_set_string (kf, key, "PhysicalId", fu_device_get_physical_id (device));
+	if (fu_device_get_logical_id (device) != NULL)
+		g_key_file_set_string (kf, key, "LogicalId", fu_device_get_logical_id (device));
+	if (fu_device_get_name (device) != NULL)
+		g_key_file_set_string (kf, key, "Name", fu_device_get_name (device));
+	if (fu_device_get_vendor (device) != NULL)
+		g_key_file_set_string (kf, key, "Vendor", fu_device_get_vendor (device));
+	if (fu_device_get_serial (device) != NULL)
+		g_key_file_set_string (kf, key, "Serial", fu_device_get_serial (device));
+	if (fu_device_get_summary (device) != NULL)
+		g_key_file_set_string (kf, key, "Summary", fu_device_get_summary (device));
+	g_key_file_set_string (kf, key, "VersionFormat",
+			       fwupd_version_format_to_string (fu_device_get_version_format (device)));
+	if (fu_device_get_version (device) != NULL)
+		g_key_file_set_string (kf, key, "Version", fu_device_get_version (device));
+	if (fu_device_get_version_lowest (device) != NULL) {
+		g_key_file_set_string (kf, key, "VersionLowest",
+				       fu_device_get_version_lowest (device));
+	}
+	if (fu_device_get_version_bootloader (device) != NULL) {
+		g_key_file_set_string (kf, key, "VersionBootloader",
+				       fu_device_get_version_bootloader (device));
+	}
+	g_key_file_set_uint64 (kf, key, "Flags",
+			       fu_device_get_flags (device) & ~FU_PROBE_CACHE_FLAGS_RUNTIME);
+	g_key_file_set_uint64 (kf, key, "InternalFlags",
+			       fu_device_get_internal_flags (device) &
+			       ~FU_PROBE_CACHE_INTERNAL_FLAGS_RUNTIME);
+	g_key_file_set_uint64 (kf, key, "PrivateFlags", fu_device_get_private_flags (device));
+	g_key_file_set_uint64 (kf, key, "FirmwareSizeMin",
+			       fu_device_get_firmware_size_min (device));
+	g_key_file_set_uint64 (kf, key, "FirmwareSizeMax",
+			       fu_device_get_firmware_size_max (device));
+	g_key_file_set_integer (kf, key, "InstallDuration",
+				fu_device_get_install_duration (device));
+	fu_probe_cache_set_ptr_array (kf, key, "VendorIds", fu_device_get_vendor_ids (device));
+	fu_probe_cache_set_ptr_array (kf, key, "Protocols", fu_device_get_protocols (device));
+	fu_probe_cache_set_ptr_array (kf, key, "Icons", fu_device_get_icons (device));
+	fu_probe_cache_set_ptr_array (kf, key, "InstanceIds", fu_device_get_instance_ids (device));
+	fu_probe_cache_set_ptr_array (kf, key, "Guids", fu_device_get_guids (device));
+
+	/* any plugin-specific values */
+	metadata_keys = fu_device_get_metadata_keys (device);
+	for (guint i = 0; i < metadata_keys->len; i++) {
+		const gchar *metadata_key = g_ptr_array_index (metadata_keys, i);
+		g_autofree gchar *kf_key = g_strdup_printf ("Metadata.%s", metadata_key);
+		const gchar *value = fu_device_get_metadata (device, metadata_key);
+		if (value != NULL)
+			g_key_file_set_string (kf, key, kf_key, value);
+	}
+
+	/* success */
+	self->dirty = TRUE;
+	return TRUE;
+}
+
+/**
+ * fu_probe_cache_restore:
+ * @self: a #FuProbeCache
+ * @key: a key from fu_probe_cache_build_key()
+ * @device: a #FuDevice that has not yet been probed
+ * @error: (nullable): optional return location for an error
+ *
+ * Restores the probed properties of the device from the cache. The entry is
+ * checked before anything is set, so the device is not modified on failure.
+ *
+ * Returns: %TRUE if the device was found in the cache
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fu_probe_cache_restore (FuProbeCache *self,
+			const gchar *key,
+			FuDevice *device,
+			GError **error)
+{
+	GKeyFile *kf;
+	FwupdVersionFormat verfmt = FWUPD_VERSION_FORMAT_UNKNOWN;
+	g_autofree gchar *device_id = NULL;
+	g_autofree gchar *logical_id = NULL;
+	g_autofree gchar *physical_id = NULL;
+	g_autofree gchar *tmp = NULL;
+	g_auto(GStrv) instance_ids = NULL;
+	g_auto(GStrv) kf_keys = NULL;
+
+	g_return_val_if_fail (FU_IS_PROBE_CACHE (self), FALSE);
+	g_return_val_if_fail (key != NULL, FALSE);
+	g_return_val_if_fail (FU_IS_DEVICE (device), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	kf = fu_probe_cache_ensure_keyfile (self);
+	kf_keys = g_key_file_get_keys (kf, key, NULL, NULL);
+	if (kf_keys == NULL) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "no probe cache entry for %s",
+			     key);
+		return FALSE;
+	}
+
+	/* check everything required is present */
+	device_id = g_key_file_get_string (kf, key, "DeviceId", NULL);
+	physical_id = g_key_file_get_string (kf, key, "PhysicalId", NULL);
+	logical_id = g_key_file_get_string (kf, key, "LogicalId", NULL);
+	if (device_id == NULL || physical_id == NULL ||
+	    !fwupd_device_id_is_valid (device_id)) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "probe cache entry %s has no device ID",
+			     key);
+		return FALSE;
+	}
+	if (fu_device_get_physical_id (device) != NULL &&
+	    g_strcmp0 (fu_device_get_physical_id (device), physical_id) != 0) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_FOUND,
+			     "probe cache entry %s is for %s, not %s",
+			     key, physical_id,
+			     fu_device_get_physical_id (device));
+		return FALSE;
+	}
+	tmp = g_key_file_get_string (kf, key, "VersionFormat", NULL);
+	if (tmp != NULL) {
+		verfmt = fwupd_version_format_from_string (tmp);
+		if (verfmt == FWUPD_VERSION_FORMAT_UNKNOWN &&
+		    g_strcmp0 (tmp, "unknown") != 0) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "probe cache entry %s has invalid version format %s",
+				     key, tmp);
+			return FALSE;
+		}
+	}
+	g_clear_pointer (&tmp, g_free);
+
+	/* do this first so that the quirks can be overwritten by the cached values */
+	fu_device_set_physical_id (device, physical_id);
+	if (logical_id != NULL)
+		fu_device_set_logical_id (device, logical_id);
+	instance_ids = g_key_file_get_string_list (kf, key, "InstanceIds", NULL, NULL);
+	for (guint i = 0; instance_ids != NULL && instance_ids[i] != NULL; i++)
+		fu_device_add_instance_id (device, instance_ids[i]);
+
+	for (guint i = 0; kf_keys[i] != NULL; i++) {
+		const gchar *kf_key = kf_keys[i];
+		g_autofree gchar *value = NULL;
+		g_auto(GStrv) values = NULL;
+
+		if (g_strcmp0 (kf_key, "VendorIds") == 0 ||
+		    g_strcmp0 (kf_key, "Protocols") == 0 ||
+		    g_strcmp0 (kf_key, "Icons") == 0 ||
+		    g_strcmp0 (kf_key, "Guids") == 0) {
+			values = g_key_file_get_string_list (kf, key, kf_key, NULL, NULL);
+			for (guint j = 0; values != NULL && values[j] != NULL; j++) {
+				if (g_strcmp0 (kf_key, "VendorIds") == 0)
+					fu_device_add_vendor_id (device, values[j]);
+				else if (g_strcmp0 (kf_key, "Protocols") == 0)
+					fu_device_add_protocol (device, values[j]);
+				else if (g_strcmp0 (kf_key, "Icons") == 0)
+					fu_device_add_icon (device, values[j]);
+				else
+					fu_device_add_guid (device, values[j]);
+			}
+			continue;
+		}
+		if (g_strcmp0 (kf_key, "Flags") == 0) {
+			fu_device_set_flags (device, g_key_file_get_uint64 (kf, key, kf_key, NULL));
+			continue;
+		}
+		if (g_strcmp0 (kf_key, "InternalFlags") == 0) {
+			fu_device_set_internal_flags (device,
+						      g_key_file_get_uint64 (kf, key, kf_key, NULL));
+			continue;
+		}
+		if (g_strcmp0 (kf_key, "PrivateFlags") == 0) {
+			fu_device_set_private_flags (device,
+						     g_key_file_get_uint64 (kf, key, kf_key, NULL));
+			continue;
+		}
+		if (g_strcmp0 (kf_key, "FirmwareSizeMin") == 0) {
+			fu_device_set_firmware_size_min (device,
+							 g_key_file_get_uint64 (kf, key, kf_key, NULL));
+			continue;
+		}
+		if (g_strcmp0 (kf_key, "FirmwareSizeMax") == 0) {
+			fu_device_set_firmware_size_max (device,
+							 g_key_file_get_uint64 (kf, key, kf_key, NULL));
+			continue;
+		}
+		if (g_strcmp0 (kf_key, "InstallDuration") == 0) {
+			fu_device_set_install_duration (device,
+							g_key_file_get_integer (kf, key, kf_key, NULL));
+			continue;
+		}
+
+		value = g_key_file_get_string (kf, key, kf_key, NULL);
+		if (value == NULL)
+			continue;
+		if (g_str_has_prefix (kf_key, "Metadata.")) {
+			fu_device_set_metadata (device, kf_key + 9, value);
+		} else if (g_strcmp0 (kf_key, "Name") == 0) {
+			fu_device_set_name (device, value);
+		} else if (g_strcmp0 (kf_key, "Vendor") == 0) {
+			fu_device_set_vendor (device, value);
+		} else if (g_strcmp0 (kf_key, "Serial") == 0) {
+			fu_device_set_serial (device, value);
+		} else if (g_strcmp0 (kf_key, "Summary") == 0) {
+			fu_device_set_summary (device, value);
+		}
+	}
+
+	/* versions are restored after the format is known */
+	if (verfmt != FWUPD_VERSION_FORMAT_UNKNOWN)
+		fu_device_set_version_format (device, verfmt);
+	tmp = g_key_file_get_string (kf, key, "Version", NULL);
+	if (tmp != NULL)
+		fu_device_set_version (device, tmp);
+	g_free (tmp);
+	tmp = g_key_file_get_string (kf, key, "VersionLowest", NULL);
+	if (tmp != NULL)
+		fu_device_set_version_lowest (device, tmp);
+	g_free (tmp);
+	tmp = g_key_file_get_string (kf, key, "VersionBootloader", NULL);
+	if (tmp != NULL)
+		fu_device_set_version_bootloader (device, tmp);
+
+	/* the same ID as before, so any history still matches */
+	fu_device_set_id (device, device_id);
+	return TRUE;
+}
+
+/**
+ * fu_probe_cache_invalidate:
+ * @self: a #FuProbeCache
+ * @device: a #FuDevice
+ *
+ * Removes any entries for the device, typically because it is being updated.
+ * The cache is not written to disk until fu_probe_cache_save() is called.
+ *
+ * Since: 1.6.2
+ **/
+void
+fu_probe_cache_invalidate (FuProbeCache *self, FuDevice *device)
+{
+	GKeyFile *kf;
+	g_auto(GStrv) groups = NULL;
+
+	g_return_if_fail (FU_IS_PROBE_CACHE (self));
+	g_return_if_fail (FU_IS_DEVICE (device));
+
+	kf = fu_probe_cache_ensure_keyfile (self);
+	groups = g_key_file_get_groups (kf, NULL);
+	for (guint i = 0; groups[i] != NULL; i++) {
+		g_autofree gchar *device_id = NULL;
+		device_id = g_key_file_get_string (kf, groups[i], "DeviceId", NULL);
+		if (g_strcmp0 (device_id, fu_device_get_id (device)) != 0)
+			continue;
+		g_key_file_remove_group (kf, groups[i], NULL);
+		self->dirty = TRUE;
+	}
+}
+
+static void
+fu_probe_cache_finalize (GObject *object)
+{
+	FuProbeCache *self = FU_PROBE_CACHE (object);
+
+	if (self->kf != NULL)
+		g_key_file_unref (self->kf);
+	g_free (self->filename);
+
+	G_OBJECT_CLASS (fu_probe_cache_parent_class)->finalize (object);
+}
+
+static void
+fu_probe_cache_class_init (FuProbeCacheClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_probe_cache_finalize;
+}
+
+static void
+fu_probe_cache_init (FuProbeCache *self)
+{
+}
+
+/**
+ * fu_probe_cache_new:
+ * @filename: a cache filename, e.g. `/var/cache/fwupd/probe/foo.ini`
+ *
+ * Creates a new #FuProbeCache. The file is not loaded until required.
+ *
+ * Returns: a #FuProbeCache
+ *
+ * Since: 1.6.2
+ **/
+FuProbeCache *
+fu_probe_cache_new (const gchar *filename)
+{
+	FuProbeCache *self;
+	g_return_val_if_fail (filename != NULL, NULL);
+	self = g_object_new (FU_TYPE_PROBE_CACHE, NULL);
+	self->filename = g_strdup (filename);
+	return self;
+}
@@ -0,0 +1,31 @@
+/*
+ * Copyright (C) 2021 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include "fu-device.h"
+
+#define FU_TYPE_PROBE_CACHE (fu_probe_cache_get_type ())
+G_DECLARE_FINAL_TYPE (FuProbeCache, fu_probe_cache, FU, PROBE_CACHE, GObject)
+
+FuProbeCache	*fu_probe_cache_new			(const gchar	*filename);
+gchar		*fu_probe_cache_build_key		(FuDevice	*device,
+							 GType		 gtype);
+gboolean	 fu_probe_cache_restore			(FuProbeCache	*self,
+							 const gchar	*key,
+							 FuDevice	*device,
+							 GError		**error)
+							 G_GNUC_WARN_UNUSED_RESULT;
+gboolean	 fu_probe_cache_add			(FuProbeCache	*self,
+							 const gchar	*key,
+							 FuDevice	*device,
+							 GError		**error)
+							 G_GNUC_WARN_UNUSED_RESULT;
+void		 fu_probe_cache_invalidate		(FuProbeCache	*self,
+							 FuDevice	*device);
+gboolean	 fu_probe_cache_save			(FuProbeCache	*self,
+							 GError		**error)
+							 G_GNUC_WARN_UNUSED_RESULT;
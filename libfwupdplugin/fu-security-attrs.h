@@ -11,6 +11,27 @@
 
 #define FU_TYPE_SECURITY_ATTRS (fu_security_attrs_get_type ())
 
+/**
+ * FuSecurityAttrsInput:
+ * @FU_SECURITY_ATTRS_INPUT_NONE:		Only depends on state fixed at boot, e.g. ACPI tables
+ * @FU_SECURITY_ATTRS_INPUT_DEVICES:		Depends on devices being added, removed or changed
+ * @FU_SECURITY_ATTRS_INPUT_METADATA:		Depends on the loaded metadata
+ * @FU_SECURITY_ATTRS_INPUT_RUNTIME:		Depends on runtime state, e.g. swap or kernel lockdown
+ * @FU_SECURITY_ATTRS_INPUT_ALL:		Depends on everything
+ *
+ * The inputs that the HSI security attributes of a plugin or device depend on.
+ * Attributes are only recalculated when one of the declared inputs changes.
+ **/
+typedef enum {
+	FU_SECURITY_ATTRS_INPUT_NONE			= 0,
+	FU_SECURITY_ATTRS_INPUT_DEVICES			= 1 << 0,
+	FU_SECURITY_ATTRS_INPUT_METADATA		= 1 << 1,
+	FU_SECURITY_ATTRS_INPUT_RUNTIME			= 1 << 2,
+	FU_SECURITY_ATTRS_INPUT_ALL			= FU_SECURITY_ATTRS_INPUT_DEVICES |
+							  FU_SECURITY_ATTRS_INPUT_METADATA |
+							  FU_SECURITY_ATTRS_INPUT_RUNTIME,
+} FuSecurityAttrsInput;
+
 G_DECLARE_FINAL_TYPE (FuSecurityAttrs, fu_security_attrs, FU, SECURITY_ATTRS, GObject)
 
 void		 fu_security_attrs_append		(FuSecurityAttrs	*self,
@@ -16,7 +16,9 @@
 #include "fu-common-private.h"
 #include "fu-context-private.h"
 #include "fu-device-private.h"
+#include "fu-hwids-private.h"
 #include "fu-plugin-private.h"
+#include "fu-probe-cache.h"
 #include "fu-security-attrs-private.h"
 #include "fu-smbios-private.h"
 #include "fwupd-security-attr-private.h"
@@ -286,6 +288,112 @@ fu_device_metadata_func (void)
 	g_assert_cmpint (fu_device_get_metadata_integer (device, "huge"), ==, G_MAXUINT);
 }
 
+static void
+fu_probe_cache_func (void)
+{
+	gboolean ret;
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *tmpdir = NULL;
+	g_autoptr(FuDevice) child = fu_device_new ();
+	g_autoptr(FuDevice) device1 = fu_device_new ();
+	g_autoptr(FuDevice) device2 = fu_device_new ();
+	g_autoptr(FuDevice) device3 = fu_device_new ();
+	g_autoptr(FuDevice) device4 = fu_device_new ();
+	g_autoptr(FuProbeCache) cache1 = NULL;
+	g_autoptr(FuProbeCache) cache2 = NULL;
+	g_autoptr(FuProbeCache) cache3 = NULL;
+	g_autoptr(GError) error = NULL;
+
+	tmpdir = g_dir_make_tmp ("fwupd-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (tmpdir);
+	fn = g_build_filename (tmpdir, "probe-cache.ini", NULL);
+
+	/* save a device that has been set up */
+	fu_device_set_physical_id (device1, "usb:FF:FF:06");
+	fu_device_set_name (device1, "ColorHug");
+	fu_device_set_version_format (device1, FWUPD_VERSION_FORMAT_TRIPLET);
+	fu_device_set_version (device1, "1.2.3");
+	fu_device_add_flag (device1, FWUPD_DEVICE_FLAG_UPDATABLE);
+	fu_device_add_guid (device1, "2082b5e0-7a64-478a-b1b2-e3404fab6dad");
+	fu_device_add_instance_id (device1, "USB\\VID_273F&PID_1001");
+	fu_device_add_internal_flag (device1, FU_DEVICE_INTERNAL_FLAG_PROBE_CACHE);
+	fu_device_add_internal_flag (device1, FU_DEVICE_INTERNAL_FLAG_IS_OPEN);
+	fu_device_set_private_flags (device1, 0x4);
+	fu_device_set_metadata (device1, "CustomKey", "CustomValue");
+	ret = fu_device_ensure_id (device1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	cache1 = fu_probe_cache_new (fn);
+	ret = fu_probe_cache_add (cache1, "abcdef", device1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* not written until saved */
+	g_assert_false (g_file_test (fn, G_FILE_TEST_EXISTS));
+	ret = fu_probe_cache_save (cache1, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_true (g_file_test (fn, G_FILE_TEST_EXISTS));
+
+	/* a different device is not modified */
+	cache2 = fu_probe_cache_new (fn);
+	fu_device_set_physical_id (device3, "usb:FF:FF:07");
+	ret = fu_probe_cache_restore (cache2, "abcdef", device3, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert_false (ret);
+	g_clear_error (&error);
+	g_assert_null (fu_device_get_name (device3));
+	g_assert_false (fu_device_has_flag (device3, FWUPD_DEVICE_FLAG_UPDATABLE));
+
+	/* restore from disk, without the physical ID only set in probe() */
+	ret = fu_probe_cache_restore (cache2, "abcdef", device2, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpstr (fu_device_get_id (device2), ==, fu_device_get_id (device1));
+	g_assert_cmpstr (fu_device_get_physical_id (device2), ==, "usb:FF:FF:06");
+	g_assert_false (fu_device_has_internal_flag (device2, FU_DEVICE_INTERNAL_FLAG_IS_OPEN));
+	g_assert_cmpstr (fu_device_get_name (device2), ==, "ColorHug");
+	g_assert_cmpstr (fu_device_get_version (device2), ==, "1.2.3");
+	g_assert_cmpint (fu_device_get_version_format (device2), ==, FWUPD_VERSION_FORMAT_TRIPLET);
+	g_assert_true (fu_device_has_flag (device2, FWUPD_DEVICE_FLAG_UPDATABLE));
+	g_assert_true (fu_device_has_guid (device2, "2082b5e0-7a64-478a-b1b2-e3404fab6dad"));
+	g_assert_true (fu_device_has_instance_id (device2, "USB\\VID_273F&PID_1001"));
+	g_assert_true (fu_device_has_internal_flag (device2, FU_DEVICE_INTERNAL_FLAG_PROBE_CACHE));
+	g_assert_cmpint (fu_device_get_private_flags (device2), ==, 0x4);
+	g_assert_cmpstr (fu_device_get_metadata (device2, "CustomKey"), ==, "CustomValue");
+
+	/* different fingerprint */
+	ret = fu_probe_cache_restore (cache2, "123456", device3, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert_false (ret);
+	g_clear_error (&error);
+
+	/* devices with children cannot be restored */
+	fu_device_add_child (device3, child);
+	ret = fu_probe_cache_add (cache2, "123456", device3, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED);
+	g_assert_false (ret);
+	g_clear_error (&error);
+
+	/* updating the device invalidates the entry */
+	fu_probe_cache_invalidate (cache2, device2);
+	ret = fu_probe_cache_restore (cache2, "abcdef", device4, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert_false (ret);
+	g_clear_error (&error);
+	ret = fu_probe_cache_save (cache2, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	cache3 = fu_probe_cache_new (fn);
+	ret = fu_probe_cache_restore (cache3, "abcdef", device4, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert_false (ret);
+
+	g_unlink (fn);
+	g_rmdir (tmpdir);
+}
+
 static void
 fu_smbios_func (void)
 {
@@ -415,7 +523,10 @@ fu_common_uri_scheme_func (void)
 static void
 fu_hwids_func (void)
 {
+	g_autofree gchar *fn = NULL;
+	g_autofree gchar *tmpdir = NULL;
 	g_autoptr(FuHwids) hwids = NULL;
+	g_autoptr(FuHwids) hwids_cache = NULL;
 	g_autoptr(FuSmbios) smbios = NULL;
 	g_autoptr(GError) error = NULL;
 	gboolean ret;
@@ -476,6 +587,37 @@ fu_hwids_func (void)
 	}
 	for (guint i = 0; guids[i].key != NULL; i++)
 		g_assert (fu_hwids_has_guid (hwids, guids[i].value));
+
+	/* round trip via the cache */
+	tmpdir = g_dir_make_tmp ("fwupd-self-test-XXXXXX", &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (tmpdir);
+	fn = g_build_filename (tmpdir, "hwids.ini", NULL);
+	ret = fu_hwids_save_cache (hwids, fn, "deadbeef", &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	hwids_cache = fu_hwids_new ();
+	ret = fu_hwids_load_cache (hwids_cache, fn, "cafebabe", &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert (!ret);
+	g_clear_error (&error);
+	ret = fu_hwids_load_cache (hwids_cache, fn, "deadbeef", &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpstr (fu_hwids_get_value (hwids_cache, FU_HWIDS_KEY_BIOS_VERSION), ==,
+			 "GJET75WW (2.25 )");
+	g_assert_cmpint (fu_hwids_get_guids (hwids_cache)->len, ==,
+			 fu_hwids_get_guids (hwids)->len);
+	for (guint i = 0; guids[i].key != NULL; i++)
+		g_assert (fu_hwids_has_guid (hwids_cache, guids[i].value));
+
+	/* the cache does not describe overridden values */
+	fu_hwids_add_smbios_override (hwids_cache, FU_HWIDS_KEY_BIOS_VERSION, "1.2.3");
+	ret = fu_hwids_load_cache (hwids_cache, fn, "deadbeef", &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_SUPPORTED);
+	g_assert (!ret);
+	g_unlink (fn);
+	g_rmdir (tmpdir);
 }
 
 static void
@@ -1321,6 +1463,121 @@ fu_device_poll_func (void)
 	g_assert_cmpint (fu_device_get_metadata_integer (device, "cnt"), ==, cnt);
 }
 
+static GBytes *
+fu_device_erase_block_dump_firmware_cb (FuDevice *device, GError **error)
+{
+	GByteArray *flash = g_object_get_data (G_OBJECT (device), "flash");
+	guint64 cnt = fu_device_get_metadata_integer (device, "dump-cnt");
+	fu_device_set_metadata_integer (device, "dump-cnt", cnt + 1);
+	return g_bytes_new (flash->data, flash->len);
+}
+
+static gboolean
+fu_device_erase_block_write_firmware_cb (FuDevice *device,
+					 FuFirmware *firmware,
+					 FwupdInstallFlags flags,
+					 GError **error)
+{
+	GByteArray *flash = g_object_get_data (G_OBJECT (device), "flash");
+	gsize bufsz = 0;
+	const guint8 *buf;
+	g_autoptr(GBytes) blob = fu_firmware_write (firmware, error);
+	if (blob == NULL)
+		return FALSE;
+	buf = g_bytes_get_data (blob, &bufsz);
+	g_byte_array_set_size (flash, 0);
+	g_byte_array_append (flash, buf, bufsz);
+	fu_device_set_metadata_integer (device, "chunk-cnt", G_MAXUINT);
+	return TRUE;
+}
+
+static gboolean
+fu_device_erase_block_write_firmware_partial_cb (FuDevice *device,
+						 GPtrArray *chunks,
+						 FwupdInstallFlags flags,
+						 GError **error)
+{
+	GByteArray *flash = g_object_get_data (G_OBJECT (device), "flash");
+	for (guint i = 0; i < chunks->len; i++) {
+		FuChunk *chk = g_ptr_array_index (chunks, i);
+
+		/* the data has to outlive the image that was written */
+		g_assert_nonnull (fu_chunk_get_bytes (chk));
+		g_assert_cmpint (fu_chunk_get_address (chk) + fu_chunk_get_data_sz (chk), <=, flash->len);
+		memcpy (flash->data + fu_chunk_get_address (chk),
+			fu_chunk_get_data (chk),
+			fu_chunk_get_data_sz (chk));
+	}
+	fu_device_set_metadata_integer (device, "chunk-cnt", chunks->len);
+	return TRUE;
+}
+
+static void
+fu_device_erase_block_write (FuDevice *device,
+			     const gchar *data,
+			     FwupdInstallFlags flags,
+			     guint chunk_cnt,
+			     guint dump_cnt)
+{
+	GByteArray *flash = g_object_get_data (G_OBJECT (device), "flash");
+	gboolean ret;
+	g_autoptr(GBytes) fw = g_bytes_new (data, strlen (data));
+	g_autoptr(GError) error = NULL;
+
+	ret = fu_device_write_firmware (device, fw, flags, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_assert_cmpint (flash->len, ==, strlen (data));
+	g_assert_cmpint (memcmp (flash->data, data, flash->len), ==, 0);
+	g_assert_cmpint (fu_device_get_metadata_integer (device, "chunk-cnt"), ==, chunk_cnt);
+	g_assert_cmpint (fu_device_get_metadata_integer (device, "dump-cnt"), ==, dump_cnt);
+}
+
+static void
+fu_device_erase_block_func (void)
+{
+	GByteArray *flash = g_byte_array_new ();
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(GBytes) flash_current = NULL;
+	FuDeviceClass *klass = FU_DEVICE_GET_CLASS (device);
+
+	klass->dump_firmware = fu_device_erase_block_dump_firmware_cb;
+	klass->write_firmware = fu_device_erase_block_write_firmware_cb;
+	klass->write_firmware_partial = fu_device_erase_block_write_firmware_partial_cb;
+	g_byte_array_append (flash, (const guint8 *) "AAAABBBBCCCC", 12);
+	g_object_set_data_full (G_OBJECT (device), "flash", flash,
+				(GDestroyNotify) g_byte_array_unref);
+	fu_device_set_metadata_integer (device, "dump-cnt", 0);
+	fu_device_set_erase_block_size (device, 4);
+
+	/* the existing flash is dumped to find the changed block */
+	fu_device_erase_block_write (device, "AAAAXXXXCCCC", FWUPD_INSTALL_FLAG_NONE, 1, 1);
+
+	/* the checksums from the last write are used */
+	fu_device_erase_block_write (device, "AAAAXXXXYYYY", FWUPD_INSTALL_FLAG_NONE, 1, 1);
+	fu_device_erase_block_write (device, "AAAAXXXXYYYY", FWUPD_INSTALL_FLAG_NONE, 0, 1);
+
+	/* the contents provided by the plugin are used */
+	flash_current = g_bytes_new (flash->data, flash->len);
+	fu_device_set_erase_block_contents (device, flash_current);
+	fu_device_erase_block_write (device, "ZZZZXXXXYYYY", FWUPD_INSTALL_FLAG_NONE, 1, 1);
+
+	/* a block written outside of the erase path is written again */
+	memcpy (flash->data + 4, "QQQQ", 4);
+	fu_device_invalidate_erase_blocks (device, 5, 2);
+	fu_device_erase_block_write (device, "ZZZZXXXXYYYY", FWUPD_INSTALL_FLAG_NONE, 1, 1);
+
+	/* everything is written when forced */
+	fu_device_erase_block_write (device, "ZZZZXXXXYYYY", FWUPD_INSTALL_FLAG_FORCE, G_MAXUINT, 1);
+
+	/* the existing flash is dumped again */
+	fu_device_erase_block_write (device, "ZZZZXXXXWWWW", FWUPD_INSTALL_FLAG_NONE, 1, 2);
+
+	klass->dump_firmware = NULL;
+	klass->write_firmware = NULL;
+	klass->write_firmware_partial = NULL;
+}
+
 static void
 fu_device_func (void)
 {
@@ -2145,6 +2402,97 @@ fu_firmware_srec_tokenization_func (void)
 	g_assert_cmpint (rcd->buf->data[0], ==, 0x50);
 }
 
+static GBytes *
+fu_firmware_throughput_blob_new (gsize bufsz)
+{
+	guint8 *buf = g_malloc (bufsz);
+	for (gsize i = 0; i < bufsz; i++)
+		buf[i] = (guint8) ((i * 7) ^ (i >> 8));
+	return g_bytes_new_take (buf, bufsz);
+}
+
+static void
+fu_firmware_ihex_throughput_func (void)
+{
+	gboolean ret;
+	gdouble elapsed;
+	g_autoptr(FuFirmware) firmware = fu_ihex_firmware_new ();
+	g_autoptr(FuFirmware) firmware2 = fu_ihex_firmware_new ();
+	g_autoptr(GBytes) blob = fu_firmware_throughput_blob_new (0x100000);
+	g_autoptr(GBytes) blob_hex = NULL;
+	g_autoptr(GBytes) blob2 = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	/* write */
+	fu_firmware_set_bytes (firmware, blob);
+	blob_hex = fu_firmware_write (firmware, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob_hex);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_print ("write=%.1fMB/s ", g_bytes_get_size (blob_hex) / (elapsed * 1024 * 1024));
+
+	/* parse */
+	g_timer_reset (timer);
+	ret = fu_firmware_parse (firmware2, blob_hex, FWUPD_INSTALL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_print ("parse=%.1fMB/s ", g_bytes_get_size (blob_hex) / (elapsed * 1024 * 1024));
+
+	/* round trip */
+	blob2 = fu_firmware_get_bytes (firmware2, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob2);
+	ret = fu_common_bytes_compare (blob, blob2, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* records are only created on demand */
+	g_assert_cmpint (fu_ihex_firmware_get_records (FU_IHEX_FIRMWARE (firmware2))->len, ==,
+			 (0x100000 / 16) + 15 + 1);
+}
+
+static void
+fu_firmware_srec_throughput_func (void)
+{
+	gboolean ret;
+	gdouble elapsed;
+	g_autoptr(FuFirmware) firmware = fu_srec_firmware_new ();
+	g_autoptr(FuFirmware) firmware2 = fu_srec_firmware_new ();
+	g_autoptr(GBytes) blob = fu_firmware_throughput_blob_new (0x100000);
+	g_autoptr(GBytes) blob_srec = NULL;
+	g_autoptr(GBytes) blob2 = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	/* write */
+	fu_firmware_set_bytes (firmware, blob);
+	fu_firmware_set_addr (firmware, 0x1000000);
+	blob_srec = fu_firmware_write (firmware, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob_srec);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_print ("write=%.1fMB/s ", g_bytes_get_size (blob_srec) / (elapsed * 1024 * 1024));
+
+	/* parse */
+	g_timer_reset (timer);
+	ret = fu_firmware_parse (firmware2, blob_srec, FWUPD_INSTALL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	elapsed = g_timer_elapsed (timer, NULL);
+	g_print ("parse=%.1fMB/s ", g_bytes_get_size (blob_srec) / (elapsed * 1024 * 1024));
+
+	/* round trip */
+	g_assert_cmpint (fu_firmware_get_addr (firmware2), ==, 0x1000000);
+	blob2 = fu_firmware_get_bytes (firmware2, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob2);
+	ret = fu_common_bytes_compare (blob, blob2, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+}
+
 static void
 fu_firmware_build_func (void)
 {
@@ -2363,6 +2711,38 @@ fu_firmware_new_from_gtypes_func (void)
 	g_assert_null (firmware3);
 }
 
+static void
+fu_firmware_check_magic_func (void)
+{
+	gboolean ret;
+	g_autofree gchar *fn = NULL;
+	g_autoptr(FuFirmware) firmware_dfu = fu_dfu_firmware_new ();
+	g_autoptr(FuFirmware) firmware_dfuse = fu_dfuse_firmware_new ();
+	g_autoptr(FuFirmware) firmware_ihex = fu_ihex_firmware_new ();
+	g_autoptr(FuFirmware) firmware_raw = fu_firmware_new ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+
+	fn = g_build_filename (TESTDATADIR_SRC, "firmware.dfu", NULL);
+	blob = fu_common_get_contents_bytes (fn, &error);
+	g_assert_no_error (error);
+	g_assert (blob != NULL);
+
+	ret = fu_firmware_check_magic (firmware_dfu, blob, 0x0, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_firmware_check_magic (firmware_raw, blob, 0x0, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_firmware_check_magic (firmware_dfuse, blob, 0x0, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_FILE);
+	g_assert_false (ret);
+	g_clear_error (&error);
+	ret = fu_firmware_check_magic (firmware_ihex, blob, 0x0, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_FILE);
+	g_assert_false (ret);
+}
+
 static void
 fu_firmware_dfu_func (void)
 {
@@ -2475,6 +2855,108 @@ fu_firmware_func (void)
 	g_assert_false (ret);
 }
 
+static void
+fu_firmware_path_func (void)
+{
+	FuFirmware *img_tmp = NULL;
+	FuFirmwareIter iter;
+	g_auto(FuFirmwareIter) iter_partial = { NULL };
+	g_autoptr(FuFirmware) firmware = fu_firmware_new ();
+	g_autoptr(FuFirmware) firmware2 = fu_firmware_new ();
+	g_autoptr(FuFirmware) img1 = fu_firmware_new ();
+	g_autoptr(FuFirmware) img2 = fu_firmware_new ();
+	g_autoptr(FuFirmware) img3 = fu_firmware_new ();
+	g_autoptr(FuFirmware) img_path = NULL;
+	g_autoptr(FuFirmware) img_id = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GString) str = g_string_new (NULL);
+
+	/* firmware -> img1 -> [img2, img3] */
+	fu_firmware_set_id (img1, "bios");
+	fu_firmware_add_image (firmware, img1);
+	fu_firmware_set_id (img2, "8c8ce578-8a3d-4f1c-9935-896185c32dd3");
+	fu_firmware_set_idx (img2, 2);
+	fu_firmware_add_image (img1, img2);
+	fu_firmware_set_idx (img3, 3);
+	fu_firmware_add_image (img1, img3);
+	g_assert_true (fu_firmware_get_parent (img2) == img1);
+
+	/* changing the ID after adding invalidates the index */
+	img_id = fu_firmware_get_image_by_id (img1, "8c8ce578-8a3d-4f1c-9935-896185c32dd3", &error);
+	g_assert_no_error (error);
+	g_assert_true (img_id == img2);
+	fu_firmware_set_id (img3, "payload");
+	g_clear_object (&img_id);
+	img_id = fu_firmware_get_image_by_id (img1, "payload", &error);
+	g_assert_no_error (error);
+	g_assert_true (img_id == img3);
+
+	img_path = fu_firmware_get_image_by_path (firmware, "bios/[8c8ce578-8a3d-4f1c-9935-896185c32dd3]", &error);
+	g_assert_no_error (error);
+	g_assert_true (img_path == img2);
+	g_clear_object (&img_path);
+	img_path = fu_firmware_get_image_by_path (firmware, "bios/firmware[3]", &error);
+	g_assert_no_error (error);
+	g_assert_true (img_path == img3);
+	g_clear_object (&img_path);
+	img_path = fu_firmware_get_image_by_path (firmware, "bios/[0x2]", &error);
+	g_assert_no_error (error);
+	g_assert_true (img_path == img2);
+	g_clear_object (&img_path);
+	img_path = fu_firmware_get_image_by_path (firmware, "bios/[4]", &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOT_FOUND);
+	g_assert_null (img_path);
+	g_clear_error (&error);
+	img_path = fu_firmware_get_image_by_path (firmware, "bios/[4", &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_FILE);
+	g_assert_null (img_path);
+	g_clear_error (&error);
+
+	/* depth first */
+	fu_firmware_iter_init (&iter, firmware);
+	while (fu_firmware_iter_next (&iter, &img_tmp, &error)) {
+		g_string_append_printf (str, "%u:%s,",
+					fu_firmware_iter_get_depth (&iter),
+					fu_firmware_get_id (img_tmp));
+	}
+	g_assert_no_error (error);
+	g_assert_cmpstr (str->str, ==, "1:bios,2:8c8ce578-8a3d-4f1c-9935-896185c32dd3,2:payload,");
+
+	/* an image added to a second parent is indexed in both */
+	fu_firmware_add_image (firmware2, img3);
+	g_assert_true (fu_firmware_get_parent (img3) == firmware2);
+	g_clear_object (&img_id);
+	img_id = fu_firmware_get_image_by_id (firmware2, "payload", &error);
+	g_assert_no_error (error);
+	g_assert_true (img_id == img3);
+	fu_firmware_set_id (img3, "config");
+	g_clear_object (&img_id);
+	img_id = fu_firmware_get_image_by_id (img1, "config", &error);
+	g_assert_no_error (error);
+	g_assert_true (img_id == img3);
+	g_clear_object (&img_id);
+	img_id = fu_firmware_get_image_by_id (firmware2, "config", &error);
+	g_assert_no_error (error);
+	g_assert_true (img_id == img3);
+
+	/* ...and the iterator still walks the original tree */
+	g_string_truncate (str, 0);
+	fu_firmware_iter_init (&iter, firmware);
+	while (fu_firmware_iter_next (&iter, &img_tmp, &error)) {
+		g_string_append_printf (str, "%u:%s,",
+					fu_firmware_iter_get_depth (&iter),
+					fu_firmware_get_id (img_tmp));
+	}
+	g_assert_no_error (error);
+	g_assert_cmpstr (str->str, ==, "1:bios,2:8c8ce578-8a3d-4f1c-9935-896185c32dd3,2:config,");
+
+	/* stopped early */
+	fu_firmware_iter_init (&iter_partial, firmware);
+	g_assert_true (fu_firmware_iter_next (&iter_partial, &img_tmp, &error));
+	g_assert_no_error (error);
+	g_assert_true (img_tmp == img1);
+}
+
 static void
 fu_firmware_dedupe_func (void)
 {
@@ -2986,6 +3468,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/smbios{dt}", fu_smbios_dt_func);
 	g_test_add_func ("/fwupd/firmware", fu_firmware_func);
 	g_test_add_func ("/fwupd/firmware{dedupe}", fu_firmware_dedupe_func);
+	g_test_add_func ("/fwupd/firmware{path}", fu_firmware_path_func);
 	g_test_add_func ("/fwupd/firmware{build}", fu_firmware_build_func);
 	g_test_add_func ("/fwupd/firmware{ihex}", fu_firmware_ihex_func);
 	g_test_add_func ("/fwupd/firmware{ihex-xml}", fu_firmware_ihex_xml_func);
@@ -2994,12 +3477,15 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/firmware{srec-tokenization}", fu_firmware_srec_tokenization_func);
 	g_test_add_func ("/fwupd/firmware{srec}", fu_firmware_srec_func);
 	g_test_add_func ("/fwupd/firmware{srec-xml}", fu_firmware_srec_xml_func);
+	g_test_add_func ("/fwupd/firmware{ihex-throughput}", fu_firmware_ihex_throughput_func);
+	g_test_add_func ("/fwupd/firmware{srec-throughput}", fu_firmware_srec_throughput_func);
 	g_test_add_func ("/fwupd/firmware{dfu}", fu_firmware_dfu_func);
 	g_test_add_func ("/fwupd/firmware{dfuse}", fu_firmware_dfuse_func);
 	g_test_add_func ("/fwupd/firmware{dfuse-xml}", fu_firmware_dfuse_xml_func);
 	g_test_add_func ("/fwupd/firmware{fmap}", fu_firmware_fmap_func);
 	g_test_add_func ("/fwupd/firmware{fmap-xml}", fu_firmware_fmap_xml_func);
 	g_test_add_func ("/fwupd/firmware{gtypes}", fu_firmware_new_from_gtypes_func);
+	g_test_add_func ("/fwupd/firmware{check-magic}", fu_firmware_check_magic_func);
 	g_test_add_func ("/fwupd/archive{invalid}", fu_archive_invalid_func);
 	g_test_add_func ("/fwupd/archive{cab}", fu_archive_cab_func);
 	g_test_add_func ("/fwupd/device", fu_device_func);
@@ -3017,7 +3503,9 @@ main (int argc, char **argv)
 	g_test_add_func ("/fwupd/device-locker{fail}", fu_device_locker_fail_func);
 	g_test_add_func ("/fwupd/device{name}", fu_device_name_func);
 	g_test_add_func ("/fwupd/device{metadata}", fu_device_metadata_func);
+	g_test_add_func ("/fwupd/device{erase-block}", fu_device_erase_block_func);
 	g_test_add_func ("/fwupd/device{open-refcount}", fu_device_open_refcount_func);
+	g_test_add_func ("/fwupd/probe-cache", fu_probe_cache_func);
 	g_test_add_func ("/fwupd/device{version-format}", fu_device_version_format_func);
 	g_test_add_func ("/fwupd/device{retry-success}", fu_device_retry_success_func);
 	g_test_add_func ("/fwupd/device{retry-failed}", fu_device_retry_failed_func);
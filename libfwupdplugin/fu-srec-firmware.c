@@ -25,11 +25,30 @@
 typedef struct {
 	FuFirmware		 parent_instance;
 	GPtrArray		*records;
+	gboolean		 records_loaded;
+	GByteArray		*tokens;	/* of FuSrecFirmwareToken+data */
+	GBytes			*fw;		/* for creating records on demand */
+	FwupdInstallFlags	 flags;
 } FuSrecFirmwarePrivate;
 
+/* each decoded line is stored in ->tokens as this header followed by the data */
+typedef struct {
+	guint32			 ln;
+	guint32			 addr;
+	guint8			 kind;
+	guint8			 datasz;
+} FuSrecFirmwareToken;
+
 G_DEFINE_TYPE_WITH_PRIVATE (FuSrecFirmware, fu_srec_firmware, FU_TYPE_FIRMWARE)
 #define GET_PRIVATE(o) (fu_srec_firmware_get_instance_private (o))
 
+static gboolean fu_srec_firmware_tokenize_full (FuSrecFirmware *self,
+						GBytes *fw,
+						FwupdInstallFlags flags,
+						GPtrArray *records,
+						GByteArray *tokens,
+						GError **error);
+
 /**
  * fu_srec_firmware_get_records:
  * @self: A #FuSrecFirmware
@@ -39,6 +58,8 @@ G_DEFINE_TYPE_WITH_PRIVATE (FuSrecFirmware, fu_srec_firmware, FU_TYPE_FIRMWARE)
  * This might be useful if the plugin is expecting the SREC file to be a list
  * of operations, rather than a simple linear image with filled holes.
  *
+ * The records are only created the first time this function is called.
+ *
  * Returns: (transfer none) (element-type FuSrecFirmwareRecord): records
  *
  * Since: 1.3.2
@@ -48,6 +69,14 @@ fu_srec_firmware_get_records (FuSrecFirmware *self)
 {
 	FuSrecFirmwarePrivate *priv = GET_PRIVATE (self);
 	g_return_val_if_fail (FU_IS_SREC_FIRMWARE (self), NULL);
+	if (!priv->records_loaded && priv->fw != NULL) {
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_srec_firmware_tokenize_full (self, priv->fw, priv->flags,
+						     priv->records, NULL,
+						     &error_local))
+			g_warning ("failed to create records: %s", error_local->message);
+	}
+	priv->records_loaded = TRUE;
 	return priv->records;
 }
 
@@ -112,39 +141,46 @@ fu_srec_firmware_record_get_type (void)
 	return type_id;
 }
 
+/* decodes each line exactly once, either into compact @tokens or into @records */
 static gboolean
-fu_srec_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
-			   FwupdInstallFlags flags, GError **error)
+fu_srec_firmware_tokenize_full (FuSrecFirmware *self, GBytes *fw,
+				FwupdInstallFlags flags,
+				GPtrArray *records,
+				GByteArray *tokens,
+				GError **error)
 {
-	FuSrecFirmware *self = FU_SREC_FIRMWARE (firmware);
-	FuSrecFirmwarePrivate *priv = GET_PRIVATE (self);
 	const gchar *data;
 	gboolean got_eof = FALSE;
+	gboolean verbose = g_getenv ("FU_SREC_FIRMWARE_VERBOSE") != NULL;
 	gsize sz = 0;
-	g_auto(GStrv) lines = NULL;
+	guint ln = 0;
+	guint8 buf[0xff + 1];
 
 	/* parse records */
 	data = g_bytes_get_data (fw, &sz);
-	lines = fu_common_strnsplit (data, sz, "\n", -1);
-	for (guint ln = 0; lines[ln] != NULL; ln++) {
-		FuSrecFirmwareRecord *rcd;
-		const gchar *line = lines[ln];
-		gsize linesz;
+	for (gsize offset = 0; offset < sz; ln++) {
+		const gchar *line = data + offset;
+		const gchar *tmp = memchr (line, '\n', sz - offset);
+		gsize linesz = tmp != NULL ? (gsize) (tmp - line) : sz - offset;
 		guint32 rec_addr32;
-		guint16 rec_addr16;
 		guint8 addrsz = 0;		/* bytes */
 		guint8 rec_count;		/* words */
 		guint8 rec_kind;
 
-		/* ignore blank lines */
-		g_strdelimit (lines[ln], "\r", '\0');
-		linesz = strlen (line);
+		/* ignore anything after a CR or NUL, and blank lines */
+		offset += linesz + 1;
+		for (gsize i = 0; i < linesz; i++) {
+			if (line[i] == '\r' || line[i] == '\0') {
+				linesz = i;
+				break;
+			}
+		}
 		if (linesz == 0)
 			continue;
 
 		/* check starting token */
 		if (line[0] != 'S') {
-			g_autofree gchar *strsafe = fu_common_strsafe (line, 3);
+			g_autofree gchar *strsafe = fu_common_strsafe (line, MIN (linesz, 3));
 			if (strsafe != NULL) {
 				g_set_error (error,
 					     FWUPD_ERROR,
@@ -162,8 +198,16 @@ fu_srec_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 		}
 
 		/* kind, count, address, (data), checksum, linefeed */
+		if (linesz < 4) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "record too short at line %u",
+				     ln + 1);
+			return FALSE;
+		}
 		rec_kind = line[1] - '0';
-		if (!fu_firmware_strparse_uint8_safe (line, linesz, 2, &rec_count, error))
+		if (!fu_firmware_strparse_hex_safe (line, linesz, 2, &rec_count, 1, error))
 			return FALSE;
 		if (rec_count * 2 != linesz - 4) {
 			g_set_error (error,
@@ -175,25 +219,17 @@ fu_srec_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 			return FALSE;
 		}
 
+		/* count, address, data and checksum in one pass */
+		if (!fu_firmware_strparse_hex_safe (line, linesz, 2, buf, rec_count + 1, error))
+			return FALSE;
+
 		/* checksum check */
 		if ((flags & FWUPD_INSTALL_FLAG_IGNORE_CHECKSUM) == 0) {
 			guint8 rec_csum = 0;
-			guint8 rec_csum_expected;
-			for (guint8 i = 0; i < rec_count; i++) {
-				guint8 csum_tmp = 0;
-				if (!fu_firmware_strparse_uint8_safe (line, linesz,
-								      (i * 2) + 2,
-								      &csum_tmp,
-								      error))
-					return FALSE;
-				rec_csum += csum_tmp;
-			}
+			guint8 rec_csum_expected = buf[rec_count];
+			for (guint i = 0; i < rec_count; i++)
+				rec_csum += buf[i];
 			rec_csum ^= 0xff;
-			if (!fu_firmware_strparse_uint8_safe (line, linesz,
-							      (rec_count * 2) + 2,
-							      &rec_csum_expected,
-							      error))
-				return FALSE;
 			if (rec_csum != rec_csum_expected) {
 				g_set_error (error,
 					     FWUPD_ERROR,
@@ -248,46 +284,43 @@ fu_srec_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 		}
 
 		/* parse address */
-		switch (addrsz) {
-		case 2:
-			if (!fu_firmware_strparse_uint16_safe (line, linesz,
-							       4, &rec_addr16,
-							       error))
-				return FALSE;
-			rec_addr32 = rec_addr16;
-			break;
-		case 3:
-			if (!fu_firmware_strparse_uint24_safe (line, linesz,
-							       4, &rec_addr32,
-							       error))
-				return FALSE;
-			break;
-		case 4:
-			if (!fu_firmware_strparse_uint32_safe (line, linesz,
-							       4, &rec_addr32,
-							       error))
-				return FALSE;
-			break;
-		default:
-			g_assert_not_reached ();
+		if (addrsz + 1 > rec_count) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "address incomplete at line %u",
+				     ln + 1);
+			return FALSE;
 		}
-		if (g_getenv ("FU_SREC_FIRMWARE_VERBOSE") != NULL) {
+		rec_addr32 = 0;
+		for (guint i = 0; i < addrsz; i++)
+			rec_addr32 = (rec_addr32 << 8) | buf[i + 1];
+		if (verbose) {
 			g_debug ("line %03u S%u addr:0x%04x datalen:0x%02x",
 				 ln + 1, rec_kind, rec_addr32,
 				 (guint) rec_count - addrsz - 1);
 		}
 
 		/* data */
-		rcd = fu_srec_firmware_record_new (ln + 1, rec_kind, rec_addr32);
-		if (rec_kind == 1 || rec_kind == 2 || rec_kind == 3) {
-			for (gsize i = 4 + (addrsz * 2); i <= rec_count * 2; i += 2) {
-				guint8 tmp = 0;
-				if (!fu_firmware_strparse_uint8_safe (line, linesz, i, &tmp, error))
-					return FALSE;
-				fu_byte_array_append_uint8 (rcd->buf, tmp);
-			}
+		if (records != NULL) {
+			FuSrecFirmwareRecord *rcd;
+			rcd = fu_srec_firmware_record_new (ln + 1, rec_kind, rec_addr32);
+			if (rec_kind == 1 || rec_kind == 2 || rec_kind == 3)
+				g_byte_array_append (rcd->buf, buf + addrsz + 1, rec_count - addrsz - 1);
+			g_ptr_array_add (records, rcd);
+		}
+		if (tokens != NULL) {
+			FuSrecFirmwareToken tok = {
+				.ln = ln + 1,
+				.addr = rec_addr32,
+				.kind = rec_kind,
+				.datasz = 0,
+			};
+			if (rec_kind == 1 || rec_kind == 2 || rec_kind == 3)
+				tok.datasz = rec_count - addrsz - 1;
+			g_byte_array_append (tokens, (const guint8 *) &tok, sizeof(tok));
+			g_byte_array_append (tokens, buf + addrsz + 1, tok.datasz);
 		}
-		g_ptr_array_add (priv->records, rcd);
 	}
 
 	/* no EOF */
@@ -301,6 +334,25 @@ fu_srec_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
 	return TRUE;
 }
 
+static gboolean
+fu_srec_firmware_tokenize (FuFirmware *firmware, GBytes *fw,
+			   FwupdInstallFlags flags, GError **error)
+{
+	FuSrecFirmware *self = FU_SREC_FIRMWARE (firmware);
+	FuSrecFirmwarePrivate *priv = GET_PRIVATE (self);
+
+	/* records are only created if required */
+	g_ptr_array_set_size (priv->records, 0);
+	priv->records_loaded = FALSE;
+	g_byte_array_set_size (priv->tokens, 0);
+	g_clear_pointer (&priv->fw, g_bytes_unref);
+	if (!fu_srec_firmware_tokenize_full (self, fw, flags, NULL, priv->tokens, error))
+		return FALSE;
+	priv->fw = g_bytes_ref (fw);
+	priv->flags = flags;
+	return TRUE;
+}
+
 static gboolean
 fu_srec_firmware_parse (FuFirmware *firmware,
 			GBytes *fw,
@@ -316,14 +368,20 @@ fu_srec_firmware_parse (FuFirmware *firmware,
 	guint32 addr32_last = 0;
 	guint32 img_address = 0;
 	g_autoptr(GBytes) img_bytes = NULL;
-	g_autoptr(GByteArray) outbuf = g_byte_array_new ();
+	g_autoptr(GByteArray) outbuf = g_byte_array_sized_new (priv->tokens->len);
 
-	/* parse records */
-	for (guint j = 0; j < priv->records->len; j++) {
-		FuSrecFirmwareRecord *rcd = g_ptr_array_index (priv->records, j);
+	/* parse tokens */
+	for (guint offset = 0; offset < priv->tokens->len; ) {
+		FuSrecFirmwareToken rcd;
+		const guint8 *data;
+
+		/* the header is not aligned */
+		memcpy (&rcd, priv->tokens->data + offset, sizeof(rcd));
+		data = priv->tokens->data + offset + sizeof(rcd);
+		offset += sizeof(rcd) + rcd.datasz;
 
 		/* header */
-		if (rcd->kind == FU_FIRMWARE_SREC_RECORD_KIND_S0_HEADER) {
+		if (rcd.kind == FU_FIRMWARE_SREC_RECORD_KIND_S0_HEADER) {
 			g_autoptr(GString) modname = g_string_new (NULL);
 
 			/* check for duplicate */
@@ -332,13 +390,13 @@ fu_srec_firmware_parse (FuFirmware *firmware,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_INVALID_FILE,
 					     "duplicate header record at line %u",
-					     rcd->ln);
+					     rcd.ln);
 				return FALSE;
 			}
 
 			/* could be anything, lets assume text */
-			for (guint8 i = 0; i < rcd->buf->len; i++) {
-				gchar tmp = rcd->buf->data[i];
+			for (guint8 i = 0; i < rcd.datasz; i++) {
+				gchar tmp = data[i];
 				if (!g_ascii_isgraph (tmp))
 					break;
 				g_string_append_c (modname, tmp);
@@ -350,48 +408,48 @@ fu_srec_firmware_parse (FuFirmware *firmware,
 		}
 
 		/* verify we got all records */
-		if (rcd->kind == FU_FIRMWARE_SREC_RECORD_KIND_S5_COUNT_16) {
-			if (rcd->addr != data_cnt) {
+		if (rcd.kind == FU_FIRMWARE_SREC_RECORD_KIND_S5_COUNT_16) {
+			if (rcd.addr != data_cnt) {
 				g_set_error (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_INVALID_FILE,
 					     "count record was not valid, got 0x%02x expected 0x%02x at line %u",
-					     (guint) rcd->addr, (guint) data_cnt, rcd->ln);
+					     (guint) rcd.addr, (guint) data_cnt, rcd.ln);
 				return FALSE;
 			}
 			continue;
 		}
 
 		/* data */
-		if (rcd->kind == FU_FIRMWARE_SREC_RECORD_KIND_S1_DATA_16 ||
-		    rcd->kind == FU_FIRMWARE_SREC_RECORD_KIND_S2_DATA_24 ||
-		    rcd->kind == FU_FIRMWARE_SREC_RECORD_KIND_S3_DATA_32) {
+		if (rcd.kind == FU_FIRMWARE_SREC_RECORD_KIND_S1_DATA_16 ||
+		    rcd.kind == FU_FIRMWARE_SREC_RECORD_KIND_S2_DATA_24 ||
+		    rcd.kind == FU_FIRMWARE_SREC_RECORD_KIND_S3_DATA_32) {
 			/* invalid */
 			if (!got_hdr) {
 				g_set_error (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_INVALID_FILE,
 					     "missing header record at line %u",
-					     rcd->ln);
+					     rcd.ln);
 				return FALSE;
 			}
 
 			/* does not make sense */
-			if (rcd->addr < addr32_last) {
+			if (rcd.addr < addr32_last) {
 				g_set_error (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_INVALID_FILE,
 					     "invalid address 0x%x, last was 0x%x at line %u",
-					     (guint) rcd->addr,
+					     (guint) rcd.addr,
 					     (guint) addr32_last,
-					     rcd->ln);
+					     rcd.ln);
 				return FALSE;
 			}
-			if (rcd->addr < addr_start) {
+			if (rcd.addr < addr_start) {
 				g_debug ("ignoring data at 0x%x as before start address 0x%x at line %u",
-					 (guint) rcd->addr, (guint) addr_start, rcd->ln);
+					 (guint) rcd.addr, (guint) addr_start, rcd.ln);
 			} else {
-				guint32 len_hole = rcd->addr - addr32_last;
+				guint32 len_hole = rcd.addr - addr32_last;
 
 				/* fill any holes, but only up to 1Mb to avoid a DoS */
 				if (addr32_last > 0 && len_hole > 0x100000) {
@@ -399,27 +457,26 @@ fu_srec_firmware_parse (FuFirmware *firmware,
 						     FWUPD_ERROR,
 						     FWUPD_ERROR_INVALID_FILE,
 						     "hole of 0x%x bytes too large to fill at line %u",
-						     (guint) len_hole, rcd->ln);
+						     (guint) len_hole, rcd.ln);
 					return FALSE;
 				}
 				if (addr32_last > 0x0 && len_hole > 1) {
 					g_debug ("filling address 0x%08x to 0x%08x at line %u",
-						 addr32_last + 1, addr32_last + len_hole - 1, rcd->ln);
-					for (guint i = 0; i < len_hole; i++)
-						fu_byte_array_append_uint8 (outbuf, 0xff);
+						 addr32_last + 1, addr32_last + len_hole - 1, rcd.ln);
+					fu_byte_array_set_size_full (outbuf, outbuf->len + len_hole, 0xff);
 				}
 
 				/* add data */
-				g_byte_array_append (outbuf, rcd->buf->data, rcd->buf->len);
+				g_byte_array_append (outbuf, data, rcd.datasz);
 				if (img_address == 0x0)
-					img_address = rcd->addr;
-				addr32_last = rcd->addr + rcd->buf->len;
-				if (addr32_last < rcd->addr) {
+					img_address = rcd.addr;
+				addr32_last = rcd.addr + rcd.datasz;
+				if (addr32_last < rcd.addr) {
 					g_set_error (error,
 						     FWUPD_ERROR,
 						     FWUPD_ERROR_INVALID_FILE,
 						     "overflow from address 0x%x at line %u",
-						     (guint) rcd->addr, rcd->ln);
+						     (guint) rcd.addr, rcd.ln);
 					return FALSE;
 				}
 			}
@@ -427,13 +484,24 @@ fu_srec_firmware_parse (FuFirmware *firmware,
 		}
 	}
 
+	/* the tokens are not required now */
+	g_byte_array_set_size (priv->tokens, 0);
+
 	/* add single image */
-	img_bytes = g_bytes_new (outbuf->data, outbuf->len);
+	img_bytes = g_byte_array_free_to_bytes (g_steal_pointer (&outbuf));
 	fu_firmware_set_bytes (firmware, img_bytes);
 	fu_firmware_set_addr (firmware, img_address);
 	return TRUE;
 }
 
+static void
+fu_srec_firmware_append_uint8 (GString *str, guint8 val)
+{
+	const gchar hex[] = "0123456789ABCDEF";
+	g_string_append_c (str, hex[val >> 4]);
+	g_string_append_c (str, hex[val & 0x0f]);
+}
+
 static void
 fu_srec_firmware_write_line (GString *str,
 			     FuFirmareSrecRecordKind kind,
@@ -442,45 +510,49 @@ fu_srec_firmware_write_line (GString *str,
 			     gsize bufsz)
 {
 	guint8 csum = 0;
-	g_autoptr(GByteArray) buf_addr = g_byte_array_new ();
+	guint8 buf_addr[4] = { 0x0 };
+	guint addrsz = 0;
 
 	if (kind == FU_FIRMWARE_SREC_RECORD_KIND_S0_HEADER ||
 	    kind == FU_FIRMWARE_SREC_RECORD_KIND_S1_DATA_16 ||
 	    kind == FU_FIRMWARE_SREC_RECORD_KIND_S5_COUNT_16 ||
 	    kind == FU_FIRMWARE_SREC_RECORD_KIND_S9_TERMINATION_16) {
-		fu_byte_array_append_uint16 (buf_addr, addr, G_BIG_ENDIAN);
+		addrsz = 2;
 	} else if (kind == FU_FIRMWARE_SREC_RECORD_KIND_S2_DATA_24 ||
 		   kind == FU_FIRMWARE_SREC_RECORD_KIND_S6_COUNT_24 ||
 		   kind == FU_FIRMWARE_SREC_RECORD_KIND_S8_TERMINATION_24) {
-		fu_byte_array_append_uint32 (buf_addr, addr, G_BIG_ENDIAN);
-		g_byte_array_remove_index (buf_addr, 0);
+		addrsz = 3;
 	} else if (kind == FU_FIRMWARE_SREC_RECORD_KIND_S3_DATA_32 ||
 		   kind == FU_FIRMWARE_SREC_RECORD_KIND_S7_COUNT_32) {
-		fu_byte_array_append_uint32 (buf_addr, addr, G_BIG_ENDIAN);
+		addrsz = 4;
 	}
+	for (guint i = 0; i < addrsz; i++)
+		buf_addr[i] = (guint8) (addr >> ((addrsz - i - 1) * 8));
 
 	/* bytecount + address + data */
-	csum = buf_addr->len + bufsz + 1;
-	for (guint i = 0; i < buf_addr->len; i++)
-		csum += buf_addr->data[i];
+	csum = addrsz + bufsz + 1;
+	for (guint i = 0; i < addrsz; i++)
+		csum += buf_addr[i];
 	for (guint i = 0; i < bufsz; i++)
 		csum += buf[i];
 	csum ^= 0xff;
 
 	/* output record */
-	g_string_append_printf (str, "S%X", kind);
-	g_string_append_printf (str, "%02X", (guint) (buf_addr->len + bufsz + 1));
-	for (guint i = 0; i < buf_addr->len; i++)
-		g_string_append_printf (str, "%02X", buf_addr->data[i]);
+	g_string_append_c (str, 'S');
+	g_string_append_c (str, '0' + kind);
+	fu_srec_firmware_append_uint8 (str, (guint8) (addrsz + bufsz + 1));
+	for (guint i = 0; i < addrsz; i++)
+		fu_srec_firmware_append_uint8 (str, buf_addr[i]);
 	for (guint i = 0; i < bufsz; i++)
-		g_string_append_printf (str, "%02X", buf[i]);
-	g_string_append_printf (str, "%02X\n", csum);
+		fu_srec_firmware_append_uint8 (str, buf[i]);
+	fu_srec_firmware_append_uint8 (str, csum);
+	g_string_append_c (str, '\n');
 }
 
 static GBytes *
 fu_srec_firmware_write (FuFirmware *firmware, GError **error)
 {
-	g_autoptr(GString) str = g_string_new (NULL);
+	g_autoptr(GString) str = NULL;
 	g_autoptr(GBytes) buf_blob = NULL;
 	const gchar *id = fu_firmware_get_id (firmware);
 	gsize id_strlen = id != NULL ? strlen (id) : 0;
@@ -499,29 +571,28 @@ fu_srec_firmware_write (FuFirmware *firmware, GError **error)
 		kind_term = FU_FIRMWARE_SREC_RECORD_KIND_S8_TERMINATION_24;
 	}
 
-	/* main blob */
+	/* main blob, where each 64 byte chunk is at most 142 chars */
 	buf_blob = fu_firmware_get_bytes (firmware, error);
 	if (buf_blob == NULL)
 		return NULL;
+	str = g_string_sized_new (((g_bytes_get_size (buf_blob) / 64) + 3) * 142);
 
 	/* header */
 	fu_srec_firmware_write_line (str, FU_FIRMWARE_SREC_RECORD_KIND_S0_HEADER,
 				     0x0, (const guint8 *) id, id_strlen);
 
-	/* payload */
+	/* payload, in chunks of 64 bytes */
 	if (g_bytes_get_size (buf_blob) > 0) {
-		g_autoptr(GPtrArray) chunks = NULL;
-		chunks = fu_chunk_array_new_from_bytes (buf_blob,
-							fu_firmware_get_addr (firmware),
-							0x0, 64);
-		for (guint i = 0; i < chunks->len; i++) {
-			FuChunk *chk = g_ptr_array_index (chunks, i);
-			fu_srec_firmware_write_line (str, kind_data,
-						     fu_chunk_get_address (chk),
-						     fu_chunk_get_data (chk),
-						     fu_chunk_get_data_sz (chk));
+		gsize bufsz = 0;
+		const guint8 *buf = g_bytes_get_data (buf_blob, &bufsz);
+		guint32 addr = fu_firmware_get_addr (firmware);
+		guint chunks = 0;
+		for (gsize i = 0; i < bufsz; i += 64) {
+			fu_srec_firmware_write_line (str, kind_data, addr + i,
+						     buf + i, MIN (bufsz - i, 64));
+			chunks++;
 		}
-		fu_srec_firmware_write_line (str, kind_coun, chunks->len, NULL, 0);
+		fu_srec_firmware_write_line (str, kind_coun, chunks, NULL, 0);
 	}
 
 	/* EOF */
@@ -537,6 +608,9 @@ fu_srec_firmware_finalize (GObject *object)
 	FuSrecFirmware *self = FU_SREC_FIRMWARE (object);
 	FuSrecFirmwarePrivate *priv = GET_PRIVATE (self);
 	g_ptr_array_unref (priv->records);
+	g_byte_array_unref (priv->tokens);
+	if (priv->fw != NULL)
+		g_bytes_unref (priv->fw);
 	G_OBJECT_CLASS (fu_srec_firmware_parent_class)->finalize (object);
 }
 
@@ -545,9 +619,31 @@ fu_srec_firmware_init (FuSrecFirmware *self)
 {
 	FuSrecFirmwarePrivate *priv = GET_PRIVATE (self);
 	priv->records = g_ptr_array_new_with_free_func ((GFreeFunc) fu_srec_firmware_record_free);
+	priv->tokens = g_byte_array_new ();
 	fu_firmware_add_flag (FU_FIRMWARE (self), FU_FIRMWARE_FLAG_HAS_CHECKSUM);
 }
 
+static gboolean
+fu_srec_firmware_check_magic (FuFirmware *firmware, GBytes *fw, gsize offset, GError **error)
+{
+	gsize bufsz = 0;
+	const guint8 *buf = g_bytes_get_data (fw, &bufsz);
+
+	/* skip any blank lines */
+	for (gsize i = offset; i < bufsz; i++) {
+		if (buf[i] == '\r' || buf[i] == '\n')
+			continue;
+		if (buf[i] == 'S')
+			return TRUE;
+		break;
+	}
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "invalid starting token, expected 'S'");
+	return FALSE;
+}
+
 static void
 fu_srec_firmware_class_init (FuSrecFirmwareClass *klass)
 {
@@ -555,6 +651,7 @@ fu_srec_firmware_class_init (FuSrecFirmwareClass *klass)
 	FuFirmwareClass *klass_firmware = FU_FIRMWARE_CLASS (klass);
 	object_class->finalize = fu_srec_firmware_finalize;
 	klass_firmware->parse = fu_srec_firmware_parse;
+	klass_firmware->check_magic = fu_srec_firmware_check_magic;
 	klass_firmware->tokenize = fu_srec_firmware_tokenize;
 	klass_firmware->write = fu_srec_firmware_write;
 }
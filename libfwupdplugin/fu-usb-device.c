@@ -8,6 +8,8 @@
 
 #include "config.h"
 
+#include "fu-chunk.h"
+#include "fu-common.h"
 #include "fu-device-private.h"
 #include "fu-usb-device-private.h"
 
@@ -551,6 +553,224 @@ fu_usb_device_find_udev_device (FuUsbDevice *device, GError **error)
 	return NULL;
 }
 
+#ifdef HAVE_GUSB
+typedef struct {
+	FuUsbDevice		*self;
+	GPtrArray		*chunks;	/* element-type FuChunk */
+	FuUsbDeviceBulkFlags	 flags;
+	GCancellable		*cancellable;	/* cancelled on the first failure */
+	guint8			*done;		/* per chunk */
+	guint			 idx_submit;
+	guint			 idx_done;	/* all chunks before this have completed */
+	guint			 in_flight;
+	GError			*error;
+} FuUsbDeviceBulkHelper;
+
+typedef struct {
+	FuUsbDeviceBulkHelper	*helper;
+	guint			 idx;
+	guint8			*buf;
+	gsize			 bufsz;
+} FuUsbDeviceBulkTransfer;
+
+static void
+fu_usb_device_bulk_transfer_free (FuUsbDeviceBulkTransfer *xfer)
+{
+	g_free (xfer->buf);
+	g_free (xfer);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuUsbDeviceBulkTransfer, fu_usb_device_bulk_transfer_free)
+
+static void
+fu_usb_device_bulk_write_cb (GObject *source, GAsyncResult *res, gpointer user_data)
+{
+	g_autoptr(FuUsbDeviceBulkTransfer) xfer = (FuUsbDeviceBulkTransfer *) user_data;
+	FuUsbDeviceBulkHelper *helper = xfer->helper;
+	gssize actual;
+	g_autoptr(GError) error_local = NULL;
+
+	helper->in_flight--;
+	actual = g_usb_device_bulk_transfer_finish (G_USB_DEVICE (source), res, &error_local);
+	if (actual < 0) {
+		g_prefix_error (&error_local, "failed to write chunk %u: ", xfer->idx);
+	} else if ((gsize) actual != xfer->bufsz) {
+		g_set_error (&error_local,
+			     G_IO_ERROR,
+			     G_IO_ERROR_PARTIAL_INPUT,
+			     "only sent %" G_GSSIZE_FORMAT "/%" G_GSIZE_FORMAT
+			     " bytes of chunk %u",
+			     actual, xfer->bufsz, xfer->idx);
+	}
+
+	/* keep the first failure, and abort everything else in flight */
+	if (error_local != NULL) {
+		if (helper->error == NULL)
+			helper->error = g_steal_pointer (&error_local);
+		g_cancellable_cancel (helper->cancellable);
+		return;
+	}
+
+	/* completions are reported in the order the chunks were submitted */
+	helper->done[xfer->idx] = TRUE;
+	while (helper->idx_done < helper->chunks->len && helper->done[helper->idx_done])
+		helper->idx_done++;
+	if (helper->flags & FU_USB_DEVICE_BULK_FLAG_SET_PROGRESS) {
+		fu_device_set_progress_full (FU_DEVICE (helper->self),
+					     helper->idx_done,
+					     helper->chunks->len);
+	}
+}
+
+static gboolean
+fu_usb_device_bulk_write_submit (FuUsbDeviceBulkHelper *helper,
+				 guint8 endpoint,
+				 guint timeout,
+				 GError **error)
+{
+	GUsbDevice *usb_device = fu_usb_device_get_dev (helper->self);
+	FuChunk *chk = g_ptr_array_index (helper->chunks, helper->idx_submit);
+	FuUsbDeviceBulkTransfer *xfer = g_new0 (FuUsbDeviceBulkTransfer, 1);
+	guint timeout_queued;
+
+	/* make mutable, and keep alive until the transfer completes */
+	xfer->helper = helper;
+	xfer->idx = helper->idx_submit;
+	xfer->bufsz = fu_chunk_get_data_sz (chk);
+	xfer->buf = fu_memdup_safe (fu_chunk_get_data (chk), xfer->bufsz, error);
+	if (xfer->buf == NULL) {
+		fu_usb_device_bulk_transfer_free (xfer);
+		return FALSE;
+	}
+
+	/* the timer starts now, but the device only sees this transfer after
+	 * all the ones already in flight have completed */
+	timeout_queued = timeout * (helper->in_flight + 1);
+	g_usb_device_bulk_transfer_async (usb_device, endpoint,
+					  xfer->buf, xfer->bufsz,
+					  timeout_queued, helper->cancellable,
+					  fu_usb_device_bulk_write_cb, xfer);
+	helper->idx_submit++;
+	helper->in_flight++;
+	return TRUE;
+}
+
+static void
+fu_usb_device_bulk_write_cancelled_cb (GCancellable *cancellable, gpointer user_data)
+{
+	GCancellable *cancellable_helper = G_CANCELLABLE (user_data);
+	g_cancellable_cancel (cancellable_helper);
+}
+#endif
+
+/**
+ * fu_usb_device_bulk_write_chunks:
+ * @self: a #FuUsbDevice
+ * @endpoint: the bulk OUT endpoint, e.g. 0x01
+ * @chunks: (element-type FuChunk): chunks of data
+ * @window: maximum number of transfers in flight at any one time, typically 4
+ * @timeout: timeout for each transfer in ms, not including the time spent
+ *   waiting for the transfers queued before it
+ * @flags: some #FuUsbDeviceBulkFlags, e.g. %FU_USB_DEVICE_BULK_FLAG_SET_PROGRESS
+ * @cancellable: (nullable): optional #GCancellable
+ * @error: (nullable): optional return location for an error
+ *
+ * Writes all the chunks to a bulk endpoint, keeping up to @window transfers
+ * queued so that the bus is not idle between each round trip.
+ *
+ * The chunks are sent in order, and on the first failure all the queued
+ * transfers are cancelled.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fu_usb_device_bulk_write_chunks (FuUsbDevice *self,
+				 guint8 endpoint,
+				 GPtrArray *chunks,
+				 guint window,
+				 guint timeout,
+				 FuUsbDeviceBulkFlags flags,
+				 GCancellable *cancellable,
+				 GError **error)
+{
+#ifdef HAVE_GUSB
+	gulong cancelled_id = 0;
+	FuUsbDeviceBulkHelper helper = {
+		.self = self,
+		.chunks = chunks,
+		.flags = flags,
+	};
+	g_autofree guint8 *done = NULL;
+	g_autoptr(GCancellable) cancellable_helper = g_cancellable_new ();
+	g_autoptr(GMainContext) context = g_main_context_new ();
+
+	g_return_val_if_fail (FU_IS_USB_DEVICE (self), FALSE);
+	g_return_val_if_fail (chunks != NULL, FALSE);
+	g_return_val_if_fail (window > 0, FALSE);
+	g_return_val_if_fail (cancellable == NULL || G_IS_CANCELLABLE (cancellable), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	/* nothing to do */
+	if (chunks->len == 0)
+		return TRUE;
+	if (fu_usb_device_get_dev (self) == NULL) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_NOT_INITIALIZED,
+				     "no USB device");
+		return FALSE;
+	}
+
+	done = g_new0 (guint8, chunks->len);
+	helper.done = done;
+	helper.cancellable = cancellable_helper;
+	if (cancellable != NULL) {
+		cancelled_id = g_cancellable_connect (cancellable,
+						      G_CALLBACK (fu_usb_device_bulk_write_cancelled_cb),
+						      g_object_ref (cancellable_helper),
+						      g_object_unref);
+	}
+
+	/* completions are dispatched in this context */
+	g_main_context_push_thread_default (context);
+	while (TRUE) {
+		/* keep the window full */
+		while (helper.error == NULL &&
+		       helper.in_flight < window &&
+		       helper.idx_submit < chunks->len) {
+			GError *error_local = NULL;
+			if (!fu_usb_device_bulk_write_submit (&helper, endpoint, timeout, &error_local)) {
+				helper.error = error_local;
+				g_cancellable_cancel (cancellable_helper);
+			}
+		}
+		if (helper.in_flight == 0)
+			break;
+		g_main_context_iteration (context, TRUE);
+	}
+	g_main_context_pop_thread_default (context);
+	if (cancellable != NULL)
+		g_cancellable_disconnect (cancellable, cancelled_id);
+
+	/* the first failure, which may be from the caller cancelling */
+	if (helper.error != NULL) {
+		g_propagate_error (error, helper.error);
+		return FALSE;
+	}
+
+	/* success */
+	return TRUE;
+#else
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_NOT_SUPPORTED,
+			     "Not supported as <gusb.h> is unavailable");
+	return FALSE;
+#endif
+}
+
 /**
  * fu_usb_device_get_dev:
  * @device: a #FuUsbDevice
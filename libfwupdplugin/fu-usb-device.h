@@ -29,6 +29,20 @@ struct _FuUsbDeviceClass
 	gpointer	__reserved[31];
 };
 
+/**
+ * FuUsbDeviceBulkFlags:
+ * @FU_USB_DEVICE_BULK_FLAG_NONE:		No flags set
+ * @FU_USB_DEVICE_BULK_FLAG_SET_PROGRESS:	Set the device progress as chunks complete
+ *
+ * Flags used when writing chunks using fu_usb_device_bulk_write_chunks().
+ **/
+typedef enum {
+	FU_USB_DEVICE_BULK_FLAG_NONE		= 0,
+	FU_USB_DEVICE_BULK_FLAG_SET_PROGRESS	= 1 << 0,
+	/*< private >*/
+	FU_USB_DEVICE_BULK_FLAG_LAST
+} FuUsbDeviceBulkFlags;
+
 FuUsbDevice	*fu_usb_device_new			(GUsbDevice	*usb_device);
 guint16		 fu_usb_device_get_vid			(FuUsbDevice	*self);
 guint16		 fu_usb_device_get_pid			(FuUsbDevice	*self);
@@ -40,3 +54,12 @@ gboolean	 fu_usb_device_is_open			(FuUsbDevice	*device);
 GUdevDevice	*fu_usb_device_find_udev_device		(FuUsbDevice	*device,
 							 GError		**error)
 							 G_GNUC_WARN_UNUSED_RESULT;
+gboolean	 fu_usb_device_bulk_write_chunks	(FuUsbDevice	*self,
+							 guint8		 endpoint,
+							 GPtrArray	*chunks,
+							 guint		 window,
+							 guint		 timeout,
+							 FuUsbDeviceBulkFlags flags,
+							 GCancellable	*cancellable,
+							 GError		**error)
+							 G_GNUC_WARN_UNUSED_RESULT;
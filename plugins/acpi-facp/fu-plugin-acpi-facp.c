@@ -14,6 +14,7 @@ void
 fu_plugin_init (FuPlugin *plugin)
 {
 	fu_plugin_set_build_hash (plugin, FU_BUILD_HASH);
+	fu_plugin_set_security_inputs (plugin, FU_SECURITY_ATTRS_INPUT_NONE);
 }
 
 void
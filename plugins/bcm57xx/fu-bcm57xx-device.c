@@ -127,6 +127,9 @@ fu_bcm57xx_device_nvram_write (FuBcm57xxDevice *self,
 		return FALSE;
 	}
 
+	/* the cached erase block contents are no longer valid */
+	fu_device_invalidate_erase_blocks (FU_DEVICE (self), address, bufsz);
+
 	/* write EEPROM (NVRAM) data */
 	eepromsz = sizeof(struct ethtool_eeprom) + bufsz;
 	eeprom = (struct ethtool_eeprom *) g_malloc0 (eepromsz);
@@ -430,6 +433,9 @@ fu_bcm57xx_device_prepare_firmware (FuDevice *device,
 		g_prefix_error (error, "failed to parse existing firmware: ");
 		return NULL;
 	}
+
+	/* do not dump the NVRAM again to find the changed erase blocks */
+	fu_device_set_erase_block_contents (device, fw_old);
 	if (g_getenv ("FWUPD_BCM57XX_VERBOSE") != NULL) {
 		g_autofree gchar *str = fu_firmware_to_string (firmware);
 		g_debug ("existing device firmware: %s", str);
@@ -506,6 +512,47 @@ fu_bcm57xx_device_write_firmware (FuDevice *device,
 	return fu_device_activate (device, error);
 }
 
+static gboolean
+fu_bcm57xx_device_write_firmware_partial (FuDevice *device,
+					  GPtrArray *chunks,
+					  FwupdInstallFlags flags,
+					  GError **error)
+{
+	FuBcm57xxDevice *self = FU_BCM57XX_DEVICE (device);
+
+	/* hit hardware, only for the blocks that have changed */
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_WRITE);
+	for (guint i = 0; i < chunks->len; i++) {
+		FuChunk *chk = g_ptr_array_index (chunks, i);
+		if (!fu_bcm57xx_device_nvram_write (self, fu_chunk_get_address (chk),
+						    fu_chunk_get_data (chk),
+						    fu_chunk_get_data_sz (chk),
+						    error))
+			return FALSE;
+		fu_device_set_progress_full (device, i + 1, chunks->len);
+	}
+
+	/* verify */
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_VERIFY);
+	for (guint i = 0; i < chunks->len; i++) {
+		FuChunk *chk = g_ptr_array_index (chunks, i);
+		g_autofree guint8 *buf = g_malloc0 (fu_chunk_get_data_sz (chk));
+		if (!fu_bcm57xx_device_nvram_read (self, fu_chunk_get_address (chk),
+						   buf, fu_chunk_get_data_sz (chk),
+						   error))
+			return FALSE;
+		if (!fu_common_bytes_compare_raw (fu_chunk_get_data (chk),
+						  fu_chunk_get_data_sz (chk),
+						  buf, fu_chunk_get_data_sz (chk),
+						  error))
+			return FALSE;
+		fu_device_set_progress_full (device, i + 1, chunks->len);
+	}
+
+	/* reset APE */
+	return fu_device_activate (device, error);
+}
+
 static gboolean
 fu_bcm57xx_device_setup (FuDevice *device, GError **error)
 {
@@ -616,6 +663,7 @@ fu_bcm57xx_device_init (FuBcm57xxDevice *self)
 
 	/* other values are set from a quirk */
 	fu_device_set_firmware_size (FU_DEVICE (self), BCM_FIRMWARE_SIZE);
+	fu_device_set_erase_block_size (FU_DEVICE (self), FU_BCM57XX_BLOCK_SZ);
 
 	/* used for recovery in case of ethtool failure and for APE reset */
 	self->recovery = fu_bcm57xx_recovery_device_new ();
@@ -642,6 +690,7 @@ fu_bcm57xx_device_class_init (FuBcm57xxDeviceClass *klass)
 	klass_device->close = fu_bcm57xx_device_close;
 	klass_device->activate = fu_bcm57xx_device_activate;
 	klass_device->write_firmware = fu_bcm57xx_device_write_firmware;
+	klass_device->write_firmware_partial = fu_bcm57xx_device_write_firmware_partial;
 	klass_device->read_firmware = fu_bcm57xx_device_read_firmware;
 	klass_device->dump_firmware = fu_bcm57xx_device_dump_firmware;
 	klass_device->probe = fu_bcm57xx_device_probe;
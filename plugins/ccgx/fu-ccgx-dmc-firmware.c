@@ -460,6 +460,29 @@ fu_ccgx_dmc_firmware_finalize (GObject *object)
 	G_OBJECT_CLASS (fu_ccgx_dmc_firmware_parent_class)->finalize (object);
 }
 
+static gboolean
+fu_ccgx_dmc_firmware_check_magic (FuFirmware *firmware, GBytes *fw, gsize offset, GError **error)
+{
+	gsize bufsz = 0;
+	guint32 hdr_signature = 0;
+	const guint8 *buf = g_bytes_get_data (fw, &bufsz);
+
+	if (!fu_common_read_uint32_safe (buf, bufsz, offset,
+					 &hdr_signature,
+					 G_LITTLE_ENDIAN, error))
+		return FALSE;
+	if (hdr_signature != DMC_FWCT_SIGN) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "invalid dmc signature, expected 0x%04X got 0x%04X",
+			     (guint32) DMC_FWCT_SIGN,
+			     (guint32) hdr_signature);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static void
 fu_ccgx_dmc_firmware_class_init (FuCcgxDmcFirmwareClass *klass)
 {
@@ -467,6 +490,7 @@ fu_ccgx_dmc_firmware_class_init (FuCcgxDmcFirmwareClass *klass)
 	FuFirmwareClass *klass_firmware = FU_FIRMWARE_CLASS (klass);
 	object_class->finalize = fu_ccgx_dmc_firmware_finalize;
 	klass_firmware->parse = fu_ccgx_dmc_firmware_parse;
+	klass_firmware->check_magic = fu_ccgx_dmc_firmware_check_magic;
 	klass_firmware->write = fu_ccgx_dmc_firmware_write;
 	klass_firmware->export = fu_ccgx_dmc_firmware_export;
 }
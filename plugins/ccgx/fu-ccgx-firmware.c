@@ -459,6 +459,36 @@ fu_ccgx_firmware_finalize (GObject *object)
 	G_OBJECT_CLASS (fu_ccgx_firmware_parent_class)->finalize (object);
 }
 
+static gboolean
+fu_ccgx_firmware_check_magic (FuFirmware *firmware, GBytes *fw, gsize offset, GError **error)
+{
+	gsize bufsz = 0;
+	const guint8 *buf = g_bytes_get_data (fw, &bufsz);
+
+	/* the header is 12 hex characters, followed by ':' records */
+	for (gsize i = 0; i < 12; i++) {
+		if (offset + i >= bufsz || !g_ascii_isxdigit (buf[offset + i])) {
+			g_set_error_literal (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_INVALID_FILE,
+					     "invalid header, expected 12 hex chars");
+			return FALSE;
+		}
+	}
+	for (gsize i = offset + 12; i < bufsz; i++) {
+		if (buf[i] == '\r' || buf[i] == '\n')
+			continue;
+		if (buf[i] == ':')
+			return TRUE;
+		break;
+	}
+	g_set_error_literal (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "invalid record, expected ':'");
+	return FALSE;
+}
+
 static void
 fu_ccgx_firmware_class_init (FuCcgxFirmwareClass *klass)
 {
@@ -466,6 +496,7 @@ fu_ccgx_firmware_class_init (FuCcgxFirmwareClass *klass)
 	FuFirmwareClass *klass_firmware = FU_FIRMWARE_CLASS (klass);
 	object_class->finalize = fu_ccgx_firmware_finalize;
 	klass_firmware->parse = fu_ccgx_firmware_parse;
+	klass_firmware->check_magic = fu_ccgx_firmware_check_magic;
 	klass_firmware->write = fu_ccgx_firmware_write;
 	klass_firmware->build = fu_ccgx_firmware_build;
 	klass_firmware->export = fu_ccgx_firmware_export;
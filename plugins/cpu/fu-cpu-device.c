@@ -103,6 +103,7 @@ fu_cpu_device_init (FuCpuDevice *self)
 	fu_device_add_icon (FU_DEVICE (self), "computer");
 	fu_device_set_version_format (FU_DEVICE (self), FWUPD_VERSION_FORMAT_HEX);
 	fu_device_set_physical_id (FU_DEVICE (self), "cpu:0");
+	fu_device_set_security_inputs (FU_DEVICE (self), FU_SECURITY_ATTRS_INPUT_NONE);
 }
 
 static gboolean
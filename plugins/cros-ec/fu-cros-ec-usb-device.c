@@ -20,6 +20,7 @@
 #define MAX_BLOCK_XFER_RETRIES		10
 #define FLUSH_TIMEOUT_MS		10
 #define BULK_SEND_TIMEOUT_MS		2000
+#define BULK_SEND_WINDOW		8
 #define BULK_RECV_TIMEOUT_MS		5000
 #define CROS_EC_REMOVE_DELAY_RE_ENUMERATE              20000
 
@@ -533,26 +534,23 @@ fu_cros_ec_usb_device_transfer_block (FuDevice *device, gpointer user_data,
 		return FALSE;
 	}
 
-	/* send the block, chunk by chunk */
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
-
-		if (!fu_cros_ec_usb_device_do_xfer (self,
-						    fu_chunk_get_data (chk),
-						    fu_chunk_get_data_sz (chk),
-						    NULL,
-						    0, FALSE,
-						    NULL, error)) {
-			g_autoptr(GError) error_flush = NULL;
-			g_prefix_error (error, "failed at sending chunk: ");
-
-			/* flush all data from endpoint to recover in case of error */
-			if (!fu_cros_ec_usb_device_recovery (device, &error_flush)) {
-				g_debug ("failed to flush to idle: %s",
-					 error_flush->message);
-			}
-			return FALSE;
+	/* send the block, keeping several chunks in flight */
+	if (!fu_usb_device_bulk_write_chunks (FU_USB_DEVICE (self),
+					      self->ep_num,
+					      chunks,
+					      BULK_SEND_WINDOW,
+					      BULK_SEND_TIMEOUT_MS,
+					      FU_USB_DEVICE_BULK_FLAG_NONE,
+					      NULL, error)) {
+		g_autoptr(GError) error_flush = NULL;
+		g_prefix_error (error, "failed at sending chunk: ");
+
+		/* flush all data from endpoint to recover in case of error */
+		if (!fu_cros_ec_usb_device_recovery (device, &error_flush)) {
+			g_debug ("failed to flush to idle: %s",
+				 error_flush->message);
 		}
+		return FALSE;
 	}
 
 	/* get the reply */
@@ -14,6 +14,7 @@
 
 #define FASTBOOT_REMOVE_DELAY_RE_ENUMERATE	60000 /* ms */
 #define FASTBOOT_TRANSACTION_TIMEOUT		1000 /* ms */
+#define FASTBOOT_DOWNLOAD_WINDOW		4 /* transfers */
 #define FASTBOOT_TRANSACTION_RETRY_MAX		600
 #define FASTBOOT_EP_IN				0x81
 #define FASTBOOT_EP_OUT				0x01
@@ -289,14 +290,15 @@ fu_fastboot_device_download (FuDevice *device, GBytes *fw, GError **error)
 						0x00,	/* start addr */
 						0x00,	/* page_sz */
 						self->blocksz);
-	for (guint i = 0; i < chunks->len; i++) {
-		FuChunk *chk = g_ptr_array_index (chunks, i);
-		if (!fu_fastboot_device_write (device,
-					       fu_chunk_get_data (chk),
-					       fu_chunk_get_data_sz (chk),
-					       error))
-			return FALSE;
-		fu_device_set_progress_full (device, (gsize) i, (gsize) chunks->len * 2);
+	if (!fu_usb_device_bulk_write_chunks (FU_USB_DEVICE (device),
+					      FASTBOOT_EP_OUT,
+					      chunks,
+					      FASTBOOT_DOWNLOAD_WINDOW,
+					      FASTBOOT_TRANSACTION_TIMEOUT,
+					      FU_USB_DEVICE_BULK_FLAG_SET_PROGRESS,
+					      NULL, error)) {
+		g_prefix_error (error, "failed to do bulk transfer: ");
+		return FALSE;
 	}
 	if (!fu_fastboot_device_read (device, NULL,
 				      FU_FASTBOOT_DEVICE_READ_FLAG_STATUS_POLL, error))
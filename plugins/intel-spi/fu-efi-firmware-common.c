@@ -55,19 +55,48 @@ fu_efi_firmware_parse_sections (FuFirmware *firmware,
 	return TRUE;
 }
 
+/* the uncompressed size is stored after the properties in the LZMA header,
+ * but do not trust a header that would allocate more than 64Mb up front */
+#define FU_EFI_FIRMWARE_LZMA_OFFSET_SIZE	0x05
+#define FU_EFI_FIRMWARE_LZMA_SIZE_MAX		0x4000000
+
+static gsize
+fu_efi_firmware_decompress_lzma_size_hint (GBytes *blob)
+{
+	gsize bufsz = 0;
+	guint64 size = 0;
+	const guint8 *buf = g_bytes_get_data (blob, &bufsz);
+	if (!fu_common_read_uint64_safe (buf, bufsz,
+					 FU_EFI_FIRMWARE_LZMA_OFFSET_SIZE,
+					 &size, G_LITTLE_ENDIAN, NULL))
+		return 0;
+	if (size == 0 || size > FU_EFI_FIRMWARE_LZMA_SIZE_MAX)
+		return 0;
+	return (gsize) size;
+}
+
 GBytes *
 fu_efi_firmware_decompress_lzma (GBytes *blob, GError **error)
 {
 #ifdef HAVE_LZMA
-	const gsize tmpbufsz = 0x20000;
+	gsize bufsz = fu_efi_firmware_decompress_lzma_size_hint (blob);
 	lzma_ret rc;
 	lzma_stream strm = LZMA_STREAM_INIT;
 	uint64_t memlimit = G_MAXUINT32;
-	g_autofree guint8 *tmpbuf = g_malloc0 (tmpbufsz);
-	g_autoptr(GByteArray) buf = g_byte_array_new ();
+	g_autofree guint8 *buf = NULL;
 
+	/* the size is usually known, otherwise grow as required; one extra
+	 * byte means an exact hint can reach the end of the stream without
+	 * the output buffer being full, which would double the allocation */
+	if (bufsz == 0)
+		bufsz = 0x20000;
+	else
+		bufsz += 1;
+	buf = g_malloc (bufsz);
 	strm.next_in = g_bytes_get_data (blob, NULL);
 	strm.avail_in = g_bytes_get_size (blob);
+	strm.next_out = buf;
+	strm.avail_out = bufsz;
 
 	rc = lzma_auto_decoder (&strm, memlimit, LZMA_TELL_UNSUPPORTED_CHECK);
 	if (rc != LZMA_OK) {
@@ -79,24 +108,29 @@ fu_efi_firmware_decompress_lzma (GBytes *blob, GError **error)
 		return NULL;
 	}
 	do {
-		strm.next_out = tmpbuf;
-		strm.avail_out = tmpbufsz;
+		if (strm.avail_out == 0) {
+			buf = g_realloc (buf, bufsz * 2);
+			strm.next_out = buf + bufsz;
+			strm.avail_out = bufsz;
+			bufsz *= 2;
+		}
 		rc = lzma_code (&strm, LZMA_RUN);
-		if (rc != LZMA_OK && rc != LZMA_STREAM_END)
-			break;
-		g_byte_array_append (buf, tmpbuf, tmpbufsz - strm.avail_out);
 	} while (rc == LZMA_OK);
 	lzma_end (&strm);
 
 	/* success */
-	if (rc != LZMA_OK && rc != LZMA_STREAM_END) {
+	if (rc != LZMA_STREAM_END) {
 		g_set_error (error,
 			     G_IO_ERROR,
 			     G_IO_ERROR_NOT_SUPPORTED,
 			     "failed to decode LZMA data rc=%u", rc);
 		return NULL;
 	}
-	return g_byte_array_free_to_bytes (g_steal_pointer (&buf));
+
+	/* do not keep the unused space if the buffer had to grow */
+	if (strm.total_out < bufsz)
+		buf = g_realloc (buf, strm.total_out);
+	return g_bytes_new_take (g_steal_pointer (&buf), strm.total_out);
 #else
 	g_set_error_literal (error,
 			     G_IO_ERROR,
@@ -105,3 +139,104 @@ fu_efi_firmware_decompress_lzma (GBytes *blob, GError **error)
 	return NULL;
 #endif
 }
+
+typedef struct {
+	FuEfiFirmwareSection	*section;
+	GError			*error;		/* (nullable) */
+} FuEfiFirmwareDecompressItem;
+
+static void
+fu_efi_firmware_decompress_item_free (FuEfiFirmwareDecompressItem *item)
+{
+	g_object_unref (item->section);
+	if (item->error != NULL)
+		g_error_free (item->error);
+	g_free (item);
+}
+
+/* runs in a worker thread, so must only touch the item */
+static void
+fu_efi_firmware_decompress_item_cb (gpointer data, gpointer user_data)
+{
+	FuEfiFirmwareDecompressItem *item = (FuEfiFirmwareDecompressItem *) data;
+	fu_efi_firmware_section_decompress (item->section, &item->error);
+}
+
+static gboolean
+fu_efi_firmware_decompress_collect (FuFirmware *firmware, GPtrArray *items, GError **error)
+{
+	g_autoptr(GPtrArray) images = NULL;
+
+	/* do not load the images, as that would decompress in this thread */
+	if (FU_IS_EFI_FIRMWARE_SECTION (firmware) &&
+	    fu_efi_firmware_section_needs_decompress (FU_EFI_FIRMWARE_SECTION (firmware))) {
+		FuEfiFirmwareDecompressItem *item = g_new0 (FuEfiFirmwareDecompressItem, 1);
+		item->section = g_object_ref (FU_EFI_FIRMWARE_SECTION (firmware));
+		g_ptr_array_add (items, item);
+		return TRUE;
+	}
+
+	/* parses the sections decompressed by the last pass */
+	if (!fu_firmware_ensure_images (firmware, error))
+		return FALSE;
+	images = fu_firmware_get_images (firmware);
+	for (guint i = 0; i < images->len; i++) {
+		FuFirmware *img = g_ptr_array_index (images, i);
+		if (!fu_efi_firmware_decompress_collect (img, items, error))
+			return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * fu_efi_firmware_decompress_sections:
+ * @firmware: a #FuFirmware
+ * @error: (nullable): optional return location for an error
+ *
+ * Decompresses every compressed EFI section in the firmware tree using a
+ * thread pool. This is only useful when most of the tree is going to be
+ * required, e.g. when exporting -- otherwise the sections are decompressed
+ * on demand when the images are first accessed.
+ *
+ * Returns: %TRUE for success
+ **/
+gboolean
+fu_efi_firmware_decompress_sections (FuFirmware *firmware, GError **error)
+{
+	/* compressed sections can contain more compressed sections, so do
+	 * one level of the tree at a time */
+	while (TRUE) {
+		GThreadPool *pool;
+		g_autoptr(GError) error_pool = NULL;
+		g_autoptr(GPtrArray) items = NULL;
+
+		items = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_efi_firmware_decompress_item_free);
+		if (!fu_efi_firmware_decompress_collect (firmware, items, error))
+			return FALSE;
+		if (items->len == 0)
+			break;
+
+		pool = g_thread_pool_new (fu_efi_firmware_decompress_item_cb, NULL,
+					  (gint) MIN (g_get_num_processors (), items->len),
+					  FALSE, &error_pool);
+		if (pool == NULL) {
+			g_propagate_error (error, g_steal_pointer (&error_pool));
+			return FALSE;
+		}
+		for (guint i = 0; i < items->len; i++)
+			g_thread_pool_push (pool, g_ptr_array_index (items, i), NULL);
+		g_thread_pool_free (pool, FALSE, TRUE);
+
+		/* report the first failure */
+		for (guint i = 0; i < items->len; i++) {
+			FuEfiFirmwareDecompressItem *item = g_ptr_array_index (items, i);
+			if (item->error != NULL) {
+				g_propagate_error (error, g_steal_pointer (&item->error));
+				return FALSE;
+			}
+		}
+	}
+
+	/* success */
+	return TRUE;
+}
@@ -14,3 +14,5 @@ gboolean	fu_efi_firmware_parse_sections		(FuFirmware	*firmware,
 							 GError		**error);
 GBytes		*fu_efi_firmware_decompress_lzma	(GBytes		*fw,
 							 GError		**error);
+gboolean	fu_efi_firmware_decompress_sections	(FuFirmware	*firmware,
+							 GError		**error);
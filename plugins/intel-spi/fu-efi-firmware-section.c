@@ -15,6 +15,9 @@
 
 typedef struct {
 	guint8			 type;
+	gboolean		 lzma_pending;
+	GBytes			*blob_uncomp;	/* nullable */
+	FwupdInstallFlags	 parse_flags;
 } FuEfiFirmwareSectionPrivate;
 
 G_DEFINE_TYPE_WITH_PRIVATE (FuEfiFirmwareSection, fu_efi_firmware_section, FU_TYPE_FIRMWARE)
@@ -176,23 +179,98 @@ fu_efi_firmware_section_parse (FuFirmware *firmware,
 			return FALSE;
 		fu_firmware_add_image (firmware, img);
 
-	/* LZMA */
+	/* LZMA, which is only decompressed when the images are required */
 	} else if (priv->type == FU_EFI_FIRMWARE_SECTION_TYPE_GUID_DEFINED &&
 		   g_strcmp0 (fu_firmware_get_id (firmware), FU_EFI_FIRMWARE_SECTION_LZMA_COMPRESS) == 0) {
-		g_autoptr(GBytes) blob_uncomp = NULL;
-
-		/* parse all sections */
-		blob_uncomp = fu_efi_firmware_decompress_lzma (blob, error);
-		if (blob_uncomp == NULL)
-			return FALSE;
-		if (!fu_efi_firmware_parse_sections (firmware, blob_uncomp, flags, error))
-			return FALSE;
+		priv->lzma_pending = TRUE;
+		priv->parse_flags = flags;
 	}
 
 	/* success */
 	return TRUE;
 }
 
+static gboolean
+fu_efi_firmware_section_ensure_images (FuFirmware *firmware, GError **error)
+{
+	FuEfiFirmwareSection *self = FU_EFI_FIRMWARE_SECTION (firmware);
+	FuEfiFirmwareSectionPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(FuFirmware) container = fu_firmware_new ();
+	g_autoptr(GPtrArray) images = NULL;
+
+	if (!priv->lzma_pending)
+		return TRUE;
+
+	/* may have already been done in a worker thread */
+	if (!fu_efi_firmware_section_decompress (self, error))
+		return FALSE;
+
+	/* parse all sections into a container so that nothing is added to
+	 * @firmware unless they all parse, and a later call can try again */
+	if (!fu_efi_firmware_parse_sections (container, priv->blob_uncomp,
+					     priv->parse_flags, error))
+		return FALSE;
+	images = fu_firmware_get_images (container);
+	for (guint i = 0; i < images->len; i++) {
+		FuFirmware *img = g_ptr_array_index (images, i);
+		fu_firmware_add_image (firmware, img);
+	}
+	priv->lzma_pending = FALSE;
+	g_clear_pointer (&priv->blob_uncomp, g_bytes_unref);
+	return TRUE;
+}
+
+/**
+ * fu_efi_firmware_section_needs_decompress:
+ * @self: a #FuEfiFirmwareSection
+ *
+ * Gets if the section is compressed and the payload has not yet been
+ * decompressed.
+ *
+ * Returns: %TRUE if fu_efi_firmware_section_decompress() should be called
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fu_efi_firmware_section_needs_decompress (FuEfiFirmwareSection *self)
+{
+	FuEfiFirmwareSectionPrivate *priv = GET_PRIVATE (self);
+	g_return_val_if_fail (FU_IS_EFI_FIRMWARE_SECTION (self), FALSE);
+	return priv->lzma_pending && priv->blob_uncomp == NULL;
+}
+
+/**
+ * fu_efi_firmware_section_decompress:
+ * @self: a #FuEfiFirmwareSection
+ * @error: (nullable): optional return location for an error
+ *
+ * Decompresses the section payload so that the nested sections can be parsed
+ * when the images are next required.
+ *
+ * This only modifies @self and so is safe to call from a worker thread.
+ *
+ * Returns: %TRUE for success
+ *
+ * Since: 1.6.2
+ **/
+gboolean
+fu_efi_firmware_section_decompress (FuEfiFirmwareSection *self, GError **error)
+{
+	FuEfiFirmwareSectionPrivate *priv = GET_PRIVATE (self);
+	g_autoptr(GBytes) blob = NULL;
+
+	g_return_val_if_fail (FU_IS_EFI_FIRMWARE_SECTION (self), FALSE);
+	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
+
+	if (!fu_efi_firmware_section_needs_decompress (self))
+		return TRUE;
+	blob = fu_firmware_get_bytes (FU_FIRMWARE (self), error);
+	if (blob == NULL)
+		return FALSE;
+	priv->blob_uncomp = fu_efi_firmware_decompress_lzma (blob, error);
+	return priv->blob_uncomp != NULL;
+}
+
 static GBytes *
 fu_efi_firmware_section_write (FuFirmware *firmware, GError **error)
 {
@@ -255,14 +333,27 @@ fu_efi_firmware_section_init (FuEfiFirmwareSection *self)
 //	fu_firmware_set_alignment (FU_FIRMWARE (self), FU_FIRMWARE_ALIGNMENT_8);
 }
 
+static void
+fu_efi_firmware_section_finalize (GObject *object)
+{
+	FuEfiFirmwareSection *self = FU_EFI_FIRMWARE_SECTION (object);
+	FuEfiFirmwareSectionPrivate *priv = GET_PRIVATE (self);
+	if (priv->blob_uncomp != NULL)
+		g_bytes_unref (priv->blob_uncomp);
+	G_OBJECT_CLASS (fu_efi_firmware_section_parent_class)->finalize (object);
+}
+
 static void
 fu_efi_firmware_section_class_init (FuEfiFirmwareSectionClass *klass)
 {
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
 	FuFirmwareClass *klass_firmware = FU_FIRMWARE_CLASS (klass);
+	object_class->finalize = fu_efi_firmware_section_finalize;
 	klass_firmware->parse = fu_efi_firmware_section_parse;
 	klass_firmware->write = fu_efi_firmware_section_write;
 	klass_firmware->build = fu_efi_firmware_section_build;
 	klass_firmware->export = fu_efi_firmware_section_export;
+	klass_firmware->ensure_images = fu_efi_firmware_section_ensure_images;
 }
 
 /**
@@ -17,3 +17,6 @@ struct _FuEfiFirmwareSectionClass
 };
 
 FuFirmware	*fu_efi_firmware_section_new		(void);
+gboolean	 fu_efi_firmware_section_needs_decompress	(FuEfiFirmwareSection *self);
+gboolean	 fu_efi_firmware_section_decompress	(FuEfiFirmwareSection *self,
+							 GError		**error);
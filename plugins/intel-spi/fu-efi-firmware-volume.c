@@ -361,11 +361,34 @@ fu_efi_firmware_volume_init (FuEfiFirmwareVolume *self)
 	priv->attrs = 0xfeff;
 }
 
+static gboolean
+fu_efi_firmware_volume_check_magic (FuFirmware *firmware, GBytes *fw, gsize offset, GError **error)
+{
+	gsize bufsz = 0;
+	guint32 sig = 0;
+	const guint8 *buf = g_bytes_get_data (fw, &bufsz);
+
+	if (!fu_common_read_uint32_safe (buf, bufsz,
+					 offset + FU_EFI_FIRMWARE_VOLUME_OFFSET_SIGNATURE,
+					 &sig, G_LITTLE_ENDIAN, error))
+		return FALSE;
+	if (sig != FU_EFI_FIRMWARE_VOLUME_SIGNATURE) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "EFI FV signature invalid, got 0x%x, expected 0x%x",
+			     sig, (guint) FU_EFI_FIRMWARE_VOLUME_SIGNATURE);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static void
 fu_efi_firmware_volume_class_init (FuEfiFirmwareVolumeClass *klass)
 {
 	FuFirmwareClass *klass_firmware = FU_FIRMWARE_CLASS (klass);
 	klass_firmware->parse = fu_efi_firmware_volume_parse;
+	klass_firmware->check_magic = fu_efi_firmware_volume_check_magic;
 	klass_firmware->write = fu_efi_firmware_volume_write;
 	klass_firmware->export = fu_ifd_firmware_export;
 }
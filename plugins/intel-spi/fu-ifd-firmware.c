@@ -436,6 +436,28 @@ fu_ifd_firmware_finalize (GObject *object)
 }
 
 
+static gboolean
+fu_ifd_firmware_check_magic (FuFirmware *firmware, GBytes *fw, gsize offset, GError **error)
+{
+	gsize bufsz = 0;
+	guint32 sig = 0;
+	const guint8 *buf = g_bytes_get_data (fw, &bufsz);
+
+	if (!fu_common_read_uint32_safe (buf, bufsz,
+					 offset + FU_IFD_FDBAR_SIGNATURE,
+					 &sig, G_LITTLE_ENDIAN, error))
+		return FALSE;
+	if (sig != FU_IFD_SIGNATURE) {
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INVALID_FILE,
+			     "signature invalid, got 0x%x, expected 0x%x",
+			     sig, (guint) FU_IFD_SIGNATURE);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static void
 fu_ifd_firmware_class_init (FuIfdFirmwareClass *klass)
 {
@@ -444,6 +466,7 @@ fu_ifd_firmware_class_init (FuIfdFirmwareClass *klass)
 	object_class->finalize = fu_ifd_firmware_finalize;
 	klass_firmware->export = fu_ifd_firmware_export;
 	klass_firmware->parse = fu_ifd_firmware_parse;
+	klass_firmware->check_magic = fu_ifd_firmware_check_magic;
 	klass_firmware->write = fu_ifd_firmware_write;
 	klass_firmware->build = fu_ifd_firmware_build;
 }
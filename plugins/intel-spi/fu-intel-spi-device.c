@@ -391,23 +391,26 @@ fu_intel_spi_device_set_addr (FuIntelSpiDevice *self, guint32 addr)
 	fu_mmio_write32 (self->spibar, ICH9_REG_FADDR, (addr & PCH100_FADDR_FLA) | addr_old);
 }
 
-GBytes *
-fu_intel_spi_device_dump (FuIntelSpiDevice *self,
+/* only notify every 64kB to avoid flooding the daemon with progress */
+#define FU_INTEL_SPI_PROGRESS_STRIDE		0x10000
+
+static gboolean
+fu_intel_spi_device_read (FuIntelSpiDevice *self,
 			  FuDevice *device,
 			  guint32 offset,
-			  guint32 length,
+			  guint8 *buf,
+			  guint32 bufsz,
+			  guint32 progress_done,
+			  guint32 progress_total,
 			  GError **error)
 {
-	guint8 block_len = 0x40;
-	g_autoptr(GByteArray) buf = g_byte_array_sized_new (length);
-
 	/* set FDONE, FCERR, AEL */
-	fu_device_set_status (device, FWUPD_STATUS_DEVICE_READ);
 	fu_mmio_write16 (self->spibar, ICH9_REG_HSFS,
 			 fu_mmio_read16 (self->spibar, ICH9_REG_HSFS));
-	for (guint32 addr = offset; addr < offset + length; addr += block_len) {
+	for (guint32 i = 0; i < bufsz; i += 0x40) {
 		guint16 hsfc;
-		guint32 buftmp32 = 0;
+		guint32 addr = offset + i;
+		guint32 block_len = MIN (bufsz - i, 0x40);
 
 		/* set up read */
 		fu_intel_spi_device_set_addr (self, addr);
@@ -421,32 +424,100 @@ fu_intel_spi_device_dump (FuIntelSpiDevice *self,
 		fu_mmio_write16 (self->spibar, ICH9_REG_HSFC, hsfc);
 		if (!fu_intel_spi_device_wait (self, FU_INTEL_SPI_READ_TIMEOUT, error)) {
 			g_prefix_error (error, "failed @0x%x: ", addr);
-			return NULL;
+			return FALSE;
 		}
 
-		/* copy out data */
-		for (guint i = 0; i < block_len; i++) {
-			if (i % 4 == 0)
-				buftmp32 = fu_mmio_read32 (self->spibar, ICH9_REG_FDATA0 + i);
-			fu_byte_array_append_uint8 (buf, buftmp32 >> ((i % 4) * 8));
+		/* copy out data a word at a time */
+		for (guint32 j = 0; j < block_len; j += 4) {
+			guint32 tmp = fu_mmio_read32 (self->spibar, ICH9_REG_FDATA0 + j);
+			if (block_len - j >= 4) {
+				fu_common_write_uint32 (buf + i + j, tmp, G_LITTLE_ENDIAN);
+			} else {
+				for (guint32 k = 0; k < block_len - j; k++)
+					buf[i + j + k] = tmp >> (k * 8);
+			}
 		}
 
 		/* progress */
-		fu_device_set_progress_full (device, addr - offset + block_len, length);
+		if ((i + block_len) % FU_INTEL_SPI_PROGRESS_STRIDE == 0 ||
+		    i + block_len == bufsz) {
+			fu_device_set_progress_full (device,
+						     progress_done + i + block_len,
+						     progress_total);
+		}
 	}
 
 	/* success */
-	return g_byte_array_free_to_bytes (g_steal_pointer (&buf));
+	return TRUE;
+}
+
+GBytes *
+fu_intel_spi_device_dump (FuIntelSpiDevice *self,
+			  FuDevice *device,
+			  guint32 offset,
+			  guint32 length,
+			  GError **error)
+{
+	g_autofree guint8 *buf = g_malloc0 (length);
+
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_READ);
+	if (!fu_intel_spi_device_read (self, device, offset, buf, length,
+				       0x0, length, error))
+		return NULL;
+	return g_bytes_new_take (g_steal_pointer (&buf), length);
+}
+
+static gboolean
+fu_intel_spi_device_region_readable (FuIntelSpiDevice *self, FuIfdRegion region)
+{
+	guint32 freg_base = FU_IFD_FREG_BASE (self->freg[region]);
+	guint32 freg_limt = FU_IFD_FREG_LIMIT (self->freg[region]);
+	if (freg_base > freg_limt)
+		return FALSE;
+	/* BRRA: BIOS master read access */
+	return (self->frap & (1u << region)) > 0;
 }
 
 static GBytes *
 fu_intel_spi_device_dump_firmware (FuDevice *device, GError **error)
 {
 	FuIntelSpiDevice *self = FU_INTEL_SPI_DEVICE (device);
-	guint64 total_size = fu_device_get_firmware_size_max (device);
-	return fu_intel_spi_device_dump (self, device,
-						       0x0, total_size,
-						       error);
+	guint32 total_size = fu_device_get_firmware_size_max (device);
+	g_autofree guint8 *buf = NULL;
+
+	/* a region the host cannot read would leave bytes that do not match the
+	 * flash, so refuse to create an image that cannot be verified */
+	for (guint i = FU_IFD_REGION_DESC; i < 4; i++) {
+		guint32 freg_base = FU_IFD_FREG_BASE (self->freg[i]);
+		guint32 freg_limt = FU_IFD_FREG_LIMIT (self->freg[i]);
+		if (freg_base > freg_limt)
+			continue;
+		if (!fu_intel_spi_device_region_readable (self, i)) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_NOT_SUPPORTED,
+				     "%s region is not readable by the host",
+				     fu_ifd_region_to_string (i));
+			return NULL;
+		}
+		if (freg_limt >= total_size) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "region %s limit 0x%x outside flash size 0x%x",
+				     fu_ifd_region_to_string (i),
+				     freg_limt, total_size);
+			return NULL;
+		}
+	}
+
+	/* read everything, including any gaps between the regions */
+	buf = g_malloc0 (total_size);
+	fu_device_set_status (device, FWUPD_STATUS_DEVICE_READ);
+	if (!fu_intel_spi_device_read (self, device, 0x0, buf, total_size,
+				       0x0, total_size, error))
+		return NULL;
+	return g_bytes_new_take (g_steal_pointer (&buf), total_size);
 }
 
 static FuFirmware *
@@ -514,6 +585,7 @@ fu_intel_spi_device_init (FuIntelSpiDevice *self)
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_CAN_VERIFY_IMAGE);
 	fu_device_add_icon (FU_DEVICE (self), "computer");
 	fu_device_set_physical_id (FU_DEVICE (self), "intel_spi");
+	fu_device_set_security_inputs (FU_DEVICE (self), FU_SECURITY_ATTRS_INPUT_NONE);
 	fu_device_register_private_flag (FU_DEVICE (self),
 					 FU_INTEL_SPI_DEVICE_FLAG_ICH,
 					 "ICH");
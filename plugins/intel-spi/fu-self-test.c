@@ -8,11 +8,13 @@
 
 #include <fwupdplugin.h>
 
+#include "fu-efi-firmware-common.h"
 #include "fu-efi-firmware-file.h"
 #include "fu-efi-firmware-filesystem.h"
 #include "fu-efi-firmware-section.h"
 #include "fu-efi-firmware-volume.h"
 #include "fu-ifd-bios.h"
+#include "fu-ifd-firmware.h"
 #include "fu-ifd-image.h"
 
 static void
@@ -194,6 +196,90 @@ fu_ifd_image_xml_func (void)
 	csum2 = fu_firmware_get_checksum (firmware2, G_CHECKSUM_SHA1, &error);
 	g_assert_cmpstr (csum1, ==, csum2);
 }
+
+static void
+fu_efi_firmware_section_lzma_corrupt_func (void)
+{
+	gboolean ret;
+	const guint8 buf[] = {
+		0x20, 0x00, 0x00, 0x02,	/* size, type */
+		0x98, 0x58, 0x4e, 0xee, 0x14, 0x39, 0x59, 0x42,
+		0x9d, 0x6e, 0xdc, 0x7b, 0xd7, 0x94, 0x03, 0xcf,	/* LZMA */
+		0x18, 0x00, 0x00, 0x00,	/* offset, attr */
+		0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,	/* not LZMA */
+	};
+	g_autoptr(FuFirmware) firmware = fu_efi_firmware_section_new ();
+	g_autoptr(GBytes) blob = g_bytes_new_static (buf, sizeof(buf));
+	g_autoptr(GError) error = NULL;
+
+	/* the payload is not decompressed when parsing */
+	ret = fu_firmware_parse (firmware, blob, FWUPD_INSTALL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* ...but is when checking, and the failure is not forgotten */
+	ret = fu_firmware_check (firmware, &error);
+	g_assert_nonnull (error);
+	g_assert_false (ret);
+	g_clear_error (&error);
+	ret = fu_firmware_check (firmware, &error);
+	g_assert_nonnull (error);
+	g_assert_false (ret);
+}
+
+static void
+fu_ifd_firmware_decompress_func (void)
+{
+	gboolean ret;
+	const gchar *fn = g_getenv ("FWUPD_INTEL_SPI_BIOS_IMAGE");
+	g_autoptr(FuFirmware) firmware1 = fu_ifd_firmware_new ();
+	g_autoptr(FuFirmware) firmware2 = fu_ifd_firmware_new ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+	g_autofree gchar *xml1 = NULL;
+	g_autofree gchar *xml2 = NULL;
+
+	/* a real SPI image is too large to ship */
+	if (fn == NULL) {
+		g_test_skip ("FWUPD_INTEL_SPI_BIOS_IMAGE not set");
+		return;
+	}
+	blob = fu_common_get_contents_bytes (fn, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (blob);
+
+	/* no sections are decompressed */
+	g_timer_reset (timer);
+	ret = fu_firmware_parse (firmware1, blob, FWUPD_INSTALL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	g_print ("parse=%.3fms ", g_timer_elapsed (timer, NULL) * 1000.f);
+
+	/* decompressed on demand */
+	g_timer_reset (timer);
+	xml1 = fu_firmware_export_to_xml (firmware1, FU_FIRMWARE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (xml1);
+	g_print ("lazy=%.3fms ", g_timer_elapsed (timer, NULL) * 1000.f);
+
+	/* decompressed in parallel */
+	g_timer_reset (timer);
+	ret = fu_firmware_parse (firmware2, blob, FWUPD_INSTALL_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	ret = fu_efi_firmware_decompress_sections (firmware2, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	xml2 = fu_firmware_export_to_xml (firmware2, FU_FIRMWARE_EXPORT_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (xml2);
+	g_print ("parallel=%.3fms ", g_timer_elapsed (timer, NULL) * 1000.f);
+
+	/* both trees are identical */
+	g_assert_cmpstr (xml1, ==, xml2);
+}
+
 int
 main (int argc, char **argv)
 {
@@ -209,5 +295,7 @@ main (int argc, char **argv)
 	g_test_add_func ("/efi/firmware-filesystem{xml}", fu_efi_firmware_filesystem_xml_func);
 	g_test_add_func ("/efi/firmware-volume{xml}", fu_efi_firmware_volume_xml_func);
 	g_test_add_func ("/ifd/image{xml}", fu_ifd_image_xml_func);
+	g_test_add_func ("/efi/firmware-section{lzma-corrupt}", fu_efi_firmware_section_lzma_corrupt_func);
+	g_test_add_func ("/ifd/firmware{decompress}", fu_ifd_firmware_decompress_func);
 	return g_test_run ();
 }
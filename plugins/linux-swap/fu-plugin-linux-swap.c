@@ -20,6 +20,7 @@ fu_plugin_init (FuPlugin *plugin)
 {
 	fu_plugin_alloc_data (plugin, sizeof (FuPluginData));
 	fu_plugin_set_build_hash (plugin, FU_BUILD_HASH);
+	fu_plugin_set_security_inputs (plugin, FU_SECURITY_ATTRS_INPUT_RUNTIME);
 }
 
 void
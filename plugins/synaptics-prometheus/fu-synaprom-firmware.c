@@ -216,11 +216,40 @@ fu_synaprom_firmware_init (FuSynapromFirmware *self)
 	fu_firmware_add_flag (FU_FIRMWARE (self), FU_FIRMWARE_FLAG_HAS_VID_PID);
 }
 
+static gboolean
+fu_synaprom_firmware_check_magic (FuFirmware *firmware, GBytes *fw, gsize offset, GError **error)
+{
+	gsize bufsz = 0;
+	guint16 tag = 0;
+	const guint8 *buf = g_bytes_get_data (fw, &bufsz);
+
+	/* there is no magic, but the first tag has to be valid */
+	if (bufsz < offset + FU_SYNAPROM_FIRMWARE_SIGSIZE + sizeof(FuSynapromFirmwareHdr)) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "blob is too small to be firmware");
+		return FALSE;
+	}
+	if (!fu_common_read_uint16_safe (buf, bufsz, offset, &tag, G_LITTLE_ENDIAN, error))
+		return FALSE;
+	if (tag >= FU_SYNAPROM_FIRMWARE_TAG_MAX) {
+		g_set_error (error,
+			     G_IO_ERROR,
+			     G_IO_ERROR_INVALID_DATA,
+			     "tag 0x%04x is too large",
+			     tag);
+		return FALSE;
+	}
+	return TRUE;
+}
+
 static void
 fu_synaprom_firmware_class_init (FuSynapromFirmwareClass *klass)
 {
 	FuFirmwareClass *klass_firmware = FU_FIRMWARE_CLASS (klass);
 	klass_firmware->parse = fu_synaprom_firmware_parse;
+	klass_firmware->check_magic = fu_synaprom_firmware_check_magic;
 	klass_firmware->write = fu_synaprom_firmware_write;
 	klass_firmware->export = fu_synaprom_firmware_export;
 	klass_firmware->build = fu_synaprom_firmware_build;
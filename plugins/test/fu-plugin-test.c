@@ -10,6 +10,7 @@
 
 struct FuPluginData {
 	GMutex			 mutex;
+	guint			 security_attrs_cnt;
 };
 
 void
@@ -257,3 +258,25 @@ fu_plugin_composite_cleanup (FuPlugin *plugin,
 	}
 	return TRUE;
 }
+
+void
+fu_plugin_add_security_attrs (FuPlugin *plugin, FuSecurityAttrs *attrs)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	g_autofree gchar *cnt = NULL;
+	g_autoptr(FwupdSecurityAttr) attr = NULL;
+
+	if (g_strcmp0 (g_getenv ("FWUPD_PLUGIN_TEST"), "security") != 0)
+		return;
+
+	/* count how many times this was called */
+	cnt = g_strdup_printf ("%u", ++data->security_attrs_cnt);
+	attr = fwupd_security_attr_new ("org.fwupd.hsi.Test");
+	fwupd_security_attr_set_plugin (attr, fu_plugin_get_name (plugin));
+	fwupd_security_attr_set_name (attr, "Test");
+	fwupd_security_attr_set_level (attr, FWUPD_SECURITY_ATTR_LEVEL_CRITICAL);
+	fwupd_security_attr_set_result (attr, FWUPD_SECURITY_ATTR_RESULT_VALID);
+	fwupd_security_attr_add_flag (attr, FWUPD_SECURITY_ATTR_FLAG_SUCCESS);
+	fwupd_security_attr_add_metadata (attr, "Count", cnt);
+	fu_security_attrs_append (attrs, attr);
+}
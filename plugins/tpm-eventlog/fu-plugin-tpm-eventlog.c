@@ -10,8 +10,12 @@
 
 #include "fu-tpm-eventlog-device.h"
 
+#define FU_TPM_EVENTLOG_FILENAME	"/sys/kernel/security/tpm0/binary_bios_measurements"
+
 struct FuPluginData {
+	FuTpmEventlogDevice	*device;
 	GPtrArray		*pcr0s;
+	GPtrArray		*uefi_checksums;
 	gboolean		 has_tpm_device;
 	gboolean		 has_uefi_device;
 	gboolean		 reconstructed;
@@ -24,14 +28,19 @@ fu_plugin_init (FuPlugin *plugin)
 	fu_plugin_add_rule (plugin, FU_PLUGIN_RULE_RUN_BEFORE, "uefi_capsule");
 	fu_plugin_add_rule (plugin, FU_PLUGIN_RULE_RUN_AFTER, "tpm");
 	fu_plugin_set_build_hash (plugin, FU_BUILD_HASH);
+	fu_plugin_set_security_inputs (plugin, FU_SECURITY_ATTRS_INPUT_DEVICES);
 }
 
 void
 fu_plugin_destroy (FuPlugin *plugin)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
+	if (data->device != NULL)
+		g_object_unref (data->device);
 	if (data->pcr0s != NULL)
 		g_ptr_array_unref (data->pcr0s);
+	if (data->uefi_checksums != NULL)
+		g_ptr_array_unref (data->uefi_checksums);
 }
 
 gboolean
@@ -39,7 +48,7 @@ fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
 	gsize bufsz = 0;
-	const gchar *fn = "/sys/kernel/security/tpm0/binary_bios_measurements";
+	const gchar *fn = FU_TPM_EVENTLOG_FILENAME;
 	g_autofree gchar *str = NULL;
 	g_autofree guint8 *buf = NULL;
 	g_autoptr(FuTpmEventlogDevice) dev = NULL;
@@ -84,30 +93,38 @@ fu_plugin_coldplug (FuPlugin *plugin, GError **error)
 	str = fu_tpm_eventlog_device_report_metadata (dev);
 	fu_plugin_add_report_metadata (plugin, "TpmEventLog", str);
 	fu_plugin_device_add (plugin, FU_DEVICE (dev));
+	data->device = g_steal_pointer (&dev);
 	return TRUE;
 }
 
-static void
-fu_plugin_device_registered_tpm (FuPlugin *plugin, FuDevice *device)
+/* the log may have grown since coldplug, but only the new events are parsed */
+static gboolean
+fu_plugin_tpm_eventlog_reload (FuPlugin *plugin, GError **error)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
-	data->has_tpm_device = TRUE;
+	gsize bufsz = 0;
+	g_autofree guint8 *buf = NULL;
+	g_autoptr(GPtrArray) pcr0s = NULL;
+
+	if (!g_file_get_contents (FU_TPM_EVENTLOG_FILENAME, (gchar **) &buf, &bufsz, error))
+		return FALSE;
+	if (!fu_tpm_eventlog_device_update (data->device, buf, bufsz, error))
+		return FALSE;
+	pcr0s = fu_tpm_eventlog_device_get_checksums (data->device, 0, error);
+	if (pcr0s == NULL)
+		return FALSE;
+	g_ptr_array_unref (data->pcr0s);
+	data->pcr0s = g_steal_pointer (&pcr0s);
+	return TRUE;
 }
 
 static void
-fu_plugin_device_registered_uefi (FuPlugin *plugin, FuDevice *device)
+fu_plugin_tpm_eventlog_ensure_reconstructed (FuPlugin *plugin)
 {
 	FuPluginData *data = fu_plugin_get_data (plugin);
-	GPtrArray *checksums;
-
-	/* only the system-firmware device gets checksums */
-	checksums = fu_device_get_checksums (device);
-	if (checksums->len == 0)
-		return;
-	data->has_uefi_device = TRUE;
 
-	for (guint i = 0; i < checksums->len; i++) {
-		const gchar *checksum = g_ptr_array_index (checksums, i);
+	for (guint i = 0; i < data->uefi_checksums->len; i++) {
+		const gchar *checksum = g_ptr_array_index (data->uefi_checksums, i);
 		data->reconstructed = FALSE;
 		for (guint j = 0; j < data->pcr0s->len; j++) {
 			const gchar *checksum_tmp = g_ptr_array_index (data->pcr0s, j);
@@ -125,6 +142,30 @@ fu_plugin_device_registered_uefi (FuPlugin *plugin, FuDevice *device)
 	}
 }
 
+static void
+fu_plugin_device_registered_tpm (FuPlugin *plugin, FuDevice *device)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	data->has_tpm_device = TRUE;
+}
+
+static void
+fu_plugin_device_registered_uefi (FuPlugin *plugin, FuDevice *device)
+{
+	FuPluginData *data = fu_plugin_get_data (plugin);
+	GPtrArray *checksums;
+
+	/* only the system-firmware device gets checksums */
+	checksums = fu_device_get_checksums (device);
+	if (checksums->len == 0)
+		return;
+	data->has_uefi_device = TRUE;
+	if (data->uefi_checksums != NULL)
+		g_ptr_array_unref (data->uefi_checksums);
+	data->uefi_checksums = g_ptr_array_ref (checksums);
+	fu_plugin_tpm_eventlog_ensure_reconstructed (plugin);
+}
+
 void
 fu_plugin_device_registered (FuPlugin *plugin, FuDevice *device)
 {
@@ -162,6 +203,14 @@ fu_plugin_add_security_attrs (FuPlugin *plugin, FuSecurityAttrs *attrs)
 		fwupd_security_attr_set_result (attr, FWUPD_SECURITY_ATTR_RESULT_NOT_FOUND);
 		return;
 	}
+	if (data->device != NULL) {
+		g_autoptr(GError) error_local = NULL;
+		if (!fu_plugin_tpm_eventlog_reload (plugin, &error_local)) {
+			g_debug ("failed to reload event log: %s", error_local->message);
+		} else {
+			fu_plugin_tpm_eventlog_ensure_reconstructed (plugin);
+		}
+	}
 	if (!data->reconstructed) {
 		fwupd_security_attr_set_result (attr, FWUPD_SECURITY_ATTR_RESULT_NOT_VALID);
 		return;
@@ -10,6 +10,7 @@
 
 #include "fu-tpm-eventlog-common.h"
 #include "fu-tpm-eventlog-device.h"
+#include "fu-tpm-eventlog-parser.h"
 
 static void
 fu_test_tpm_eventlog_parse_v1_func (void)
@@ -92,6 +93,132 @@ fu_test_tpm_eventlog_parse_v2_func (void)
 	g_assert_cmpstr (tmp, ==, "6d9fed68092cfb91c9552bcb7879e75e1df36efd407af67690dc3389a5722fab");
 }
 
+static void
+fu_test_tpm_eventlog_replay_func (void)
+{
+	const gchar *ci = g_getenv ("CI_NETWORK");
+	const guint8 *digest;
+	gboolean ret;
+	gsize bufsz = 0;
+	gsize digestsz = 0;
+	g_autofree gchar *fn = NULL;
+	g_autofree guint8 *buf = NULL;
+	g_autoptr(FuTpmEventlogReplay) replay = fu_tpm_eventlog_replay_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) items = NULL;
+	g_autoptr(GPtrArray) pcr0s = NULL;
+
+	fn = g_test_build_filename (G_TEST_DIST, "tests", "binary_bios_measurements-v2", NULL);
+	if (!g_file_test (fn, G_FILE_TEST_EXISTS) && ci == NULL) {
+		g_test_skip ("Missing binary_bios_measurements-v2");
+		return;
+	}
+	ret = g_file_get_contents (fn, (gchar **) &buf, &bufsz, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* nothing extended yet */
+	pcr0s = fu_tpm_eventlog_replay_get_checksums (replay, 0, &error);
+	g_assert_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA);
+	g_assert_null (pcr0s);
+	g_clear_error (&error);
+
+	/* replay while parsing */
+	items = fu_tpm_eventlog_parser_new (buf, bufsz,
+					    FU_TPM_EVENTLOG_PARSER_FLAG_NONE,
+					    replay, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (items);
+	g_assert_cmpint (fu_tpm_eventlog_replay_get_pcr_mask (replay) & 0x1, ==, 0x1);
+
+	/* only PCR0 items are kept, but every PCR is extended */
+	g_assert_cmpint (fu_tpm_eventlog_replay_get_pcr_mask (replay), >, 0x1);
+	pcr0s = fu_tpm_eventlog_replay_get_checksums (replay, 0, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (pcr0s);
+	g_assert_cmpint (pcr0s->len, ==, 2);
+	g_assert_cmpstr (g_ptr_array_index (pcr0s, 0), ==, "ebead4b31c7c49e193c440cd6ee90bc1b61a3ca6");
+	g_assert_cmpstr (g_ptr_array_index (pcr0s, 1), ==, "6d9fed68092cfb91c9552bcb7879e75e1df36efd407af67690dc3389a5722fab");
+	digest = fu_tpm_eventlog_replay_get_digest (replay, 0, TPM2_ALG_SHA256, &digestsz);
+	g_assert_nonnull (digest);
+	g_assert_cmpint (digestsz, ==, TPM2_SHA256_DIGEST_SIZE);
+	g_assert_cmpint (fu_tpm_eventlog_replay_get_offset (replay), ==, bufsz);
+
+	/* parsing the same log again does not extend anything twice */
+	g_ptr_array_unref (items);
+	items = fu_tpm_eventlog_parser_new (buf, bufsz,
+					    FU_TPM_EVENTLOG_PARSER_FLAG_NONE,
+					    replay, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (items);
+	g_assert_cmpint (items->len, ==, 0);
+	g_ptr_array_unref (pcr0s);
+	pcr0s = fu_tpm_eventlog_replay_get_checksums (replay, 0, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (pcr0s);
+	g_assert_cmpstr (g_ptr_array_index (pcr0s, 0), ==, "ebead4b31c7c49e193c440cd6ee90bc1b61a3ca6");
+
+	/* a truncated or replaced log cannot be resumed */
+	g_assert_false (fu_tpm_eventlog_replay_check_log (replay, buf, bufsz - 1));
+	buf[0] ^= 0xff;
+	g_assert_false (fu_tpm_eventlog_replay_check_log (replay, buf, bufsz));
+	buf[0] ^= 0xff;
+	g_assert_true (fu_tpm_eventlog_replay_check_log (replay, buf, bufsz));
+}
+
+static void
+fu_test_tpm_eventlog_replay_resume_func (void)
+{
+	const gchar *ci = g_getenv ("CI_NETWORK");
+	gboolean ret;
+	gsize bufsz = 0;
+	guint32 hdrsz = 0;
+	g_autofree gchar *fn = NULL;
+	g_autofree guint8 *buf = NULL;
+	g_autoptr(FuTpmEventlogReplay) replay = fu_tpm_eventlog_replay_new ();
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) items1 = NULL;
+	g_autoptr(GPtrArray) items2 = NULL;
+	g_autoptr(GPtrArray) pcr0s = NULL;
+
+	fn = g_test_build_filename (G_TEST_DIST, "tests", "binary_bios_measurements-v2", NULL);
+	if (!g_file_test (fn, G_FILE_TEST_EXISTS) && ci == NULL) {
+		g_test_skip ("Missing binary_bios_measurements-v2");
+		return;
+	}
+	ret = g_file_get_contents (fn, (gchar **) &buf, &bufsz, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+
+	/* only the header has been written so far */
+	ret = fu_common_read_uint32_safe (buf, bufsz,
+					  FU_TPM_EVENTLOG_V1_IDX_EVENT_SIZE,
+					  &hdrsz, G_LITTLE_ENDIAN, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	items1 = fu_tpm_eventlog_parser_new (buf, FU_TPM_EVENTLOG_V1_SIZE + hdrsz,
+					     FU_TPM_EVENTLOG_PARSER_FLAG_NONE,
+					     replay, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (items1);
+	g_assert_cmpint (items1->len, ==, 0);
+	g_assert_cmpint (fu_tpm_eventlog_replay_get_offset (replay), ==, FU_TPM_EVENTLOG_V1_SIZE + hdrsz);
+
+	/* the grown log is resumed from the saved offset */
+	items2 = fu_tpm_eventlog_parser_new (buf, bufsz,
+					     FU_TPM_EVENTLOG_PARSER_FLAG_NONE,
+					     replay, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (items2);
+	g_assert_cmpint (items2->len, >, 0);
+	pcr0s = fu_tpm_eventlog_replay_get_checksums (replay, 0, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (pcr0s);
+	g_assert_cmpint (pcr0s->len, ==, 2);
+	g_assert_cmpstr (g_ptr_array_index (pcr0s, 0), ==, "ebead4b31c7c49e193c440cd6ee90bc1b61a3ca6");
+	g_assert_cmpstr (g_ptr_array_index (pcr0s, 1), ==, "6d9fed68092cfb91c9552bcb7879e75e1df36efd407af67690dc3389a5722fab");
+}
+
 int
 main (int argc, char **argv)
 {
@@ -99,5 +226,7 @@ main (int argc, char **argv)
 	g_log_set_fatal_mask (NULL, G_LOG_LEVEL_ERROR | G_LOG_LEVEL_CRITICAL);
 	g_test_add_func ("/tpm-eventlog/parse{v1}", fu_test_tpm_eventlog_parse_v1_func);
 	g_test_add_func ("/tpm-eventlog/parse{v2}", fu_test_tpm_eventlog_parse_v2_func);
+	g_test_add_func ("/tpm-eventlog/replay", fu_test_tpm_eventlog_replay_func);
+	g_test_add_func ("/tpm-eventlog/replay{resume}", fu_test_tpm_eventlog_replay_resume_func);
 	return g_test_run ();
 }
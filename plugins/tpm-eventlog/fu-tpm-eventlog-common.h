@@ -10,6 +10,29 @@
 #include <gio/gio.h>
 #include <tss2/tss2_tpm2_types.h>
 
+#define FU_TPM_EVENTLOG_V1_IDX_PCR			0x00
+#define FU_TPM_EVENTLOG_V1_IDX_TYPE			0x04
+#define FU_TPM_EVENTLOG_V1_IDX_DIGEST			0x08
+#define FU_TPM_EVENTLOG_V1_IDX_EVENT_SIZE		0x1c
+#define FU_TPM_EVENTLOG_V1_SIZE				0x20
+
+#define FU_TPM_EVENTLOG_V2_HDR_IDX_SIGNATURE		0x00
+#define FU_TPM_EVENTLOG_V2_HDR_IDX_PLATFORM_CLASS	0x10
+#define FU_TPM_EVENTLOG_V2_HDR_IDX_SPEC_VERSION_MINOR	0x14
+#define FU_TPM_EVENTLOG_V2_HDR_IDX_SPEC_VERSION_MAJOR	0X15
+#define FU_TPM_EVENTLOG_V2_HDR_IDX_SPEC_ERRATA		0x16
+#define FU_TPM_EVENTLOG_V2_HDR_IDX_UINTN_SIZE		0x17
+#define FU_TPM_EVENTLOG_V2_HDR_IDX_NUMBER_OF_ALGS	0x18
+
+#define FU_TPM_EVENTLOG_V2_HDR_SIGNATURE		"Spec ID Event03"
+
+#define FU_TPM_EVENTLOG_V2_IDX_PCR			0x00
+#define FU_TPM_EVENTLOG_V2_IDX_TYPE			0x04
+#define FU_TPM_EVENTLOG_V2_IDX_DIGEST_COUNT		0x08
+#define FU_TPM_EVENTLOG_V2_SIZE				0x0c
+
+#define FU_TPM_EVENTLOG_ITEM_SIZE_MAX			(1024 * 1024)
+
 typedef enum {
 	EV_PREBOOT_CERT				= 0x00000000,
 	EV_POST_CODE				= 0x00000001,
@@ -55,6 +78,3 @@ guint32		 fu_tpm_eventlog_hash_get_size		(TPM2_ALG_ID	 hash_kind);
 const gchar	*fu_tpm_eventlog_item_kind_to_string	(FuTpmEventlogItemKind	 event_type);
 gchar		*fu_tpm_eventlog_strhex			(GBytes		*blob);
 gchar		*fu_tpm_eventlog_blobstr		(GBytes		*blob);
-GPtrArray	*fu_tpm_eventlog_calc_checksums		(GPtrArray	*items,
-							 guint8		 pcr,
-							 GError		**error);
@@ -15,6 +15,7 @@
 struct _FuTpmEventlogDevice {
 	FuDevice		 parent_instance;
 	GPtrArray		*items;
+	FuTpmEventlogReplay	*replay;
 };
 
 G_DEFINE_TYPE (FuTpmEventlogDevice, fu_tpm_eventlog_device, FU_TYPE_DEVICE)
@@ -22,7 +23,7 @@ G_DEFINE_TYPE (FuTpmEventlogDevice, fu_tpm_eventlog_device, FU_TYPE_DEVICE)
 GPtrArray *
 fu_tpm_eventlog_device_get_checksums (FuTpmEventlogDevice *self, guint8 pcr, GError **error)
 {
-	return fu_tpm_eventlog_calc_checksums (self->items, pcr, error);
+	return fu_tpm_eventlog_replay_get_checksums (self->replay, pcr, error);
 }
 
 static void
@@ -53,7 +54,7 @@ fu_tpm_eventlog_device_report_metadata (FuTpmEventlogDevice *self)
 			g_string_append_printf (str, " [%s]", blobstr);
 		g_string_append (str, "\n");
 	}
-	pcrs = fu_tpm_eventlog_calc_checksums (self->items, 0, NULL);
+	pcrs = fu_tpm_eventlog_replay_get_checksums (self->replay, 0, NULL);
 	if (pcrs != NULL) {
 		for (guint j = 0; j < pcrs->len; j++) {
 			const gchar *csum = g_ptr_array_index (pcrs, j);
@@ -68,6 +69,7 @@ fu_tpm_eventlog_device_report_metadata (FuTpmEventlogDevice *self)
 static void
 fu_tpm_eventlog_device_init (FuTpmEventlogDevice *self)
 {
+	self->replay = fu_tpm_eventlog_replay_new ();
 	fu_device_set_name (FU_DEVICE (self), "Event Log");
 	fu_device_add_flag (FU_DEVICE (self), FWUPD_DEVICE_FLAG_INTERNAL);
 	fu_device_set_physical_id (FU_DEVICE (self), "DEVNAME=/dev/tpm0");
@@ -82,6 +84,7 @@ fu_tpm_eventlog_device_finalize (GObject *object)
 	FuTpmEventlogDevice *self = FU_TPM_EVENTLOG_DEVICE (object);
 
 	g_ptr_array_unref (self->items);
+	g_object_unref (self->replay);
 
 	G_OBJECT_CLASS (fu_tpm_eventlog_device_parent_class)->finalize (object);
 }
@@ -95,6 +98,35 @@ fu_tpm_eventlog_device_class_init (FuTpmEventlogDeviceClass *klass)
 	klass_device->to_string = fu_tpm_eventlog_device_to_string;
 }
 
+/* only the events appended since the log was last parsed are replayed */
+gboolean
+fu_tpm_eventlog_device_update (FuTpmEventlogDevice *self,
+			       const guint8 *buf,
+			       gsize bufsz,
+			       GError **error)
+{
+	g_autoptr(GPtrArray) items = NULL;
+
+	g_return_val_if_fail (FU_IS_TPM_EVENTLOG_DEVICE (self), FALSE);
+	g_return_val_if_fail (buf != NULL, FALSE);
+
+	/* the log was replaced, so the parser starts again */
+	if (!fu_tpm_eventlog_replay_check_log (self->replay, buf, bufsz))
+		g_ptr_array_set_size (self->items, 0);
+	items = fu_tpm_eventlog_parser_new (buf, bufsz,
+					    FU_TPM_EVENTLOG_PARSER_FLAG_NONE,
+					    self->replay,
+					    error);
+	if (items == NULL) {
+		g_ptr_array_set_size (self->items, 0);
+		return FALSE;
+	}
+	g_ptr_array_set_free_func (items, NULL);
+	for (guint i = 0; i < items->len; i++)
+		g_ptr_array_add (self->items, g_ptr_array_index (items, i));
+	return TRUE;
+}
+
 FuTpmEventlogDevice *
 fu_tpm_eventlog_device_new (const guint8 *buf, gsize bufsz, GError **error)
 {
@@ -106,6 +138,7 @@ fu_tpm_eventlog_device_new (const guint8 *buf, gsize bufsz, GError **error)
 	self = g_object_new (FU_TYPE_TPM_EVENTLOG_DEVICE, NULL);
 	self->items = fu_tpm_eventlog_parser_new (buf, bufsz,
 						  FU_TPM_EVENTLOG_PARSER_FLAG_NONE,
+						  self->replay,
 						  error);
 	if (self->items == NULL)
 		return NULL;
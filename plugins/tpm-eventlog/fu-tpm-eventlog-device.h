@@ -14,6 +14,10 @@ G_DECLARE_FINAL_TYPE (FuTpmEventlogDevice, fu_tpm_eventlog_device, FU, TPM_EVENT
 FuTpmEventlogDevice *fu_tpm_eventlog_device_new		(const guint8	*buf,
 							 gsize		 bufsz,
 							 GError		**error);
+gboolean	 fu_tpm_eventlog_device_update		(FuTpmEventlogDevice *self,
+							 const guint8	*buf,
+							 gsize		 bufsz,
+							 GError		**error);
 gchar		*fu_tpm_eventlog_device_report_metadata	(FuTpmEventlogDevice *self);
 GPtrArray	*fu_tpm_eventlog_device_get_checksums	(FuTpmEventlogDevice *self,
 							 guint8		 pcr,
@@ -11,27 +11,6 @@
 
 #include "fu-tpm-eventlog-parser.h"
 
-#define FU_TPM_EVENTLOG_V1_IDX_PCR			0x00
-#define FU_TPM_EVENTLOG_V1_IDX_TYPE			0x04
-#define FU_TPM_EVENTLOG_V1_IDX_DIGEST			0x08
-#define FU_TPM_EVENTLOG_V1_IDX_EVENT_SIZE		0x1c
-#define FU_TPM_EVENTLOG_V1_SIZE				0x20
-
-#define FU_TPM_EVENTLOG_V2_HDR_IDX_SIGNATURE		0x00
-#define FU_TPM_EVENTLOG_V2_HDR_IDX_PLATFORM_CLASS	0x10
-#define FU_TPM_EVENTLOG_V2_HDR_IDX_SPEC_VERSION_MINOR	0x14
-#define FU_TPM_EVENTLOG_V2_HDR_IDX_SPEC_VERSION_MAJOR	0X15
-#define FU_TPM_EVENTLOG_V2_HDR_IDX_SPEC_ERRATA		0x16
-#define FU_TPM_EVENTLOG_V2_HDR_IDX_UINTN_SIZE		0x17
-#define FU_TPM_EVENTLOG_V2_HDR_IDX_NUMBER_OF_ALGS	0x18
-
-#define FU_TPM_EVENTLOG_V2_HDR_SIGNATURE		"Spec ID Event03"
-
-#define FU_TPM_EVENTLOG_V2_IDX_PCR			0x00
-#define FU_TPM_EVENTLOG_V2_IDX_TYPE			0x04
-#define FU_TPM_EVENTLOG_V2_IDX_DIGEST_COUNT		0x08
-#define FU_TPM_EVENTLOG_V2_SIZE				0x0c
-
 static void
 fu_tpm_eventlog_parser_item_free (FuTpmEventlogItem *item)
 {
@@ -70,9 +49,12 @@ fu_tpm_eventlog_item_to_string (FuTpmEventlogItem *item, guint idt, GString *str
 
 static GPtrArray *
 fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
+				      gsize offset,
 				      FuTpmEventlogParserFlags flags,
+				      FuTpmEventlogReplay *replay,
 				      GError **error)
 {
+	gsize idx;
 	guint32 hdrsz = 0x0;
 	g_autoptr(GPtrArray) items = NULL;
 
@@ -82,13 +64,13 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 					 &hdrsz, G_LITTLE_ENDIAN, error))
 		return NULL;
 	items = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_tpm_eventlog_parser_item_free);
-	for (gsize idx = FU_TPM_EVENTLOG_V1_SIZE + hdrsz; idx < bufsz;) {
+	for (idx = MAX (FU_TPM_EVENTLOG_V1_SIZE + hdrsz, offset); idx < bufsz;) {
 		guint32 pcr = 0;
 		guint32 event_type = 0;
 		guint32 digestcnt = 0;
 		guint32 datasz = 0;
-		g_autoptr(GBytes) checksum_sha1 = NULL;
-		g_autoptr(GBytes) checksum_sha256 = NULL;
+		gsize idx_sha1 = G_MAXSIZE;
+		gsize idx_sha256 = G_MAXSIZE;
 
 		/* read entry */
 		if (!fu_common_read_uint32_safe	(buf, bufsz,
@@ -109,7 +91,6 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 		for (guint i = 0; i < digestcnt; i++) {
 			guint16 alg_type = 0;
 			guint32 alg_size = 0;
-			g_autofree guint8 *digest = NULL;
 
 			/* get checksum type */
 			if (!fu_common_read_uint16_safe	(buf, bufsz, idx,
@@ -128,18 +109,21 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 			/* build checksum */
 			idx += sizeof(alg_type);
 
-			/* copy hash */
-			digest = g_malloc0 (alg_size);
-			if (!fu_memcpy_safe (digest, alg_size, 0x0,	/* dst */
-					     buf, bufsz, idx,		/* src */
-					     alg_size, error))
+			/* only copy the hash if the item is going to be saved */
+			if (idx + alg_size > bufsz) {
+				g_set_error (error,
+					     FWUPD_ERROR,
+					     FWUPD_ERROR_READ,
+					     "digest 0x%x truncated at 0x%x",
+					     alg_type, (guint) idx);
 				return NULL;
-
-			/* save this for analysis */
+			}
 			if (alg_type == TPM2_ALG_SHA1)
-				checksum_sha1 = g_bytes_new_take (g_steal_pointer (&digest), alg_size);
+				idx_sha1 = idx;
 			else if (alg_type == TPM2_ALG_SHA256)
-				checksum_sha256 = g_bytes_new_take (g_steal_pointer (&digest), alg_size);
+				idx_sha256 = idx;
+			if (replay != NULL)
+				fu_tpm_eventlog_replay_extend (replay, pcr, alg_type, buf + idx);
 
 			/* next block */
 			idx += alg_size;
@@ -149,7 +133,7 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 		if (!fu_common_read_uint32_safe	(buf, bufsz, idx,
 						 &datasz, G_LITTLE_ENDIAN, error))
 			return NULL;
-		if (datasz > 1024 * 1024) {
+		if (datasz > FU_TPM_EVENTLOG_ITEM_SIZE_MAX) {
 			g_set_error_literal (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_NOT_SUPPORTED,
@@ -180,8 +164,10 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 			item = g_new0 (FuTpmEventlogItem, 1);
 			item->pcr = pcr;
 			item->kind = event_type;
-			item->checksum_sha1 = g_steal_pointer (&checksum_sha1);
-			item->checksum_sha256 = g_steal_pointer (&checksum_sha256);
+			if (idx_sha1 != G_MAXSIZE)
+				item->checksum_sha1 = g_bytes_new (buf + idx_sha1, TPM2_SHA1_DIGEST_SIZE);
+			if (idx_sha256 != G_MAXSIZE)
+				item->checksum_sha256 = g_bytes_new (buf + idx_sha256, TPM2_SHA256_DIGEST_SIZE);
 			item->blob = g_bytes_new_take (g_steal_pointer (&data), datasz);
 			g_ptr_array_add (items, item);
 		}
@@ -191,30 +177,23 @@ fu_tpm_eventlog_parser_parse_blob_v2 (const guint8 *buf, gsize bufsz,
 	}
 
 	/* success */
+	if (replay != NULL)
+		fu_tpm_eventlog_replay_set_offset (replay, buf, idx);
 	return g_steal_pointer (&items);
 }
 
-GPtrArray *
-fu_tpm_eventlog_parser_new (const guint8 *buf, gsize bufsz,
-			    FuTpmEventlogParserFlags flags,
-			    GError **error)
+static GPtrArray *
+fu_tpm_eventlog_parser_parse_blob_v1 (const guint8 *buf, gsize bufsz,
+				      gsize offset,
+				      FuTpmEventlogParserFlags flags,
+				      FuTpmEventlogReplay *replay,
+				      GError **error)
 {
-	gchar sig[] = FU_TPM_EVENTLOG_V2_HDR_SIGNATURE;
+	gsize idx;
 	g_autoptr(GPtrArray) items = NULL;
 
-	g_return_val_if_fail (buf != NULL, NULL);
-
-	/* look for TCG v2 signature */
-	if (!fu_memcpy_safe ((guint8 *) sig, sizeof(sig), 0x0,		/* dst */
-			     buf, bufsz, FU_TPM_EVENTLOG_V1_SIZE,	/* src */
-			     sizeof(sig), error))
-		return NULL;
-	if (g_strcmp0 (sig, FU_TPM_EVENTLOG_V2_HDR_SIGNATURE) == 0)
-		return fu_tpm_eventlog_parser_parse_blob_v2 (buf, bufsz, flags, error);
-
-	/* assume v1 structure */
 	items = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_tpm_eventlog_parser_item_free);
-	for (gsize idx = 0; idx < bufsz; idx += FU_TPM_EVENTLOG_V1_SIZE) {
+	for (idx = offset; idx < bufsz; idx += FU_TPM_EVENTLOG_V1_SIZE) {
 		guint32 datasz = 0;
 		guint32 pcr = 0;
 		guint32 event_type = 0;
@@ -230,13 +209,17 @@ fu_tpm_eventlog_parser_new (const guint8 *buf, gsize bufsz,
 						 idx + FU_TPM_EVENTLOG_V1_IDX_EVENT_SIZE,
 						 &datasz, G_LITTLE_ENDIAN, error))
 			return NULL;
-		if (datasz > 1024 * 1024) {
+		if (datasz > FU_TPM_EVENTLOG_ITEM_SIZE_MAX) {
 			g_set_error_literal (error,
 					     FWUPD_ERROR,
 					     FWUPD_ERROR_NOT_SUPPORTED,
 					     "event log item too large");
 			return NULL;
 		}
+		if (replay != NULL) {
+			fu_tpm_eventlog_replay_extend (replay, pcr, TPM2_ALG_SHA1,
+						       buf + idx + FU_TPM_EVENTLOG_V1_IDX_DIGEST);
+		}
 		if (pcr == ESYS_TR_PCR0 ||
 		    flags & FU_TPM_EVENTLOG_PARSER_FLAG_ALL_PCRS) {
 			FuTpmEventlogItem *item;
@@ -268,6 +251,53 @@ fu_tpm_eventlog_parser_new (const guint8 *buf, gsize bufsz,
 		}
 		idx += datasz;
 	}
+
+	/* success */
+	if (replay != NULL)
+		fu_tpm_eventlog_replay_set_offset (replay, buf, idx);
 	return g_steal_pointer (&items);
+}
 
+/* if @replay is set, every digest of every PCR is extended into it while the
+ * log is being walked, so the PCRs can be reconstructed without a second pass;
+ * if @replay has already seen the start of this log then only the events that
+ * were appended since are parsed and returned */
+GPtrArray *
+fu_tpm_eventlog_parser_new (const guint8 *buf, gsize bufsz,
+			    FuTpmEventlogParserFlags flags,
+			    FuTpmEventlogReplay *replay,
+			    GError **error)
+{
+	gchar sig[] = FU_TPM_EVENTLOG_V2_HDR_SIGNATURE;
+	gsize offset = 0;
+	g_autoptr(GPtrArray) items = NULL;
+
+	g_return_val_if_fail (buf != NULL, NULL);
+
+	/* look for TCG v2 signature */
+	if (!fu_memcpy_safe ((guint8 *) sig, sizeof(sig), 0x0,		/* dst */
+			     buf, bufsz, FU_TPM_EVENTLOG_V1_SIZE,	/* src */
+			     sizeof(sig), error))
+		return NULL;
+
+	/* resume unless the log was truncated or replaced */
+	if (replay != NULL) {
+		if (!fu_tpm_eventlog_replay_check_log (replay, buf, bufsz)) {
+			g_debug ("event log changed, replaying from the start");
+			fu_tpm_eventlog_replay_reset (replay);
+		}
+		offset = fu_tpm_eventlog_replay_get_offset (replay);
+	}
+	if (g_strcmp0 (sig, FU_TPM_EVENTLOG_V2_HDR_SIGNATURE) == 0) {
+		items = fu_tpm_eventlog_parser_parse_blob_v2 (buf, bufsz, offset,
+							      flags, replay, error);
+	} else {
+		items = fu_tpm_eventlog_parser_parse_blob_v1 (buf, bufsz, offset,
+							      flags, replay, error);
+	}
+
+	/* the PCRs were partly extended by the invalid event */
+	if (items == NULL && replay != NULL)
+		fu_tpm_eventlog_replay_reset (replay);
+	return g_steal_pointer (&items);
 }
@@ -9,6 +9,7 @@
 #include <fwupdplugin.h>
 
 #include "fu-tpm-eventlog-common.h"
+#include "fu-tpm-eventlog-replay.h"
 
 typedef enum {
 	FU_TPM_EVENTLOG_PARSER_FLAG_NONE		= 0,
@@ -19,6 +20,7 @@ typedef enum {
 GPtrArray	*fu_tpm_eventlog_parser_new	(const guint8	*buf,
 						 gsize		 bufsz,
 						 FuTpmEventlogParserFlags flags,
+						 FuTpmEventlogReplay *replay,
 						 GError		**error);
 void		 fu_tpm_eventlog_item_to_string	(FuTpmEventlogItem *item,
 						 guint		 idt,
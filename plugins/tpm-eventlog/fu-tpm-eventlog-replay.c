@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2021 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "fu-tpm-eventlog-replay.h"
+
+#define FU_TPM_EVENTLOG_REPLAY_CHECK_SIZE	64
+
+typedef enum {
+	FU_TPM_EVENTLOG_REPLAY_BANK_SHA1,
+	FU_TPM_EVENTLOG_REPLAY_BANK_SHA256,
+	FU_TPM_EVENTLOG_REPLAY_BANK_SHA384,
+	FU_TPM_EVENTLOG_REPLAY_BANK_LAST
+} FuTpmEventlogReplayBank;
+
+/*
+ * Replays the measurements of a TCG event log into all PCRs and all the
+ * supported hash banks, extended by the parser as it walks the log.
+ *
+ * The event log only ever grows, so the offset of the first unprocessed event
+ * is saved along with the bytes either side of it, and parsing the same log
+ * again resumes from there rather than from the beginning.
+ */
+struct _FuTpmEventlogReplay {
+	GObject			 parent_instance;
+	gsize			 offset;
+	guint8			 head[FU_TPM_EVENTLOG_REPLAY_CHECK_SIZE];
+	gsize			 headsz;
+	guint8			 tail[FU_TPM_EVENTLOG_REPLAY_CHECK_SIZE];
+	gsize			 tailsz;
+	GChecksum		*csums[FU_TPM_EVENTLOG_REPLAY_BANK_LAST];
+	guint32			 extended[FU_TPM_EVENTLOG_REPLAY_BANK_LAST];
+	guint8			 digests[FU_TPM_EVENTLOG_REPLAY_BANK_LAST]
+					[FU_TPM_EVENTLOG_REPLAY_PCR_MAX]
+					[TPM2_SHA384_DIGEST_SIZE];
+};
+
+G_DEFINE_TYPE (FuTpmEventlogReplay, fu_tpm_eventlog_replay, G_TYPE_OBJECT)
+
+static FuTpmEventlogReplayBank
+fu_tpm_eventlog_replay_bank_from_hash_kind (TPM2_ALG_ID hash_kind)
+{
+	if (hash_kind == TPM2_ALG_SHA1)
+		return FU_TPM_EVENTLOG_REPLAY_BANK_SHA1;
+	if (hash_kind == TPM2_ALG_SHA256)
+		return FU_TPM_EVENTLOG_REPLAY_BANK_SHA256;
+	if (hash_kind == TPM2_ALG_SHA384)
+		return FU_TPM_EVENTLOG_REPLAY_BANK_SHA384;
+	return FU_TPM_EVENTLOG_REPLAY_BANK_LAST;
+}
+
+/**
+ * fu_tpm_eventlog_replay_extend:
+ * @self: a #FuTpmEventlogReplay
+ * @pcr: PCR index
+ * @hash_kind: hash algorithm, e.g. %TPM2_ALG_SHA256
+ * @digest: the event digest, of the size used by @hash_kind
+ *
+ * Extends a PCR in one bank, i.e. new = HASH(old || digest), reusing the same
+ * #GChecksum for every event. Unsupported banks and PCRs are ignored.
+ **/
+void
+fu_tpm_eventlog_replay_extend (FuTpmEventlogReplay *self,
+			       guint32 pcr,
+			       TPM2_ALG_ID hash_kind,
+			       const guint8 *digest)
+{
+	FuTpmEventlogReplayBank bank = fu_tpm_eventlog_replay_bank_from_hash_kind (hash_kind);
+	gsize digestsz = fu_tpm_eventlog_hash_get_size (hash_kind);
+	GChecksum *csum;
+
+	g_return_if_fail (FU_IS_TPM_EVENTLOG_REPLAY (self));
+	g_return_if_fail (digest != NULL);
+
+	/* not a real PCR, or bank not supported by GLib */
+	if (bank == FU_TPM_EVENTLOG_REPLAY_BANK_LAST)
+		return;
+	csum = self->csums[bank];
+	if (pcr >= FU_TPM_EVENTLOG_REPLAY_PCR_MAX || csum == NULL)
+		return;
+	g_checksum_reset (csum);
+	g_checksum_update (csum, self->digests[bank][pcr], digestsz);
+	g_checksum_update (csum, digest, digestsz);
+	g_checksum_get_digest (csum, self->digests[bank][pcr], &digestsz);
+	self->extended[bank] |= 1u << pcr;
+}
+
+/**
+ * fu_tpm_eventlog_replay_reset:
+ * @self: a #FuTpmEventlogReplay
+ *
+ * Sets all the PCRs back to zero so the log can be replayed from the start.
+ **/
+void
+fu_tpm_eventlog_replay_reset (FuTpmEventlogReplay *self)
+{
+	g_return_if_fail (FU_IS_TPM_EVENTLOG_REPLAY (self));
+	self->offset = 0;
+	self->headsz = 0;
+	self->tailsz = 0;
+	memset (self->extended, 0x0, sizeof(self->extended));
+	memset (self->digests, 0x0, sizeof(self->digests));
+}
+
+/**
+ * fu_tpm_eventlog_replay_get_offset:
+ * @self: a #FuTpmEventlogReplay
+ *
+ * Gets the offset of the first event that has not yet been replayed.
+ *
+ * Returns: offset in bytes
+ **/
+gsize
+fu_tpm_eventlog_replay_get_offset (FuTpmEventlogReplay *self)
+{
+	g_return_val_if_fail (FU_IS_TPM_EVENTLOG_REPLAY (self), 0);
+	return self->offset;
+}
+
+/**
+ * fu_tpm_eventlog_replay_set_offset:
+ * @self: a #FuTpmEventlogReplay
+ * @buf: the event log
+ * @offset: offset of the first event that has not yet been replayed
+ *
+ * Saves how much of @buf has been replayed, and enough of the data to detect
+ * if the log is later truncated or replaced.
+ **/
+void
+fu_tpm_eventlog_replay_set_offset (FuTpmEventlogReplay *self, const guint8 *buf, gsize offset)
+{
+	g_return_if_fail (FU_IS_TPM_EVENTLOG_REPLAY (self));
+	g_return_if_fail (buf != NULL);
+	self->offset = offset;
+	self->headsz = MIN (offset, sizeof(self->head));
+	memcpy (self->head, buf, self->headsz);
+	self->tailsz = MIN (offset, sizeof(self->tail));
+	memcpy (self->tail, buf + offset - self->tailsz, self->tailsz);
+}
+
+/**
+ * fu_tpm_eventlog_replay_check_log:
+ * @self: a #FuTpmEventlogReplay
+ * @buf: the event log
+ * @bufsz: size of @buf
+ *
+ * Checks if @buf is the log that has already been replayed, possibly with
+ * more events appended, so that it is safe to resume from the saved offset.
+ *
+ * Returns: %FALSE if the log was truncated or replaced
+ **/
+gboolean
+fu_tpm_eventlog_replay_check_log (FuTpmEventlogReplay *self, const guint8 *buf, gsize bufsz)
+{
+	g_return_val_if_fail (FU_IS_TPM_EVENTLOG_REPLAY (self), FALSE);
+	g_return_val_if_fail (buf != NULL, FALSE);
+
+	/* nothing replayed yet */
+	if (self->offset == 0)
+		return TRUE;
+	if (bufsz < self->offset)
+		return FALSE;
+	if (memcmp (buf, self->head, self->headsz) != 0)
+		return FALSE;
+	if (memcmp (buf + self->offset - self->tailsz, self->tail, self->tailsz) != 0)
+		return FALSE;
+	return TRUE;
+}
+
+/**
+ * fu_tpm_eventlog_replay_get_pcr_mask:
+ * @self: a #FuTpmEventlogReplay
+ *
+ * Gets the PCRs that have been extended in any bank.
+ *
+ * Returns: bitmask, where bit 0 is PCR0
+ **/
+guint32
+fu_tpm_eventlog_replay_get_pcr_mask (FuTpmEventlogReplay *self)
+{
+	guint32 mask = 0;
+	g_return_val_if_fail (FU_IS_TPM_EVENTLOG_REPLAY (self), 0);
+	for (guint i = 0; i < FU_TPM_EVENTLOG_REPLAY_BANK_LAST; i++)
+		mask |= self->extended[i];
+	return mask;
+}
+
+/**
+ * fu_tpm_eventlog_replay_get_digest:
+ * @self: a #FuTpmEventlogReplay
+ * @pcr: PCR index
+ * @hash_kind: hash algorithm, e.g. %TPM2_ALG_SHA384
+ * @digestsz: (out) (optional): size of the digest
+ *
+ * Gets the reconstructed raw PCR value for a specific bank.
+ *
+ * Returns: digest, or %NULL if the PCR was never extended in this bank
+ **/
+const guint8 *
+fu_tpm_eventlog_replay_get_digest (FuTpmEventlogReplay *self,
+				   guint8 pcr,
+				   TPM2_ALG_ID hash_kind,
+				   gsize *digestsz)
+{
+	FuTpmEventlogReplayBank bank = fu_tpm_eventlog_replay_bank_from_hash_kind (hash_kind);
+
+	g_return_val_if_fail (FU_IS_TPM_EVENTLOG_REPLAY (self), NULL);
+
+	if (bank == FU_TPM_EVENTLOG_REPLAY_BANK_LAST)
+		return NULL;
+	if (pcr >= FU_TPM_EVENTLOG_REPLAY_PCR_MAX)
+		return NULL;
+	if ((self->extended[bank] & (1u << pcr)) == 0)
+		return NULL;
+	if (digestsz != NULL)
+		*digestsz = fu_tpm_eventlog_hash_get_size (hash_kind);
+	return self->digests[bank][pcr];
+}
+
+/**
+ * fu_tpm_eventlog_replay_get_checksums:
+ * @self: a #FuTpmEventlogReplay
+ * @pcr: PCR index
+ * @error: (nullable): optional return location for an error
+ *
+ * Gets the reconstructed SHA1 and SHA256 PCR values as hex strings.
+ *
+ * Returns: (transfer container) (element-type utf8): checksums, or %NULL
+ **/
+GPtrArray *
+fu_tpm_eventlog_replay_get_checksums (FuTpmEventlogReplay *self, guint8 pcr, GError **error)
+{
+	const TPM2_ALG_ID hash_kinds[] = { TPM2_ALG_SHA1, TPM2_ALG_SHA256 };
+	g_autoptr(GPtrArray) csums = g_ptr_array_new_with_free_func (g_free);
+
+	g_return_val_if_fail (FU_IS_TPM_EVENTLOG_REPLAY (self), NULL);
+	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
+
+	/* sanity check */
+	if (fu_tpm_eventlog_replay_get_pcr_mask (self) == 0) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "no event log data");
+		return NULL;
+	}
+	for (guint i = 0; i < G_N_ELEMENTS (hash_kinds); i++) {
+		gsize digestsz = 0;
+		const guint8 *digest;
+		g_autoptr(GBytes) blob = NULL;
+
+		digest = fu_tpm_eventlog_replay_get_digest (self, pcr, hash_kinds[i], &digestsz);
+		if (digest == NULL)
+			continue;
+		blob = g_bytes_new_static (digest, digestsz);
+		g_ptr_array_add (csums, fu_tpm_eventlog_strhex (blob));
+	}
+	if (csums->len == 0) {
+		g_set_error_literal (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_INVALID_DATA,
+				     "no SHA1 or SHA256 data");
+		return NULL;
+	}
+	return g_steal_pointer (&csums);
+}
+
+static void
+fu_tpm_eventlog_replay_init (FuTpmEventlogReplay *self)
+{
+	self->csums[FU_TPM_EVENTLOG_REPLAY_BANK_SHA1] = g_checksum_new (G_CHECKSUM_SHA1);
+	self->csums[FU_TPM_EVENTLOG_REPLAY_BANK_SHA256] = g_checksum_new (G_CHECKSUM_SHA256);
+#if GLIB_CHECK_VERSION(2,51,0)
+	self->csums[FU_TPM_EVENTLOG_REPLAY_BANK_SHA384] = g_checksum_new (G_CHECKSUM_SHA384);
+#endif
+}
+
+static void
+fu_tpm_eventlog_replay_finalize (GObject *object)
+{
+	FuTpmEventlogReplay *self = FU_TPM_EVENTLOG_REPLAY (object);
+
+	for (guint i = 0; i < FU_TPM_EVENTLOG_REPLAY_BANK_LAST; i++) {
+		if (self->csums[i] != NULL)
+			g_checksum_free (self->csums[i]);
+	}
+
+	G_OBJECT_CLASS (fu_tpm_eventlog_replay_parent_class)->finalize (object);
+}
+
+static void
+fu_tpm_eventlog_replay_class_init (FuTpmEventlogReplayClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+	object_class->finalize = fu_tpm_eventlog_replay_finalize;
+}
+
+/**
+ * fu_tpm_eventlog_replay_new:
+ *
+ * Creates a new PCR replay engine with all PCRs set to zero.
+ *
+ * Returns: a #FuTpmEventlogReplay
+ **/
+FuTpmEventlogReplay *
+fu_tpm_eventlog_replay_new (void)
+{
+	return g_object_new (FU_TYPE_TPM_EVENTLOG_REPLAY, NULL);
+}
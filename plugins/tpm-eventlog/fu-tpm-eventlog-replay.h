@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2021 Richard Hughes <richard@hughsie.com>
+ *
+ * SPDX-License-Identifier: LGPL-2.1+
+ */
+
+#pragma once
+
+#include <fwupdplugin.h>
+
+#include "fu-tpm-eventlog-common.h"
+
+#define FU_TPM_EVENTLOG_REPLAY_PCR_MAX		24
+
+#define FU_TYPE_TPM_EVENTLOG_REPLAY (fu_tpm_eventlog_replay_get_type ())
+G_DECLARE_FINAL_TYPE (FuTpmEventlogReplay, fu_tpm_eventlog_replay, FU, TPM_EVENTLOG_REPLAY, GObject)
+
+FuTpmEventlogReplay *fu_tpm_eventlog_replay_new	(void);
+void		 fu_tpm_eventlog_replay_reset		(FuTpmEventlogReplay *self);
+gsize		 fu_tpm_eventlog_replay_get_offset	(FuTpmEventlogReplay *self);
+void		 fu_tpm_eventlog_replay_set_offset	(FuTpmEventlogReplay *self,
+							 const guint8	*buf,
+							 gsize		 offset);
+gboolean	 fu_tpm_eventlog_replay_check_log	(FuTpmEventlogReplay *self,
+							 const guint8	*buf,
+							 gsize		 bufsz);
+void		 fu_tpm_eventlog_replay_extend		(FuTpmEventlogReplay *self,
+							 guint32	 pcr,
+							 TPM2_ALG_ID	 hash_kind,
+							 const guint8	*digest);
+guint32		 fu_tpm_eventlog_replay_get_pcr_mask	(FuTpmEventlogReplay *self);
+const guint8	*fu_tpm_eventlog_replay_get_digest	(FuTpmEventlogReplay *self,
+							 guint8		 pcr,
+							 TPM2_ALG_ID	 hash_kind,
+							 gsize		*digestsz);
+GPtrArray	*fu_tpm_eventlog_replay_get_checksums	(FuTpmEventlogReplay *self,
+							 guint8		 pcr,
+							 GError		**error);
@@ -16,6 +16,7 @@
 #include <unistd.h>
 
 #include "fu-tpm-eventlog-parser.h"
+#include "fu-tpm-eventlog-replay.h"
 
 static gint
 fu_tmp_eventlog_sort_cb (gconstpointer a, gconstpointer b)
@@ -34,6 +35,7 @@ fu_tmp_eventlog_process (const gchar *fn, gint pcr, GError **error)
 {
 	gsize bufsz = 0;
 	g_autofree guint8 *buf = NULL;
+	g_autoptr(FuTpmEventlogReplay) replay = fu_tpm_eventlog_replay_new ();
 	g_autoptr(GPtrArray) items = NULL;
 	g_autoptr(GString) str = g_string_new (NULL);
 	gint max_pcr = 0;
@@ -43,6 +45,7 @@ fu_tmp_eventlog_process (const gchar *fn, gint pcr, GError **error)
 		return FALSE;
 	items = fu_tpm_eventlog_parser_new (buf, bufsz,
 					    FU_TPM_EVENTLOG_PARSER_FLAG_ALL_PCRS,
+					    replay,
 					    error);
 	if (items == NULL)
 		return FALSE;
@@ -64,7 +67,7 @@ fu_tmp_eventlog_process (const gchar *fn, gint pcr, GError **error)
 	}
 	fu_common_string_append_kv (str, 0, "Reconstructed PCRs", NULL);
 	for (guint8 i = 0; i <= max_pcr; i++) {
-		g_autoptr(GPtrArray) pcrs = fu_tpm_eventlog_calc_checksums (items, i, NULL);
+		g_autoptr(GPtrArray) pcrs = fu_tpm_eventlog_replay_get_checksums (replay, i, NULL);
 		if (pcrs == NULL)
 			continue;
 		for (guint j = 0; j < pcrs->len; j++) {
@@ -18,6 +18,9 @@
 #include <sys/utsname.h>
 #endif
 #include <errno.h>
+#ifdef HAVE_MALLOC_H
+#include <malloc.h>
+#endif
 
 #include "fwupd-common-private.h"
 #include "fwupd-enums-private.h"
@@ -80,6 +83,9 @@
 
 static void fu_engine_finalize	 (GObject *obj);
 static void fu_engine_ensure_security_attrs	(FuEngine *self);
+static void fu_engine_md_refresh_devices_flush	(FuEngine *self);
+static void fu_engine_md_refresh_devices_queue	(FuEngine *self,
+						 XbSilo *silo_old);
 
 struct _FuEngine
 {
@@ -108,8 +114,22 @@ struct _FuEngine
 	gboolean		 loaded;
 	gchar			*host_security_id;
 	FuSecurityAttrs		*host_security_attrs;
+	GHashTable		*host_security_cache;	/* contributor-id:FuEngineSecurityItem */
+	GHashTable		*requirement_cache;	/* key:FuEngineRequirementResult */
+	guint			 requirement_cache_hits;
+	guint			 requirement_cache_misses;
+	guint			 md_refresh_id;
+	gboolean		 md_refresh_all;
+	GHashTable		*md_refresh_guids;	/* guid set */
 };
 
+typedef struct {
+	FuSecurityAttrs		*attrs;
+	FuSecurityAttrsInput	 inputs;
+	gboolean		 valid;
+	guint64			 elapsed;	/* µs */
+} FuEngineSecurityItem;
+
 enum {
 	SIGNAL_CHANGED,
 	SIGNAL_DEVICE_ADDED,
@@ -140,11 +160,52 @@ fu_engine_emit_changed (FuEngine *self)
 	}
 }
 
+static void
+fu_engine_security_item_free (FuEngineSecurityItem *item)
+{
+	g_object_unref (item->attrs);
+	g_free (item);
+}
+
+static gchar *
+fu_engine_security_item_id_for_device (FuDevice *device)
+{
+	return g_strdup_printf ("device:%s", fu_device_get_id (device));
+}
+
+/* only the contributors that depend on the changed inputs get recalculated */
+static void
+fu_engine_invalidate_security_attrs (FuEngine *self, FuSecurityAttrsInput inputs)
+{
+	GHashTableIter iter;
+	gpointer value;
+
+	g_hash_table_iter_init (&iter, self->host_security_cache);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		FuEngineSecurityItem *item = (FuEngineSecurityItem *) value;
+		if (item->inputs & inputs)
+			item->valid = FALSE;
+	}
+	g_clear_pointer (&self->host_security_id, g_free);
+}
+
+static void
+fu_engine_invalidate_security_attrs_for_device (FuEngine *self, FuDevice *device)
+{
+	FuEngineSecurityItem *item;
+	g_autofree gchar *id = fu_engine_security_item_id_for_device (device);
+
+	item = g_hash_table_lookup (self->host_security_cache, id);
+	if (item != NULL)
+		item->valid = FALSE;
+	fu_engine_invalidate_security_attrs (self, FU_SECURITY_ATTRS_INPUT_DEVICES);
+}
+
 static void
 fu_engine_emit_device_changed (FuEngine *self, FuDevice *device)
 {
 	/* invalidate host security attributes */
-	g_clear_pointer (&self->host_security_id, g_free);
+	fu_engine_invalidate_security_attrs_for_device (self, device);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_CHANGED], 0, device);
 }
 
@@ -255,6 +316,8 @@ fu_engine_device_added_cb (FuDeviceList *device_list, FuDevice *device, FuEngine
 {
 	fu_engine_watch_device (self, device);
 	fu_engine_ensure_device_battery_inhibit (self, device);
+	fu_engine_invalidate_security_attrs (self, FU_SECURITY_ATTRS_INPUT_DEVICES);
+	g_hash_table_remove_all (self->requirement_cache);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_ADDED], 0, device);
 }
 
@@ -271,7 +334,12 @@ fu_engine_device_runner_device_removed (FuEngine *self, FuDevice *device)
 static void
 fu_engine_device_removed_cb (FuDeviceList *device_list, FuDevice *device, FuEngine *self)
 {
+	g_autofree gchar *id = fu_engine_security_item_id_for_device (device);
+
 	fu_engine_device_runner_device_removed (self, device);
+	g_hash_table_remove (self->host_security_cache, id);
+	fu_engine_invalidate_security_attrs (self, FU_SECURITY_ATTRS_INPUT_DEVICES);
+	g_hash_table_remove_all (self->requirement_cache);
 	g_signal_handlers_disconnect_by_data (device, self);
 	g_signal_emit (self, signals[SIGNAL_DEVICE_REMOVED], 0, device);
 }
@@ -280,6 +348,7 @@ static void
 fu_engine_device_changed_cb (FuDeviceList *device_list, FuDevice *device, FuEngine *self)
 {
 	fu_engine_watch_device (self, device);
+	g_hash_table_remove_all (self->requirement_cache);
 	fu_engine_emit_device_changed (self, device);
 }
 
@@ -1594,12 +1663,12 @@ fu_engine_check_requirement_client (FuEngine *self,
 }
 
 static gboolean
-fu_engine_check_requirement (FuEngine *self,
-			     FuEngineRequest *request,
-			     XbNode *req,
-			     FuDevice *device,
-			     FwupdInstallFlags flags,
-			     GError **error)
+fu_engine_check_requirement_uncached (FuEngine *self,
+				      FuEngineRequest *request,
+				      XbNode *req,
+				      FuDevice *device,
+				      FwupdInstallFlags flags,
+				      GError **error)
 {
 	/* ensure component requirement */
 	if (g_strcmp0 (xb_node_get_element (req), "id") == 0)
@@ -1630,6 +1699,129 @@ fu_engine_check_requirement (FuEngine *self,
 	return FALSE;
 }
 
+typedef struct {
+	gboolean	 ret;
+	GError		*error;		/* (nullable) */
+} FuEngineRequirementResult;
+
+static void
+fu_engine_requirement_result_free (FuEngineRequirementResult *result)
+{
+	if (result->error != NULL)
+		g_error_free (result->error);
+	g_free (result);
+}
+
+/* returns %NULL if the outcome depends on more than the requirement and device */
+static gchar *
+fu_engine_requirement_cache_key (FuEngineRequest *request,
+				 XbNode *req,
+				 FuDevice *device,
+				 FwupdInstallFlags flags)
+{
+	const gchar *element = xb_node_get_element (req);
+	const gchar *text = xb_node_get_text (req);
+	const gchar *compare = xb_node_get_attr (req, "compare");
+	const gchar *version = xb_node_get_attr (req, "version");
+	GString *str;
+
+	/* parents, siblings, children and other devices can change at any time */
+	if (g_strcmp0 (element, "firmware") == 0) {
+		if (device == NULL)
+			return NULL;
+		if (xb_node_get_attr (req, "depth") != NULL)
+			return NULL;
+		if (text != NULL &&
+		    g_strcmp0 (text, "bootloader") != 0 &&
+		    g_strcmp0 (text, "vendor-id") != 0)
+			return NULL;
+	}
+
+	str = g_string_new (element);
+	g_string_append_printf (str, "|%s|%s|%s",
+				text != NULL ? text : "",
+				compare != NULL ? compare : "",
+				version != NULL ? version : "");
+	if (g_strcmp0 (element, "firmware") == 0) {
+		const gchar *version_device = fu_device_get_version (device);
+		const gchar *version_bootloader = fu_device_get_version_bootloader (device);
+		g_string_append_printf (str, "|%s|%s|%s|%u",
+					fu_device_get_id (device),
+					version_device != NULL ? version_device : "",
+					version_bootloader != NULL ? version_bootloader : "",
+					(flags & FWUPD_INSTALL_FLAG_IGNORE_VID_PID) > 0);
+		if (g_strcmp0 (text, "vendor-id") == 0) {
+			GPtrArray *vendor_ids = fu_device_get_vendor_ids (device);
+			for (guint i = 0; i < vendor_ids->len; i++)
+				g_string_append_printf (str, "|%s", (const gchar *) g_ptr_array_index (vendor_ids, i));
+		}
+	}
+	if (g_strcmp0 (element, "client") == 0) {
+		g_string_append_printf (str, "|%" G_GUINT64_FORMAT,
+					(guint64) fu_engine_request_get_feature_flags (request));
+	}
+	return g_string_free (str, FALSE);
+}
+
+static gboolean
+fu_engine_check_requirement (FuEngine *self,
+			     FuEngineRequest *request,
+			     XbNode *req,
+			     FuDevice *device,
+			     FwupdInstallFlags flags,
+			     GError **error)
+{
+	FuEngineRequirementResult *result;
+	g_autofree gchar *key = NULL;
+	g_autoptr(GError) error_local = NULL;
+
+	/* the same requirement is shared by many releases and components */
+	key = fu_engine_requirement_cache_key (request, req, device, flags);
+	if (key == NULL)
+		return fu_engine_check_requirement_uncached (self, request, req, device, flags, error);
+	result = g_hash_table_lookup (self->requirement_cache, key);
+	if (result != NULL) {
+		self->requirement_cache_hits++;
+		if (!result->ret) {
+			g_propagate_error (error, g_error_copy (result->error));
+			return FALSE;
+		}
+		return TRUE;
+	}
+	self->requirement_cache_misses++;
+
+	/* save for next time */
+	result = g_new0 (FuEngineRequirementResult, 1);
+	result->ret = fu_engine_check_requirement_uncached (self, request, req, device,
+							    flags, &error_local);
+	if (!result->ret)
+		result->error = g_error_copy (error_local);
+	g_hash_table_insert (self->requirement_cache, g_steal_pointer (&key), result);
+	if (!result->ret) {
+		g_propagate_error (error, g_steal_pointer (&error_local));
+		return FALSE;
+	}
+	return TRUE;
+}
+
+/**
+ * fu_engine_get_requirement_cache_stats:
+ * @self: a #FuEngine
+ * @hits: (out) (optional): number of requirements answered from the cache
+ * @misses: (out) (optional): number of requirements that had to be evaluated
+ *
+ * Gets how effective the requirement cache has been.
+ **/
+void
+fu_engine_get_requirement_cache_stats (FuEngine *self, guint *hits, guint *misses)
+{
+	g_return_if_fail (FU_IS_ENGINE (self));
+	if (hits != NULL)
+		*hits = self->requirement_cache_hits;
+	if (misses != NULL)
+		*misses = self->requirement_cache_misses;
+}
+
 gboolean
 fu_engine_check_trust (FuInstallTask *task, GError **error)
 {
@@ -2661,6 +2853,23 @@ fu_engine_get_plugins (FuEngine *self)
 	return fu_plugin_list_get_all (self->plugin_list);
 }
 
+/**
+ * fu_engine_get_plugin_levels:
+ * @self: a #FuEngine
+ *
+ * Gets the plugins grouped into levels by the depsolved rules.
+ *
+ * Returns: (transfer none) (element-type GPtrArray): the levels
+ *
+ * Since: 1.6.2
+ **/
+GPtrArray *
+fu_engine_get_plugin_levels (FuEngine *self)
+{
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+	return fu_plugin_list_get_levels (self->plugin_list);
+}
+
 /**
  * fu_engine_get_device:
  * @self: a #FuEngine
@@ -2678,6 +2887,9 @@ fu_engine_get_device (FuEngine *self, const gchar *device_id, GError **error)
 	g_autoptr(FuDevice) device2 = NULL;
 	g_autoptr(FuDevice) root = NULL;
 
+	/* apply any pending metadata changes */
+	fu_engine_md_refresh_devices_flush (self);
+
 	/* find device */
 	device1 = fu_device_list_get_by_id (self->device_list, device_id, error);
 	if (device1 == NULL)
@@ -3179,9 +3391,18 @@ fu_engine_get_item_by_id_fallback_history (FuEngine *self, const gchar *id, GErr
 void
 fu_engine_set_silo (FuEngine *self, XbSilo *silo)
 {
+	g_autoptr(XbSilo) silo_old = NULL;
+
 	g_return_if_fail (FU_IS_ENGINE (self));
 	g_return_if_fail (XB_IS_SILO (silo));
+	g_hash_table_remove_all (self->requirement_cache);
+
+	/* replacing the metadata refreshes devices like an update would */
+	if (self->silo != NULL)
+		silo_old = g_object_ref (self->silo);
 	g_set_object (&self->silo, silo);
+	if (silo_old != NULL)
+		fu_engine_md_refresh_devices_queue (self, silo_old);
 }
 
 static gboolean
@@ -3489,20 +3710,217 @@ fu_engine_md_refresh_device_from_component (FuEngine *self, FuDevice *device, Xb
 		fu_engine_md_refresh_device_verfmt (self, device, component);
 }
 
+static void
+fu_engine_md_refresh_device (FuEngine *self, FuDevice *device)
+{
+	g_autoptr(XbNode) component = fu_engine_get_component_by_guids (self, device);
+
+	/* set or clear the SUPPORTED flag */
+	fu_engine_ensure_device_supported (self, device);
+
+	/* fixup the name and format as needed */
+	fu_engine_md_refresh_device_from_component (self, device, component);
+}
+
 static void
 fu_engine_md_refresh_devices (FuEngine *self)
 {
 	g_autoptr(GPtrArray) devices = fu_device_list_get_all (self->device_list);
 	for (guint i = 0; i < devices->len; i++) {
 		FuDevice *device = g_ptr_array_index (devices, i);
-		g_autoptr(XbNode) component = fu_engine_get_component_by_guids (self, device);
+		fu_engine_md_refresh_device (self, device);
+	}
+}
 
-		/* set or clear the SUPPORTED flag */
-		fu_engine_ensure_device_supported (self, device);
+static gboolean
+fu_engine_md_device_has_refresh_guid (FuEngine *self, FuDevice *device)
+{
+	GPtrArray *guids = fu_device_get_guids (device);
+	for (guint i = 0; i < guids->len; i++) {
+		const gchar *guid = g_ptr_array_index (guids, i);
+		if (g_hash_table_contains (self->md_refresh_guids, guid))
+			return TRUE;
+	}
+	return FALSE;
+}
 
-		/* fixup the name and format as needed */
-		fu_engine_md_refresh_device_from_component (self, device, component);
+/* run any refresh that was queued, so callers never see stale devices */
+static void
+fu_engine_md_refresh_devices_flush (FuEngine *self)
+{
+	guint cnt = 0;
+	g_autoptr(GPtrArray) devices = NULL;
+
+	if (self->md_refresh_id == 0)
+		return;
+	g_source_remove (self->md_refresh_id);
+	self->md_refresh_id = 0;
+
+	devices = fu_device_list_get_all (self->device_list);
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		if (!self->md_refresh_all &&
+		    !fu_engine_md_device_has_refresh_guid (self, device))
+			continue;
+		fu_engine_md_refresh_device (self, device);
+		cnt++;
 	}
+	g_debug ("refreshed %u of %u devices from metadata", cnt, devices->len);
+	g_hash_table_remove_all (self->md_refresh_guids);
+	self->md_refresh_all = FALSE;
+}
+
+static gboolean
+fu_engine_md_refresh_devices_cb (gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	fu_engine_md_refresh_devices_flush (self);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fu_engine_md_digest_append (GString *str, const gchar *value)
+{
+	if (value != NULL)
+		g_string_append (str, value);
+	g_string_append_c (str, '\n');
+}
+
+/* only the parts of the component the device refresh uses, as exporting
+ * the whole thing would include every translated description */
+static void
+fu_engine_md_component_digest_append (GString *str, XbNode *component)
+{
+	g_autoptr(GPtrArray) children = xb_node_get_children (component);
+	for (guint i = 0; i < children->len; i++) {
+		XbNode *n = g_ptr_array_index (children, i);
+		const gchar *element = xb_node_get_element (n);
+		g_autoptr(GPtrArray) values = NULL;
+
+		if (g_strcmp0 (element, "name") == 0 ||
+		    g_strcmp0 (element, "icon") == 0) {
+			fu_engine_md_digest_append (str, element);
+			fu_engine_md_digest_append (str, xb_node_get_text (n));
+			continue;
+		}
+		if (g_strcmp0 (element, "categories") != 0 &&
+		    g_strcmp0 (element, "X-categories") != 0 &&
+		    g_strcmp0 (element, "custom") != 0 &&
+		    g_strcmp0 (element, "requires") != 0 &&
+		    g_strcmp0 (element, "releases") != 0)
+			continue;
+		values = xb_node_get_children (n);
+		for (guint j = 0; j < values->len; j++) {
+			XbNode *value = g_ptr_array_index (values, j);
+			fu_engine_md_digest_append (str, xb_node_get_element (value));
+			fu_engine_md_digest_append (str, xb_node_get_attr (value, "key"));
+			fu_engine_md_digest_append (str, xb_node_get_attr (value, "compare"));
+			fu_engine_md_digest_append (str, xb_node_get_attr (value, "version"));
+
+			/* a release is identified by its checksums */
+			if (g_strcmp0 (element, "releases") == 0) {
+				g_autoptr(GPtrArray) csums = xb_node_get_children (value);
+				for (guint k = 0; k < csums->len; k++) {
+					XbNode *csum = g_ptr_array_index (csums, k);
+					if (g_strcmp0 (xb_node_get_element (csum), "checksum") != 0)
+						continue;
+					fu_engine_md_digest_append (str, xb_node_get_text (csum));
+				}
+				continue;
+			}
+			fu_engine_md_digest_append (str, xb_node_get_text (value));
+		}
+	}
+}
+
+/* a checksum of every component that provides the GUID */
+static gchar *
+fu_engine_md_get_guid_digest (XbSilo *silo, XbQuery *query, const gchar *guid)
+{
+	g_autoptr(GPtrArray) components = NULL;
+	g_autoptr(GString) str = g_string_new (NULL);
+#if LIBXMLB_CHECK_VERSION(0,3,0)
+	g_auto(XbQueryContext) context = XB_QUERY_CONTEXT_INIT ();
+#endif
+
+	if (query == NULL)
+		return NULL;
+
+	/* bind GUID and then query */
+#if LIBXMLB_CHECK_VERSION(0,3,0)
+	xb_value_bindings_bind_str (xb_query_context_get_bindings (&context), 0, guid, NULL);
+	components = xb_silo_query_with_context (silo, query, &context, NULL);
+#else
+	if (!xb_query_bind_str (query, 0, guid, NULL))
+		return NULL;
+	components = xb_silo_query_full (silo, query, NULL);
+#endif
+	if (components == NULL)
+		return NULL;
+	for (guint i = 0; i < components->len; i++) {
+		XbNode *component = g_ptr_array_index (components, i);
+		fu_engine_md_component_digest_append (str, component);
+	}
+	return g_compute_checksum_for_string (G_CHECKSUM_SHA1, str->str, str->len);
+}
+
+/* an empty silo cannot prepare the query, and has no components anyway */
+static XbQuery *
+fu_engine_md_get_guid_query (XbSilo *silo)
+{
+	g_autoptr(GError) error_local = NULL;
+	XbQuery *query;
+
+	query = xb_query_new_full (silo,
+				   "components/component[@type='firmware']/"
+				   "provides/firmware[@type='flashed'][text()=?]/"
+				   "../..",
+				   XB_QUERY_FLAG_OPTIMIZE |
+				   XB_QUERY_FLAG_USE_INDEXES,
+				   &error_local);
+	if (query == NULL)
+		g_debug ("failed to prepare query: %s", error_local->message);
+	return query;
+}
+
+/* only devices with GUIDs whose components changed between the silos are
+ * refreshed, and several metadata changes in a row only cause one pass */
+static void
+fu_engine_md_refresh_devices_queue (FuEngine *self, XbSilo *silo_old)
+{
+	g_autoptr(GHashTable) guids_checked = g_hash_table_new (g_str_hash, g_str_equal);
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(XbQuery) query_old = NULL;
+	g_autoptr(XbQuery) query_new = NULL;
+
+	if (silo_old == NULL || self->silo == NULL) {
+		self->md_refresh_all = TRUE;
+	} else if (!self->md_refresh_all) {
+		query_old = fu_engine_md_get_guid_query (silo_old);
+		query_new = fu_engine_md_get_guid_query (self->silo);
+		devices = fu_device_list_get_all (self->device_list);
+		for (guint i = 0; i < devices->len; i++) {
+			FuDevice *device = g_ptr_array_index (devices, i);
+			GPtrArray *guids = fu_device_get_guids (device);
+			for (guint j = 0; j < guids->len; j++) {
+				const gchar *guid = g_ptr_array_index (guids, j);
+				g_autofree gchar *digest_old = NULL;
+				g_autofree gchar *digest_new = NULL;
+
+				if (g_hash_table_contains (guids_checked, guid))
+					continue;
+				g_hash_table_add (guids_checked, (gpointer) guid);
+				digest_old = fu_engine_md_get_guid_digest (silo_old, query_old, guid);
+				digest_new = fu_engine_md_get_guid_digest (self->silo, query_new, guid);
+				if (g_strcmp0 (digest_old, digest_new) != 0) {
+					g_hash_table_add (self->md_refresh_guids,
+							  g_strdup (guid));
+				}
+			}
+		}
+	}
+	if (self->md_refresh_id == 0)
+		self->md_refresh_id = g_idle_add (fu_engine_md_refresh_devices_cb, self);
 }
 
 static gboolean
@@ -3597,6 +4015,7 @@ fu_engine_load_metadata_store (FuEngine *self, FuEngineLoadFlags flags, GError *
 	cachedirpkg = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
 	xmlbfn = g_build_filename (cachedirpkg, "metadata.xmlb", NULL);
 	xmlb = g_file_new_for_path (xmlbfn);
+	g_hash_table_remove_all (self->requirement_cache);
 	self->silo = xb_builder_ensure (builder, xmlb, compile_flags, NULL, error);
 	if (self->silo == NULL) {
 		g_prefix_error (error, "cannot create file %s: ", xmlbfn);
@@ -3638,16 +4057,20 @@ static void
 fu_engine_remote_list_changed_cb (FuRemoteList *remote_list, FuEngine *self)
 {
 	g_autoptr(GError) error_local = NULL;
+	g_autoptr(XbSilo) silo_old = NULL;
+
+	if (self->silo != NULL)
+		silo_old = g_object_ref (self->silo);
 	if (!fu_engine_load_metadata_store (self, FU_ENGINE_LOAD_FLAG_NONE,
 					    &error_local))
 		g_warning ("Failed to reload metadata store: %s",
 			   error_local->message);
 
 	/* set device properties from the metadata */
-	fu_engine_md_refresh_devices (self);
+	fu_engine_md_refresh_devices_queue (self, silo_old);
 
 	/* invalidate host security attributes */
-	g_clear_pointer (&self->host_security_id, g_free);
+	fu_engine_invalidate_security_attrs (self, FU_SECURITY_ATTRS_INPUT_METADATA);
 
 	/* make the UI update */
 	fu_engine_emit_changed (self);
@@ -3786,6 +4209,7 @@ fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
 	FwupdRemote *remote;
 	JcatVerifyFlags jcat_flags = JCAT_VERIFY_FLAG_REQUIRE_SIGNATURE;
 	g_autoptr(JcatFile) jcat_file = jcat_file_new ();
+	g_autoptr(XbSilo) silo_old = NULL;
 
 	g_return_val_if_fail (FU_IS_ENGINE (self), FALSE);
 	g_return_val_if_fail (remote_id != NULL, FALSE);
@@ -3887,14 +4311,16 @@ fu_engine_update_metadata_bytes (FuEngine *self, const gchar *remote_id,
 						   bytes_sig, error))
 			return FALSE;
 	}
+	if (self->silo != NULL)
+		silo_old = g_object_ref (self->silo);
 	if (!fu_engine_load_metadata_store (self, FU_ENGINE_LOAD_FLAG_NONE, error))
 		return FALSE;
 
 	/* refresh SUPPORTED flag on devices */
-	fu_engine_md_refresh_devices (self);
+	fu_engine_md_refresh_devices_queue (self, silo_old);
 
 	/* invalidate host security attributes */
-	g_clear_pointer (&self->host_security_id, g_free);
+	fu_engine_invalidate_security_attrs (self, FU_SECURITY_ATTRS_INPUT_METADATA);
 
 	/* make the UI update */
 	fu_engine_emit_changed (self);
@@ -4271,6 +4697,9 @@ fu_engine_get_devices (FuEngine *self, GError **error)
 	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
+	/* apply any pending metadata changes */
+	fu_engine_md_refresh_devices_flush (self);
+
 	devices = fu_device_list_get_active (self->device_list);
 	if (devices->len == 0) {
 		g_set_error_literal (error,
@@ -4299,6 +4728,9 @@ fu_engine_get_devices_by_guid (FuEngine *self, const gchar *guid, GError **error
 	g_autoptr(GPtrArray) devices = NULL;
 	g_autoptr(GPtrArray) devices_tmp = NULL;
 
+	/* apply any pending metadata changes */
+	fu_engine_md_refresh_devices_flush (self);
+
 	/* find the devices by GUID */
 	devices_tmp = fu_device_list_get_all (self->device_list);
 	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
@@ -4339,6 +4771,9 @@ fu_engine_get_devices_by_composite_id (FuEngine *self,
 	g_autoptr(GPtrArray) devices = NULL;
 	g_autoptr(GPtrArray) devices_tmp = NULL;
 
+	/* apply any pending metadata changes */
+	fu_engine_md_refresh_devices_flush (self);
+
 	/* find the devices by composite ID */
 	devices_tmp = fu_device_list_get_all (self->device_list);
 	devices = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
@@ -4844,6 +5279,9 @@ fu_engine_get_releases (FuEngine *self,
 	g_return_val_if_fail (device_id != NULL, NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
+	/* apply any pending metadata changes */
+	fu_engine_md_refresh_devices_flush (self);
+
 	/* find the device */
 	device = fu_device_list_get_by_id (self->device_list, device_id, error);
 	if (device == NULL)
@@ -4890,6 +5328,9 @@ fu_engine_get_downgrades (FuEngine *self,
 	g_return_val_if_fail (device_id != NULL, NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
+	/* apply any pending metadata changes */
+	fu_engine_md_refresh_devices_flush (self);
+
 	/* find the device */
 	device = fu_device_list_get_by_id (self->device_list, device_id, error);
 	if (device == NULL)
@@ -5099,6 +5540,9 @@ fu_engine_get_upgrades (FuEngine *self,
 	g_return_val_if_fail (device_id != NULL, NULL);
 	g_return_val_if_fail (error == NULL || *error == NULL, NULL);
 
+	/* apply any pending metadata changes */
+	fu_engine_md_refresh_devices_flush (self);
+
 	/* find the device */
 	device = fu_device_list_get_by_id (self->device_list, device_id, error);
 	if (device == NULL)
@@ -5664,13 +6108,21 @@ fu_engine_plugin_rules_changed_cb (FuPlugin *plugin, gpointer user_data)
 	}
 }
 
+/* plugins can add runtime versions at any time, not just using the engine */
+static void
+fu_engine_context_runtime_versions_changed_cb (FuContext *ctx, gpointer user_data)
+{
+	FuEngine *self = FU_ENGINE (user_data);
+	g_hash_table_remove_all (self->requirement_cache);
+}
+
 static void
 fu_engine_context_security_changed_cb (FuContext *ctx, gpointer user_data)
 {
 	FuEngine *self = FU_ENGINE (user_data);
 
 	/* invalidate host security attributes */
-	g_clear_pointer (&self->host_security_id, g_free);
+	fu_engine_invalidate_security_attrs (self, FU_SECURITY_ATTRS_INPUT_RUNTIME);
 
 	/* make UI refresh */
 	fu_engine_emit_changed (self);
@@ -5892,12 +6344,39 @@ fu_engine_attrs_calculate_hsi_for_chassis (FuEngine *self)
 }
 
 
+static FuEngineSecurityItem *
+fu_engine_security_item_ensure (FuEngine *self, const gchar *id, FuSecurityAttrsInput inputs)
+{
+	FuEngineSecurityItem *item = g_hash_table_lookup (self->host_security_cache, id);
+	if (item == NULL) {
+		item = g_new0 (FuEngineSecurityItem, 1);
+		item->attrs = fu_security_attrs_new ();
+		g_hash_table_insert (self->host_security_cache, g_strdup (id), item);
+	}
+	item->inputs = inputs;
+	return item;
+}
+
+/* the host attributes are modified by depsolve, so never share the cached ones */
+static void
+fu_engine_security_item_append_to_host (FuEngine *self, FuEngineSecurityItem *item)
+{
+	g_autoptr(GPtrArray) attrs = fu_security_attrs_get_all (item->attrs);
+	for (guint i = 0; i < attrs->len; i++) {
+		FwupdSecurityAttr *attr = g_ptr_array_index (attrs, i);
+		g_autoptr(FwupdSecurityAttr) attr_copy = fwupd_security_attr_copy (attr);
+		fu_security_attrs_append (self->host_security_attrs, attr_copy);
+	}
+}
+
 static void
 fu_engine_ensure_security_attrs (FuEngine *self)
 {
 	GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
+	guint cnt_cached = 0;
 	g_autoptr(GPtrArray) devices = fu_device_list_get_all (self->device_list);
 	g_autoptr(GPtrArray) items = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
 
 	/* already valid */
 	if (self->host_security_id != NULL)
@@ -5909,17 +6388,47 @@ fu_engine_ensure_security_attrs (FuEngine *self)
 	/* built in */
 	fu_engine_ensure_security_attrs_tainted (self);
 
-	/* call into devices */
+	/* call into devices, unless nothing they depend on has changed */
 	for (guint i = 0; i < devices->len; i++) {
 		FuDevice *device = g_ptr_array_index (devices, i);
-		fu_device_add_security_attrs (device, self->host_security_attrs);
+		FuEngineSecurityItem *item;
+		g_autofree gchar *id = fu_engine_security_item_id_for_device (device);
+
+		item = fu_engine_security_item_ensure (self, id,
+						       fu_device_get_security_inputs (device));
+		if (item->valid) {
+			cnt_cached++;
+		} else {
+			g_timer_reset (timer);
+			fu_security_attrs_remove_all (item->attrs);
+			fu_device_add_security_attrs (device, item->attrs);
+			item->elapsed = g_timer_elapsed (timer, NULL) * G_USEC_PER_SEC;
+			item->valid = TRUE;
+		}
+		fu_engine_security_item_append_to_host (self, item);
 	}
 
-	/* call into plugins */
+	/* call into plugins, unless nothing they depend on has changed */
 	for (guint j = 0; j < plugins->len; j++) {
 		FuPlugin *plugin_tmp = g_ptr_array_index (plugins, j);
-		fu_plugin_runner_add_security_attrs (plugin_tmp, self->host_security_attrs);
+		FuEngineSecurityItem *item;
+		g_autofree gchar *id = g_strdup_printf ("plugin:%s", fu_plugin_get_name (plugin_tmp));
+
+		item = fu_engine_security_item_ensure (self, id,
+						       fu_plugin_get_security_inputs (plugin_tmp));
+		if (item->valid) {
+			cnt_cached++;
+		} else {
+			g_timer_reset (timer);
+			fu_security_attrs_remove_all (item->attrs);
+			fu_plugin_runner_add_security_attrs (plugin_tmp, item->attrs);
+			item->elapsed = g_timer_elapsed (timer, NULL) * G_USEC_PER_SEC;
+			item->valid = TRUE;
+		}
+		fu_engine_security_item_append_to_host (self, item);
 	}
+	g_debug ("used cached security attributes for %u of %u contributors",
+		 cnt_cached, devices->len + plugins->len);
 
 	/* set the fallback names for clients without native translations */
 	items = fu_security_attrs_get_all (self->host_security_attrs);
@@ -5960,10 +6469,139 @@ fu_engine_get_host_security_attrs (FuEngine *self)
 	return g_object_ref (self->host_security_attrs);
 }
 
+/**
+ * fu_engine_get_host_security_timings:
+ * @self: a #FuEngine
+ *
+ * Gets how long each plugin or device took the last time its security
+ * attributes were calculated.
+ *
+ * Returns: (transfer container): contributor ID:duration in µs
+ **/
+GHashTable *
+fu_engine_get_host_security_timings (FuEngine *self)
+{
+	GHashTableIter iter;
+	gpointer key;
+	gpointer value;
+	GHashTable *timings = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), NULL);
+
+	fu_engine_ensure_security_attrs (self);
+	g_hash_table_iter_init (&iter, self->host_security_cache);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		FuEngineSecurityItem *item = (FuEngineSecurityItem *) value;
+		g_hash_table_insert (timings,
+				     g_strdup (key),
+				     GUINT_TO_POINTER ((guint) MIN (item->elapsed, G_MAXUINT)));
+	}
+	return timings;
+}
+
+static const gchar *
+fu_engine_memory_tier_to_string (FuEngineMemoryTier tier)
+{
+	if (tier == FU_ENGINE_MEMORY_TIER_CACHES)
+		return "caches";
+	if (tier == FU_ENGINE_MEMORY_TIER_METADATA)
+		return "metadata";
+	if (tier == FU_ENGINE_MEMORY_TIER_HEAP)
+		return "heap";
+	return NULL;
+}
+
+/* memory in use, or for the heap tier the memory held by the allocator */
+static guint64
+fu_engine_get_heap_size (FuEngineMemoryTier tier)
+{
+#ifdef HAVE_MALLINFO2
+	struct mallinfo2 mi = mallinfo2 ();
+	if (tier == FU_ENGINE_MEMORY_TIER_HEAP)
+		return mi.arena + mi.hblkhd;
+	return mi.uordblks + mi.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+/* returns the number of bytes known to be freed, if not measured by the allocator */
+static guint64
+fu_engine_release_memory_tier (FuEngine *self, FuEngineMemoryTier tier)
+{
+	if (tier == FU_ENGINE_MEMORY_TIER_CACHES) {
+		GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
+
+		/* recalculated for every contributor on the next request */
+		g_hash_table_remove_all (self->host_security_cache);
+		fu_security_attrs_remove_all (self->host_security_attrs);
+		g_clear_pointer (&self->host_security_id, g_free);
+		g_hash_table_remove_all (self->requirement_cache);
+
+		/* probe results are also saved to disk */
+		for (guint i = 0; i < plugins->len; i++) {
+			FuPlugin *plugin = g_ptr_array_index (plugins, i);
+			fu_plugin_release_memory (plugin);
+		}
+		return 0;
+	}
+	if (tier == FU_ENGINE_MEMORY_TIER_METADATA) {
+		/* nodes are recreated from the mapped silo when next queried */
+#if LIBXMLB_CHECK_VERSION(0,3,0)
+		if (self->silo != NULL) {
+			xb_silo_set_enable_node_cache (self->silo, FALSE);
+			xb_silo_set_enable_node_cache (self->silo, TRUE);
+		}
+#endif
+		return fu_history_release_memory (self->history);
+	}
+	if (tier == FU_ENGINE_MEMORY_TIER_HEAP) {
+#ifdef HAVE_MALLOC_TRIM
+		malloc_trim (0);
+#endif
+		return 0;
+	}
+	return 0;
+}
+
+/**
+ * fu_engine_shed_memory:
+ * @self: a #FuEngine
+ * @tier: the most expensive #FuEngineMemoryTier to release
+ *
+ * Releases memory that can be recreated on demand, cheapest to recreate first
+ * and stopping after @tier.
+ *
+ * Returns: number of bytes freed, or 0 if unknown
+ **/
+guint64
+fu_engine_shed_memory (FuEngine *self, FuEngineMemoryTier tier)
+{
+	guint64 total = 0;
+
+	g_return_val_if_fail (FU_IS_ENGINE (self), 0);
+
+	for (guint i = 0; i <= tier && i < FU_ENGINE_MEMORY_TIER_LAST; i++) {
+		guint64 size_before = fu_engine_get_heap_size (i);
+		guint64 size_after;
+		guint64 freed;
+
+		freed = fu_engine_release_memory_tier (self, i);
+		size_after = fu_engine_get_heap_size (i);
+		if (size_before > size_after)
+			freed = size_before - size_after;
+		g_debug ("released %" G_GUINT64_FORMAT " bytes of %s",
+			 freed, fu_engine_memory_tier_to_string (i));
+		total += freed;
+	}
+	return total;
+}
+
 gboolean
 fu_engine_load_plugins (FuEngine *self, GError **error)
 {
 	const gchar *fn;
+	GPtrArray *levels;
 	g_autoptr(GDir) dir = NULL;
 	g_autofree gchar *plugin_path = NULL;
 	g_autofree gchar *suffix = g_strdup_printf (".%s", G_MODULE_SUFFIX);
@@ -6056,6 +6694,20 @@ fu_engine_load_plugins (FuEngine *self, GError **error)
 	if (!fu_plugin_list_depsolve (self->plugin_list, error))
 		return FALSE;
 
+	/* show the plugins that have no ordering between them */
+	levels = fu_plugin_list_get_levels (self->plugin_list);
+	for (guint i = 0; i < levels->len; i++) {
+		GPtrArray *level = g_ptr_array_index (levels, i);
+		g_autoptr(GString) str = g_string_new (NULL);
+		for (guint j = 0; j < level->len; j++) {
+			FuPlugin *plugin = g_ptr_array_index (level, j);
+			if (str->len > 0)
+				g_string_append (str, ", ");
+			g_string_append (str, fu_plugin_get_name (plugin));
+		}
+		g_debug ("plugin level %u: %s", i, str->str);
+	}
+
 	/* success */
 	return TRUE;
 }
@@ -6095,6 +6747,9 @@ fu_engine_backend_device_removed_cb (FuBackend *backend, FuDevice *device, FuEng
 			 fu_device_get_backend_id (device));
 	}
 
+	/* plugins may set HSI state from backend devices */
+	fu_engine_invalidate_security_attrs (self, FU_SECURITY_ATTRS_INPUT_DEVICES);
+
 	/* go through each device and remove any that match */
 	devices = fu_device_list_get_all (self->device_list);
 	for (guint i = 0; i < devices->len; i++) {
@@ -6128,6 +6783,9 @@ fu_engine_backend_device_added_cb (FuBackend *backend, FuDevice *device, FuEngin
 		return;
 	}
 
+	/* plugins may set HSI state from backend devices */
+	fu_engine_invalidate_security_attrs (self, FU_SECURITY_ATTRS_INPUT_DEVICES);
+
 	/* super useful for plugin development */
 	if (g_getenv ("FWUPD_PROBE_VERBOSE") != NULL) {
 		g_autofree gchar *str = fu_device_to_string (FU_DEVICE (device));
@@ -6158,6 +6816,10 @@ fu_engine_backend_device_added_cb (FuBackend *backend, FuDevice *device, FuEngin
 				   error->message);
 			continue;
 		}
+
+		/* during coldplug the cache is only written once at the end */
+		if (self->loaded && !fu_plugin_save_probe_cache (plugin, &error))
+			g_warning ("failed to save probe cache: %s", error->message);
 	}
 }
 
@@ -6586,6 +7248,7 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 
 	/* coldplug backends */
 	if (flags & FU_ENGINE_LOAD_FLAG_COLDPLUG) {
+		GPtrArray *plugins = fu_plugin_list_get_all (self->plugin_list);
 		for (guint i = 0; i < self->backends->len; i++) {
 			FuBackend *backend = g_ptr_array_index (self->backends, i);
 			g_autoptr(GError) error_backend = NULL;
@@ -6607,6 +7270,14 @@ fu_engine_load (FuEngine *self, FuEngineLoadFlags flags, GError **error)
 				continue;
 			}
 		}
+
+		/* write each probe cache once rather than for every device */
+		for (guint i = 0; i < plugins->len; i++) {
+			FuPlugin *plugin = g_ptr_array_index (plugins, i);
+			g_autoptr(GError) error_local = NULL;
+			if (!fu_plugin_save_probe_cache (plugin, &error_local))
+				g_warning ("failed to save probe cache: %s", error_local->message);
+		}
 	}
 
 	/* set device properties from the metadata */
@@ -6720,8 +7391,13 @@ fu_engine_init (FuEngine *self)
 	self->plugin_list = fu_plugin_list_new ();
 	self->plugin_filter = g_ptr_array_new_with_free_func (g_free);
 	self->host_security_attrs = fu_security_attrs_new ();
+	self->host_security_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+							   (GDestroyNotify) fu_engine_security_item_free);
 	self->backends = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	self->runtime_versions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	self->md_refresh_guids = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	self->requirement_cache = g_hash_table_new_full (g_str_hash, g_str_equal, g_free,
+							 (GDestroyNotify) fu_engine_requirement_result_free);
 	self->compile_versions = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
 	fu_context_set_runtime_versions (self->ctx, self->runtime_versions);
@@ -6730,6 +7406,9 @@ fu_engine_init (FuEngine *self)
 	g_signal_connect (self->ctx, "security-changed",
 			  G_CALLBACK (fu_engine_context_security_changed_cb),
 			  self);
+	g_signal_connect (self->ctx, "runtime-versions-changed",
+			  G_CALLBACK (fu_engine_context_runtime_versions_changed_cb),
+			  self);
 	g_signal_connect (self->ctx, "notify::battery-state",
 			  G_CALLBACK (fu_engine_context_battery_changed_cb),
 			  self);
@@ -6755,7 +7434,7 @@ fu_engine_init (FuEngine *self)
 	g_ptr_array_add (self->backends, fu_usb_backend_new ());
 #endif
 #ifdef HAVE_GUDEV
-	g_ptr_array_add (self->backends, fu_udev_backend_new (fu_context_get_udev_subsystems (self->ctx)));
+	g_ptr_array_add (self->backends, fu_udev_backend_new (self->ctx));
 #endif
 #ifdef HAVE_BLUEZ
 	g_ptr_array_add (self->backends, fu_bluez_backend_new ());
@@ -6811,6 +7490,8 @@ fu_engine_finalize (GObject *obj)
 		g_object_unref (self->silo);
 	if (self->coldplug_id != 0)
 		g_source_remove (self->coldplug_id);
+	if (self->md_refresh_id != 0)
+		g_source_remove (self->md_refresh_id);
 	if (self->approved_firmware != NULL)
 		g_hash_table_unref (self->approved_firmware);
 	if (self->blocked_firmware != NULL)
@@ -6831,6 +7512,9 @@ fu_engine_finalize (GObject *obj)
 	g_hash_table_unref (self->runtime_versions);
 	g_hash_table_unref (self->compile_versions);
 	g_object_unref (self->plugin_list);
+	g_hash_table_unref (self->host_security_cache);
+	g_hash_table_unref (self->requirement_cache);
+	g_hash_table_unref (self->md_refresh_guids);
 
 	G_OBJECT_CLASS (fu_engine_parent_class)->finalize (obj);
 }
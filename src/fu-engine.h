@@ -43,6 +43,23 @@ typedef enum {
 	FU_ENGINE_LOAD_FLAG_LAST
 } FuEngineLoadFlags;
 
+/**
+ * FuEngineMemoryTier:
+ * @FU_ENGINE_MEMORY_TIER_CACHES:	Cached results that are cheap to recalculate
+ * @FU_ENGINE_MEMORY_TIER_METADATA:	Metadata and history that are reloaded from disk
+ * @FU_ENGINE_MEMORY_TIER_HEAP:		Unused heap held by the allocator
+ *
+ * The groups of memory that can be released when the system is low on memory,
+ * cheapest to recreate first.
+ **/
+typedef enum {
+	FU_ENGINE_MEMORY_TIER_CACHES,
+	FU_ENGINE_MEMORY_TIER_METADATA,
+	FU_ENGINE_MEMORY_TIER_HEAP,
+	/*< private >*/
+	FU_ENGINE_MEMORY_TIER_LAST
+} FuEngineMemoryTier;
+
 FuEngine	*fu_engine_new				(FuAppFlags	 app_flags);
 void		 fu_engine_add_app_flag			(FuEngine	*self,
 							 FuAppFlags	 app_flags);
@@ -64,6 +81,7 @@ XbSilo		*fu_engine_get_silo_from_blob		(FuEngine	*self,
 							 GError		**error);
 guint64		 fu_engine_get_archive_size_max		(FuEngine	*self);
 GPtrArray	*fu_engine_get_plugins			(FuEngine	*self);
+GPtrArray	*fu_engine_get_plugin_levels		(FuEngine	*self);
 GPtrArray	*fu_engine_get_devices			(FuEngine	*self,
 							 GError		**error);
 FuDevice	*fu_engine_get_device			(FuEngine	*self,
@@ -98,6 +116,9 @@ FwupdDevice	*fu_engine_get_results			(FuEngine	*self,
 							 const gchar	*device_id,
 							 GError		**error);
 FuSecurityAttrs	*fu_engine_get_host_security_attrs	(FuEngine	*self);
+GHashTable	*fu_engine_get_host_security_timings	(FuEngine	*self);
+guint64		 fu_engine_shed_memory			(FuEngine	*self,
+							 FuEngineMemoryTier tier);
 GHashTable	*fu_engine_get_report_metadata		(FuEngine	*self,
 							 GError		**error);
 gboolean	 fu_engine_clear_results		(FuEngine	*self,
@@ -208,6 +229,9 @@ gboolean	 fu_engine_check_requirements		(FuEngine	*self,
 							 FuInstallTask	*task,
 							 FwupdInstallFlags flags,
 							 GError		**error);
+void		 fu_engine_get_requirement_cache_stats	(FuEngine	*self,
+							 guint		*hits,
+							 guint		*misses);
 void		 fu_engine_set_silo			(FuEngine	*self,
 							 XbSilo		*silo);
 XbNode		*fu_engine_get_component_by_guids	(FuEngine	*self,
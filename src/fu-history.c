@@ -1222,6 +1222,39 @@ fu_history_add_blocked_firmware (FuHistory *self, const gchar *checksum, GError
 	return fu_history_stmt_exec (self, stmt, NULL, error);
 }
 
+/**
+ * fu_history_release_memory:
+ * @self: a #FuHistory
+ *
+ * Frees the page cache of the history database, which is repopulated from
+ * disk the next time the history is queried.
+ *
+ * Returns: number of bytes freed
+ *
+ * Since: 1.6.2
+ **/
+guint64
+fu_history_release_memory (FuHistory *self)
+{
+	gint cur_before = 0;
+	gint cur_after = 0;
+	gint hiwtr = 0;
+	g_autoptr(GRWLockWriterLocker) locker = NULL;
+
+	g_return_val_if_fail (FU_IS_HISTORY (self), 0);
+
+	/* not yet loaded */
+	if (self->db == NULL)
+		return 0;
+
+	locker = g_rw_lock_writer_locker_new (&self->db_mutex);
+	g_return_val_if_fail (locker != NULL, 0);
+	sqlite3_db_status (self->db, SQLITE_DBSTATUS_CACHE_USED, &cur_before, &hiwtr, 0);
+	sqlite3_db_release_memory (self->db);
+	sqlite3_db_status (self->db, SQLITE_DBSTATUS_CACHE_USED, &cur_after, &hiwtr, 0);
+	return cur_before > cur_after ? (guint64) (cur_before - cur_after) : 0;
+}
+
 static void
 fu_history_class_init (FuHistoryClass *klass)
 {
@@ -54,3 +54,5 @@ gboolean	 fu_history_add_blocked_firmware	(FuHistory	*self,
 							 GError		**error);
 GPtrArray	*fu_history_get_blocked_firmware	(FuHistory	*self,
 							 GError		**error);
+
+guint64		 fu_history_release_memory		(FuHistory	*self);
@@ -12,6 +12,7 @@
 #include <fwupd.h>
 #include <gio/gunixfdlist.h>
 #include <glib/gi18n.h>
+#include <glib/gstdio.h>
 #include <glib-unix.h>
 #include <locale.h>
 #ifdef HAVE_MALLOC_H
@@ -28,6 +29,7 @@
 #include <jcat.h>
 
 #include "fwupd-device-private.h"
+#include "fwupd-enums-private.h"
 #include "fwupd-plugin-private.h"
 #include "fwupd-security-attr-private.h"
 #include "fwupd-release-private.h"
@@ -57,6 +59,26 @@ typedef enum {
 	FU_MAIN_MACHINE_KIND_CONTAINER,
 } FuMainMachineKind;
 
+typedef struct {
+	GDBusConnection		*connection;
+	GMainContext		*context;
+	GMainLoop		*loop;
+	GThread			*thread;
+	guint			 registration_id;
+	GVariant		*properties;	/* a{sv}, until loaded */
+	GVariant		*devices;	/* aa{sv}, until loaded */
+	GHashTable		*unseen;	/* device-id:GVariant, main thread only */
+	GPtrArray		*invocations;	/* element-type GDBusMethodInvocation */
+	gboolean		 loaded;
+	GMutex			 mutex;		/* for @invocations, @loaded and the variants */
+} FuMainSnapshot;
+
+typedef struct {
+	guint64			 calls;
+	guint64			 usecs;		/* only the synchronous part */
+	gint64			 heap;		/* bytes retained after return */
+} FuMainMethodStats;
+
 typedef struct {
 	GDBusConnection		*connection;
 	GDBusNodeInfo		*introspection_daemon;
@@ -64,6 +86,10 @@ typedef struct {
 	GMainLoop		*loop;
 	GFileMonitor		*argv0_monitor;
 	GHashTable		*sender_features;	/* sender:FwupdFeatureFlags */
+	GHashTable		*sender_requests;	/* sender:FuEngineRequest */
+	GHashTable		*sender_watches;	/* sender:NameOwnerChanged subscription */
+	GHashTable		*method_stats;		/* method:FuMainMethodStats */
+	gboolean		 method_stats_heap;
 #if GLIB_CHECK_VERSION(2,63,3)
 	GMemoryMonitor		*memory_monitor;
 #endif
@@ -75,6 +101,7 @@ typedef struct {
 	gboolean		 update_in_progress;
 	gboolean		 pending_sigterm;
 	FuMainMachineKind	 machine_kind;
+	FuMainSnapshot		*snapshot;	/* (nullable): owns the object if started from one */
 } FuMainPrivate;
 
 static gboolean
@@ -110,16 +137,23 @@ fu_main_engine_device_added_cb (FuEngine *engine,
 				FuMainPrivate *priv)
 {
 	GVariant *val;
+	const gchar *signal_name = "DeviceAdded";
 
 	/* not yet connected */
 	if (priv->connection == NULL)
 		return;
+
+	/* clients already know about this device from the snapshot */
+	if (priv->snapshot != NULL &&
+	    g_hash_table_remove (priv->snapshot->unseen, fu_device_get_id (device)))
+		signal_name = "DeviceChanged";
+
 	val = fwupd_device_to_variant (FWUPD_DEVICE (device));
 	g_dbus_connection_emit_signal (priv->connection,
 				       NULL,
 				       FWUPD_DBUS_PATH,
 				       FWUPD_DBUS_INTERFACE,
-				       "DeviceAdded",
+				       signal_name,
 				       g_variant_new_tuple (&val, 1), NULL);
 }
 
@@ -227,17 +261,74 @@ fu_main_engine_percentage_changed_cb (FuEngine *engine,
 				       g_variant_new_uint32 (percentage));
 }
 
+static void
+fu_main_name_owner_changed_cb (GDBusConnection *connection,
+			       const gchar *sender_name,
+			       const gchar *object_path,
+			       const gchar *interface_name,
+			       const gchar *signal_name,
+			       GVariant *parameters,
+			       gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	const gchar *name = NULL;
+	const gchar *old_owner = NULL;
+	const gchar *new_owner = NULL;
+	guint subscription_id;
+
+	/* the client has gone away */
+	g_variant_get (parameters, "(&s&s&s)", &name, &old_owner, &new_owner);
+	if (new_owner[0] != '\0')
+		return;
+	subscription_id = GPOINTER_TO_UINT (g_hash_table_lookup (priv->sender_watches, name));
+	if (subscription_id > 0)
+		g_dbus_connection_signal_unsubscribe (connection, subscription_id);
+	g_hash_table_remove (priv->sender_watches, name);
+	g_hash_table_remove (priv->sender_requests, name);
+	g_hash_table_remove (priv->sender_features, name);
+}
+
+/* only ask the bus about the clients we keep state for */
+static void
+fu_main_sender_watch (FuMainPrivate *priv, const gchar *sender)
+{
+	guint subscription_id;
+
+	if (g_hash_table_contains (priv->sender_watches, sender))
+		return;
+	subscription_id =
+		g_dbus_connection_signal_subscribe (priv->connection,
+						    "org.freedesktop.DBus",
+						    "org.freedesktop.DBus",
+						    "NameOwnerChanged",
+						    "/org/freedesktop/DBus",
+						    sender, /* arg0 */
+						    G_DBUS_SIGNAL_FLAGS_NONE,
+						    fu_main_name_owner_changed_cb,
+						    priv, NULL);
+	g_hash_table_insert (priv->sender_watches,
+			     g_strdup (sender),
+			     GUINT_TO_POINTER (subscription_id));
+}
+
 static FuEngineRequest *
 fu_main_create_request (FuMainPrivate *priv, const gchar *sender, GError **error)
 {
 	FwupdFeatureFlags *feature_flags;
 	FwupdDeviceFlags device_flags = FWUPD_DEVICE_FLAG_NONE;
 	uid_t calling_uid = 0;
-	g_autoptr(FuEngineRequest) request = fu_engine_request_new ();
+	FuEngineRequest *request_cached;
+	g_autoptr(FuEngineRequest) request = NULL;
 	g_autoptr(GVariant) value = NULL;
 
 	g_return_val_if_fail (sender != NULL, NULL);
 
+	/* unique names are never reused, so the uid cannot change */
+	request_cached = g_hash_table_lookup (priv->sender_requests, sender);
+	if (request_cached != NULL)
+		return g_object_ref (request_cached);
+
+	request = fu_engine_request_new ();
 	/* did the client set the list of supported feature */
 	feature_flags = g_hash_table_lookup (priv->sender_features, sender);
 	if (feature_flags != NULL)
@@ -261,6 +352,8 @@ fu_main_create_request (FuMainPrivate *priv, const gchar *sender, GError **error
 	fu_engine_request_set_device_flags (request, device_flags);
 
 	/* success */
+	fu_main_sender_watch (priv, sender);
+	g_hash_table_insert (priv->sender_requests, g_strdup (sender), g_object_ref (request));
 	return g_steal_pointer (&request);
 }
 
@@ -920,12 +1013,10 @@ fu_main_device_id_valid (const gchar *device_id, GError **error)
 }
 
 static void
-fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
-			    const gchar *object_path, const gchar *interface_name,
-			    const gchar *method_name, GVariant *parameters,
-			    GDBusMethodInvocation *invocation, gpointer user_data)
+fu_main_daemon_method_dispatch (FuMainPrivate *priv, const gchar *sender,
+				const gchar *method_name, GVariant *parameters,
+				GDBusMethodInvocation *invocation)
 {
-	FuMainPrivate *priv = (FuMainPrivate *) user_data;
 	GVariant *val = NULL;
 	g_autoptr(FuEngineRequest) request = NULL;
 	g_autoptr(GError) error = NULL;
@@ -1509,6 +1600,7 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 
 		/* old flags for the same sender will be automatically destroyed */
 		feature_flags = feature_flags_u64;
+		fu_main_sender_watch (priv, sender);
 		g_hash_table_insert (priv->sender_features,
 				     g_strdup (sender),
 #if GLIB_CHECK_VERSION(2,67,4)
@@ -1516,6 +1608,7 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 #else
 				     g_memdup (&feature_flags, sizeof(feature_flags)));
 #endif
+		g_hash_table_remove (priv->sender_requests, sender);
 		g_dbus_method_invocation_return_value (invocation, NULL);
 		return;
 	}
@@ -1660,6 +1753,59 @@ fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
 	g_dbus_method_invocation_return_gerror (invocation, error);
 }
 
+static gint64
+fu_main_get_heap_used (void)
+{
+#ifdef HAVE_MALLINFO2
+	struct mallinfo2 mi = mallinfo2 ();
+	return (gint64) (mi.uordblks + mi.hblkhd);
+#else
+	return 0;
+#endif
+}
+
+static void
+fu_main_daemon_method_call (GDBusConnection *connection, const gchar *sender,
+			    const gchar *object_path, const gchar *interface_name,
+			    const gchar *method_name, GVariant *parameters,
+			    GDBusMethodInvocation *invocation, gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	FuMainMethodStats *stats;
+	gint64 heap_used = priv->method_stats_heap ? fu_main_get_heap_used () : 0;
+	gint64 start = g_get_monotonic_time ();
+
+	fu_main_daemon_method_dispatch (priv, sender, method_name, parameters, invocation);
+
+	/* keep track of what each method costs */
+	stats = g_hash_table_lookup (priv->method_stats, method_name);
+	if (stats == NULL) {
+		stats = g_new0 (FuMainMethodStats, 1);
+		g_hash_table_insert (priv->method_stats, g_strdup (method_name), stats);
+	}
+	stats->calls++;
+	stats->usecs += g_get_monotonic_time () - start;
+	if (priv->method_stats_heap)
+		stats->heap += fu_main_get_heap_used () - heap_used;
+}
+
+static gboolean
+fu_main_sigusr1_cb (gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	g_autoptr(GList) keys = g_hash_table_get_keys (priv->method_stats);
+
+	keys = g_list_sort (keys, (GCompareFunc) g_strcmp0);
+	for (GList *l = keys; l != NULL; l = l->next) {
+		const gchar *method_name = l->data;
+		FuMainMethodStats *stats = g_hash_table_lookup (priv->method_stats, method_name);
+		g_message ("%s: %" G_GUINT64_FORMAT " calls, %" G_GUINT64_FORMAT "us, "
+			   "%" G_GINT64_FORMAT " bytes retained",
+			   method_name, stats->calls, stats->usecs, stats->heap);
+	}
+	return G_SOURCE_CONTINUE;
+}
+
 static GVariant *
 fu_main_daemon_get_property (GDBusConnection *connection_, const gchar *sender,
 			     const gchar *object_path, const gchar *interface_name,
@@ -1701,6 +1847,29 @@ fu_main_daemon_get_property (GDBusConnection *connection_, const gchar *sender,
 	return NULL;
 }
 
+/* everything that needs the connection apart from the object itself */
+static void
+fu_main_setup_connection (FuMainPrivate *priv)
+{
+	g_autoptr(GError) error = NULL;
+
+	/* connect to D-Bus directly */
+	priv->proxy_uid =
+		g_dbus_proxy_new_sync (priv->connection,
+				       G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+				       G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+				       NULL,
+				       "org.freedesktop.DBus",
+				       "/org/freedesktop/DBus",
+				       "org.freedesktop.DBus",
+				       NULL,
+				       &error);
+	if (priv->proxy_uid == NULL) {
+		g_warning ("cannot connect to DBus: %s", error->message);
+		return;
+	}
+}
+
 static void
 fu_main_on_bus_acquired_cb (GDBusConnection *connection,
 			    const gchar *name,
@@ -1708,14 +1877,13 @@ fu_main_on_bus_acquired_cb (GDBusConnection *connection,
 {
 	FuMainPrivate *priv = (FuMainPrivate *) user_data;
 	guint registration_id;
-	g_autoptr(GError) error = NULL;
 	static const GDBusInterfaceVTable interface_vtable = {
 		fu_main_daemon_method_call,
 		fu_main_daemon_get_property,
 		NULL
 	};
 
-	priv->connection = g_object_ref (connection);
+	g_set_object (&priv->connection, connection);
 	registration_id = g_dbus_connection_register_object (connection,
 							     FWUPD_DBUS_PATH,
 							     priv->introspection_daemon->interfaces[0],
@@ -1724,22 +1892,7 @@ fu_main_on_bus_acquired_cb (GDBusConnection *connection,
 							     NULL,  /* user_data_free_func */
 							     NULL); /* GError** */
 	g_assert (registration_id > 0);
-
-	/* connect to D-Bus directly */
-	priv->proxy_uid =
-		g_dbus_proxy_new_sync (priv->connection,
-				       G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
-				       G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
-				       NULL,
-				       "org.freedesktop.DBus",
-				       "/org/freedesktop/DBus",
-				       "org.freedesktop.DBus",
-				       NULL,
-				       &error);
-	if (priv->proxy_uid == NULL) {
-		g_warning ("cannot connect to DBus: %s", error->message);
-		return;
-	}
+	fu_main_setup_connection (priv);
 }
 
 static void
@@ -1764,6 +1917,456 @@ fu_main_on_name_lost_cb (GDBusConnection *connection,
 	g_main_loop_quit (priv->loop);
 }
 
+static gchar *
+fu_main_snapshot_get_filename (void)
+{
+	g_autofree gchar *cachedir = fu_common_get_path (FU_PATH_KIND_CACHEDIR_PKG);
+	return g_build_filename (cachedir, "devices.gvariant", NULL);
+}
+
+static gint
+fu_main_snapshot_sort_cb (gconstpointer a, gconstpointer b)
+{
+	const gchar *name1 = *((const gchar **) a);
+	const gchar *name2 = *((const gchar **) b);
+	return g_strcmp0 (name1, name2);
+}
+
+/* the snapshot is only valid for the exact same daemon, plugins and config */
+static gchar *
+fu_main_snapshot_get_fingerprint (void)
+{
+	const gchar *fn;
+	g_autofree gchar *plugindir = fu_common_get_path (FU_PATH_KIND_PLUGINDIR_PKG);
+	g_autofree gchar *sysconfdir = fu_common_get_path (FU_PATH_KIND_SYSCONFDIR_PKG);
+	g_autofree gchar *conf = g_build_filename (sysconfdir, "daemon.conf", NULL);
+	g_autoptr(GDir) dir = NULL;
+	g_autoptr(GPtrArray) names = g_ptr_array_new_with_free_func (g_free);
+	g_autoptr(GString) str = g_string_new (SOURCE_VERSION);
+	GStatBuf st;
+
+	if (g_stat (conf, &st) == 0)
+		g_string_append_printf (str, "|daemon.conf:%" G_GINT64_FORMAT, (gint64) st.st_mtime);
+	dir = g_dir_open (plugindir, 0, NULL);
+	if (dir != NULL) {
+		while ((fn = g_dir_read_name (dir)) != NULL)
+			g_ptr_array_add (names, g_strdup (fn));
+	}
+	g_ptr_array_sort (names, fu_main_snapshot_sort_cb);
+	for (guint i = 0; i < names->len; i++) {
+		const gchar *name = g_ptr_array_index (names, i);
+		g_autofree gchar *path = g_build_filename (plugindir, name, NULL);
+		if (g_stat (path, &st) != 0)
+			continue;
+		g_string_append_printf (str, "|%s:%" G_GINT64_FORMAT, name, (gint64) st.st_mtime);
+	}
+	return g_compute_checksum_for_string (G_CHECKSUM_SHA1, str->str, -1);
+}
+
+static void
+fu_main_snapshot_save (FuMainPrivate *priv)
+{
+	GVariantBuilder builder_devices;
+	GVariantBuilder builder_props;
+	const gchar *tmp;
+	g_autofree gchar *filename = fu_main_snapshot_get_filename ();
+	g_autofree gchar *fingerprint = fu_main_snapshot_get_fingerprint ();
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	/* nothing useful to serve next time */
+	devices = fu_engine_get_devices (priv->engine, &error);
+	if (devices == NULL) {
+		g_debug ("not saving device snapshot: %s", error->message);
+		g_unlink (filename);
+		return;
+	}
+
+	/* only the untrusted fields, as the snapshot is sent before auth */
+	g_variant_builder_init (&builder_devices, G_VARIANT_TYPE ("aa{sv}"));
+	for (guint i = 0; i < devices->len; i++) {
+		FuDevice *device = g_ptr_array_index (devices, i);
+		g_variant_builder_add_value (&builder_devices,
+					     fwupd_device_to_variant (FWUPD_DEVICE (device)));
+	}
+	g_variant_builder_init (&builder_props, G_VARIANT_TYPE_VARDICT);
+	g_variant_builder_add (&builder_props, "{sv}", "Tainted",
+			       g_variant_new_boolean (fu_engine_get_tainted (priv->engine)));
+	tmp = fu_engine_get_host_product (priv->engine);
+	if (tmp != NULL) {
+		g_variant_builder_add (&builder_props, "{sv}", "HostProduct",
+				       g_variant_new_string (tmp));
+	}
+	tmp = fu_engine_get_host_machine_id (priv->engine);
+	if (tmp != NULL) {
+		g_variant_builder_add (&builder_props, "{sv}", "HostMachineId",
+				       g_variant_new_string (tmp));
+	}
+	val = g_variant_ref_sink (g_variant_new ("(sa{sv}aa{sv})",
+						 fingerprint,
+						 &builder_props,
+						 &builder_devices));
+	blob = g_variant_get_data_as_bytes (val);
+	if (!fu_common_set_contents_bytes (filename, blob, &error)) {
+		g_warning ("failed to save device snapshot: %s", error->message);
+		return;
+	}
+	g_debug ("saved snapshot of %u devices", devices->len);
+}
+
+static gboolean
+fu_main_snapshot_quit_cb (gpointer user_data)
+{
+	GMainLoop *loop = (GMainLoop *) user_data;
+	g_main_loop_quit (loop);
+	return G_SOURCE_REMOVE;
+}
+
+static void
+fu_main_snapshot_free (FuMainSnapshot *snapshot)
+{
+	if (snapshot->registration_id > 0)
+		g_dbus_connection_unregister_object (snapshot->connection,
+						     snapshot->registration_id);
+	if (snapshot->thread != NULL) {
+		g_autoptr(GSource) source = g_idle_source_new ();
+		g_source_set_callback (source, fu_main_snapshot_quit_cb, snapshot->loop, NULL);
+		g_source_attach (source, snapshot->context);
+		g_thread_join (snapshot->thread);
+	}
+	if (snapshot->loop != NULL)
+		g_main_loop_unref (snapshot->loop);
+	g_main_context_unref (snapshot->context);
+	if (snapshot->connection != NULL)
+		g_object_unref (snapshot->connection);
+	if (snapshot->properties != NULL)
+		g_variant_unref (snapshot->properties);
+	if (snapshot->devices != NULL)
+		g_variant_unref (snapshot->devices);
+	g_hash_table_unref (snapshot->unseen);
+	g_ptr_array_unref (snapshot->invocations);
+	g_mutex_clear (&snapshot->mutex);
+	g_free (snapshot);
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-function"
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuMainSnapshot, fu_main_snapshot_free)
+#pragma clang diagnostic pop
+
+static FuMainSnapshot *
+fu_main_snapshot_load (GError **error)
+{
+	GVariantIter iter;
+	GVariant *dev;
+	const gchar *fingerprint = NULL;
+	g_autofree gchar *filename = fu_main_snapshot_get_filename ();
+	g_autofree gchar *fingerprint_now = NULL;
+	g_autoptr(FuMainSnapshot) snapshot = g_new0 (FuMainSnapshot, 1);
+	g_autoptr(GBytes) blob = NULL;
+	g_autoptr(GVariant) val = NULL;
+
+	g_mutex_init (&snapshot->mutex);
+	snapshot->context = g_main_context_new ();
+	snapshot->unseen = g_hash_table_new_full (g_str_hash, g_str_equal,
+						  g_free, (GDestroyNotify) g_variant_unref);
+	snapshot->invocations = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+
+	/* the file is written by us, but do not trust it blindly */
+	blob = fu_common_get_contents_bytes (filename, error);
+	if (blob == NULL)
+		return NULL;
+	val = g_variant_ref_sink (g_variant_new_from_bytes (G_VARIANT_TYPE ("(sa{sv}aa{sv})"),
+							    blob, FALSE));
+	if (!g_variant_is_normal_form (val)) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_FILE,
+				     "device snapshot is corrupt");
+		return NULL;
+	}
+	g_variant_get (val, "(&s@a{sv}@aa{sv})",
+		       &fingerprint,
+		       &snapshot->properties,
+		       &snapshot->devices);
+	fingerprint_now = fu_main_snapshot_get_fingerprint ();
+	if (g_strcmp0 (fingerprint, fingerprint_now) != 0) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_NOT_SUPPORTED,
+				     "device snapshot is out of date");
+		return NULL;
+	}
+
+	/* every device has to be seen again during coldplug */
+	g_variant_iter_init (&iter, snapshot->devices);
+	while ((dev = g_variant_iter_next_value (&iter)) != NULL) {
+		const gchar *device_id = NULL;
+		if (!g_variant_lookup (dev, FWUPD_RESULT_KEY_DEVICE_ID, "&s", &device_id)) {
+			g_variant_unref (dev);
+			continue;
+		}
+		g_hash_table_insert (snapshot->unseen, g_strdup (device_id), dev);
+	}
+	return g_steal_pointer (&snapshot);
+}
+
+/* called in the snapshot thread */
+static GVariant *
+fu_main_snapshot_get_property (GDBusConnection *connection_, const gchar *sender,
+			       const gchar *object_path, const gchar *interface_name,
+			       const gchar *property_name, GError **error,
+			       gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	GVariant *val;
+
+	if (g_strcmp0 (property_name, "DaemonVersion") == 0)
+		return g_variant_new_string (SOURCE_VERSION);
+
+	/* the devices are stale until coldplug has finished */
+	if (g_strcmp0 (property_name, "Status") == 0)
+		return g_variant_new_uint32 (FWUPD_STATUS_LOADING);
+
+	if (g_strcmp0 (property_name, "Interactive") == 0)
+		return g_variant_new_boolean (isatty (fileno (stdout)) != 0);
+
+	val = g_variant_lookup_value (priv->snapshot->properties, property_name, NULL);
+	if (val != NULL)
+		return val;
+
+	/* return an error */
+	g_set_error (error,
+		     G_DBUS_ERROR,
+		     G_DBUS_ERROR_UNKNOWN_PROPERTY,
+		     "daemon property %s not available while loading",
+		     property_name);
+	return NULL;
+}
+
+/* the object is registered without a get_property vfunc so that the
+ * org.freedesktop.DBus.Properties methods can be forwarded like any other */
+static void
+fu_main_properties_method_call (FuMainPrivate *priv,
+				GDBusInterfaceGetPropertyFunc get_property,
+				GDBusMethodInvocation *invocation)
+{
+	GDBusConnection *connection = g_dbus_method_invocation_get_connection (invocation);
+	GDBusInterfaceInfo *info = priv->introspection_daemon->interfaces[0];
+	GVariant *parameters = g_dbus_method_invocation_get_parameters (invocation);
+	const gchar *method_name = g_dbus_method_invocation_get_method_name (invocation);
+	const gchar *object_path = g_dbus_method_invocation_get_object_path (invocation);
+	const gchar *sender = g_dbus_method_invocation_get_sender (invocation);
+
+	if (g_strcmp0 (method_name, "Get") == 0) {
+		const gchar *property_name = NULL;
+		g_autoptr(GError) error = NULL;
+		g_autoptr(GVariant) val = NULL;
+
+		g_variant_get (parameters, "(&s&s)", NULL, &property_name);
+		val = get_property (connection, sender, object_path, info->name,
+				    property_name, &error, priv);
+		if (val == NULL) {
+			g_dbus_method_invocation_return_gerror (invocation, error);
+			return;
+		}
+		g_variant_take_ref (val);
+		g_dbus_method_invocation_return_value (invocation, g_variant_new ("(v)", val));
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetAll") == 0) {
+		GVariantBuilder builder;
+
+		g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+		for (guint i = 0; info->properties[i] != NULL; i++) {
+			const gchar *property_name = info->properties[i]->name;
+			g_autoptr(GVariant) val = NULL;
+
+			val = get_property (connection, sender, object_path, info->name,
+					    property_name, NULL, priv);
+			if (val == NULL)
+				continue;
+			g_variant_take_ref (val);
+			g_variant_builder_add (&builder, "{sv}", property_name, val);
+		}
+		g_dbus_method_invocation_return_value (invocation,
+						       g_variant_new ("(a{sv})", &builder));
+		return;
+	}
+	g_dbus_method_invocation_return_error (invocation,
+					       G_DBUS_ERROR,
+					       G_DBUS_ERROR_UNKNOWN_METHOD,
+					       "no such method %s", method_name);
+}
+
+/* called in the main thread once the engine has loaded */
+static void
+fu_main_snapshot_dispatch (FuMainPrivate *priv, GDBusMethodInvocation *invocation)
+{
+	const gchar *interface_name = g_dbus_method_invocation_get_interface_name (invocation);
+
+	if (g_strcmp0 (interface_name, "org.freedesktop.DBus.Properties") == 0) {
+		fu_main_properties_method_call (priv, fu_main_daemon_get_property, invocation);
+		return;
+	}
+	fu_main_daemon_method_call (g_dbus_method_invocation_get_connection (invocation),
+				    g_dbus_method_invocation_get_sender (invocation),
+				    g_dbus_method_invocation_get_object_path (invocation),
+				    interface_name,
+				    g_dbus_method_invocation_get_method_name (invocation),
+				    g_dbus_method_invocation_get_parameters (invocation),
+				    invocation, priv);
+}
+
+static gboolean
+fu_main_snapshot_forward_cb (gpointer user_data)
+{
+	GDBusMethodInvocation *invocation = G_DBUS_METHOD_INVOCATION (user_data);
+	fu_main_snapshot_dispatch (g_dbus_method_invocation_get_user_data (invocation),
+				   invocation);
+	return G_SOURCE_REMOVE;
+}
+
+/* called in the snapshot thread */
+static void
+fu_main_snapshot_method_call (GDBusConnection *connection, const gchar *sender,
+			      const gchar *object_path, const gchar *interface_name,
+			      const gchar *method_name, GVariant *parameters,
+			      GDBusMethodInvocation *invocation, gpointer user_data)
+{
+	FuMainPrivate *priv = (FuMainPrivate *) user_data;
+	FuMainSnapshot *snapshot = priv->snapshot;
+	g_autoptr(GMutexLocker) locker = g_mutex_locker_new (&snapshot->mutex);
+
+	/* the engine has loaded, so everything is handled in the main thread */
+	if (snapshot->loaded) {
+		g_main_context_invoke (NULL, fu_main_snapshot_forward_cb, invocation);
+		return;
+	}
+
+	if (g_strcmp0 (interface_name, "org.freedesktop.DBus.Properties") == 0) {
+		fu_main_properties_method_call (priv, fu_main_snapshot_get_property, invocation);
+		return;
+	}
+	if (g_strcmp0 (method_name, "GetDevices") == 0) {
+		g_debug ("Called %s() using snapshot", method_name);
+		g_dbus_method_invocation_return_value (invocation,
+						       g_variant_new ("(@aa{sv})",
+								      snapshot->devices));
+		return;
+	}
+
+	/* everything else has to wait for the engine */
+	g_debug ("Called %s(), deferring until loaded", method_name);
+	g_ptr_array_add (snapshot->invocations, invocation);
+}
+
+static gpointer
+fu_main_snapshot_thread_cb (gpointer user_data)
+{
+	FuMainSnapshot *snapshot = (FuMainSnapshot *) user_data;
+	g_main_context_push_thread_default (snapshot->context);
+	g_main_loop_run (snapshot->loop);
+	g_main_context_pop_thread_default (snapshot->context);
+	return NULL;
+}
+
+/* answer GetDevices from the last run while the engine is loading */
+static gboolean
+fu_main_snapshot_start (FuMainPrivate *priv, GError **error)
+{
+	FuMainSnapshot *snapshot;
+	g_autoptr(FuMainSnapshot) snapshot_tmp = NULL;
+	static const GDBusInterfaceVTable interface_vtable = {
+		fu_main_snapshot_method_call,
+		NULL,
+		NULL
+	};
+
+	snapshot_tmp = fu_main_snapshot_load (error);
+	if (snapshot_tmp == NULL)
+		return FALSE;
+	snapshot_tmp->connection = g_bus_get_sync (G_BUS_TYPE_SYSTEM, NULL, error);
+	if (snapshot_tmp->connection == NULL)
+		return FALSE;
+
+	/* method calls are dispatched in the thread-default context */
+	g_main_context_push_thread_default (snapshot_tmp->context);
+	snapshot_tmp->registration_id =
+		g_dbus_connection_register_object (snapshot_tmp->connection,
+						   FWUPD_DBUS_PATH,
+						   priv->introspection_daemon->interfaces[0],
+						   &interface_vtable,
+						   priv,  /* user_data */
+						   NULL,  /* user_data_free_func */
+						   error);
+	g_main_context_pop_thread_default (snapshot_tmp->context);
+	if (snapshot_tmp->registration_id == 0)
+		return FALSE;
+
+	/* the method handler uses priv->snapshot, so set it before serving */
+	priv->snapshot = g_steal_pointer (&snapshot_tmp);
+	snapshot = priv->snapshot;
+	snapshot->loop = g_main_loop_new (snapshot->context, FALSE);
+	snapshot->thread = g_thread_new ("fu-snapshot", fu_main_snapshot_thread_cb, snapshot);
+
+	/* emit signals as devices are coldplugged */
+	priv->connection = g_object_ref (snapshot->connection);
+	priv->owner_id = g_bus_own_name_on_connection (priv->connection,
+						       FWUPD_DBUS_SERVICE,
+						       G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT |
+						       G_BUS_NAME_OWNER_FLAGS_REPLACE,
+						       fu_main_on_name_acquired_cb,
+						       fu_main_on_name_lost_cb,
+						       priv, NULL);
+	g_debug ("serving snapshot of %" G_GSIZE_FORMAT " devices",
+		 g_variant_n_children (snapshot->devices));
+	return TRUE;
+}
+
+/* switch to the real engine, then catch up */
+static void
+fu_main_snapshot_stop (FuMainPrivate *priv)
+{
+	FuMainSnapshot *snapshot = priv->snapshot;
+	GHashTableIter iter;
+	gpointer value;
+	g_autoptr(GPtrArray) invocations = NULL;
+
+	/* the object is not replaced by the real one, as any call made between
+	 * the unregister and the register would fail; from now on the snapshot
+	 * thread forwards each call to the main thread instead */
+	g_mutex_lock (&snapshot->mutex);
+	snapshot->loaded = TRUE;
+	invocations = g_steal_pointer (&snapshot->invocations);
+	snapshot->invocations = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
+	g_clear_pointer (&snapshot->properties, g_variant_unref);
+	g_clear_pointer (&snapshot->devices, g_variant_unref);
+	g_mutex_unlock (&snapshot->mutex);
+	fu_main_setup_connection (priv);
+
+	/* run anything that was waiting, in the order it arrived */
+	for (guint i = 0; i < invocations->len; i++) {
+		GDBusMethodInvocation *invocation = g_ptr_array_index (invocations, i);
+		fu_main_snapshot_dispatch (priv, g_object_ref (invocation));
+	}
+
+	/* devices from the snapshot that did not come back */
+	g_hash_table_iter_init (&iter, snapshot->unseen);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		GVariant *val = g_variant_ref ((GVariant *) value);
+		g_dbus_connection_emit_signal (priv->connection,
+					       NULL,
+					       FWUPD_DBUS_PATH,
+					       FWUPD_DBUS_INTERFACE,
+					       "DeviceRemoved",
+					       g_variant_new_tuple (&val, 1), NULL);
+	}
+	g_hash_table_remove_all (snapshot->unseen);
+}
+
 static gboolean
 fu_main_timed_exit_cb (gpointer user_data)
 {
@@ -1793,14 +2396,31 @@ fu_main_memory_monitor_warning_cb (GMemoryMonitor *memory_monitor,
 				   GMemoryMonitorWarningLevel level,
 				   FuMainPrivate *priv)
 {
-	/* can do straight away? */
+	FuEngineMemoryTier tier = FU_ENGINE_MEMORY_TIER_CACHES;
+	guint64 freed;
+
+	/* the engine is in use */
 	if (priv->update_in_progress) {
+		if (level < G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL)
+			return;
 		g_warning ("OOM during a firmware update, ignoring");
 		priv->pending_sigterm = TRUE;
 		return;
 	}
-	g_debug ("OOM event, shutting down");
-	g_main_loop_quit (priv->loop);
+
+	/* drop what can be recreated, which is much cheaper than a cold start */
+	if (level >= G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL)
+		tier = FU_ENGINE_MEMORY_TIER_HEAP;
+	else if (level >= G_MEMORY_MONITOR_WARNING_LEVEL_MEDIUM)
+		tier = FU_ENGINE_MEMORY_TIER_METADATA;
+	freed = fu_engine_shed_memory (priv->engine, tier);
+	g_debug ("OOM event, released %" G_GUINT64_FORMAT " bytes", freed);
+
+	/* last resort, as we can just rescan hardware */
+	if (level >= G_MEMORY_MONITOR_WARNING_LEVEL_CRITICAL) {
+		g_debug ("critical OOM event, shutting down");
+		g_main_loop_quit (priv->loop);
+	}
 }
 #endif
 
@@ -1850,7 +2470,11 @@ fu_main_is_container (void)
 static void
 fu_main_private_free (FuMainPrivate *priv)
 {
+	if (priv->snapshot != NULL)
+		fu_main_snapshot_free (priv->snapshot);
 	g_hash_table_unref (priv->sender_features);
+	g_hash_table_unref (priv->sender_requests);
+	g_hash_table_unref (priv->method_stats);
 	if (priv->loop != NULL)
 		g_main_loop_unref (priv->loop);
 	if (priv->owner_id > 0)
@@ -1859,8 +2483,16 @@ fu_main_private_free (FuMainPrivate *priv)
 		g_object_unref (priv->proxy_uid);
 	if (priv->engine != NULL)
 		g_object_unref (priv->engine);
-	if (priv->connection != NULL)
+	if (priv->connection != NULL) {
+		GHashTableIter iter;
+		gpointer value;
+		g_hash_table_iter_init (&iter, priv->sender_watches);
+		while (g_hash_table_iter_next (&iter, NULL, &value))
+			g_dbus_connection_signal_unsubscribe (priv->connection,
+							      GPOINTER_TO_UINT (value));
 		g_object_unref (priv->connection);
+	}
+	g_hash_table_unref (priv->sender_watches);
 #ifdef HAVE_POLKIT
 	if (priv->authority != NULL)
 		g_object_unref (priv->authority);
@@ -1899,6 +2531,7 @@ main (int argc, char *argv[])
 	};
 	g_autoptr(FuMainPrivate) priv = NULL;
 	g_autoptr(GError) error = NULL;
+	g_autoptr(GError) error_snapshot = NULL;
 	g_autoptr(GFile) argv0_file = g_file_new_for_path (argv[0]);
 	g_autoptr(GOptionContext) context = NULL;
 
@@ -1923,6 +2556,11 @@ main (int argc, char *argv[])
 	/* create new objects */
 	priv = g_new0 (FuMainPrivate, 1);
 	priv->sender_features = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	priv->sender_requests = g_hash_table_new_full (g_str_hash, g_str_equal,
+						       g_free, (GDestroyNotify) g_object_unref);
+	priv->sender_watches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+	priv->method_stats = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	priv->method_stats_heap = g_getenv ("FWUPD_HEAP_VERBOSE") != NULL;
 	priv->loop = g_main_loop_new (NULL, FALSE);
 
 	/* load engine */
@@ -1945,6 +2583,19 @@ main (int argc, char *argv[])
 	g_signal_connect (priv->engine, "percentage-changed",
 			  G_CALLBACK (fu_main_engine_percentage_changed_cb),
 			  priv);
+
+	/* load introspection from file */
+	priv->introspection_daemon = fu_main_load_introspection (FWUPD_DBUS_INTERFACE ".xml",
+								 &error);
+	if (priv->introspection_daemon == NULL) {
+		g_printerr ("Failed to load introspection: %s\n", error->message);
+		return EXIT_FAILURE;
+	}
+
+	/* clients do not have to wait for coldplug to get the device list */
+	if (!fu_main_snapshot_start (priv, &error_snapshot))
+		g_debug ("not using device snapshot: %s", error_snapshot->message);
+
 	if (!fu_engine_load (priv->engine,
 			     FU_ENGINE_LOAD_FLAG_COLDPLUG |
 			     FU_ENGINE_LOAD_FLAG_HWINFO |
@@ -1958,6 +2609,11 @@ main (int argc, char *argv[])
 				SIGTERM, fu_main_sigterm_cb,
 				priv, NULL);
 
+	/* dump the per-method statistics */
+	g_unix_signal_add_full (G_PRIORITY_DEFAULT,
+				SIGUSR1, fu_main_sigusr1_cb,
+				priv, NULL);
+
 	/* restart the daemon if the binary gets replaced */
 	priv->argv0_monitor = g_file_monitor_file (argv0_file, G_FILE_MONITOR_NONE,
 						   NULL, &error);
@@ -1965,20 +2621,12 @@ main (int argc, char *argv[])
 			  G_CALLBACK (fu_main_argv_changed_cb), priv);
 
 #if GLIB_CHECK_VERSION(2,63,3)
-	/* shut down on low memory event as we can just rescan hardware */
+	/* release caches on low memory events */
 	priv->memory_monitor = g_memory_monitor_dup_default ();
 	g_signal_connect (G_OBJECT (priv->memory_monitor), "low-memory-warning",
 			  G_CALLBACK (fu_main_memory_monitor_warning_cb), priv);
 #endif
 
-	/* load introspection from file */
-	priv->introspection_daemon = fu_main_load_introspection (FWUPD_DBUS_INTERFACE ".xml",
-								 &error);
-	if (priv->introspection_daemon == NULL) {
-		g_printerr ("Failed to load introspection: %s\n", error->message);
-		return EXIT_FAILURE;
-	}
-
 #ifdef HAVE_POLKIT
 	/* get authority */
 	priv->authority = polkit_authority_get_sync (NULL, &error);
@@ -1995,15 +2643,19 @@ main (int argc, char *argv[])
 		priv->machine_kind = FU_MAIN_MACHINE_KIND_CONTAINER;
 	}
 
-	/* own the object */
-	priv->owner_id = g_bus_own_name (G_BUS_TYPE_SYSTEM,
-					 FWUPD_DBUS_SERVICE,
-					 G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT |
-					 G_BUS_NAME_OWNER_FLAGS_REPLACE,
-					 fu_main_on_bus_acquired_cb,
-					 fu_main_on_name_acquired_cb,
-					 fu_main_on_name_lost_cb,
-					 priv, NULL);
+	/* own the object, or replace the one serving the snapshot */
+	if (priv->snapshot != NULL) {
+		fu_main_snapshot_stop (priv);
+	} else {
+		priv->owner_id = g_bus_own_name (G_BUS_TYPE_SYSTEM,
+						 FWUPD_DBUS_SERVICE,
+						 G_BUS_NAME_OWNER_FLAGS_ALLOW_REPLACEMENT |
+						 G_BUS_NAME_OWNER_FLAGS_REPLACE,
+						 fu_main_on_bus_acquired_cb,
+						 fu_main_on_name_acquired_cb,
+						 fu_main_on_name_lost_cb,
+						 priv, NULL);
+	}
 
 	/* Only timeout and close the mainloop if we have specified it
 	 * on the command line */
@@ -2021,6 +2673,9 @@ main (int argc, char *argv[])
 	g_message ("Daemon ready for requests (locale %s)", g_getenv ("LANG"));
 	g_main_loop_run (priv->loop);
 
+	/* make the next startup faster */
+	fu_main_snapshot_save (priv);
+
 #ifdef HAVE_SYSTEMD
 	/* notify the service manager */
 	sd_notify (0, "STOPPING=1");
@@ -9,6 +9,7 @@
 #include "config.h"
 
 #include <glib-object.h>
+#include <string.h>
 
 #include "fu-plugin-list.h"
 #include "fu-plugin-private.h"
@@ -32,6 +33,7 @@ struct _FuPluginList
 	GObject			 parent_instance;
 	GPtrArray		*plugins;		/* of FuPlugin */
 	GHashTable		*plugins_hash;		/* of name : FuPlugin */
+	GPtrArray		*levels;		/* of GPtrArray of FuPlugin */
 };
 
 G_DEFINE_TYPE (FuPluginList, fu_plugin_list, G_TYPE_OBJECT)
@@ -113,6 +115,161 @@ fu_plugin_list_sort_cb (gconstpointer a, gconstpointer b)
 	return fu_plugin_order_compare (*pa, *pb);
 }
 
+/* a directed graph of plugin indexes, where an edge means "before" */
+typedef struct {
+	GPtrArray	*edges;		/* of GArray of guint */
+	guint		*indegree;
+} FuPluginListGraph;
+
+static FuPluginListGraph *
+fu_plugin_list_graph_new (guint len)
+{
+	FuPluginListGraph *graph = g_new0 (FuPluginListGraph, 1);
+	graph->edges = g_ptr_array_new_with_free_func ((GDestroyNotify) g_array_unref);
+	for (guint i = 0; i < len; i++)
+		g_ptr_array_add (graph->edges, g_array_new (FALSE, FALSE, sizeof(guint)));
+	graph->indegree = g_new0 (guint, len);
+	return graph;
+}
+
+static void
+fu_plugin_list_graph_free (FuPluginListGraph *graph)
+{
+	g_ptr_array_unref (graph->edges);
+	g_free (graph->indegree);
+	g_free (graph);
+}
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-function"
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuPluginListGraph, fu_plugin_list_graph_free)
+#pragma clang diagnostic pop
+
+static void
+fu_plugin_list_graph_add_edge (FuPluginListGraph *graph, guint from, guint to)
+{
+	GArray *edges = g_ptr_array_index (graph->edges, from);
+	for (guint i = 0; i < edges->len; i++) {
+		if (g_array_index (edges, guint, i) == to)
+			return;
+	}
+	g_array_append_val (edges, to);
+	graph->indegree[to]++;
+}
+
+/* add an edge for each enabled plugin referenced by @rule; if @reverse is set
+ * the referenced plugin comes after @plugin rather than before it */
+static void
+fu_plugin_list_graph_add_rules (FuPluginList *self,
+				FuPluginListGraph *graph,
+				GHashTable *indexes,
+				guint idx,
+				FuPluginRule rule,
+				gboolean reverse)
+{
+	FuPlugin *plugin = g_ptr_array_index (self->plugins, idx);
+	GPtrArray *deps = fu_plugin_get_rules (plugin, rule);
+
+	if (deps == NULL)
+		return;
+	for (guint j = 0; j < deps->len; j++) {
+		const gchar *plugin_name = g_ptr_array_index (deps, j);
+		FuPlugin *dep = g_hash_table_lookup (self->plugins_hash, plugin_name);
+		gpointer idx_dep = NULL;
+
+		if (dep == NULL ||
+		    !g_hash_table_lookup_extended (indexes, dep, NULL, &idx_dep)) {
+			g_debug ("cannot find plugin '%s' "
+				 "referenced by '%s'",
+				 plugin_name,
+				 fu_plugin_get_name (plugin));
+			continue;
+		}
+		if (fu_plugin_has_flag (dep, FWUPD_PLUGIN_FLAG_DISABLED))
+			continue;
+		if (GPOINTER_TO_UINT (idx_dep) == idx) {
+			g_debug ("ignoring self-reference in %s",
+				 fu_plugin_get_name (plugin));
+			continue;
+		}
+		if (reverse) {
+			fu_plugin_list_graph_add_edge (graph, idx,
+						       GPOINTER_TO_UINT (idx_dep));
+		} else {
+			fu_plugin_list_graph_add_edge (graph,
+						       GPOINTER_TO_UINT (idx_dep),
+						       idx);
+		}
+	}
+}
+
+/* Kahn's algorithm; returns the plugin indexes in dependency order */
+static GArray *
+fu_plugin_list_graph_sort (FuPluginList *self,
+			   FuPluginListGraph *graph,
+			   const gchar *kind,
+			   GError **error)
+{
+	guint len = self->plugins->len;
+	g_autoptr(GArray) sorted = g_array_sized_new (FALSE, FALSE, sizeof(guint), len);
+	g_autofree guint *indegree = g_new (guint, len);
+
+	memcpy (indegree, graph->indegree, sizeof(guint) * len);
+
+	for (guint i = 0; i < len; i++) {
+		if (indegree[i] == 0)
+			g_array_append_val (sorted, i);
+	}
+	for (guint i = 0; i < sorted->len; i++) {
+		guint idx = g_array_index (sorted, guint, i);
+		GArray *edges = g_ptr_array_index (graph->edges, idx);
+		for (guint j = 0; j < edges->len; j++) {
+			guint idx_to = g_array_index (edges, guint, j);
+			if (--indegree[idx_to] == 0)
+				g_array_append_val (sorted, idx_to);
+		}
+	}
+
+	/* anything left over is part of, or depends on, a cycle */
+	if (sorted->len != len) {
+		g_autoptr(GString) str = g_string_new (NULL);
+		for (guint i = 0; i < len; i++) {
+			FuPlugin *plugin = g_ptr_array_index (self->plugins, i);
+			if (indegree[i] == 0)
+				continue;
+			if (str->len > 0)
+				g_string_append (str, ", ");
+			g_string_append (str, fu_plugin_get_name (plugin));
+		}
+		g_set_error (error,
+			     FWUPD_ERROR,
+			     FWUPD_ERROR_INTERNAL,
+			     "%s rules contain a dependency loop: %s",
+			     kind, str->str);
+		return NULL;
+	}
+	return g_steal_pointer (&sorted);
+}
+
+/**
+ * fu_plugin_list_get_levels:
+ * @self: a #FuPluginList
+ *
+ * Gets the plugins grouped by the level computed by fu_plugin_list_depsolve().
+ * Plugins in the same level have no ordering rules between them, and all the
+ * plugins in a level only depend on plugins in earlier levels.
+ *
+ * Returns: (transfer none) (element-type GPtrArray): the levels, each an array of #FuPlugin
+ *
+ * Since: 1.6.2
+ **/
+GPtrArray *
+fu_plugin_list_get_levels (FuPluginList *self)
+{
+	g_return_val_if_fail (FU_IS_PLUGIN_LIST (self), NULL);
+	return self->levels;
+}
+
 /**
  * fu_plugin_list_depsolve:
  * @self: a #FuPluginList
@@ -123,6 +280,10 @@ fu_plugin_list_sort_cb (gconstpointer a, gconstpointer b)
  * may be important. Use fu_plugin_add_rule() to affect the depsolved order
  * if required.
  *
+ * The order of each plugin is set to the length of the longest chain of
+ * run-after and run-before rules leading to it, and the priority is raised
+ * above any plugin it is better than.
+ *
  * Returns: %TRUE for success, or %FALSE if the set could not be depsolved
  *
  * Since: 1.0.2
@@ -130,131 +291,92 @@ fu_plugin_list_sort_cb (gconstpointer a, gconstpointer b)
 gboolean
 fu_plugin_list_depsolve (FuPluginList *self, GError **error)
 {
-	FuPlugin *dep;
-	GPtrArray *deps;
-	gboolean changes;
-	guint dep_loop_check = 0;
+	guint len;
+	g_autofree guint *levels = NULL;
+	g_autoptr(FuPluginListGraph) graph_order = NULL;
+	g_autoptr(FuPluginListGraph) graph_prio = NULL;
+	g_autoptr(GArray) sorted_order = NULL;
+	g_autoptr(GArray) sorted_prio = NULL;
+	g_autoptr(GHashTable) indexes = g_hash_table_new (g_direct_hash, g_direct_equal);
 
 	g_return_val_if_fail (FU_IS_PLUGIN_LIST (self), FALSE);
 	g_return_val_if_fail (error == NULL || *error == NULL, FALSE);
 
+	/* build the graphs */
+	len = self->plugins->len;
+	for (guint i = 0; i < len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (self->plugins, i);
+		g_hash_table_insert (indexes, plugin, GUINT_TO_POINTER (i));
+	}
+	graph_order = fu_plugin_list_graph_new (len);
+	graph_prio = fu_plugin_list_graph_new (len);
+	for (guint i = 0; i < len; i++) {
+		fu_plugin_list_graph_add_rules (self, graph_order, indexes, i,
+						FU_PLUGIN_RULE_RUN_AFTER, FALSE);
+		fu_plugin_list_graph_add_rules (self, graph_order, indexes, i,
+						FU_PLUGIN_RULE_RUN_BEFORE, TRUE);
+		fu_plugin_list_graph_add_rules (self, graph_prio, indexes, i,
+						FU_PLUGIN_RULE_BETTER_THAN, FALSE);
+	}
+
 	/* order by deps */
-	do {
-		changes = FALSE;
-		for (guint i = 0; i < self->plugins->len; i++) {
-			FuPlugin *plugin = g_ptr_array_index (self->plugins, i);
-			deps = fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_RUN_AFTER);
-			if (deps == NULL)
-				continue;
-			for (guint j = 0; j < deps->len && !changes; j++) {
-				const gchar *plugin_name = g_ptr_array_index (deps, j);
-				dep = fu_plugin_list_find_by_name (self, plugin_name, NULL);
-				if (dep == NULL) {
-					g_debug ("cannot find plugin '%s' "
-						 "requested by '%s'",
-						 plugin_name,
-						 fu_plugin_get_name (plugin));
-					continue;
-				}
-				if (fu_plugin_has_flag (dep, FWUPD_PLUGIN_FLAG_DISABLED))
-					continue;
-				if (fu_plugin_get_order (plugin) <= fu_plugin_get_order (dep)) {
-					g_debug ("%s [%u] to be ordered after %s [%u] "
-						 "so promoting to [%u]",
-						 fu_plugin_get_name (plugin),
-						 fu_plugin_get_order (plugin),
-						 fu_plugin_get_name (dep),
-						 fu_plugin_get_order (dep),
-						 fu_plugin_get_order (dep) + 1);
-					fu_plugin_set_order (plugin, fu_plugin_get_order (dep) + 1);
-					changes = TRUE;
-				}
-			}
+	sorted_order = fu_plugin_list_graph_sort (self, graph_order, "order", error);
+	if (sorted_order == NULL)
+		return FALSE;
+	levels = g_new0 (guint, len);
+	for (guint i = 0; i < sorted_order->len; i++) {
+		guint idx = g_array_index (sorted_order, guint, i);
+		GArray *edges = g_ptr_array_index (graph_order->edges, idx);
+		for (guint j = 0; j < edges->len; j++) {
+			guint idx_to = g_array_index (edges, guint, j);
+			levels[idx_to] = MAX(levels[idx_to], levels[idx] + 1);
 		}
-		for (guint i = 0; i < self->plugins->len; i++) {
-			FuPlugin *plugin = g_ptr_array_index (self->plugins, i);
-			deps = fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_RUN_BEFORE);
-			if (deps == NULL)
-				continue;
-			for (guint j = 0; j < deps->len && !changes; j++) {
-				const gchar *plugin_name = g_ptr_array_index (deps, j);
-				dep = fu_plugin_list_find_by_name (self, plugin_name, NULL);
-				if (dep == NULL) {
-					g_debug ("cannot find plugin '%s' "
-						 "requested by '%s'",
-						 plugin_name,
-						 fu_plugin_get_name (plugin));
-					continue;
-				}
-				if (fu_plugin_has_flag (dep, FWUPD_PLUGIN_FLAG_DISABLED))
-					continue;
-				if (fu_plugin_get_order (plugin) >= fu_plugin_get_order (dep)) {
-					g_debug ("%s [%u] to be ordered before %s [%u] "
-						 "so promoting to [%u]",
-						 fu_plugin_get_name (plugin),
-						 fu_plugin_get_order (plugin),
-						 fu_plugin_get_name (dep),
-						 fu_plugin_get_order (dep),
-						 fu_plugin_get_order (dep) + 1);
-					fu_plugin_set_order (dep, fu_plugin_get_order (plugin) + 1);
-					changes = TRUE;
-				}
-			}
+	}
+	for (guint i = 0; i < len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (self->plugins, i);
+		if (fu_plugin_get_order (plugin) != levels[i]) {
+			g_debug ("%s ordered at level [%u]",
+				 fu_plugin_get_name (plugin), levels[i]);
 		}
+		fu_plugin_set_order (plugin, levels[i]);
+	}
 
-		/* set priority as well */
-		for (guint i = 0; i < self->plugins->len; i++) {
-			FuPlugin *plugin = g_ptr_array_index (self->plugins, i);
-			deps = fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_BETTER_THAN);
-			if (deps == NULL)
-				continue;
-			for (guint j = 0; j < deps->len && !changes; j++) {
-				const gchar *plugin_name = g_ptr_array_index (deps, j);
-				dep = fu_plugin_list_find_by_name (self, plugin_name, NULL);
-				if (dep == NULL) {
-					g_debug ("cannot find plugin '%s' "
-						 "referenced by '%s'",
-						 plugin_name,
-						 fu_plugin_get_name (plugin));
-					continue;
-				}
-				if (fu_plugin_has_flag (dep, FWUPD_PLUGIN_FLAG_DISABLED))
-					continue;
-				if (fu_plugin_get_priority (plugin) <= fu_plugin_get_priority (dep)) {
-					g_debug ("%s [%u] better than %s [%u] "
-						 "so bumping to [%u]",
-						 fu_plugin_get_name (plugin),
-						 fu_plugin_get_priority (plugin),
-						 fu_plugin_get_name (dep),
-						 fu_plugin_get_priority (dep),
-						 fu_plugin_get_priority (dep) + 1);
-					fu_plugin_set_priority (plugin, fu_plugin_get_priority (dep) + 1);
-					changes = TRUE;
-				}
+	/* set priority as well */
+	sorted_prio = fu_plugin_list_graph_sort (self, graph_prio, "priority", error);
+	if (sorted_prio == NULL)
+		return FALSE;
+	for (guint i = 0; i < sorted_prio->len; i++) {
+		guint idx = g_array_index (sorted_prio, guint, i);
+		FuPlugin *worse = g_ptr_array_index (self->plugins, idx);
+		GArray *edges = g_ptr_array_index (graph_prio->edges, idx);
+		for (guint j = 0; j < edges->len; j++) {
+			guint idx_to = g_array_index (edges, guint, j);
+			FuPlugin *better = g_ptr_array_index (self->plugins, idx_to);
+			if (fu_plugin_get_priority (better) <= fu_plugin_get_priority (worse)) {
+				g_debug ("%s [%u] better than %s [%u] "
+					 "so bumping to [%u]",
+					 fu_plugin_get_name (better),
+					 fu_plugin_get_priority (better),
+					 fu_plugin_get_name (worse),
+					 fu_plugin_get_priority (worse),
+					 fu_plugin_get_priority (worse) + 1);
+				fu_plugin_set_priority (better, fu_plugin_get_priority (worse) + 1);
 			}
 		}
-
-		/* check we're not stuck */
-		if (dep_loop_check++ > 100) {
-			g_set_error_literal (error,
-					     FWUPD_ERROR,
-					     FWUPD_ERROR_INTERNAL,
-					     "got stuck in dep loop");
-			return FALSE;
-		}
-	} while (changes);
+	}
 
 	/* check for conflicts */
-	for (guint i = 0; i < self->plugins->len; i++) {
+	for (guint i = 0; i < len; i++) {
 		FuPlugin *plugin = g_ptr_array_index (self->plugins, i);
+		GPtrArray *deps;
 		if (fu_plugin_has_flag (plugin, FWUPD_PLUGIN_FLAG_DISABLED))
 			continue;
 		deps = fu_plugin_get_rules (plugin, FU_PLUGIN_RULE_CONFLICTS);
 		if (deps == NULL)
 			continue;
-		for (guint j = 0; j < deps->len && !changes; j++) {
+		for (guint j = 0; j < deps->len; j++) {
 			const gchar *plugin_name = g_ptr_array_index (deps, j);
-			dep = fu_plugin_list_find_by_name (self, plugin_name, NULL);
+			FuPlugin *dep = fu_plugin_list_find_by_name (self, plugin_name, NULL);
 			if (dep == NULL)
 				continue;
 			if (fu_plugin_has_flag (dep, FWUPD_PLUGIN_FLAG_DISABLED))
@@ -268,6 +390,19 @@ fu_plugin_list_depsolve (FuPluginList *self, GError **error)
 
 	/* sort by order */
 	g_ptr_array_sort (self->plugins, fu_plugin_list_sort_cb);
+
+	/* group into levels */
+	g_ptr_array_set_size (self->levels, 0);
+	for (guint i = 0; i < self->plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (self->plugins, i);
+		guint order = fu_plugin_get_order (plugin);
+		while (self->levels->len <= order) {
+			g_ptr_array_add (self->levels,
+					 g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref));
+		}
+		g_ptr_array_add (g_ptr_array_index (self->levels, order),
+				 g_object_ref (plugin));
+	}
 	return TRUE;
 }
 
@@ -284,6 +419,7 @@ fu_plugin_list_init (FuPluginList *self)
 	self->plugins = g_ptr_array_new_with_free_func ((GDestroyNotify) g_object_unref);
 	self->plugins_hash = g_hash_table_new_full (g_str_hash, g_str_equal,
 						    g_free, (GDestroyNotify) g_object_unref);
+	self->levels = g_ptr_array_new_with_free_func ((GDestroyNotify) g_ptr_array_unref);
 }
 
 static void
@@ -293,6 +429,7 @@ fu_plugin_list_finalize (GObject *obj)
 
 	g_ptr_array_unref (self->plugins);
 	g_hash_table_unref (self->plugins_hash);
+	g_ptr_array_unref (self->levels);
 
 	G_OBJECT_CLASS (fu_plugin_list_parent_class)->finalize (obj);
 }
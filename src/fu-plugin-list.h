@@ -22,3 +22,4 @@ FuPlugin	*fu_plugin_list_find_by_name		(FuPluginList	*self,
 							 GError		**error);
 gboolean	 fu_plugin_list_depsolve		(FuPluginList	*self,
 							 GError		**error);
+GPtrArray	*fu_plugin_list_get_levels		(FuPluginList	*self);
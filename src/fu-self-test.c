@@ -601,6 +601,255 @@ fu_engine_requirements_func (gconstpointer user_data)
 	g_assert (ret);
 }
 
+static FwupdSecurityAttr *
+fu_engine_security_attrs_find_test (FuEngine *engine)
+{
+	g_autoptr(FuSecurityAttrs) attrs = fu_engine_get_host_security_attrs (engine);
+	g_autoptr(GPtrArray) items = fu_security_attrs_get_all (attrs);
+	for (guint i = 0; i < items->len; i++) {
+		FwupdSecurityAttr *attr = g_ptr_array_index (items, i);
+		if (g_strcmp0 (fwupd_security_attr_get_appstream_id (attr),
+			       "org.fwupd.hsi.Test") == 0)
+			return g_object_ref (attr);
+	}
+	return NULL;
+}
+
+static void
+fu_engine_security_attrs_cache_func (gconstpointer user_data)
+{
+	FuTest *self = (FuTest *) user_data;
+	gboolean ret;
+	guint64 cnt;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FwupdSecurityAttr) attr1 = NULL;
+	g_autoptr(FwupdSecurityAttr) attr2 = NULL;
+	g_autoptr(FwupdSecurityAttr) attr3 = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
+
+	/* the test plugin only depends on runtime state */
+	g_setenv ("FWUPD_PLUGIN_TEST", "security", TRUE);
+	fu_plugin_set_security_inputs (self->plugin, FU_SECURITY_ATTRS_INPUT_RUNTIME);
+	fu_engine_set_silo (engine, silo_empty);
+	fu_engine_add_plugin (engine, self->plugin);
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert_true (ret);
+	attr1 = fu_engine_security_attrs_find_test (engine);
+	g_assert_nonnull (attr1);
+	cnt = g_ascii_strtoull (fwupd_security_attr_get_metadata (attr1, "Count"), NULL, 10);
+	g_assert_cmpint (cnt, >, 0);
+
+	/* changes to the host attributes do not leak into the cache */
+	fwupd_security_attr_add_flag (attr1, FWUPD_SECURITY_ATTR_FLAG_OBSOLETED);
+
+	/* adding a device is an unrelated input */
+	fu_device_set_id (device, "test_device");
+	fu_device_set_plugin (device, "test");
+	fu_device_add_guid (device, "12345678-1234-1234-1234-123456789012");
+	fu_engine_add_device (engine, device);
+	attr2 = fu_engine_security_attrs_find_test (engine);
+	g_assert_nonnull (attr2);
+	g_assert_cmpint (g_ascii_strtoull (fwupd_security_attr_get_metadata (attr2, "Count"), NULL, 10), ==, cnt);
+	g_assert_false (fwupd_security_attr_has_flag (attr2, FWUPD_SECURITY_ATTR_FLAG_OBSOLETED));
+
+	/* a runtime change recalculates the plugin */
+	fu_context_security_changed (fu_engine_get_context (engine));
+	attr3 = fu_engine_security_attrs_find_test (engine);
+	g_assert_nonnull (attr3);
+	g_assert_cmpint (g_ascii_strtoull (fwupd_security_attr_get_metadata (attr3, "Count"), NULL, 10), ==, cnt + 1);
+
+	fu_plugin_set_security_inputs (self->plugin, FU_SECURITY_ATTRS_INPUT_ALL);
+	g_unsetenv ("FWUPD_PLUGIN_TEST");
+}
+
+static void
+fu_engine_requirements_cache_func (gconstpointer user_data)
+{
+	gboolean ret;
+	guint hits = 0;
+	guint misses = 0;
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(FuEngineRequest) request = fu_engine_request_new ();
+	g_autoptr(FuInstallTask) task = NULL;
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) components = NULL;
+	g_autoptr(XbSilo) silo = NULL;
+	const gchar *xml =
+		"<components>"
+		"  <component>"
+		"    <requires>"
+		"      <id compare=\"ge\" version=\"1.2.3\">org.test.dummy</id>"
+		"    </requires>"
+		"  </component>"
+		"  <component>"
+		"    <requires>"
+		"      <id compare=\"ge\" version=\"1.2.3\">org.test.dummy</id>"
+		"    </requires>"
+		"  </component>"
+		"</components>";
+
+	/* set up some dummy versions */
+	fu_engine_add_runtime_version (engine, "org.test.dummy", "1.2.3");
+
+	/* two components with the identical requirement */
+	silo = xb_silo_new_from_xml (xml, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo);
+	components = xb_silo_query (silo, "components/component", 0, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (components);
+	for (guint i = 0; i < components->len; i++) {
+		XbNode *component = g_ptr_array_index (components, i);
+		g_autoptr(FuInstallTask) task_tmp = fu_install_task_new (NULL, component);
+		ret = fu_engine_check_requirements (engine, request, task_tmp,
+						    FWUPD_INSTALL_FLAG_NONE,
+						    &error);
+		g_assert_no_error (error);
+		g_assert (ret);
+	}
+	fu_engine_get_requirement_cache_stats (engine, &hits, &misses);
+	g_assert_cmpint (hits, ==, 1);
+	g_assert_cmpint (misses, ==, 1);
+
+	/* the result is not reused when the runtime changes */
+	fu_engine_add_runtime_version (engine, "org.test.dummy", "1.2.2");
+	task = fu_install_task_new (NULL, g_ptr_array_index (components, 0));
+	ret = fu_engine_check_requirements (engine, request, task,
+					    FWUPD_INSTALL_FLAG_NONE,
+					    &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INVALID_FILE);
+	g_assert (!ret);
+	g_clear_error (&error);
+	fu_engine_get_requirement_cache_stats (engine, &hits, &misses);
+	g_assert_cmpint (hits, ==, 1);
+	g_assert_cmpint (misses, ==, 2);
+
+	/* or when a plugin changes it directly */
+	fu_context_add_runtime_version (fu_engine_get_context (engine), "org.test.dummy", "1.2.3");
+	ret = fu_engine_check_requirements (engine, request, task,
+					    FWUPD_INSTALL_FLAG_NONE,
+					    &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	fu_engine_get_requirement_cache_stats (engine, &hits, &misses);
+	g_assert_cmpint (hits, ==, 1);
+	g_assert_cmpint (misses, ==, 3);
+}
+
+static void
+fu_engine_md_refresh_func (gconstpointer user_data)
+{
+	gboolean ret;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(XbSilo) silo1 = NULL;
+	g_autoptr(XbSilo) silo2 = NULL;
+	g_autoptr(XbSilo) silo3 = NULL;
+	const gchar *xml1 =
+		"<components>"
+		"  <component type=\"firmware\">"
+		"    <id>com.acme.device</id>"
+		"    <name>ACME Device</name>"
+		"    <provides>"
+		"      <firmware type=\"flashed\">aaaaaaaa-bbbb-cccc-dddd-eeeeeeeeeeee</firmware>"
+		"    </provides>"
+		"  </component>"
+		"  <component type=\"firmware\">"
+		"    <id>com.acme.other</id>"
+		"    <name>ACME Other</name>"
+		"    <provides>"
+		"      <firmware type=\"flashed\">11111111-2222-3333-4444-555555555555</firmware>"
+		"    </provides>"
+		"  </component>"
+		"</components>";
+	const gchar *xml2 =
+		"<components>"
+		"  <component type=\"firmware\">"
+		"    <id>com.acme.device</id>"
+		"    <name>ACME Device</name>"
+		"    <provides>"
+		"      <firmware type=\"flashed\">aaaaaaaa-bbbb-cccc-dddd-eeeeeeeeeeee</firmware>"
+		"    </provides>"
+		"  </component>"
+		"  <component type=\"firmware\">"
+		"    <id>com.acme.other</id>"
+		"    <name>ACME Other</name>"
+		"    <provides>"
+		"      <firmware type=\"flashed\">11111111-2222-3333-4444-555555555555</firmware>"
+		"    </provides>"
+		"    <releases>"
+		"      <release version=\"1.2.3\">"
+		"        <checksum filename=\"foo.cab\" target=\"container\" type=\"sha1\">0123456789012345678901234567890123456789</checksum>"
+		"      </release>"
+		"    </releases>"
+		"  </component>"
+		"</components>";
+	const gchar *xml3 =
+		"<components>"
+		"  <component type=\"firmware\">"
+		"    <id>com.acme.device</id>"
+		"    <name>ACME Device</name>"
+		"    <provides>"
+		"      <firmware type=\"flashed\">aaaaaaaa-bbbb-cccc-dddd-eeeeeeeeeeee</firmware>"
+		"    </provides>"
+		"    <releases>"
+		"      <release version=\"1.2.3\">"
+		"        <checksum filename=\"foo.cab\" target=\"container\" type=\"sha1\">0123456789012345678901234567890123456789</checksum>"
+		"      </release>"
+		"    </releases>"
+		"  </component>"
+		"</components>";
+
+	/* load engine to get FuConfig set up */
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	silo1 = xb_silo_new_from_xml (xml1, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo1);
+	fu_engine_set_silo (engine, silo1);
+
+	/* the name is set from the metadata when added */
+	fu_device_set_id (device, "test_device");
+	fu_device_set_name (device, "Unknown Device");
+	fu_device_add_guid (device, "aaaaaaaa-bbbb-cccc-dddd-eeeeeeeeeeee");
+	fu_device_add_internal_flag (device, FU_DEVICE_INTERNAL_FLAG_MD_SET_NAME);
+	fu_engine_add_device (engine, device);
+	devices = fu_engine_get_devices (engine, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices);
+	g_assert_cmpstr (fu_device_get_name (device), ==, "ACME Device");
+	g_clear_pointer (&devices, g_ptr_array_unref);
+
+	/* a new release for a different device does not refresh this one */
+	fu_device_set_name (device, "Unknown Device");
+	fu_device_add_internal_flag (device, FU_DEVICE_INTERNAL_FLAG_MD_SET_NAME);
+	silo2 = xb_silo_new_from_xml (xml2, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo2);
+	fu_engine_set_silo (engine, silo2);
+	devices = fu_engine_get_devices (engine, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices);
+	g_assert_cmpstr (fu_device_get_name (device), ==, "Unknown Device");
+	g_clear_pointer (&devices, g_ptr_array_unref);
+
+	/* a new release for this device does */
+	silo3 = xb_silo_new_from_xml (xml3, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (silo3);
+	fu_engine_set_silo (engine, silo3);
+	devices = fu_engine_get_devices (engine, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices);
+	g_assert_cmpstr (fu_device_get_name (device), ==, "ACME Device");
+}
+
 static void
 fu_engine_requirements_device_func (gconstpointer user_data)
 {
@@ -1772,6 +2021,45 @@ fu_engine_history_func (gconstpointer user_data)
 	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_NOTHING_TO_DO);
 }
 
+static void
+fu_engine_shed_memory_func (gconstpointer user_data)
+{
+	FuTest *self = (FuTest *) user_data;
+	gboolean ret;
+	g_autofree gchar *host_security_id = NULL;
+	g_autoptr(FuDevice) device = fu_device_new ();
+	g_autoptr(FuEngine) engine = fu_engine_new (FU_APP_FLAGS_NONE);
+	g_autoptr(GError) error = NULL;
+	g_autoptr(GPtrArray) devices = NULL;
+	g_autoptr(XbSilo) silo_empty = xb_silo_new ();
+
+	/* ensure empty tree */
+	fu_self_test_mkroot ();
+
+	/* no metadata in daemon */
+	fu_engine_set_silo (engine, silo_empty);
+
+	/* set up dummy plugin */
+	fu_engine_add_plugin (engine, self->plugin);
+	ret = fu_engine_load (engine, FU_ENGINE_LOAD_FLAG_NONE, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	fu_device_set_id (device, "test_device");
+	fu_device_set_name (device, "Test Device");
+	fu_device_set_plugin (device, "test");
+	fu_device_add_guid (device, "12345678-1234-1234-1234-123456789012");
+	fu_engine_add_device (engine, device);
+	host_security_id = g_strdup (fu_engine_get_host_security_id (engine));
+
+	/* everything is recreated on demand */
+	fu_engine_shed_memory (engine, FU_ENGINE_MEMORY_TIER_HEAP);
+	g_assert_cmpstr (fu_engine_get_host_security_id (engine), ==, host_security_id);
+	devices = fu_engine_get_devices (engine, &error);
+	g_assert_no_error (error);
+	g_assert_nonnull (devices);
+	g_assert_cmpint (devices->len, ==, 1);
+}
+
 static void
 fu_engine_multiple_rels_func (gconstpointer user_data)
 {
@@ -2561,6 +2849,53 @@ fu_plugin_list_depsolve_func (gconstpointer user_data)
 	g_assert_true (fu_plugin_has_flag (plugin, FWUPD_PLUGIN_FLAG_DISABLED));
 }
 
+static void
+fu_plugin_list_depsolve_levels_func (gconstpointer user_data)
+{
+	GPtrArray *levels;
+	GPtrArray *level;
+	gboolean ret;
+	g_autoptr(FuPluginList) plugin_list = fu_plugin_list_new ();
+	g_autoptr(FuPlugin) plugin1 = fu_plugin_new (NULL);
+	g_autoptr(FuPlugin) plugin2 = fu_plugin_new (NULL);
+	g_autoptr(FuPlugin) plugin3 = fu_plugin_new (NULL);
+	g_autoptr(GError) error = NULL;
+
+	fu_plugin_set_name (plugin1, "plugin1");
+	fu_plugin_set_name (plugin2, "plugin2");
+	fu_plugin_set_name (plugin3, "plugin3");
+	fu_plugin_list_add (plugin_list, plugin3);
+	fu_plugin_list_add (plugin_list, plugin2);
+	fu_plugin_list_add (plugin_list, plugin1);
+
+	/* plugin1 and plugin2 are independent, plugin3 needs both */
+	fu_plugin_add_rule (plugin3, FU_PLUGIN_RULE_RUN_AFTER, "plugin1");
+	fu_plugin_add_rule (plugin2, FU_PLUGIN_RULE_RUN_BEFORE, "plugin3");
+	fu_plugin_add_rule (plugin1, FU_PLUGIN_RULE_BETTER_THAN, "plugin2");
+	ret = fu_plugin_list_depsolve (plugin_list, &error);
+	g_assert_no_error (error);
+	g_assert (ret);
+	g_assert_cmpint (fu_plugin_get_order (plugin1), ==, 0);
+	g_assert_cmpint (fu_plugin_get_order (plugin2), ==, 0);
+	g_assert_cmpint (fu_plugin_get_order (plugin3), ==, 1);
+	g_assert_cmpint (fu_plugin_get_priority (plugin1), >, fu_plugin_get_priority (plugin2));
+	levels = fu_plugin_list_get_levels (plugin_list);
+	g_assert_cmpint (levels->len, ==, 2);
+	level = g_ptr_array_index (levels, 0);
+	g_assert_cmpint (level->len, ==, 2);
+	level = g_ptr_array_index (levels, 1);
+	g_assert_cmpint (level->len, ==, 1);
+	g_assert (g_ptr_array_index (level, 0) == plugin3);
+
+	/* add a loop */
+	fu_plugin_add_rule (plugin1, FU_PLUGIN_RULE_RUN_AFTER, "plugin3");
+	ret = fu_plugin_list_depsolve (plugin_list, &error);
+	g_assert_error (error, FWUPD_ERROR, FWUPD_ERROR_INTERNAL);
+	g_assert (!ret);
+	g_assert_nonnull (g_strstr_len (error->message, -1, "plugin1"));
+	g_assert_nonnull (g_strstr_len (error->message, -1, "plugin3"));
+}
+
 static void
 fu_history_migrate_func (gconstpointer user_data)
 {
@@ -3310,6 +3645,8 @@ main (int argc, char **argv)
 			      fu_engine_history_func);
 	g_test_add_data_func ("/fwupd/engine{history-error}", self,
 			      fu_engine_history_error_func);
+	g_test_add_data_func ("/fwupd/engine{shed-memory}", self,
+			      fu_engine_shed_memory_func);
 	if (g_test_slow ()) {
 		g_test_add_data_func ("/fwupd/device-list{replug-auto}", self,
 				      fu_device_list_replug_auto_func);
@@ -3326,6 +3663,12 @@ main (int argc, char **argv)
 			      fu_engine_downgrade_func);
 	g_test_add_data_func ("/fwupd/engine{requirements-success}", self,
 			      fu_engine_requirements_func);
+	g_test_add_data_func ("/fwupd/engine{requirements-cache}", self,
+			      fu_engine_requirements_cache_func);
+	g_test_add_data_func ("/fwupd/engine{md-refresh}", self,
+			      fu_engine_md_refresh_func);
+	g_test_add_data_func ("/fwupd/engine{security-attrs-cache}", self,
+			      fu_engine_security_attrs_cache_func);
 	g_test_add_data_func ("/fwupd/engine{requirements-soft}", self,
 			      fu_engine_requirements_soft_func);
 	g_test_add_data_func ("/fwupd/engine{requirements-missing}", self,
@@ -3376,5 +3719,7 @@ main (int argc, char **argv)
 			      fu_plugin_list_func);
 	g_test_add_data_func ("/fwupd/plugin-list{depsolve}", self,
 			      fu_plugin_list_depsolve_func);
+	g_test_add_data_func ("/fwupd/plugin-list{depsolve-levels}", self,
+			      fu_plugin_list_depsolve_levels_func);
 	return g_test_run ();
 }
@@ -16,6 +16,9 @@
 #endif
 #include <fcntl.h>
 #include <locale.h>
+#ifdef HAVE_MALLINFO2
+#include <malloc.h>
+#endif
 #include <stdlib.h>
 #include <unistd.h>
 #include <jcat.h>
@@ -34,6 +37,7 @@
 #include "fu-debug.h"
 #include "fwupd-common-private.h"
 #include "fwupd-device-private.h"
+#include "fwupd-plugin-private.h"
 
 #ifdef HAVE_SYSTEMD
 #include "fu-systemd.h"
@@ -63,6 +67,7 @@ struct FuUtilPrivate {
 	gboolean		 prepare_blob;
 	gboolean		 cleanup_blob;
 	gboolean		 enable_json_state;
+	gboolean		 as_json;
 	FwupdInstallFlags	 flags;
 	gboolean		 show_all;
 	gboolean		 disable_ssl_strict;
@@ -385,6 +390,81 @@ fu_util_plugin_name_sort_cb (FuPlugin **item1, FuPlugin **item2)
 	return fu_plugin_name_compare (*item1, *item2);
 }
 
+static void
+fu_util_plugin_rules_to_json (JsonBuilder *builder,
+			      FuPlugin *plugin,
+			      FuPluginRule rule,
+			      const gchar *key)
+{
+	GPtrArray *deps = fu_plugin_get_rules (plugin, rule);
+	if (deps == NULL || deps->len == 0)
+		return;
+	json_builder_set_member_name (builder, key);
+	json_builder_begin_array (builder);
+	for (guint i = 0; i < deps->len; i++) {
+		const gchar *plugin_name = g_ptr_array_index (deps, i);
+		json_builder_add_string_value (builder, plugin_name);
+	}
+	json_builder_end_array (builder);
+}
+
+static void
+fu_util_get_plugins_as_json (FuUtilPrivate *priv)
+{
+	GPtrArray *levels = fu_engine_get_plugin_levels (priv->engine);
+	GPtrArray *plugins = fu_engine_get_plugins (priv->engine);
+	g_autofree gchar *data = NULL;
+	g_autoptr(JsonBuilder) builder = json_builder_new ();
+	g_autoptr(JsonGenerator) json_generator = json_generator_new ();
+	g_autoptr(JsonNode) json_root = NULL;
+
+	json_builder_begin_object (builder);
+
+	/* each plugin with the edges of the dependency graph */
+	json_builder_set_member_name (builder, "Plugins");
+	json_builder_begin_array (builder);
+	for (guint i = 0; i < plugins->len; i++) {
+		FuPlugin *plugin = g_ptr_array_index (plugins, i);
+		json_builder_begin_object (builder);
+		fwupd_plugin_to_json (FWUPD_PLUGIN (plugin), builder);
+		json_builder_set_member_name (builder, "Order");
+		json_builder_add_int_value (builder, fu_plugin_get_order (plugin));
+		json_builder_set_member_name (builder, "Priority");
+		json_builder_add_int_value (builder, fu_plugin_get_priority (plugin));
+		fu_util_plugin_rules_to_json (builder, plugin,
+					      FU_PLUGIN_RULE_RUN_AFTER, "RunAfter");
+		fu_util_plugin_rules_to_json (builder, plugin,
+					      FU_PLUGIN_RULE_RUN_BEFORE, "RunBefore");
+		fu_util_plugin_rules_to_json (builder, plugin,
+					      FU_PLUGIN_RULE_BETTER_THAN, "BetterThan");
+		fu_util_plugin_rules_to_json (builder, plugin,
+					      FU_PLUGIN_RULE_CONFLICTS, "Conflicts");
+		json_builder_end_object (builder);
+	}
+	json_builder_end_array (builder);
+
+	/* plugins that have no ordering between them */
+	json_builder_set_member_name (builder, "Levels");
+	json_builder_begin_array (builder);
+	for (guint i = 0; i < levels->len; i++) {
+		GPtrArray *level = g_ptr_array_index (levels, i);
+		json_builder_begin_array (builder);
+		for (guint j = 0; j < level->len; j++) {
+			FuPlugin *plugin = g_ptr_array_index (level, j);
+			json_builder_add_string_value (builder, fu_plugin_get_name (plugin));
+		}
+		json_builder_end_array (builder);
+	}
+	json_builder_end_array (builder);
+	json_builder_end_object (builder);
+
+	json_root = json_builder_get_root (builder);
+	json_generator_set_pretty (json_generator, TRUE);
+	json_generator_set_root (json_generator, json_root);
+	data = json_generator_to_data (json_generator, NULL);
+	g_print ("%s\n", data);
+}
+
 static gboolean
 fu_util_get_plugins (FuUtilPrivate *priv, gchar **values, GError **error)
 {
@@ -397,6 +477,10 @@ fu_util_get_plugins (FuUtilPrivate *priv, gchar **values, GError **error)
 	/* print */
 	plugins = fu_engine_get_plugins (priv->engine);
 	g_ptr_array_sort (plugins, (GCompareFunc) fu_util_plugin_name_sort_cb);
+	if (priv->as_json) {
+		fu_util_get_plugins_as_json (priv);
+		return TRUE;
+	}
 	for (guint i = 0; i < plugins->len; i++) {
 		FuPlugin *plugin = g_ptr_array_index (plugins, i);
 		g_autofree gchar *str = fu_util_plugin_to_string (FWUPD_PLUGIN (plugin), 0);
@@ -2005,10 +2089,130 @@ fu_util_prompt_for_firmware_type (FuUtilPrivate *priv, GError **error)
 	return g_strdup (g_ptr_array_index (firmware_types, idx - 1));
 }
 
+/* only the types that can be cheaply excluded are useful for detection */
+static GArray *
+fu_util_get_firmware_gtypes_with_magic (FuUtilPrivate *priv)
+{
+	FuContext *ctx = fu_engine_get_context (priv->engine);
+	GArray *gtypes = g_array_new (FALSE, FALSE, sizeof(GType));
+	g_autoptr(GPtrArray) firmware_types = fu_context_get_firmware_gtype_ids (ctx);
+
+	for (guint i = 0; i < firmware_types->len; i++) {
+		const gchar *id = g_ptr_array_index (firmware_types, i);
+		GType gtype = fu_context_get_firmware_gtype_by_id (ctx, id);
+		FuFirmwareClass *klass = g_type_class_ref (gtype);
+		if (klass->check_magic != NULL)
+			g_array_append_val (gtypes, gtype);
+		g_type_class_unref (klass);
+	}
+	return gtypes;
+}
+
+typedef struct {
+	gchar			*filename;
+	GArray			*gtypes;	/* noref */
+	FwupdInstallFlags	 flags;
+	FuFirmware		*firmware;	/* nullable */
+	GError			*error;		/* nullable */
+} FuUtilFirmwareParseItem;
+
+static void
+fu_util_firmware_parse_item_free (FuUtilFirmwareParseItem *item)
+{
+	g_free (item->filename);
+	if (item->firmware != NULL)
+		g_object_unref (item->firmware);
+	if (item->error != NULL)
+		g_error_free (item->error);
+	g_free (item);
+}
+
+/* runs in a worker thread, so must only touch the item */
+static void
+fu_util_firmware_parse_item_cb (gpointer data, gpointer user_data)
+{
+	FuUtilFirmwareParseItem *item = (FuUtilFirmwareParseItem *) data;
+	g_autoptr(FuFirmware) firmware = NULL;
+	g_autoptr(GBytes) blob = NULL;
+
+	blob = fu_common_get_contents_bytes (item->filename, &item->error);
+	if (blob == NULL)
+		return;
+	firmware = fu_firmware_new_from_gtype_array (blob, item->gtypes,
+						     item->flags, &item->error);
+	if (firmware == NULL)
+		return;
+
+	/* load any deferred images, as done for a single file */
+	if (!fu_firmware_check (firmware, &item->error))
+		return;
+	item->firmware = g_steal_pointer (&firmware);
+}
+
+static gboolean
+fu_util_firmware_parse_directory (FuUtilPrivate *priv,
+				  const gchar *directory,
+				  GArray *gtypes,
+				  GError **error)
+{
+	GThreadPool *pool;
+	guint cnt_success = 0;
+	gdouble elapsed;
+	g_autoptr(GPtrArray) filenames = NULL;
+	g_autoptr(GPtrArray) items = NULL;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	filenames = fu_common_filename_glob (directory, "*", error);
+	if (filenames == NULL)
+		return FALSE;
+	items = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_util_firmware_parse_item_free);
+	for (guint i = 0; i < filenames->len; i++) {
+		const gchar *filename = g_ptr_array_index (filenames, i);
+		FuUtilFirmwareParseItem *item;
+		if (!g_file_test (filename, G_FILE_TEST_IS_REGULAR))
+			continue;
+		item = g_new0 (FuUtilFirmwareParseItem, 1);
+		item->filename = g_strdup (filename);
+		item->gtypes = gtypes;
+		item->flags = priv->flags;
+		g_ptr_array_add (items, item);
+	}
+
+	/* parse each file in parallel */
+	pool = g_thread_pool_new (fu_util_firmware_parse_item_cb, NULL,
+				  (gint) g_get_num_processors (),
+				  FALSE, error);
+	if (pool == NULL)
+		return FALSE;
+	for (guint i = 0; i < items->len; i++)
+		g_thread_pool_push (pool, g_ptr_array_index (items, i), NULL);
+	g_thread_pool_free (pool, FALSE, TRUE);
+	elapsed = g_timer_elapsed (timer, NULL);
+
+	/* show results in the original order */
+	for (guint i = 0; i < items->len; i++) {
+		FuUtilFirmwareParseItem *item = g_ptr_array_index (items, i);
+		g_autofree gchar *basename = g_path_get_basename (item->filename);
+		if (item->firmware == NULL) {
+			g_print ("%s: %s\n", basename, item->error->message);
+			continue;
+		}
+		g_print ("%s: %s\n", basename, G_OBJECT_TYPE_NAME (item->firmware));
+		cnt_success++;
+	}
+	g_print ("%s: %u/%u, %.2fs, %.1f files/s\n",
+		 /* TRANSLATORS: number of files parsed, time taken, and throughput */
+		 _("Parsed"),
+		 cnt_success, items->len, elapsed,
+		 elapsed > 0.f ? (gdouble) items->len / elapsed : 0.f);
+	return TRUE;
+}
+
 static gboolean
 fu_util_firmware_parse (FuUtilPrivate *priv, gchar **values, GError **error)
 {
 	GType gtype;
+	g_autoptr(GArray) gtypes = NULL;
 	g_autoptr(GBytes) blob = NULL;
 	g_autoptr(FuFirmware) firmware = NULL;
 	g_autofree gchar *firmware_type = NULL;
@@ -2026,30 +2230,64 @@ fu_util_firmware_parse (FuUtilPrivate *priv, gchar **values, GError **error)
 	if (g_strv_length (values) == 2)
 		firmware_type = g_strdup (values[1]);
 
-	/* load file */
-	blob = fu_common_get_contents_bytes (values[0], error);
-	if (blob == NULL)
-		return FALSE;
-
 	/* load engine */
 	if (!fu_engine_load (priv->engine, FU_ENGINE_LOAD_FLAG_READONLY, error))
 		return FALSE;
 
-	/* find the GType to use */
-	if (firmware_type == NULL)
-		firmware_type = fu_util_prompt_for_firmware_type (priv, error);
-	if (firmware_type == NULL)
-		return FALSE;
-	gtype = fu_context_get_firmware_gtype_by_id (fu_engine_get_context (priv->engine), firmware_type);
-	if (gtype == G_TYPE_INVALID) {
-		g_set_error (error,
-			     G_IO_ERROR,
-			     G_IO_ERROR_NOT_FOUND,
-			     "GType %s not supported", firmware_type);
+	/* use the specified type, otherwise detect it from the magic */
+	if (firmware_type != NULL) {
+		gtype = fu_context_get_firmware_gtype_by_id (fu_engine_get_context (priv->engine), firmware_type);
+		if (gtype == G_TYPE_INVALID) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_NOT_FOUND,
+				     "GType %s not supported", firmware_type);
+			return FALSE;
+		}
+		gtypes = g_array_new (FALSE, FALSE, sizeof(GType));
+		g_array_append_val (gtypes, gtype);
+	} else {
+		gtypes = fu_util_get_firmware_gtypes_with_magic (priv);
+	}
+
+	/* batch mode */
+	if (g_file_test (values[0], G_FILE_TEST_IS_DIR))
+		return fu_util_firmware_parse_directory (priv, values[0], gtypes, error);
+
+	/* load file */
+	blob = fu_common_get_contents_bytes (values[0], error);
+	if (blob == NULL)
 		return FALSE;
+
+	/* try the types with matching magic */
+	if (firmware_type == NULL && gtypes->len > 0) {
+		g_autoptr(GError) error_local = NULL;
+		firmware = fu_firmware_new_from_gtype_array (blob, gtypes,
+							     priv->flags,
+							     &error_local);
+		if (firmware == NULL)
+			g_debug ("failed to detect firmware type: %s", error_local->message);
+	}
+
+	/* fall back to asking the user */
+	if (firmware == NULL) {
+		if (firmware_type == NULL)
+			firmware_type = fu_util_prompt_for_firmware_type (priv, error);
+		if (firmware_type == NULL)
+			return FALSE;
+		gtype = fu_context_get_firmware_gtype_by_id (fu_engine_get_context (priv->engine), firmware_type);
+		if (gtype == G_TYPE_INVALID) {
+			g_set_error (error,
+				     G_IO_ERROR,
+				     G_IO_ERROR_NOT_FOUND,
+				     "GType %s not supported", firmware_type);
+			return FALSE;
+		}
+		firmware = g_object_new (gtype, NULL);
+		if (!fu_firmware_parse (firmware, blob, priv->flags, error))
+			return FALSE;
 	}
-	firmware = g_object_new (gtype, NULL);
-	if (!fu_firmware_parse (firmware, blob, priv->flags, error))
+	if (!fu_firmware_check (firmware, error))
 		return FALSE;
 	str = fu_firmware_to_string (firmware);
 	g_print ("%s", str);
@@ -2103,6 +2341,8 @@ fu_util_firmware_export (FuUtilPrivate *priv, gchar **values, GError **error)
 	firmware = g_object_new (gtype, NULL);
 	if (!fu_firmware_parse (firmware, blob, priv->flags, error))
 		return FALSE;
+	if (!fu_firmware_check (firmware, error))
+		return FALSE;
 	if (priv->show_all)
 		flags |= FU_FIRMWARE_EXPORT_FLAG_INCLUDE_DEBUG;
 	str = fu_firmware_export_to_xml (firmware, flags, error);
@@ -2158,6 +2398,8 @@ fu_util_firmware_extract (FuUtilPrivate *priv, gchar **values, GError **error)
 	firmware = g_object_new (gtype, NULL);
 	if (!fu_firmware_parse (firmware, blob, priv->flags, error))
 		return FALSE;
+	if (!fu_firmware_check (firmware, error))
+		return FALSE;
 	str = fu_firmware_to_string (firmware);
 	g_print ("%s", str);
 	images = fu_firmware_get_images (firmware);
@@ -2193,55 +2435,33 @@ fu_util_firmware_extract (FuUtilPrivate *priv, gchar **values, GError **error)
 	return TRUE;
 }
 
-static gboolean
-fu_util_firmware_build (FuUtilPrivate *priv, gchar **values, GError **error)
+static FuFirmware *
+fu_util_firmware_new_from_builder (FuUtilPrivate *priv, GBytes *blob_src, GError **error)
 {
 	GType gtype = FU_TYPE_FIRMWARE;
 	const gchar *tmp;
-	g_autofree gchar *str = NULL;
 	g_autoptr(FuFirmware) firmware = NULL;
-	g_autoptr(FuFirmware) firmware_dst = NULL;
-	g_autoptr(GBytes) blob_dst = NULL;
-	g_autoptr(GBytes) blob_src = NULL;
 	g_autoptr(XbBuilder) builder = xb_builder_new ();
 	g_autoptr(XbBuilderSource) source = xb_builder_source_new ();
 	g_autoptr(XbNode) n = NULL;
 	g_autoptr(XbSilo) silo = NULL;
 
-	/* check args */
-	if (g_strv_length (values) != 2) {
-		g_set_error_literal (error,
-				     FWUPD_ERROR,
-				     FWUPD_ERROR_INVALID_ARGS,
-				     "Invalid arguments: filename required");
-		return FALSE;
-	}
-
-	/* load file */
-	blob_src = fu_common_get_contents_bytes (values[0], error);
-	if (blob_src == NULL)
-		return FALSE;
-
-	/* load engine */
-	if (!fu_engine_load (priv->engine, FU_ENGINE_LOAD_FLAG_READONLY, error))
-		return FALSE;
-
 	/* parse XML */
 	if (!xb_builder_source_load_bytes (source, blob_src,
 					   XB_BUILDER_SOURCE_FLAG_NONE,
 					   error)) {
 		g_prefix_error (error, "could not parse XML: ");
-		return FALSE;
+		return NULL;
 	}
 	xb_builder_import_source (builder, source);
 	silo = xb_builder_compile (builder, XB_BUILDER_COMPILE_FLAG_NONE, NULL, error);
 	if (silo == NULL)
-		return FALSE;
+		return NULL;
 
 	/* create FuFirmware of specific GType */
 	n = xb_silo_query_first (silo, "firmware", error);
 	if (n == NULL)
-		return FALSE;
+		return NULL;
 	tmp = xb_node_get_attr (n, "gtype");
 	if (tmp != NULL) {
 		gtype = g_type_from_name (tmp);
@@ -2250,7 +2470,7 @@ fu_util_firmware_build (FuUtilPrivate *priv, gchar **values, GError **error)
 				     G_IO_ERROR,
 				     G_IO_ERROR_NOT_FOUND,
 				     "GType %s not registered", tmp);
-			return FALSE;
+			return NULL;
 		}
 	}
 	tmp = xb_node_get_attr (n, "id");
@@ -2261,11 +2481,45 @@ fu_util_firmware_build (FuUtilPrivate *priv, gchar **values, GError **error)
 				     G_IO_ERROR,
 				     G_IO_ERROR_NOT_FOUND,
 				     "GType %s not supported", tmp);
-			return FALSE;
+			return NULL;
 		}
 	}
 	firmware = g_object_new (gtype, NULL);
 	if (!fu_firmware_build (firmware, n, error))
+		return NULL;
+	return g_steal_pointer (&firmware);
+}
+
+static gboolean
+fu_util_firmware_build (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	g_autofree gchar *str = NULL;
+	g_autoptr(FuFirmware) firmware = NULL;
+	g_autoptr(FuFirmware) firmware_dst = NULL;
+	g_autoptr(GBytes) blob_dst = NULL;
+	g_autoptr(GBytes) blob_src = NULL;
+
+	/* check args */
+	if (g_strv_length (values) != 2) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments: filename required");
+		return FALSE;
+	}
+
+	/* load file */
+	blob_src = fu_common_get_contents_bytes (values[0], error);
+	if (blob_src == NULL)
+		return FALSE;
+
+	/* load engine */
+	if (!fu_engine_load (priv->engine, FU_ENGINE_LOAD_FLAG_READONLY, error))
+		return FALSE;
+
+	/* build */
+	firmware = fu_util_firmware_new_from_builder (priv, blob_src, error);
+	if (firmware == NULL)
 		return FALSE;
 
 	/* write new file */
@@ -2276,7 +2530,7 @@ fu_util_firmware_build (FuUtilPrivate *priv, gchar **values, GError **error)
 		return FALSE;
 
 	/* show what we wrote */
-	firmware_dst = g_object_new (gtype, NULL);
+	firmware_dst = g_object_new (G_OBJECT_TYPE (firmware), NULL);
 	if (!fu_firmware_parse (firmware_dst, blob_dst, priv->flags, error))
 		return FALSE;
 	str = fu_firmware_to_string (firmware_dst);
@@ -2286,6 +2540,282 @@ fu_util_firmware_build (FuUtilPrivate *priv, gchar **values, GError **error)
 	return TRUE;
 }
 
+#define FU_UTIL_FIRMWARE_BENCHMARK_ITERATIONS	100
+
+typedef struct {
+	GType		 gtype;
+	guint		 files;
+	gsize		 size;
+	GArray		*parse;		/* element-type gdouble, ms */
+	GArray		*write;		/* element-type gdouble, ms */
+	GArray		*export;	/* element-type gdouble, ms */
+	gsize		 heap;		/* bytes */
+} FuUtilFirmwareBenchmark;
+
+static void
+fu_util_firmware_benchmark_free (FuUtilFirmwareBenchmark *item)
+{
+	g_array_unref (item->parse);
+	g_array_unref (item->write);
+	g_array_unref (item->export);
+	g_free (item);
+}
+
+static gsize
+fu_util_heap_in_use (void)
+{
+#ifdef HAVE_MALLINFO2
+	struct mallinfo2 mi = mallinfo2 ();
+	return mi.uordblks + mi.hblkhd;
+#else
+	return 0;
+#endif
+}
+
+static gint
+fu_util_firmware_benchmark_sort_cb (gconstpointer a, gconstpointer b)
+{
+	gdouble val_a = *((const gdouble *) a);
+	gdouble val_b = *((const gdouble *) b);
+	if (val_a < val_b)
+		return -1;
+	if (val_a > val_b)
+		return 1;
+	return 0;
+}
+
+/* sorts the array in place, where @pct is 50 for the median */
+static gdouble
+fu_util_firmware_benchmark_percentile (GArray *array, guint pct)
+{
+	guint idx;
+	if (array->len == 0)
+		return 0.f;
+	g_array_sort (array, fu_util_firmware_benchmark_sort_cb);
+	idx = MIN ((array->len * pct) / 100, array->len - 1);
+	return g_array_index (array, gdouble, idx);
+}
+
+static gboolean
+fu_util_firmware_benchmark_blob (GHashTable *results, GType gtype, GBytes *blob, GError **error)
+{
+	FuUtilFirmwareBenchmark *item;
+	g_autoptr(GTimer) timer = g_timer_new ();
+
+	item = g_hash_table_lookup (results, GSIZE_TO_POINTER (gtype));
+	if (item == NULL) {
+		item = g_new0 (FuUtilFirmwareBenchmark, 1);
+		item->gtype = gtype;
+		item->parse = g_array_new (FALSE, FALSE, sizeof(gdouble));
+		item->write = g_array_new (FALSE, FALSE, sizeof(gdouble));
+		item->export = g_array_new (FALSE, FALSE, sizeof(gdouble));
+		g_hash_table_insert (results, GSIZE_TO_POINTER (gtype), item);
+	}
+	item->files++;
+	item->size += g_bytes_get_size (blob);
+
+	for (guint i = 0; i < FU_UTIL_FIRMWARE_BENCHMARK_ITERATIONS; i++) {
+		gdouble elapsed;
+		gsize heap = fu_util_heap_in_use ();
+		g_autofree gchar *xml = NULL;
+		g_autoptr(FuFirmware) firmware = g_object_new (gtype, NULL);
+		g_autoptr(GBytes) blob_dst = NULL;
+
+		/* parse, relaxing the same restrictions as the fuzzer */
+		g_timer_reset (timer);
+		if (!fu_firmware_parse (firmware, blob,
+					FWUPD_INSTALL_FLAG_NO_SEARCH |
+					FWUPD_INSTALL_FLAG_IGNORE_VID_PID |
+					FWUPD_INSTALL_FLAG_IGNORE_CHECKSUM,
+					error))
+			return FALSE;
+		elapsed = g_timer_elapsed (timer, NULL) * 1000.f;
+		g_array_append_val (item->parse, elapsed);
+
+		/* only the first iteration, as the allocator caches */
+		if (i == 0) {
+			gsize heap_new = fu_util_heap_in_use ();
+			if (heap_new > heap)
+				item->heap += heap_new - heap;
+		}
+
+		g_timer_reset (timer);
+		blob_dst = fu_firmware_write (firmware, error);
+		if (blob_dst == NULL)
+			return FALSE;
+		elapsed = g_timer_elapsed (timer, NULL) * 1000.f;
+		g_array_append_val (item->write, elapsed);
+
+		g_timer_reset (timer);
+		xml = fu_firmware_export_to_xml (firmware, FU_FIRMWARE_EXPORT_FLAG_NONE, error);
+		if (xml == NULL)
+			return FALSE;
+		elapsed = g_timer_elapsed (timer, NULL) * 1000.f;
+		g_array_append_val (item->export, elapsed);
+	}
+
+	/* success */
+	return TRUE;
+}
+
+static gint
+fu_util_firmware_benchmark_sort_name_cb (gconstpointer a, gconstpointer b)
+{
+	FuUtilFirmwareBenchmark *item1 = *((FuUtilFirmwareBenchmark **) a);
+	FuUtilFirmwareBenchmark *item2 = *((FuUtilFirmwareBenchmark **) b);
+	return g_strcmp0 (g_type_name (item1->gtype), g_type_name (item2->gtype));
+}
+
+static gboolean
+fu_util_firmware_benchmark (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	g_autoptr(GArray) gtypes = NULL;
+	g_autoptr(GHashTable) results = NULL;
+	g_autoptr(GList) items = NULL;
+	g_autoptr(GPtrArray) array = g_ptr_array_new ();
+	g_autoptr(GPtrArray) builders = NULL;
+
+	/* load engine */
+	if (!fu_engine_load (priv->engine, FU_ENGINE_LOAD_FLAG_READONLY, error))
+		return FALSE;
+	results = g_hash_table_new_full (g_direct_hash, g_direct_equal,
+					 NULL, (GDestroyNotify) fu_util_firmware_benchmark_free);
+
+	/* the fuzzing corpus is only available in the source tree */
+	if (g_file_test (FWUPD_FUZZINGSRCDIR, G_FILE_TEST_IS_DIR)) {
+		builders = fu_common_filename_glob (FWUPD_FUZZINGSRCDIR, "*.builder.xml", error);
+		if (builders == NULL)
+			return FALSE;
+	} else {
+		g_debug ("no fuzzing corpus in %s", FWUPD_FUZZINGSRCDIR);
+	}
+	for (guint i = 0; builders != NULL && i < builders->len; i++) {
+		const gchar *filename = g_ptr_array_index (builders, i);
+		g_autoptr(FuFirmware) firmware = NULL;
+		g_autoptr(GBytes) blob = NULL;
+		g_autoptr(GBytes) blob_src = NULL;
+		g_autoptr(GError) error_local = NULL;
+
+		blob_src = fu_common_get_contents_bytes (filename, error);
+		if (blob_src == NULL)
+			return FALSE;
+		firmware = fu_util_firmware_new_from_builder (priv, blob_src, &error_local);
+		if (firmware == NULL) {
+			g_debug ("ignoring %s: %s", filename, error_local->message);
+			continue;
+		}
+		blob = fu_firmware_write (firmware, error);
+		if (blob == NULL)
+			return FALSE;
+		if (!fu_util_firmware_benchmark_blob (results, G_OBJECT_TYPE (firmware),
+						      blob, error)) {
+			g_prefix_error (error, "failed to benchmark %s: ", filename);
+			return FALSE;
+		}
+	}
+
+	/* any extra directories, detecting the type from the magic */
+	gtypes = fu_util_get_firmware_gtypes_with_magic (priv);
+	for (guint j = 0; values[j] != NULL; j++) {
+		g_autoptr(GPtrArray) filenames = NULL;
+		filenames = fu_common_filename_glob (values[j], "*", error);
+		if (filenames == NULL)
+			return FALSE;
+		for (guint i = 0; i < filenames->len; i++) {
+			const gchar *filename = g_ptr_array_index (filenames, i);
+			g_autoptr(FuFirmware) firmware = NULL;
+			g_autoptr(GBytes) blob = NULL;
+			g_autoptr(GError) error_local = NULL;
+
+			if (!g_file_test (filename, G_FILE_TEST_IS_REGULAR))
+				continue;
+			blob = fu_common_get_contents_bytes (filename, error);
+			if (blob == NULL)
+				return FALSE;
+			firmware = fu_firmware_new_from_gtype_array (blob, gtypes,
+								     priv->flags,
+								     &error_local);
+			if (firmware == NULL) {
+				g_debug ("ignoring %s: %s", filename, error_local->message);
+				continue;
+			}
+			if (!fu_util_firmware_benchmark_blob (results, G_OBJECT_TYPE (firmware),
+							      blob, error)) {
+				g_prefix_error (error, "failed to benchmark %s: ", filename);
+				return FALSE;
+			}
+		}
+	}
+
+	/* sort by type name so that the output can be compared */
+	items = g_hash_table_get_values (results);
+	for (GList *l = items; l != NULL; l = l->next)
+		g_ptr_array_add (array, l->data);
+	g_ptr_array_sort (array, fu_util_firmware_benchmark_sort_name_cb);
+	if (priv->as_json) {
+		g_autofree gchar *data = NULL;
+		g_autoptr(JsonBuilder) builder = json_builder_new ();
+		g_autoptr(JsonGenerator) json_generator = json_generator_new ();
+		g_autoptr(JsonNode) json_root = NULL;
+
+		json_builder_begin_object (builder);
+		json_builder_set_member_name (builder, "FirmwareBenchmark");
+		json_builder_begin_array (builder);
+		for (guint i = 0; i < array->len; i++) {
+			FuUtilFirmwareBenchmark *item = g_ptr_array_index (array, i);
+			json_builder_begin_object (builder);
+			json_builder_set_member_name (builder, "GType");
+			json_builder_add_string_value (builder, g_type_name (item->gtype));
+			json_builder_set_member_name (builder, "Files");
+			json_builder_add_int_value (builder, item->files);
+			json_builder_set_member_name (builder, "Size");
+			json_builder_add_int_value (builder, item->size);
+			json_builder_set_member_name (builder, "Iterations");
+			json_builder_add_int_value (builder, item->parse->len);
+#ifdef HAVE_MALLINFO2
+			json_builder_set_member_name (builder, "HeapBytes");
+			json_builder_add_int_value (builder, item->heap);
+#endif
+			json_builder_set_member_name (builder, "ParseMedian");
+			json_builder_add_double_value (builder, fu_util_firmware_benchmark_percentile (item->parse, 50));
+			json_builder_set_member_name (builder, "ParseP99");
+			json_builder_add_double_value (builder, fu_util_firmware_benchmark_percentile (item->parse, 99));
+			json_builder_set_member_name (builder, "WriteMedian");
+			json_builder_add_double_value (builder, fu_util_firmware_benchmark_percentile (item->write, 50));
+			json_builder_set_member_name (builder, "WriteP99");
+			json_builder_add_double_value (builder, fu_util_firmware_benchmark_percentile (item->write, 99));
+			json_builder_set_member_name (builder, "ExportMedian");
+			json_builder_add_double_value (builder, fu_util_firmware_benchmark_percentile (item->export, 50));
+			json_builder_set_member_name (builder, "ExportP99");
+			json_builder_add_double_value (builder, fu_util_firmware_benchmark_percentile (item->export, 99));
+			json_builder_end_object (builder);
+		}
+		json_builder_end_array (builder);
+		json_builder_end_object (builder);
+		json_root = json_builder_get_root (builder);
+		json_generator_set_pretty (json_generator, TRUE);
+		json_generator_set_root (json_generator, json_root);
+		data = json_generator_to_data (json_generator, NULL);
+		g_print ("%s\n", data);
+		return TRUE;
+	}
+
+	/* human readable, in ms */
+	for (guint i = 0; i < array->len; i++) {
+		FuUtilFirmwareBenchmark *item = g_ptr_array_index (array, i);
+		g_print ("%s: parse %.3f/%.3fms write %.3f/%.3fms export %.3f/%.3fms heap %" G_GSIZE_FORMAT "\n",
+			 g_type_name (item->gtype),
+			 fu_util_firmware_benchmark_percentile (item->parse, 50),
+			 fu_util_firmware_benchmark_percentile (item->parse, 99),
+			 fu_util_firmware_benchmark_percentile (item->write, 50),
+			 fu_util_firmware_benchmark_percentile (item->write, 99),
+			 fu_util_firmware_benchmark_percentile (item->export, 50),
+			 fu_util_firmware_benchmark_percentile (item->export, 99),
+			 item->heap);
+	}
+	return TRUE;
+}
+
 static gboolean
 fu_util_firmware_convert (FuUtilPrivate *priv, gchar **values, GError **error)
 {
@@ -2346,6 +2876,8 @@ fu_util_firmware_convert (FuUtilPrivate *priv, gchar **values, GError **error)
 	firmware_src = g_object_new (gtype_src, NULL);
 	if (!fu_firmware_parse (firmware_src, blob_src, priv->flags, error))
 		return FALSE;
+	if (!fu_firmware_check (firmware_src, error))
+		return FALSE;
 	gtype_dst = fu_context_get_firmware_gtype_by_id (ctx, firmware_type_dst);
 	if (gtype_dst == G_TYPE_INVALID) {
 		g_set_error (error,
@@ -2649,6 +3181,18 @@ fu_util_security (FuUtilPrivate *priv, gchar **values, GError **error)
 	items = fu_security_attrs_get_all (attrs);
 	str = fu_util_security_attrs_to_string (items, flags);
 	g_print ("%s\n", str);
+
+	/* show how long each plugin and device took */
+	if (priv->show_all) {
+		g_autoptr(GHashTable) timings = fu_engine_get_host_security_timings (priv->engine);
+		g_autoptr(GList) ids = g_hash_table_get_keys (timings);
+		ids = g_list_sort (ids, (GCompareFunc) g_strcmp0);
+		for (GList *l = ids; l != NULL; l = l->next) {
+			const gchar *id = l->data;
+			guint elapsed = GPOINTER_TO_UINT (g_hash_table_lookup (timings, id));
+			g_print ("%s: %.2fms\n", id, (gdouble) elapsed / 1000.f);
+		}
+	}
 	return TRUE;
 }
 
@@ -2967,6 +3511,9 @@ main (int argc, char *argv[])
 		{ "enable-json-state", '\0', 0, G_OPTION_ARG_NONE, &priv->enable_json_state,
 			/* TRANSLATORS: command line option */
 			_("Save device state into a JSON file between executions"), NULL },
+		{ "json", '\0', 0, G_OPTION_ARG_NONE, &priv->as_json,
+			/* TRANSLATORS: command line option */
+			_("Output in JSON format"), NULL },
 		{ "disable-ssl-strict", '\0', 0, G_OPTION_ARG_NONE, &priv->disable_ssl_strict,
 			/* TRANSLATORS: command line option */
 			_("Ignore SSL strict checks when downloading files"), NULL },
@@ -3188,10 +3735,17 @@ main (int argc, char *argv[])
 	fu_util_cmd_array_add (cmd_array,
 		     "firmware-parse",
 		     /* TRANSLATORS: command argument: uppercase, spaces->dashes */
-		     _("FILENAME [FIRMWARE-TYPE]"),
+		     _("FILENAME|DIRECTORY [FIRMWARE-TYPE]"),
 		     /* TRANSLATORS: command description */
 		     _("Parse and show details about a firmware file"),
 		     fu_util_firmware_parse);
+	fu_util_cmd_array_add (cmd_array,
+		     "firmware-benchmark",
+		     /* TRANSLATORS: command argument: uppercase, spaces->dashes */
+		     _("[DIRECTORY...]"),
+		     /* TRANSLATORS: command description */
+		     _("Benchmark parsing, writing and exporting firmware"),
+		     fu_util_firmware_benchmark);
 	fu_util_cmd_array_add (cmd_array,
 		     "firmware-export",
 		     /* TRANSLATORS: command argument: uppercase, spaces->dashes */
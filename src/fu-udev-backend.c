@@ -10,6 +10,8 @@
 
 #include <gudev/gudev.h>
 
+#include "fu-device-private.h"
+#include "fu-quirks.h"
 #include "fu-udev-device.h"
 #include "fu-udev-backend.h"
 
@@ -25,12 +27,239 @@ G_DEFINE_TYPE (FuUdevBackend, fu_udev_backend, FU_TYPE_BACKEND)
 static void
 fu_udev_backend_device_add (FuUdevBackend *self, GUdevDevice *udev_device)
 {
+	FuContext *ctx = fu_backend_get_context (FU_BACKEND (self));
 	g_autoptr(FuUdevDevice) device = fu_udev_device_new (udev_device);
+	g_autoptr(GError) error_local = NULL;
+	g_autoptr(GPtrArray) possible_plugins = NULL;
+
+	/* the quirks are required to get the possible plugins; this uses the
+	 * shared GUdevClient and FuQuirks so has to be done on the main thread */
+	fu_device_set_context (FU_DEVICE (device), ctx);
+	if (!fu_device_probe (FU_DEVICE (device), &error_local)) {
+		g_warning ("failed to probe device %s: %s",
+			   g_udev_device_get_sysfs_path (udev_device),
+			   error_local->message);
+		return;
+	}
+
+	/* no plugin declared support in a quirk, so nothing would use it */
+	possible_plugins = fu_device_get_possible_plugins (FU_DEVICE (device));
+	if (possible_plugins->len == 0) {
+		if (g_getenv ("FWUPD_PROBE_VERBOSE") != NULL) {
+			g_debug ("UDEV %s ignored as no possible plugins",
+				 g_udev_device_get_sysfs_path (udev_device));
+		}
+		return;
+	}
 
 	/* success */
 	fu_backend_device_added (FU_BACKEND (self), FU_DEVICE (device));
 }
 
+/* values needed to build the udev instance IDs; the GUdevDevice is only used
+ * on the main thread, and the sysfs values are read by the worker pool using
+ * plain file I/O so that no GUdev, libudev or FuQuirks state is shared */
+typedef struct {
+	GUdevDevice	*udev_device;
+	gchar		*sysfs_path;
+	gchar		*subsystem;
+	gchar		*driver;
+	gchar		*hid_id;
+	gchar		*serio_fwid;
+	gchar		*class_id;
+	guint64		 vendor;
+	guint64		 model;
+	guint64		 revision;
+	guint64		 subsystem_vendor;
+	guint64		 subsystem_model;
+} FuUdevBackendProbeItem;
+
+static void
+fu_udev_backend_probe_item_free (FuUdevBackendProbeItem *item)
+{
+	g_object_unref (item->udev_device);
+	g_free (item->sysfs_path);
+	g_free (item->subsystem);
+	g_free (item->driver);
+	g_free (item->hid_id);
+	g_free (item->serio_fwid);
+	g_free (item->class_id);
+	g_free (item);
+}
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC(FuUdevBackendProbeItem, fu_udev_backend_probe_item_free)
+
+/* main thread only */
+static FuUdevBackendProbeItem *
+fu_udev_backend_probe_item_new (GUdevDevice *udev_device)
+{
+	FuUdevBackendProbeItem *item = g_new0 (FuUdevBackendProbeItem, 1);
+	item->udev_device = g_object_ref (udev_device);
+	item->sysfs_path = g_strdup (g_udev_device_get_sysfs_path (udev_device));
+	item->subsystem = g_strdup (g_udev_device_get_subsystem (udev_device));
+	item->driver = g_strdup (g_udev_device_get_driver (udev_device));
+	if (g_strcmp0 (item->subsystem, "hidraw") == 0) {
+		g_autoptr(GUdevDevice) udev_parent = g_udev_device_get_parent (udev_device);
+		if (udev_parent != NULL)
+			item->hid_id = g_strdup (g_udev_device_get_property (udev_parent, "HID_ID"));
+	}
+	if (g_strcmp0 (item->subsystem, "serio") == 0)
+		item->serio_fwid = g_strdup (g_udev_device_get_property (udev_device, "SERIO_FIRMWARE_ID"));
+	return item;
+}
+
+/* safe to call from any thread */
+static gchar *
+fu_udev_backend_probe_item_read_attr (FuUdevBackendProbeItem *item, const gchar *name)
+{
+	gchar *buf = NULL;
+	g_autofree gchar *fn = g_build_filename (item->sysfs_path, name, NULL);
+	if (!g_file_get_contents (fn, &buf, NULL, NULL))
+		return NULL;
+	return g_strchomp (buf);
+}
+
+/* safe to call from any thread */
+static guint64
+fu_udev_backend_probe_item_read_attr_uint (FuUdevBackendProbeItem *item, const gchar *name)
+{
+	g_autofree gchar *tmp = fu_udev_backend_probe_item_read_attr (item, name);
+	return fu_common_strtoull (tmp);
+}
+
+/* runs in the worker pool */
+static void
+fu_udev_backend_probe_item_cb (gpointer data, gpointer user_data)
+{
+	FuUdevBackendProbeItem *item = (FuUdevBackendProbeItem *) data;
+	if (item->sysfs_path == NULL)
+		return;
+	item->vendor = fu_udev_backend_probe_item_read_attr_uint (item, "vendor");
+	item->model = fu_udev_backend_probe_item_read_attr_uint (item, "device");
+	item->revision = fu_udev_backend_probe_item_read_attr_uint (item, "revision");
+	item->subsystem_vendor = fu_udev_backend_probe_item_read_attr_uint (item, "subsystem_vendor");
+	item->subsystem_model = fu_udev_backend_probe_item_read_attr_uint (item, "subsystem_device");
+	item->class_id = fu_udev_backend_probe_item_read_attr (item, "class");
+}
+
+static gboolean
+fu_udev_backend_probe_item_has_quirk (FuUdevBackend *self, const gchar *instance_id)
+{
+	FuContext *ctx = fu_backend_get_context (FU_BACKEND (self));
+	g_autofree gchar *guid = fwupd_guid_hash_string (instance_id);
+
+	/* a Guid quirk can cascade to an entry that sets the plugin */
+	if (fu_context_lookup_quirk_by_id (ctx, guid, FU_QUIRKS_PLUGIN) != NULL)
+		return TRUE;
+	if (fu_context_lookup_quirk_by_id (ctx, guid, FU_QUIRKS_GUID) != NULL)
+		return TRUE;
+	return FALSE;
+}
+
+/* builds the same instance IDs as fu_udev_device_probe() without creating a
+ * FuUdevDevice, returning %FALSE only when no quirk could set a plugin */
+static gboolean
+fu_udev_backend_probe_item_has_plugin (FuUdevBackend *self, FuUdevBackendProbeItem *item)
+{
+	guint64 vendor = item->vendor;
+	guint64 model = item->model;
+	g_autofree gchar *subsystem = NULL;
+	g_autoptr(GPtrArray) instance_ids = g_ptr_array_new_with_free_func (g_free);
+
+	/* the net subsystem uses the parent device, and overflowed values are
+	 * clamped by the probe, so leave these to fu_device_probe() */
+	if (item->subsystem == NULL || g_strcmp0 (item->subsystem, "net") == 0)
+		return TRUE;
+	if (vendor > G_MAXUINT32 || model > G_MAXUINT32 ||
+	    item->revision > G_MAXUINT8 ||
+	    item->subsystem_vendor > G_MAXUINT32 ||
+	    item->subsystem_model > G_MAXUINT32)
+		return TRUE;
+
+	/* hidraw encodes the information in the parent */
+	if (vendor == 0x0 && model == 0x0 && item->revision == 0x0 &&
+	    item->hid_id != NULL) {
+		g_auto(GStrv) split = g_strsplit (item->hid_id, ":", -1);
+		if (g_strv_length (split) == 3) {
+			vendor = g_ascii_strtoull (split[1], NULL, 16);
+			model = g_ascii_strtoull (split[2], NULL, 16);
+			if (vendor > G_MAXUINT32 || model > G_MAXUINT32)
+				return TRUE;
+		}
+	}
+
+	subsystem = g_ascii_strup (item->subsystem, -1);
+	if (vendor != 0x0000 && model != 0x0000 &&
+	    item->subsystem_vendor != 0x0000 && item->subsystem_model != 0x0000) {
+		g_ptr_array_add (instance_ids,
+				 g_strdup_printf ("%s\\VEN_%04X&DEV_%04X&SUBSYS_%04X%04X&REV_%02X",
+						  subsystem, (guint) vendor, (guint) model,
+						  (guint) item->subsystem_vendor,
+						  (guint) item->subsystem_model,
+						  (guint) item->revision));
+		g_ptr_array_add (instance_ids,
+				 g_strdup_printf ("%s\\VEN_%04X&DEV_%04X&SUBSYS_%04X%04X",
+						  subsystem, (guint) vendor, (guint) model,
+						  (guint) item->subsystem_vendor,
+						  (guint) item->subsystem_model));
+	}
+	if (vendor != 0x0000 && model != 0x0000) {
+		g_ptr_array_add (instance_ids,
+				 g_strdup_printf ("%s\\VEN_%04X&DEV_%04X&REV_%02X",
+						  subsystem, (guint) vendor, (guint) model,
+						  (guint) item->revision));
+		g_ptr_array_add (instance_ids,
+				 g_strdup_printf ("%s\\VEN_%04X&DEV_%04X",
+						  subsystem, (guint) vendor, (guint) model));
+	}
+	if (vendor != 0x0000) {
+		g_ptr_array_add (instance_ids,
+				 g_strdup_printf ("%s\\VEN_%04X", subsystem, (guint) vendor));
+	}
+	if (item->class_id != NULL && g_str_has_prefix (item->class_id, "0x")) {
+		g_autofree gchar *class_id = g_utf8_strup (item->class_id + 2, -1);
+		g_ptr_array_add (instance_ids,
+				 g_strdup_printf ("%s\\VEN_%04X&CLASS_%s",
+						  subsystem, (guint) vendor, class_id));
+	}
+	if (item->driver != NULL) {
+		g_ptr_array_add (instance_ids,
+				 g_strdup_printf ("%s\\DRIVER_%s", subsystem, item->driver));
+	}
+	g_ptr_array_add (instance_ids, g_strdup (subsystem));
+	if (item->serio_fwid != NULL) {
+		const gchar *tmp = item->serio_fwid;
+		g_autofree gchar *id_safe = NULL;
+		if (g_str_has_prefix (tmp, "PNP: "))
+			tmp += 5;
+		id_safe = g_utf8_strup (tmp, -1);
+		g_strdelimit (id_safe, " /\\\"", '-');
+		g_ptr_array_add (instance_ids, g_strdup_printf ("SERIO\\FWID_%s", id_safe));
+	}
+
+	/* any quirk that could set the possible plugin */
+	for (guint i = 0; i < instance_ids->len; i++) {
+		const gchar *instance_id = g_ptr_array_index (instance_ids, i);
+		if (fu_udev_backend_probe_item_has_quirk (self, instance_id))
+			return TRUE;
+	}
+	return FALSE;
+}
+
+static void
+fu_udev_backend_device_add_item (FuUdevBackend *self, FuUdevBackendProbeItem *item)
+{
+	/* no plugin declared support in a quirk, so do not create the device */
+	if (!fu_udev_backend_probe_item_has_plugin (self, item)) {
+		if (g_getenv ("FWUPD_PROBE_VERBOSE") != NULL) {
+			g_debug ("UDEV %s ignored as no quirk sets a plugin",
+				 item->sysfs_path);
+		}
+		return;
+	}
+	fu_udev_backend_device_add (self, item->udev_device);
+}
+
 static void
 fu_udev_backend_device_remove (FuUdevBackend *self, GUdevDevice *udev_device)
 {
@@ -114,7 +343,9 @@ fu_udev_backend_uevent_cb (GUdevClient *gudev_client,
 			   FuUdevBackend *self)
 {
 	if (g_strcmp0 (action, "add") == 0) {
-		fu_udev_backend_device_add (self, udev_device);
+		g_autoptr(FuUdevBackendProbeItem) item = fu_udev_backend_probe_item_new (udev_device);
+		fu_udev_backend_probe_item_cb (item, NULL);
+		fu_udev_backend_device_add_item (self, item);
 		return;
 	}
 	if (g_strcmp0 (action, "remove") == 0) {
@@ -127,6 +358,36 @@ fu_udev_backend_uevent_cb (GUdevClient *gudev_client,
 	}
 }
 
+/* reads the sysfs attributes of the whole batch in parallel; the pool only
+ * uses plain file I/O and never touches GUdev or FuQuirks */
+static void
+fu_udev_backend_probe_items (GPtrArray *items)
+{
+	GThreadPool *pool;
+	g_autoptr(GError) error_local = NULL;
+
+	pool = g_thread_pool_new (fu_udev_backend_probe_item_cb, NULL,
+				  (gint) MIN (g_get_num_processors (), items->len),
+				  FALSE, &error_local);
+	if (pool == NULL) {
+		g_debug ("failed to create thread pool, probing serially: %s",
+			 error_local->message);
+		for (guint i = 0; i < items->len; i++)
+			fu_udev_backend_probe_item_cb (g_ptr_array_index (items, i), NULL);
+		return;
+	}
+	for (guint i = 0; i < items->len; i++) {
+		if (!g_thread_pool_push (pool, g_ptr_array_index (items, i), &error_local)) {
+			g_debug ("failed to push to thread pool: %s", error_local->message);
+			g_clear_error (&error_local);
+			fu_udev_backend_probe_item_cb (g_ptr_array_index (items, i), NULL);
+		}
+	}
+
+	/* wait for all the items to be processed */
+	g_thread_pool_free (pool, FALSE, TRUE);
+}
+
 static gboolean
 fu_udev_backend_coldplug (FuBackend *backend, GError **error)
 {
@@ -144,21 +405,31 @@ fu_udev_backend_coldplug (FuBackend *backend, GError **error)
 				  G_CALLBACK (fu_udev_backend_uevent_cb), self);
 	}
 
-	/* get all devices of class */
+	/* get all devices of class, one batch per subsystem */
 	for (guint i = 0; i < self->subsystems->len; i++) {
 		const gchar *subsystem = g_ptr_array_index (self->subsystems, i);
 		GList *devices = g_udev_client_query_by_subsystem (self->gudev_client,
 								   subsystem);
+		g_autoptr(GPtrArray) items = NULL;
+
 		if (g_getenv ("FWUPD_PROBE_VERBOSE") != NULL) {
 			g_debug ("%u devices with subsystem %s",
 				 g_list_length (devices), subsystem);
 		}
+		items = g_ptr_array_new_with_free_func ((GDestroyNotify) fu_udev_backend_probe_item_free);
 		for (GList *l = devices; l != NULL; l = l->next) {
 			GUdevDevice *udev_device = l->data;
-			fu_udev_backend_device_add (self, udev_device);
+			g_ptr_array_add (items, fu_udev_backend_probe_item_new (udev_device));
 		}
 		g_list_foreach (devices, (GFunc) g_object_unref, NULL);
 		g_list_free (devices);
+		if (items->len == 0)
+			continue;
+		fu_udev_backend_probe_items (items);
+
+		/* filter and add on the main thread in enumeration order */
+		for (guint j = 0; j < items->len; j++)
+			fu_udev_backend_device_add_item (self, g_ptr_array_index (items, j));
 	}
 
 	return TRUE;
@@ -193,10 +464,14 @@ fu_udev_backend_class_init (FuUdevBackendClass *klass)
 }
 
 FuBackend *
-fu_udev_backend_new (GPtrArray	*subsystems)
+fu_udev_backend_new (FuContext *ctx)
 {
 	FuUdevBackend *self;
-	self = FU_UDEV_BACKEND (g_object_new (FU_TYPE_UDEV_BACKEND, "name", "udev", NULL));
+	GPtrArray *subsystems = fu_context_get_udev_subsystems (ctx);
+	self = FU_UDEV_BACKEND (g_object_new (FU_TYPE_UDEV_BACKEND,
+					      "name", "udev",
+					      "context", ctx,
+					      NULL));
 	if (subsystems != NULL)
 		self->subsystems = g_ptr_array_ref (subsystems);
 	return FU_BACKEND (self);
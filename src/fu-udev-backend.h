@@ -11,4 +11,4 @@
 #define FU_TYPE_UDEV_BACKEND (fu_udev_backend_get_type ())
 G_DECLARE_FINAL_TYPE (FuUdevBackend, fu_udev_backend, FU, UDEV_BACKEND, FuBackend)
 
-FuBackend	*fu_udev_backend_new		(GPtrArray	*subsystems);
+FuBackend	*fu_udev_backend_new		(FuContext	*ctx);
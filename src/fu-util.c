@@ -943,6 +943,34 @@ fu_util_clear_results (FuUtilPrivate *priv, gchar **values, GError **error)
 	return fwupd_client_clear_results (priv->client, fwupd_device_get_id (dev), NULL, error);
 }
 
+static gboolean
+fu_util_cache_prune (FuUtilPrivate *priv, gchar **values, GError **error)
+{
+	guint64 max_size = 0;
+
+	/* optional size in MB to keep */
+	if (g_strv_length (values) > 1) {
+		g_set_error_literal (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid arguments");
+		return FALSE;
+	}
+	if (g_strv_length (values) == 1) {
+		gchar *endptr = NULL;
+		max_size = g_ascii_strtoull (values[0], &endptr, 10);
+		if (endptr == values[0] || *endptr != '\0' || max_size > G_MAXUINT64 / 0x100000) {
+			g_set_error (error,
+				     FWUPD_ERROR,
+				     FWUPD_ERROR_INVALID_ARGS,
+				     "Invalid size: %s", values[0]);
+			return FALSE;
+		}
+		max_size *= 0x100000;
+	}
+	return fwupd_client_download_cache_prune (max_size, error);
+}
+
 static gboolean
 fu_util_clear_offline (FuUtilPrivate *priv, gchar **values, GError **error)
 {
@@ -1072,8 +1100,12 @@ fu_util_download_metadata (FuUtilPrivate *priv, GError **error)
 			continue;
 		download_remote_enabled = TRUE;
 		g_print ("%s %s\n", _("Updating"), fwupd_remote_get_id (remote));
-		if (!fwupd_client_refresh_remote (priv->client, remote,
-						  priv->cancellable, error))
+	}
+
+	/* all at the same time */
+	if (download_remote_enabled) {
+		if (!fwupd_client_refresh_remotes (priv->client, remotes,
+						   priv->cancellable, error))
 			return FALSE;
 	}
 
@@ -2927,6 +2959,13 @@ main (int argc, char *argv[])
 		     /* TRANSLATORS: command description */
 		     _("Clears the results from the last update"),
 		     fu_util_clear_results);
+	fu_util_cmd_array_add (cmd_array,
+		     "cache-prune",
+		     /* TRANSLATORS: command argument: uppercase, spaces->dashes */
+		     _("[SIZE-MB]"),
+		     /* TRANSLATORS: command description */
+		     _("Removes downloaded firmware from the cache"),
+		     fu_util_cache_prune);
 	fu_util_cmd_array_add (cmd_array,
 		     "clear-offline",
 		     NULL,